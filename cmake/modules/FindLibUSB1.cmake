@@ -0,0 +1,80 @@
+# - Find libusb-1.0 for asynchronous USB support
+# This module will find libusb-1.0 as published by
+#  http://libusb.sf.net
+# 
+# It will use PkgConfig if present and supported, else search
+# it on its own. If the LibUSB1_ROOT_DIR environment variable
+# is defined, it will be used as base path.
+# The following standard variables get defined:
+#  LibUSB1_FOUND:        true if libusb-1.0 was found
+#  LibUSB1_INCLUDE_DIRS: the directory that contains the include file
+#  LibUSB1_LIBRARIES:    the library
+
+include ( CheckLibraryExists )
+include ( CheckIncludeFile )
+
+find_package ( PkgConfig )
+if ( PKG_CONFIG_FOUND )
+  pkg_check_modules ( PKGCONFIG_LIBUSB1 libusb-1.0 )
+endif ( PKG_CONFIG_FOUND )
+
+if ( PKGCONFIG_LIBUSB1_FOUND )
+  set ( LibUSB1_FOUND ${PKGCONFIG_LIBUSB1_FOUND} )
+  set ( LibUSB1_INCLUDE_DIRS ${PKGCONFIG_LIBUSB1_INCLUDE_DIRS} )
+  foreach ( i ${PKGCONFIG_LIBUSB1_LIBRARIES} )
+    find_library ( ${i}_LIBRARY
+      NAMES ${i}
+      PATHS ${PKGCONFIG_LIBUSB1_LIBRARY_DIRS}
+    )
+    if ( ${i}_LIBRARY )
+      list ( APPEND LibUSB1_LIBRARIES ${${i}_LIBRARY} )
+    endif ( ${i}_LIBRARY )
+    mark_as_advanced ( ${i}_LIBRARY )
+  endforeach ( i )
+
+else ( PKGCONFIG_LIBUSB1_FOUND )
+  find_path ( LibUSB1_INCLUDE_DIRS
+    NAMES
+      libusb.h
+    PATHS
+      $ENV{LibUSB1_ROOT_DIR}
+    PATH_SUFFIXES
+      include
+      include/libusb-1.0
+  )
+  mark_as_advanced ( LibUSB1_INCLUDE_DIRS )
+
+  find_library ( usb-1.0_LIBRARY
+    NAMES
+      usb-1.0
+    PATHS
+      $ENV{LibUSB1_ROOT_DIR}
+    PATH_SUFFIXES
+      lib
+  )
+  mark_as_advanced ( usb-1.0_LIBRARY )
+  if ( usb-1.0_LIBRARY )
+    set ( LibUSB1_LIBRARIES ${usb-1.0_LIBRARY} )
+  endif ( usb-1.0_LIBRARY )
+
+  if ( LibUSB1_INCLUDE_DIRS AND LibUSB1_LIBRARIES )
+    set ( LibUSB1_FOUND true )
+  endif ( LibUSB1_INCLUDE_DIRS AND LibUSB1_LIBRARIES )
+endif ( PKGCONFIG_LIBUSB1_FOUND )
+
+if ( LibUSB1_FOUND )
+  set ( CMAKE_REQUIRED_INCLUDES "${LibUSB1_INCLUDE_DIRS}" )
+  check_include_file ( libusb.h LibUSB1_FOUND )
+endif ( LibUSB1_FOUND )
+if ( LibUSB1_FOUND )
+  check_library_exists ( "${LibUSB1_LIBRARIES}" libusb_submit_transfer "" LibUSB1_FOUND )
+endif ( LibUSB1_FOUND )
+
+if ( NOT LibUSB1_FOUND )
+  if ( NOT LibUSB1_FIND_QUIETLY )
+    message ( STATUS "libusb-1.0 not found, try setting LibUSB1_ROOT_DIR environment variable." )
+  endif ( NOT LibUSB1_FIND_QUIETLY )
+  if ( LibUSB1_FIND_REQUIRED )
+    message ( FATAL_ERROR "" )
+  endif ( LibUSB1_FIND_REQUIRED )
+endif ( NOT LibUSB1_FOUND )
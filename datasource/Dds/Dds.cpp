@@ -47,6 +47,8 @@ ControlDialog::ControlDialog(QWidget *parent) : QWidget(parent)
   ready = false;
   freqA = 100 ;
   freqB =  10;
+  waveA = 0;
+  waveB = 0;
   
   QHBoxLayout *layout = new QHBoxLayout(this);
  
@@ -62,6 +64,7 @@ ControlDialog::ControlDialog(QWidget *parent) : QWidget(parent)
   waveTypeA->addItem( tr( "Sine" ) );
   waveTypeA->addItem( tr( "Square" ) );
   waveTypeA->addItem( tr( "Triangular" ) );
+  connect(waveTypeA, SIGNAL(currentIndexChanged(int)), this, SLOT(waveAsetValue(int)));
   layoutChannelA->addWidget(waveTypeA);
 
   layoutChannelA->addWidget(new QLabel(tr("Amplitude")));
@@ -106,6 +109,7 @@ ControlDialog::ControlDialog(QWidget *parent) : QWidget(parent)
   waveTypeB->addItem( tr( "Sine" ) );
   waveTypeB->addItem( tr( "Square" ) );
   waveTypeB->addItem( tr( "Triangular" ) );
+  connect(waveTypeB, SIGNAL(currentIndexChanged(int)), this, SLOT(waveBsetValue(int)));
   layoutChannelB->addWidget(waveTypeB);
 
   layoutChannelB->addWidget(new QLabel(tr("Amplitude")));
@@ -183,6 +187,14 @@ void ControlDialog::noiseSetValue(int val){
   noise = (val+1)/100.0;
 }
 
+void ControlDialog::waveAsetValue(int val){
+  waveA = val;
+}
+
+void ControlDialog::waveBsetValue(int val){
+  waveB = val;
+}
+
 void ControlDialog::ampAsetValue(int val){
   ampA = (val+1)/100.0;
 }
@@ -230,42 +242,45 @@ DataSource *DdsDataSourceDescription::create() const
 
 
 DdsDataSource::DdsDataSource(const DataSourceDescription *description) :
-	DataSource(description)
+	DataSource(description),
+	pacer(100000)
 {
   	cDialog = new ControlDialog;
         cDialog->show();
 
         c0 = new signed short[512];
         c1 = new signed short[512];
-
-	t = 0;
 }
 
 unsigned DdsDataSource::getRawData(std::valarray<std::valarray<signed short> > *data)
 {
 
    if(!cDialog->ready){
-     return 100000;
+     for (size_t channel = 0; channel < 2; channel++)
+       (*data)[channel] = 0;
+     pacer.wait();
+     return 0;
    }
 
       int inputs = inputCount();
-      float freqA =  M_PI * cDialog->freqA / 100.0;
-      float freqB = M_PI * cDialog->freqB / 100.0;
-      float ampA = unitPerVoltCount() * cDialog->ampA;
-      float ampB = unitPerVoltCount() * cDialog->ampB;
-      int offsetA = cDialog->offsetA * unitPerVoltCount()  / 100;
-      int offsetB = cDialog->offsetB * unitPerVoltCount()  / 100;
       float noise =  unitPerVoltCount() * cDialog->noise;
 
       Q_ASSERT(data->size() >= inputs);
 
-      for (size_t sample = 0; sample < 512; sample++){
-         c0[sample] = 
-           (signed short)(ampA * sin( t *  freqA )) + offsetA + (signed short)(noise * ((float)rand()/RAND_MAX - 0.5));
-         c1[sample] =
-           (signed short)(ampB * sin( t *  freqB )) + offsetB + (signed short)(noise * ((float)rand()/RAND_MAX - 0.5));
-          t++;
-      }
+      /* oscillators only rebuild their wavetable when a parameter changes; a dial step is 1/200 cycle per sample */
+      oscillatorA.setWaveform((Oscillator::Waveform)cDialog->waveA);
+      oscillatorA.setAmplitude(unitPerVoltCount() * cDialog->ampA);
+      oscillatorA.setOffset(cDialog->offsetA * unitPerVoltCount()  / 100);
+      oscillatorA.setFrequency(cDialog->freqA, 200);
+      oscillatorB.setWaveform((Oscillator::Waveform)cDialog->waveB);
+      oscillatorB.setAmplitude(unitPerVoltCount() * cDialog->ampB);
+      oscillatorB.setOffset(cDialog->offsetB * unitPerVoltCount()  / 100);
+      oscillatorB.setFrequency(cDialog->freqB, 200);
+
+      oscillatorA.generate(c0, 512);
+      noiseGenerator.add(c0, 512, noise);
+      oscillatorB.generate(c1, 512);
+      noiseGenerator.add(c1, 512, noise);
 
       switch (cDialog->mathA){
       case 1:
@@ -326,9 +341,9 @@ unsigned DdsDataSource::getRawData(std::valarray<std::valarray<signed short> > *
         (*data)[1][sample] = 0;
      }
    }
-      /* elapsed microseconds */
-      //return samplingRate() * 512 / 1000000 ;
-      return 1000000 / (samplingRate() / 512);
+      /* wait until these samples would have been acquired */
+      pacer.wait();
+      return 0;
 }
 
 unsigned DdsDataSource::inputCount() const
@@ -31,6 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define __DDS_H
 
 #include <DataSource.h>
+#include <Pacer.h>
+#include <SignalGeneration.h>
 #include <QDial>
 #include <QLCDNumber>
 
@@ -41,6 +43,8 @@ class  ControlDialog : public QWidget
 
 public:
 	ControlDialog(QWidget *parent = 0);
+        int waveA;
+        int waveB;
         int freqA;
         int freqB;
         float ampA;
@@ -55,6 +59,8 @@ public:
         bool ready;
 
 private slots:
+        void waveAsetValue(int val);
+        void waveBsetValue(int val);
         void ampAsetValue(int val);
         void freqAsetValue(int val);
         void offsetAsetValue(int val);
@@ -87,12 +93,17 @@ private:
 	friend class DdsDataSourceDescription;
 	DdsDataSource(const DataSourceDescription *description);
         ~DdsDataSource(){cDialog->close(); delete cDialog;}
-	double t; //!< time
         signed short *c0,*c1;
+        Oscillator oscillatorA; //!< generator of channel A
+        Oscillator oscillatorB; //!< generator of channel B
+        NoiseGenerator noiseGenerator; //!< additive noise of both channels
+        Pacer pacer; //!< deliver blocks at the sampling rate
 
 public:
 	virtual unsigned getRawData(std::valarray<std::valarray<signed short> > *data);
-	virtual bool init(void) { return true; }
+	virtual qint64 lastBlockTimestamp() const { return pacer.blockTimestamp(); }
+	virtual QString statistics() const { return pacer.statistics(); }
+	virtual bool init(void) { pacer.reset(); return true; }
 	
 	virtual unsigned inputCount() const;
 	virtual unsigned samplingRate() const;
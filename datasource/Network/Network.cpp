@@ -0,0 +1,642 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include <QtCore>
+#include <QDialog>
+#include <QLabel>
+#include <QSpinBox>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include "Network.h"
+#include <Network.moc>
+#include "NetworkProtocol.h"
+#include "Settings.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+namespace NetworkDataSourceConstants
+{
+	const unsigned BatchSize = 32; //!< maximum number of datagrams received by one recvmmsg
+	const unsigned ReceiveTimeout = 100; //!< timeout of socket operations in ms, so that the thread checks whether it must quit
+	const unsigned FirstFrameTimeout = 5000; //!< time init() waits for the first frame, in ms
+	const unsigned MaxGapDuration = 10000; //!< duration in ms above which a gap in sequence numbers is considered a restart of the sender instead of lost frames
+	const unsigned StallTimeout = 1000; //!< time after which getRawData returns silence if no frame arrives, in ms
+}
+
+//! Return the monotonic time in ns
+static qint64 monotonicTime()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (qint64)time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+//! Return the wall clock time in ns since the Unix epoch
+static qint64 wallClockTime()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_REALTIME, &time);
+	return (qint64)time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+
+//! Default configuration: UDP on port 7878 with a 50 ms jitter buffer
+NetworkConfiguration::NetworkConfiguration() :
+	udp(true),
+	host("localhost"),
+	port(7878),
+	jitterBufferDuration(50)
+{
+}
+
+//! Load configuration from the network group of the settings
+void NetworkConfiguration::load()
+{
+	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+	settings.beginGroup("network");
+	udp = settings.value("udp", udp).toBool();
+	host = settings.value("host", host).toString();
+	port = settings.value("port", port).toUInt();
+	jitterBufferDuration = settings.value("jitterBufferDuration", jitterBufferDuration).toUInt();
+	settings.endGroup();
+}
+
+//! Save configuration to the network group of the settings
+void NetworkConfiguration::save() const
+{
+	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+	settings.beginGroup("network");
+	settings.setValue("udp", udp);
+	settings.setValue("host", host);
+	settings.setValue("port", port);
+	settings.setValue("jitterBufferDuration", jitterBufferDuration);
+	settings.endGroup();
+}
+
+NetworkStatistics::NetworkStatistics()
+{
+	receivedFrames = 0;
+	invalidFrames = 0;
+	lostFrames = 0;
+	gapCount = 0;
+	reorderedFrames = 0;
+	lateFrames = 0;
+	duplicateFrames = 0;
+	overflowFrames = 0;
+	underrunCount = 0;
+	restartCount = 0;
+	averageLatency = 0;
+	maxLatency = 0;
+	latencyCount = 0;
+}
+
+
+//! Dialog box for configuring the network data source
+class NetworkDialog : public QDialog
+{
+public:
+	QComboBox *protocol; //!< UDP or TCP
+	QLineEdit *host; //!< host to connect to in TCP
+	QSpinBox *port; //!< port
+	QSpinBox *jitterBufferDuration; //!< duration of the jitter buffer
+
+	//! Creates the widgets, initialized from configuration
+	NetworkDialog(const NetworkConfiguration &configuration)
+	{
+		QGridLayout *layout = new QGridLayout(this);
+		
+		layout->addWidget(new QLabel(tr("Protocol")), 0, 0);
+		protocol = new QComboBox();
+		protocol->addItem(tr("UDP, listen on port"));
+		protocol->addItem(tr("TCP, connect to host and port"));
+		protocol->setCurrentIndex(configuration.udp ? 0 : 1);
+		layout->addWidget(protocol, 0, 1);
+		
+		layout->addWidget(new QLabel(tr("Host")), 1, 0);
+		host = new QLineEdit(configuration.host);
+		layout->addWidget(host, 1, 1);
+		
+		layout->addWidget(new QLabel(tr("Port")), 2, 0);
+		port = new QSpinBox();
+		port->setRange(1, 65535);
+		port->setValue(configuration.port);
+		layout->addWidget(port, 2, 1);
+		
+		layout->addWidget(new QLabel(tr("Jitter buffer")), 3, 0);
+		jitterBufferDuration = new QSpinBox();
+		jitterBufferDuration->setRange(0, 10000);
+		jitterBufferDuration->setSuffix(tr(" ms"));
+		jitterBufferDuration->setValue(configuration.jitterBufferDuration);
+		layout->addWidget(jitterBufferDuration, 3, 1);
+		
+		QHBoxLayout *buttonsLayout = new QHBoxLayout;
+		buttonsLayout->addStretch();
+		QPushButton *okButton = new QPushButton(tr("Ok"));
+		connect(okButton, SIGNAL(clicked()), SLOT(accept()));
+		buttonsLayout->addWidget(okButton);
+		QPushButton *cancelButton = new QPushButton(tr("Cancel"));
+		connect(cancelButton, SIGNAL(clicked()), SLOT(reject()));
+		buttonsLayout->addWidget(cancelButton);
+		layout->addLayout(buttonsLayout, 4, 0, 1, 2);
+		
+		setWindowTitle("Network data source");
+	}
+	
+	//! Return the configuration chosen in the dialog
+	NetworkConfiguration configuration() const
+	{
+		NetworkConfiguration configuration;
+		configuration.udp = protocol->currentIndex() == 0;
+		configuration.host = host->text();
+		configuration.port = port->value();
+		configuration.jitterBufferDuration = jitterBufferDuration->value();
+		return configuration;
+	}
+};
+
+
+QString NetworkDataSourceDescription::name() const
+{
+	return "Network stream";
+}
+
+QString NetworkDataSourceDescription::description() const
+{
+	return "Receive framed sample streams over TCP or UDP";
+}
+
+DataSource *NetworkDataSourceDescription::create() const
+{
+	NetworkConfiguration configuration;
+	configuration.load();
+	
+	NetworkDialog networkDialog(configuration);
+	if (networkDialog.exec() != QDialog::Rejected)
+	{
+		configuration = networkDialog.configuration();
+		configuration.save();
+	}
+	return new NetworkDataSource(this, configuration);
+}
+
+
+NetworkDataSource::NetworkDataSource(const DataSourceDescription *description, const NetworkConfiguration &configuration) :
+	DataSource(description),
+	configuration(configuration)
+{
+	socketFd = -1;
+	quit = false;
+	channelCount = 0;
+	rate = 1;
+	frameLength = 512;
+	jitterFrameCount = 1;
+	started = false;
+	prefilling = true;
+	highestSequence = 0;
+	nextSequence = 0;
+	pendingCount = 0;
+	pendingTimestamp = 0;
+	blockTimestamp = 0;
+	owedSilence = 0;
+	stallSilence = 0;
+}
+
+NetworkDataSource::~NetworkDataSource()
+{
+	quit = true;
+	frameAvailable.wakeAll();
+	wait();
+	if (socketFd != -1)
+	{
+		reportStatistics();
+		close(socketFd);
+	}
+}
+
+//! Open the socket: bind it in UDP, connect it in TCP
+bool NetworkDataSource::openSocket()
+{
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = configuration.udp ? SOCK_DGRAM : SOCK_STREAM;
+	if (configuration.udp)
+		hints.ai_flags = AI_PASSIVE;
+	
+	struct addrinfo *addresses;
+	const QByteArray port = QByteArray::number(configuration.port);
+	if (getaddrinfo(configuration.udp ? NULL : configuration.host.toLocal8Bit().constData(), port.constData(), &hints, &addresses) != 0)
+	{
+		qDebug() << "NetworkDataSource::openSocket() : can't resolve" << configuration.host;
+		return false;
+	}
+	
+	for (struct addrinfo *address = addresses; address; address = address->ai_next)
+	{
+		socketFd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (socketFd == -1)
+			continue;
+		if (configuration.udp)
+		{
+			// a large receive buffer absorbs bursts while the thread is not scheduled
+			int bufferSize = 8 * 1024 * 1024;
+			setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+			if (bind(socketFd, address->ai_addr, address->ai_addrlen) == 0)
+				break;
+		}
+		else if (::connect(socketFd, address->ai_addr, address->ai_addrlen) == 0)
+			break;
+		close(socketFd);
+		socketFd = -1;
+	}
+	freeaddrinfo(addresses);
+	if (socketFd == -1)
+	{
+		qDebug() << "NetworkDataSource::openSocket() : can't" << (configuration.udp ? "bind to port" : "connect to") << (configuration.udp ? QString::number(configuration.port) : configuration.host + ":" + QString::number(configuration.port));
+		return false;
+	}
+	
+	// time out regularly to check whether we must quit
+	struct timeval timeout;
+	timeout.tv_sec = 0;
+	timeout.tv_usec = NetworkDataSourceConstants::ReceiveTimeout * 1000;
+	setsockopt(socketFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	return true;
+}
+
+bool NetworkDataSource::init(void)
+{
+	if (!openSocket())
+		return false;
+	start(QThread::TimeCriticalPriority);
+	
+	// the first frame gives the channel count and the sampling rate
+	QMutexLocker locker(&mutex);
+	QTime waitTime;
+	waitTime.start();
+	while (!started && (waitTime.elapsed() < (int)NetworkDataSourceConstants::FirstFrameTimeout))
+		frameAvailable.wait(&mutex, NetworkDataSourceConstants::ReceiveTimeout);
+	if (!started)
+	{
+		qDebug() << "NetworkDataSource::init() : no frame received";
+		return false;
+	}
+	return true;
+}
+
+//! Receiving thread
+void NetworkDataSource::run()
+{
+	if (configuration.udp)
+		receiveUdp();
+	else
+		receiveTcp();
+}
+
+//! Receive datagrams, in batches if possible
+void NetworkDataSource::receiveUdp()
+{
+	using namespace NetworkDataSourceConstants;
+	std::vector<unsigned char> buffers(BatchSize * NETWORK_MAX_DATAGRAM_SIZE);
+	#ifdef __linux__
+	struct mmsghdr messages[BatchSize];
+	struct iovec vectors[BatchSize];
+	for (unsigned i = 0; i < BatchSize; i++)
+	{
+		vectors[i].iov_base = &buffers[i * NETWORK_MAX_DATAGRAM_SIZE];
+		vectors[i].iov_len = NETWORK_MAX_DATAGRAM_SIZE;
+		memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+		messages[i].msg_hdr.msg_iov = &vectors[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+	#endif
+	
+	while (!quit)
+	{
+		#ifdef __linux__
+		// wait for the first datagram, then take all those already queued
+		const int count = recvmmsg(socketFd, messages, BatchSize, MSG_WAITFORONE, NULL);
+		for (int i = 0; i < count; i++)
+			frameReceived(&buffers[i * NETWORK_MAX_DATAGRAM_SIZE], messages[i].msg_len);
+		#else
+		const ssize_t size = recv(socketFd, &buffers[0], NETWORK_MAX_DATAGRAM_SIZE, 0);
+		if (size > 0)
+			frameReceived(&buffers[0], size);
+		#endif
+	}
+}
+
+//! Read exactly size bytes from the TCP connection, return false if the connection is closed or we must quit
+bool NetworkDataSource::readFully(char *dest, size_t size)
+{
+	size_t done = 0;
+	while ((done < size) && !quit)
+	{
+		const ssize_t result = recv(socketFd, dest + done, size - done, 0);
+		if (result > 0)
+			done += result;
+		else if ((result == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+			return false;
+	}
+	return done == size;
+}
+
+//! Receive frames from the TCP connection, reconnecting if it is lost
+void NetworkDataSource::receiveTcp()
+{
+	using namespace NetworkDataSourceConstants;
+	std::vector<unsigned char> frame(NETWORK_FRAME_HEADER_SIZE);
+	while (!quit)
+	{
+		// frame header, then samples
+		NetworkFrameHeader header;
+		bool ok = readFully((char *)&frame[0], NETWORK_FRAME_HEADER_SIZE);
+		if (ok && !networkDecodeFrameHeader(&frame[0], &header))
+		{
+			// the stream is not synchronized any more, reconnect
+			QMutexLocker locker(&mutex);
+			streamStatistics.invalidFrames++;
+			ok = false;
+		}
+		if (ok)
+		{
+			frame.resize(NETWORK_FRAME_HEADER_SIZE + networkFramePayloadSize(&header));
+			ok = readFully((char *)&frame[NETWORK_FRAME_HEADER_SIZE], frame.size() - NETWORK_FRAME_HEADER_SIZE);
+		}
+		if (ok)
+			frameReceived(&frame[0], frame.size());
+		else if (!quit)
+		{
+			qDebug() << "NetworkDataSource::receiveTcp() : connection lost, reconnecting";
+			close(socketFd);
+			socketFd = -1;
+			while (!quit && !openSocket())
+				sleep(1);
+		}
+	}
+}
+
+//! Insert a received frame into the jitter buffer
+void NetworkDataSource::frameReceived(const unsigned char *packet, size_t size)
+{
+	const qint64 arrival = monotonicTime();
+	QMutexLocker locker(&mutex);
+	
+	// check the header, and the format against the first frame
+	NetworkFrameHeader header;
+	if ((size < NETWORK_FRAME_HEADER_SIZE) || !networkDecodeFrameHeader(packet, &header) || (size < NETWORK_FRAME_HEADER_SIZE + networkFramePayloadSize(&header)) || (started && ((header.channelCount != channelCount) || (header.samplingRate != rate))))
+	{
+		streamStatistics.invalidFrames++;
+		return;
+	}
+	streamStatistics.receivedFrames++;
+	
+	// unwrap the sequence number around the highest received
+	quint64 sequence;
+	if (!started)
+	{
+		channelCount = header.channelCount;
+		rate = header.samplingRate;
+		frameLength = header.frameLength;
+		jitterFrameCount = std::max(1ULL, ((quint64)configuration.jitterBufferDuration * rate) / (1000ULL * frameLength));
+		pending.resize(channelCount);
+		sequence = ((quint64)1 << 32) + header.sequence;
+		highestSequence = sequence;
+		nextSequence = sequence;
+		started = true;
+	}
+	else
+	{
+		sequence = highestSequence + (qint32)(header.sequence - (quint32)highestSequence);
+		
+		// far behind playout: the sender restarted, continue from its new sequence numbers
+		if (sequence + 4 * jitterFrameCount + 64 < nextSequence)
+		{
+			jitterBuffer.clear();
+			sequence = (nextSequence & ~0xffffffffULL) + (1ULL << 32) + header.sequence;
+			highestSequence = sequence;
+			nextSequence = sequence;
+			streamStatistics.restartCount++;
+		}
+	}
+	
+	// latency of the last sample of the frame, if the sender timestamps
+	if (header.timestamp)
+	{
+		const double latency = (double)(wallClockTime() - (qint64)header.timestamp - ((qint64)header.frameLength * 1000000000LL) / rate) / 1e6;
+		streamStatistics.latencyCount++;
+		streamStatistics.averageLatency += (latency - streamStatistics.averageLatency) / streamStatistics.latencyCount;
+		streamStatistics.maxLatency = std::max(streamStatistics.maxLatency, latency);
+	}
+	
+	// classify and insert
+	if (sequence < nextSequence)
+	{
+		streamStatistics.lateFrames++;
+		return;
+	}
+	if (jitterBuffer.find(sequence) != jitterBuffer.end())
+	{
+		streamStatistics.duplicateFrames++;
+		return;
+	}
+	if (sequence < highestSequence)
+		streamStatistics.reorderedFrames++;
+	highestSequence = std::max(highestSequence, sequence);
+	
+	Frame &frame = jitterBuffer[sequence];
+	frame.timestamp = header.timestamp;
+	frame.arrival = arrival;
+	frame.length = header.frameLength;
+	frame.samples.resize(channelCount * frame.length);
+	const unsigned char *src = packet + NETWORK_FRAME_HEADER_SIZE;
+	#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+	memcpy(&frame.samples[0], src, frame.samples.size() * sizeof(signed short));
+	#else
+	for (size_t i = 0; i < frame.samples.size(); i++)
+		frame.samples[i] = (signed short)networkReadLittleEndian(src + 2 * i, 2);
+	#endif
+	
+	// if the consumer does not keep up, drop the oldest frames
+	while (jitterBuffer.size() > 4 * jitterFrameCount + 64)
+	{
+		streamStatistics.overflowFrames++;
+		jitterBuffer.erase(jitterBuffer.begin());
+	}
+	
+	frameAvailable.wakeAll();
+}
+
+//! Append frame to pending samples. Must be called with mutex locked
+void NetworkDataSource::playFrame(const Frame &frame)
+{
+	if (pendingCount == 0)
+		pendingTimestamp = frame.timestamp ? frame.timestamp - (wallClockTime() - monotonicTime()) : 0;
+	// the frame follows the previous one, so silence played meanwhile was a stall of the sender, not lost frames
+	stallSilence = 0;
+	for (unsigned channel = 0; channel < channelCount; channel++)
+		pending[channel].insert(pending[channel].end(), frame.samples.begin() + channel * frame.length, frame.samples.begin() + (channel + 1) * frame.length);
+	pendingCount += frame.length;
+}
+
+//! Append length samples of silence to pending samples. Must be called with mutex locked
+void NetworkDataSource::playSilence(unsigned length)
+{
+	if (pendingCount == 0)
+		pendingTimestamp = 0;
+	for (unsigned channel = 0; channel < channelCount; channel++)
+		pending[channel].resize(pending[channel].size() + length, 0);
+	pendingCount += length;
+}
+
+unsigned NetworkDataSource::getRawData(std::valarray<std::valarray<signed short> > *data)
+{
+	using namespace NetworkDataSourceConstants;
+	Q_ASSERT(data->size() >= channelCount);
+	const qint64 jitterDuration = (qint64)configuration.jitterBufferDuration * 1000000LL;
+	
+	QMutexLocker locker(&mutex);
+	QTime waitTime;
+	waitTime.start();
+	while ((pendingCount < 512) && !quit && (waitTime.elapsed() < (int)StallTimeout + (int)configuration.jitterBufferDuration))
+	{
+		// silence replacing lost frames, played a block at a time so that long gaps do not allocate
+		if (owedSilence)
+		{
+			const unsigned length = (unsigned)std::min<quint64>(owedSilence, 512);
+			playSilence(length);
+			owedSilence -= length;
+			continue;
+		}
+		
+		// wait for the jitter buffer to fill before playing out
+		if (prefilling && (jitterBuffer.size() >= jitterFrameCount))
+			prefilling = false;
+		if (!prefilling && !jitterBuffer.empty())
+		{
+			JitterBuffer::iterator first = jitterBuffer.begin();
+			if (first->first == nextSequence)
+			{
+				playFrame(first->second);
+				jitterBuffer.erase(first);
+				nextSequence++;
+				continue;
+			}
+			
+			// a gap: give up waiting for the missing frames once the buffer is full or they are too late
+			if ((jitterBuffer.size() > jitterFrameCount) || (monotonicTime() - first->second.arrival > jitterDuration))
+			{
+				// replace the missing samples by silence, except those already replaced while the stream stalled
+				const quint64 missing = first->first - nextSequence;
+				const quint64 missingSamples = missing * frameLength;
+				if (missingSamples > stallSilence + ((quint64)MaxGapDuration * rate) / 1000)
+					streamStatistics.restartCount++;
+				else
+				{
+					streamStatistics.lostFrames += missing;
+					streamStatistics.gapCount++;
+					owedSilence = missingSamples - std::min(missingSamples, stallSilence);
+				}
+				stallSilence = 0;
+				nextSequence = first->first;
+				continue;
+			}
+		}
+		else if (!prefilling)
+		{
+			// nothing to play, refill the buffer before playing again
+			streamStatistics.underrunCount++;
+			prefilling = jitterFrameCount > 1;
+		}
+		frameAvailable.wait(&mutex, ReceiveTimeout);
+	}
+	
+	// return 512 samples, completed with silence if the stream stalled
+	if (pendingCount < 512)
+	{
+		stallSilence += 512 - pendingCount;
+		playSilence(512 - pendingCount);
+	}
+	blockTimestamp = pendingTimestamp;
+	for (unsigned channel = 0; channel < channelCount; channel++)
+	{
+		std::copy(pending[channel].begin(), pending[channel].begin() + 512, &(*data)[channel][0]);
+		pending[channel].erase(pending[channel].begin(), pending[channel].begin() + 512);
+	}
+	pendingCount -= 512;
+	if (pendingTimestamp)
+		pendingTimestamp += (512LL * 1000000000LL) / rate;
+	
+	// pace playout so that the jitter buffer stays around its duration, catching up when it holds more
+	if (prefilling || (jitterBuffer.size() > jitterFrameCount))
+		return 0;
+	return (unsigned)((512ULL * 1000000ULL) / rate);
+}
+
+//! Return the statistics of the stream so far
+QString NetworkDataSource::statistics() const
+{
+	QMutexLocker locker(&mutex);
+	const NetworkStatistics &s = streamStatistics;
+	QString text;
+	text += QString("Received frames: %0\n").arg(s.receivedFrames);
+	text += QString("Lost frames: %0 in %1 gaps\n").arg(s.lostFrames).arg(s.gapCount);
+	text += QString("Reordered frames: %0\n").arg(s.reorderedFrames);
+	text += QString("Late frames: %0\n").arg(s.lateFrames);
+	text += QString("Duplicated frames: %0\n").arg(s.duplicateFrames);
+	text += QString("Overflowed frames: %0\n").arg(s.overflowFrames);
+	text += QString("Invalid frames: %0\n").arg(s.invalidFrames);
+	text += QString("Underruns: %0\n").arg(s.underrunCount);
+	text += QString("Restarts: %0").arg(s.restartCount);
+	if (s.latencyCount)
+		text += QString("\nLatency: %0 ms average, %1 ms max").arg(s.averageLatency, 0, 'f', 1).arg(s.maxLatency, 0, 'f', 1);
+	return text;
+}
+
+//! Print statistics, when the data source is destroyed
+void NetworkDataSource::reportStatistics()
+{
+	QMutexLocker locker(&mutex);
+	const NetworkStatistics &s = streamStatistics;
+	qDebug() << "NetworkDataSource :" << s.receivedFrames << "frames received," << s.lostFrames << "lost in" << s.gapCount << "gaps," << s.reorderedFrames << "reordered," << s.lateFrames << "late," << s.duplicateFrames << "duplicated," << s.overflowFrames << "overflowed," << s.invalidFrames << "invalid," << s.underrunCount << "underruns," << s.restartCount << "restarts";
+	if (s.latencyCount)
+		qDebug() << "NetworkDataSource : latency average" << s.averageLatency << "ms, max" << s.maxLatency << "ms";
+}
+
+Q_EXPORT_PLUGIN(NetworkDataSourceDescription)
@@ -0,0 +1,174 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __NETWORK_H
+#define __NETWORK_H
+
+#include <DataSource.h>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+#include <map>
+#include <vector>
+
+//! Configuration of the network data source
+struct NetworkConfiguration
+{
+	bool udp; //!< if true, receive datagrams on port, otherwise connect to host:port with TCP
+	QString host; //!< host to connect to, in TCP
+	unsigned port; //!< port to listen to in UDP or to connect to in TCP
+	unsigned jitterBufferDuration; //!< duration of the jitter buffer in ms
+	
+	NetworkConfiguration();
+	void load();
+	void save() const;
+};
+
+//! Statistics of the network data source
+struct NetworkStatistics
+{
+	quint64 receivedFrames; //!< number of valid frames received
+	quint64 invalidFrames; //!< number of datagrams or headers that were not valid frames
+	quint64 lostFrames; //!< number of frames never received in time for playout
+	unsigned gapCount; //!< number of gaps in the sequence at playout
+	quint64 reorderedFrames; //!< number of frames received after a frame with a higher sequence number
+	quint64 lateFrames; //!< number of frames received after their playout, dropped
+	quint64 duplicateFrames; //!< number of frames received twice, dropped
+	quint64 overflowFrames; //!< number of frames dropped because the jitter buffer was full
+	unsigned underrunCount; //!< number of times the jitter buffer ran empty
+	unsigned restartCount; //!< number of times the sender restarted its sequence numbers
+	double averageLatency; //!< average time between the acquisition of the last sample of a frame and its reception, in ms, if the sender timestamps
+	double maxLatency; //!< maximum latency in ms
+	quint64 latencyCount; //!< number of frames in averageLatency
+	
+	NetworkStatistics();
+};
+
+//! Network, a data source receiving framed sample streams over TCP or UDP
+/*!
+	Frames, whose format is described in NetworkProtocol.h, are received
+	in a thread and inserted into a jitter buffer ordered by sequence
+	number. When data are requested, frames are played out in sequence
+	order, at the stream rate as long as the jitter buffer does not hold
+	more than its duration, faster otherwise, so that the buffer absorbs
+	the jitter and the clock drift of the sender. A missing frame is waited
+	for until the jitter buffer holds more than its duration, then declared
+	lost and replaced by silence so that time stays consistent; silence
+	returned while the stream stalled counts towards the gap. After the
+	buffer ran empty, playout only restarts once it is full again.
+	If the sequence numbers jump far back, or forward by more than 10 s
+	beyond the stall, the sender is assumed to have restarted and playout
+	continues from the new numbers.
+	
+	On Linux, UDP datagrams are received in batches with recvmmsg.
+	Statistics on loss, reordering and latency are shown while acquiring
+	and printed when the data source is destroyed.
+	
+	The channel count and sampling rate are taken from the first frame,
+	init() waits for it.
+*/
+class NetworkDataSource : public DataSource, public QThread
+{
+private:
+	friend class NetworkDataSourceDescription;
+	NetworkDataSource(const DataSourceDescription *description, const NetworkConfiguration &configuration);
+	
+public:
+	virtual ~NetworkDataSource();
+	virtual bool init(void);
+	virtual unsigned getRawData(std::valarray<std::valarray<signed short> > *data);
+	virtual qint64 lastBlockTimestamp() const { return blockTimestamp; }
+	
+	virtual unsigned inputCount() const { return channelCount; }
+	virtual unsigned samplingRate() const { return rate; }
+	virtual unsigned unitPerVoltCount() const { return 1000; }
+	virtual QString statistics() const;
+	
+	virtual void run();
+	
+protected:
+	//! A frame waiting for playout
+	struct Frame
+	{
+		qint64 timestamp; //!< wall clock time of the first sample in ns, 0 if unknown
+		qint64 arrival; //!< monotonic time of reception in ns
+		unsigned length; //!< number of samples per channel
+		std::vector<signed short> samples; //!< samples, channel after channel
+	};
+	typedef std::map<quint64, Frame> JitterBuffer;
+	
+	bool openSocket();
+	void receiveUdp();
+	void receiveTcp();
+	bool readFully(char *dest, size_t size);
+	void frameReceived(const unsigned char *packet, size_t size);
+	void playFrame(const Frame &frame);
+	void playSilence(unsigned length);
+	void reportStatistics();
+	
+	NetworkConfiguration configuration; //!< configuration chosen by the user
+	int socketFd; //!< socket, -1 if not opened
+	volatile bool quit; //!< true if the receiving thread must stop
+	
+	unsigned channelCount; //!< number of channels, from the first frame
+	unsigned rate; //!< sampling rate in Hz, from the first frame
+	unsigned frameLength; //!< samples per channel of the first frame, to size silence and the jitter buffer
+	unsigned jitterFrameCount; //!< number of frames corresponding to the jitter buffer duration
+	
+	mutable QMutex mutex; //!< protects everything below
+	QWaitCondition frameAvailable; //!< signaled when a frame is inserted into the jitter buffer
+	JitterBuffer jitterBuffer; //!< frames waiting for playout, by unwrapped sequence number
+	bool started; //!< true once the first frame has been received
+	bool prefilling; //!< true while waiting for the jitter buffer to fill
+	quint64 highestSequence; //!< highest unwrapped sequence number received
+	quint64 nextSequence; //!< unwrapped sequence number of the next frame to play out
+	std::vector<std::vector<signed short> > pending; //!< played out samples not yet returned by getRawData, per channel
+	unsigned pendingCount; //!< number of samples in each channel of pending
+	qint64 pendingTimestamp; //!< wall clock time of the first pending sample in ns, 0 if unknown
+	qint64 blockTimestamp; //!< wall clock time of the first sample of the last block in ns, 0 if unknown
+	quint64 owedSilence; //!< number of samples of silence still to play out in place of lost frames
+	quint64 stallSilence; //!< number of samples of silence returned since the last frame played out, because the stream stalled
+	NetworkStatistics streamStatistics; //!< statistics of the stream
+};
+
+//! Description of Network, a data source receiving framed sample streams over TCP or UDP
+class NetworkDataSourceDescription : public QObject, public DataSourceDescription
+{
+	Q_OBJECT
+	Q_INTERFACES(DataSourceDescription)
+
+public:
+	virtual QString name() const;
+	virtual QString description() const;
+	
+	virtual DataSource *create() const;
+};
+
+#endif
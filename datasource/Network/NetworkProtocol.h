@@ -0,0 +1,132 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __NETWORK_PROTOCOL_H
+#define __NETWORK_PROTOCOL_H
+
+/*!	\file NetworkProtocol.h
+	\brief Framing of sample streams sent to the Network data source
+
+	A stream is a sequence of frames. Over UDP, every datagram holds exactly
+	one frame; over TCP, frames follow each other on the connection.
+	A frame is a NETWORK_FRAME_HEADER_SIZE bytes header followed by
+	channelCount * frameLength signed 16 bits samples, stored channel after
+	channel. All values are little endian; the header fields are, in order:
+
+	- uint32 magic, NETWORK_FRAME_MAGIC
+	- uint16 version, NETWORK_FRAME_VERSION
+	- uint16 channelCount, number of channels
+	- uint32 samplingRate, in Hz
+	- uint32 sequence, incremented by one for every frame, wrapping around
+	- uint16 frameLength, number of samples per channel in this frame
+	- uint16 reserved, 0
+	- uint32 reserved, 0
+	- uint64 timestamp, wall clock time of the first sample in ns since the Unix epoch, 0 if unknown
+
+	The samples of a frame must not exceed NETWORK_MAX_PAYLOAD_SIZE bytes,
+	so that it fits in a datagram; receivers reject larger frames, over TCP
+	as well, so that a corrupted header cannot make them allocate gigabytes.
+
+	Receivers detect lost and reordered frames from the sequence numbers,
+	and compute the latency from the timestamps if the clocks of the
+	sender and receiver are synchronized.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#define NETWORK_FRAME_MAGIC 0x4E51534F /* "OSQN" in little endian */
+#define NETWORK_FRAME_VERSION 1
+#define NETWORK_FRAME_HEADER_SIZE 32
+#define NETWORK_MAX_DATAGRAM_SIZE 65507
+#define NETWORK_MAX_PAYLOAD_SIZE (NETWORK_MAX_DATAGRAM_SIZE - NETWORK_FRAME_HEADER_SIZE)
+
+//! Header of a frame, in host byte order
+typedef struct
+{
+	uint32_t magic; //!< NETWORK_FRAME_MAGIC
+	uint16_t version; //!< NETWORK_FRAME_VERSION
+	uint16_t channelCount; //!< number of channels
+	uint32_t samplingRate; //!< sampling rate in Hz
+	uint32_t sequence; //!< sequence number of the frame
+	uint16_t frameLength; //!< number of samples per channel
+	uint64_t timestamp; //!< wall clock time of the first sample in ns since the Unix epoch, 0 if unknown
+} NetworkFrameHeader;
+
+//! Read a little endian value of byteCount bytes
+static inline uint64_t networkReadLittleEndian(const unsigned char *src, unsigned byteCount)
+{
+	uint64_t value = 0;
+	unsigned i;
+	for (i = 0; i < byteCount; i++)
+		value |= (uint64_t)src[i] << (8 * i);
+	return value;
+}
+
+//! Write a little endian value of byteCount bytes
+static inline void networkWriteLittleEndian(unsigned char *dest, uint64_t value, unsigned byteCount)
+{
+	unsigned i;
+	for (i = 0; i < byteCount; i++)
+		dest[i] = (unsigned char)(value >> (8 * i));
+}
+
+//! Return the size in bytes of the samples following header
+static inline size_t networkFramePayloadSize(const NetworkFrameHeader *header)
+{
+	return (size_t)header->channelCount * header->frameLength * sizeof(int16_t);
+}
+
+//! Decode the NETWORK_FRAME_HEADER_SIZE bytes of src into header, return 0 if it is not a valid header
+static inline int networkDecodeFrameHeader(const unsigned char *src, NetworkFrameHeader *header)
+{
+	header->magic = (uint32_t)networkReadLittleEndian(src, 4);
+	header->version = (uint16_t)networkReadLittleEndian(src + 4, 2);
+	header->channelCount = (uint16_t)networkReadLittleEndian(src + 6, 2);
+	header->samplingRate = (uint32_t)networkReadLittleEndian(src + 8, 4);
+	header->sequence = (uint32_t)networkReadLittleEndian(src + 12, 4);
+	header->frameLength = (uint16_t)networkReadLittleEndian(src + 16, 2);
+	header->timestamp = networkReadLittleEndian(src + 24, 8);
+	return (header->magic == NETWORK_FRAME_MAGIC) && (header->version == NETWORK_FRAME_VERSION) && (header->channelCount != 0) && (header->samplingRate != 0) && (header->frameLength != 0) && (networkFramePayloadSize(header) <= NETWORK_MAX_PAYLOAD_SIZE);
+}
+
+//! Encode header into the NETWORK_FRAME_HEADER_SIZE bytes of dest
+static inline void networkEncodeFrameHeader(const NetworkFrameHeader *header, unsigned char *dest)
+{
+	memset(dest, 0, NETWORK_FRAME_HEADER_SIZE);
+	networkWriteLittleEndian(dest, header->magic, 4);
+	networkWriteLittleEndian(dest + 4, header->version, 2);
+	networkWriteLittleEndian(dest + 6, header->channelCount, 2);
+	networkWriteLittleEndian(dest + 8, header->samplingRate, 4);
+	networkWriteLittleEndian(dest + 12, header->sequence, 4);
+	networkWriteLittleEndian(dest + 16, header->frameLength, 2);
+	networkWriteLittleEndian(dest + 24, header->timestamp, 8);
+}
+
+#endif
@@ -0,0 +1,258 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include <QtCore>
+#include <QInputDialog>
+#include "SharedMemory.h"
+#include <SharedMemory.moc>
+#include "Settings.h"
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//! Time after which getRawData returns silence if the producer writes no frame, in ms
+static const unsigned StallTimeout = 1000;
+//! Number of times a block is copied again if the producer overwrote it meanwhile
+static const unsigned MaxCopyAttempts = 3;
+
+QString SharedMemoryDataSourceDescription::name() const
+{
+	return "Shared memory ring";
+}
+
+QString SharedMemoryDataSourceDescription::description() const
+{
+	return "Read data written by an external process in a shared memory ring";
+}
+
+DataSource *SharedMemoryDataSourceDescription::create() const
+{
+	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+	QString name = settings.value("sharedMemory/name", "/osqoop").toString();
+	bool ok;
+	name = QInputDialog::getText(NULL, "Shared memory ring", "Name of the shared memory object", QLineEdit::Normal, name, &ok);
+	if (ok)
+		settings.setValue("sharedMemory/name", name);
+	return new SharedMemoryDataSource(this, name);
+}
+
+
+SharedMemoryDataSource::SharedMemoryDataSource(const DataSourceDescription *description, const QString &name) :
+	DataSource(description),
+	name(name)
+{
+	header = NULL;
+	size = 0;
+	samples = NULL;
+	readIndex = 0;
+	blockIndex = 0;
+	silentBlock = false;
+	skippedFrames = 0;
+	silentBlocks = 0;
+}
+
+SharedMemoryDataSource::~SharedMemoryDataSource()
+{
+	if (header)
+	{
+		if (skippedFrames)
+			qDebug() << "SharedMemoryDataSource : skipped" << skippedFrames << "frames overwritten by the producer before they were read";
+		if (silentBlocks)
+			qDebug() << "SharedMemoryDataSource : returned" << silentBlocks << "blocks of silence while the producer was stalled or gone";
+		munmap(header, size);
+	}
+}
+
+bool SharedMemoryDataSource::init(void)
+{
+	const int fd = shm_open(name.toLocal8Bit().constData(), O_RDWR, 0);
+	if (fd < 0)
+	{
+		qDebug() << "SharedMemoryDataSource::init() : can't open shared memory object" << name;
+		return false;
+	}
+	
+	// map the object and check its header
+	struct stat status;
+	if ((fstat(fd, &status) != 0) || ((size_t)status.st_size < sizeof(ShmRingHeader)))
+	{
+		qDebug() << "SharedMemoryDataSource::init() : shared memory object" << name << "is too small";
+		close(fd);
+		return false;
+	}
+	size = status.st_size;
+	void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (address == MAP_FAILED)
+	{
+		qDebug() << "SharedMemoryDataSource::init() : can't map shared memory object" << name;
+		return false;
+	}
+	header = (ShmRingHeader *)address;
+	__sync_synchronize();
+	
+	if ((header->magic != SHM_RING_MAGIC) || (header->version != SHM_RING_VERSION) || (header->channelCount == 0) || (header->samplingRate == 0) || (header->frameCount < 1024) || (header->frameCount % 512 != 0) || ((size_t)header->dataOffset + (size_t)header->channelCount * header->frameCount * sizeof(signed short) > size))
+	{
+		qDebug() << "SharedMemoryDataSource::init() : shared memory object" << name << "does not hold a valid ring";
+		munmap(header, size);
+		header = NULL;
+		return false;
+	}
+	samples = (const signed short *)((const char *)address + header->dataOffset);
+	
+	// start with the most recent complete block
+	const quint64 writeIndex = header->writeIndex;
+	readIndex = writeIndex - std::min<quint64>(writeIndex % 512, writeIndex);
+	header->readIndex = readIndex;
+	return true;
+}
+
+unsigned SharedMemoryDataSource::getRawData(std::valarray<std::valarray<signed short> > *data)
+{
+	const unsigned channelCount = header->channelCount;
+	const unsigned frameCount = header->frameCount;
+	Q_ASSERT(data->size() >= channelCount);
+	
+	// wait for a block, polling at a fraction of its duration, until the producer stalls or destroys the ring
+	quint64 writeIndex = header->writeIndex;
+	if (writeIndex - readIndex < 512)
+	{
+		struct timespec pollPeriod;
+		pollPeriod.tv_sec = 0;
+		pollPeriod.tv_nsec = std::min<long>(1000000, 128000000000LL / header->samplingRate);
+		QTime waitTime;
+		waitTime.start();
+		while (((writeIndex = header->writeIndex) - readIndex < 512) && (header->magic == SHM_RING_MAGIC) && (waitTime.elapsed() < (int)StallTimeout))
+			nanosleep(&pollPeriod, NULL);
+		
+		// no block, return silence so that the data converter can quit; if the ring is gone, pace at the sampling rate
+		if (writeIndex - readIndex < 512)
+		{
+			for (unsigned channel = 0; channel < channelCount; channel++)
+				std::fill(&(*data)[channel][0], &(*data)[channel][0] + 512, 0);
+			silentBlock = true;
+			{
+				QMutexLocker locker(&statisticsMutex);
+				silentBlocks++;
+			}
+			if (header->magic != SHM_RING_MAGIC)
+				return (unsigned)((512ULL * 1000000ULL) / header->samplingRate);
+			return 0;
+		}
+	}
+	
+	// frames up to writeIndex plus the uncommitted ones may be written while we copy, the block must not reach them
+	const quint64 maxLag = frameCount - SHM_RING_MAX_UNCOMMITTED(frameCount);
+	for (unsigned attempt = 0; attempt < MaxCopyAttempts; attempt++)
+	{
+		__sync_synchronize();
+		
+		// skip frames that are overwritten or could be during the copy
+		if (writeIndex - readIndex > maxLag)
+		{
+			const quint64 newReadIndex = writeIndex - 512;
+			QMutexLocker locker(&statisticsMutex);
+			skippedFrames += newReadIndex - readIndex;
+			readIndex = newReadIndex;
+		}
+		
+		// copy, in two parts if the block wraps around the end of the ring
+		const unsigned position = (unsigned)(readIndex % frameCount);
+		const unsigned firstPart = std::min(512u, frameCount - position);
+		for (unsigned channel = 0; channel < channelCount; channel++)
+		{
+			const signed short *src = samples + (size_t)channel * frameCount;
+			signed short *dest = &(*data)[channel][0];
+			memcpy(dest, src + position, firstPart * sizeof(signed short));
+			if (firstPart < 512)
+				memcpy(dest + firstPart, src, (512 - firstPart) * sizeof(signed short));
+		}
+		
+		// the block is intact if the producer could not reach it during the copy, otherwise copy the newest block again
+		__sync_synchronize();
+		writeIndex = header->writeIndex;
+		if (writeIndex - readIndex <= maxLag)
+		{
+			blockIndex = readIndex;
+			silentBlock = false;
+			readIndex += 512;
+			header->readIndex = readIndex;
+			return 0;
+		}
+	}
+	
+	// the producer overwrote every copy, return silence rather than torn samples
+	for (unsigned channel = 0; channel < channelCount; channel++)
+		std::fill(&(*data)[channel][0], &(*data)[channel][0] + 512, 0);
+	silentBlock = true;
+	{
+		QMutexLocker locker(&statisticsMutex);
+		skippedFrames += 512;
+		silentBlocks++;
+	}
+	readIndex += 512;
+	header->readIndex = readIndex;
+	return 0;
+}
+
+qint64 SharedMemoryDataSource::lastBlockTimestamp() const
+{
+	if (!header->startTime || silentBlock)
+		return 0;
+	// split the index in seconds and remainder, so that the product does not overflow
+	const quint64 rate = header->samplingRate;
+	return header->startTime + (qint64)((blockIndex / rate) * 1000000000ULL + ((blockIndex % rate) * 1000000000ULL) / rate);
+}
+
+QString SharedMemoryDataSource::statistics() const
+{
+	QMutexLocker locker(&statisticsMutex);
+	return QString("Skipped frames: %0\nSilent blocks: %1").arg(skippedFrames).arg(silentBlocks);
+}
+
+unsigned SharedMemoryDataSource::inputCount() const
+{
+	return header ? header->channelCount : 0;
+}
+
+unsigned SharedMemoryDataSource::samplingRate() const
+{
+	return header ? header->samplingRate : 1;
+}
+
+unsigned SharedMemoryDataSource::unitPerVoltCount() const
+{
+	return header ? header->unitPerVolt : 1;
+}
+
+Q_EXPORT_PLUGIN(SharedMemoryDataSourceDescription)
@@ -0,0 +1,102 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SHARED_MEMORY_H
+#define __SHARED_MEMORY_H
+
+#include <DataSource.h>
+#include <QString>
+#include <QMutex>
+#include "ShmRing.h"
+
+//! Description of SharedMemory, a data source reading a ring in shared memory filled by an external process
+class SharedMemoryDataSourceDescription : public QObject, public DataSourceDescription
+{
+	Q_OBJECT
+	Q_INTERFACES(DataSourceDescription)
+
+public:
+	virtual QString name() const;
+	virtual QString description() const;
+	
+	virtual DataSource *create() const;
+};
+
+//! SharedMemory, a data source reading a ring in shared memory filled by an external process
+/*!
+	External acquisition processes create a POSIX shared memory object
+	holding a ring of samples, whose layout is described in ShmRing.h,
+	and fill it, for instance using the C library of ShmProducer.h.
+	This data source maps the object and copies every block of 512 samples
+	of each channel directly from the ring to the data converter buffers.
+	This is one copy per block and not a zero-copy read, as getRawData
+	fills buffers owned by the data converter; producers write in place.
+	A block that the producer may have overwritten during the copy is
+	copied again from the newest frames, or replaced by silence, so that
+	torn blocks never reach the data converter.
+	The name of the object is asked at creation and stored in the
+	sharedMemory/name setting.
+	If the data source is read too late and the producer overwrote frames
+	not read yet, or could while they are copied, they are skipped and
+	counted. If the producer writes no frame for a second, or destroys the
+	ring, blocks of silence are returned, so that the data converter never
+	blocks. Both counts are shown while acquiring and printed when the data
+	source is destroyed.
+*/
+class SharedMemoryDataSource : public DataSource
+{
+private:
+	friend class SharedMemoryDataSourceDescription;
+	SharedMemoryDataSource(const DataSourceDescription *description, const QString &name);
+	
+public:
+	virtual ~SharedMemoryDataSource();
+	virtual bool init(void);
+	virtual unsigned getRawData(std::valarray<std::valarray<signed short> > *data);
+	virtual qint64 lastBlockTimestamp() const;
+	virtual QString statistics() const;
+	
+	virtual unsigned inputCount() const;
+	virtual unsigned samplingRate() const;
+	virtual unsigned unitPerVoltCount() const;
+	
+private:
+	QString name; //!< name of the shared memory object
+	ShmRingHeader *header; //!< mapped object, NULL if not mapped
+	size_t size; //!< size of the mapped object in bytes
+	const signed short *samples; //!< first sample of channel 0
+	quint64 readIndex; //!< index of the next frame to read
+	quint64 blockIndex; //!< index of the first frame of the last block read
+	bool silentBlock; //!< whether the last block returned was silence, because no frame was available
+	mutable QMutex statisticsMutex; //!< protects skippedFrames and silentBlocks, which the GUI thread reads
+	quint64 skippedFrames; //!< number of frames overwritten before they could be read
+	quint64 silentBlocks; //!< number of blocks of silence returned
+};
+
+#endif
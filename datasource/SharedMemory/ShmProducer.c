@@ -0,0 +1,180 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "ShmProducer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+//! State of a producer
+struct ShmProducer
+{
+	char *name; //!< name of the shared memory object
+	ShmRingHeader *header; //!< mapped object
+	size_t size; //!< size of the mapped object in bytes
+	int16_t *data; //!< first sample of channel 0
+	uint64_t writeIndex; //!< local copy of header->writeIndex
+	int16_t **channels; //!< scratch pointers for the write functions
+};
+
+ShmProducer *osqoopShmCreate(const char *name, unsigned channelCount, unsigned samplingRate, unsigned unitPerVolt, unsigned frameCount)
+{
+	ShmProducer *producer;
+	size_t dataOffset = (sizeof(ShmRingHeader) + 63) & ~(size_t)63;
+	size_t size;
+	int fd;
+	
+	if ((channelCount == 0) || (frameCount == 0))
+		return NULL;
+	frameCount = (frameCount + 511) & ~511u;
+	if (frameCount < 1024)
+		frameCount = 1024;
+	size = dataOffset + (size_t)channelCount * frameCount * sizeof(int16_t);
+	
+	// create a fresh object
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		perror("osqoopShmCreate: shm_open");
+		return NULL;
+	}
+	if (ftruncate(fd, size) != 0)
+	{
+		perror("osqoopShmCreate: ftruncate");
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+	
+	producer = (ShmProducer *)calloc(1, sizeof(ShmProducer));
+	producer->header = (ShmRingHeader *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (producer->header == MAP_FAILED)
+	{
+		perror("osqoopShmCreate: mmap");
+		free(producer);
+		shm_unlink(name);
+		return NULL;
+	}
+	producer->name = strdup(name);
+	producer->size = size;
+	producer->data = (int16_t *)((char *)producer->header + dataOffset);
+	producer->channels = (int16_t **)calloc(channelCount, sizeof(int16_t *));
+	
+	// fill the header, magic last so that a consumer never sees a partial header
+	producer->header->version = SHM_RING_VERSION;
+	producer->header->dataOffset = (uint32_t)dataOffset;
+	producer->header->channelCount = channelCount;
+	producer->header->samplingRate = samplingRate;
+	producer->header->unitPerVolt = unitPerVolt;
+	producer->header->frameCount = frameCount;
+	__sync_synchronize();
+	producer->header->magic = SHM_RING_MAGIC;
+	
+	return producer;
+}
+
+void osqoopShmDestroy(ShmProducer *producer)
+{
+	if (!producer)
+		return;
+	producer->header->magic = 0;
+	munmap(producer->header, producer->size);
+	shm_unlink(producer->name);
+	free(producer->name);
+	free(producer->channels);
+	free(producer);
+}
+
+ShmRingHeader *osqoopShmHeader(ShmProducer *producer)
+{
+	return producer->header;
+}
+
+unsigned osqoopShmBegin(ShmProducer *producer, int16_t **channels, unsigned maxFrameCount)
+{
+	const unsigned frameCount = producer->header->frameCount;
+	const unsigned position = (unsigned)(producer->writeIndex % frameCount);
+	const unsigned maxUncommitted = SHM_RING_MAX_UNCOMMITTED(frameCount);
+	unsigned available = frameCount - position;
+	unsigned channel;
+	
+	if (available > maxUncommitted)
+		available = maxUncommitted;
+	for (channel = 0; channel < producer->header->channelCount; channel++)
+		channels[channel] = producer->data + (size_t)channel * frameCount + position;
+	return maxFrameCount < available ? maxFrameCount : available;
+}
+
+void osqoopShmCommit(ShmProducer *producer, unsigned frameCount)
+{
+	producer->writeIndex += frameCount;
+	// samples must be visible before the index
+	__sync_synchronize();
+	producer->header->writeIndex = producer->writeIndex;
+}
+
+void osqoopShmWritePlanar(ShmProducer *producer, const int16_t * const *channels, unsigned frameCount)
+{
+	const unsigned channelCount = producer->header->channelCount;
+	unsigned done = 0;
+	while (done < frameCount)
+	{
+		const unsigned count = osqoopShmBegin(producer, producer->channels, frameCount - done);
+		unsigned channel;
+		for (channel = 0; channel < channelCount; channel++)
+			memcpy(producer->channels[channel], channels[channel] + done, count * sizeof(int16_t));
+		osqoopShmCommit(producer, count);
+		done += count;
+	}
+}
+
+void osqoopShmWriteInterleaved(ShmProducer *producer, const int16_t *frames, unsigned frameCount)
+{
+	const unsigned channelCount = producer->header->channelCount;
+	unsigned done = 0;
+	while (done < frameCount)
+	{
+		const unsigned count = osqoopShmBegin(producer, producer->channels, frameCount - done);
+		unsigned channel, frame;
+		for (channel = 0; channel < channelCount; channel++)
+		{
+			int16_t *dest = producer->channels[channel];
+			const int16_t *src = frames + (size_t)done * channelCount + channel;
+			for (frame = 0; frame < count; frame++)
+				dest[frame] = src[(size_t)frame * channelCount];
+		}
+		osqoopShmCommit(producer, count);
+		done += count;
+	}
+}
@@ -0,0 +1,84 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SHM_PRODUCER_H
+#define __SHM_PRODUCER_H
+
+/*!	\file ShmProducer.h
+	\brief C library for external processes feeding Osqoop through a shared memory ring
+
+	Typical use, writing directly in the ring without copy:
+	\code
+	ShmProducer *producer = osqoopShmCreate("/osqoop", 4, 1000000, 1000, 1 << 20);
+	int16_t *channels[4];
+	while (acquiring)
+	{
+		unsigned count = osqoopShmBegin(producer, channels, 4096);
+		// write count samples in each of channels[0] to channels[3]
+		osqoopShmCommit(producer, count);
+	}
+	osqoopShmDestroy(producer);
+	\endcode
+	Data already in memory can be written with osqoopShmWritePlanar or
+	osqoopShmWriteInterleaved. A producer must be used by one thread at a time.
+	See ShmRing.h for the layout of the ring.
+*/
+
+#include <stdint.h>
+#include "ShmRing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! A producer of a shared memory ring
+typedef struct ShmProducer ShmProducer;
+
+//! Create the shared memory object name (for instance "/osqoop") holding a ring of frameCount frames, rounded up to a multiple of 512 and at least 1024. Return NULL on error
+ShmProducer *osqoopShmCreate(const char *name, unsigned channelCount, unsigned samplingRate, unsigned unitPerVolt, unsigned frameCount);
+//! Unmap and remove the shared memory object, and free producer
+void osqoopShmDestroy(ShmProducer *producer);
+//! Return the header of the ring, for instance to set startTime
+ShmRingHeader *osqoopShmHeader(ShmProducer *producer);
+
+//! Set channels to where the next frames must be written, and return how many consecutive frames, at most maxFrameCount and SHM_RING_MAX_UNCOMMITTED, can be written there
+unsigned osqoopShmBegin(ShmProducer *producer, int16_t **channels, unsigned maxFrameCount);
+//! Publish frameCount frames written at the places given by osqoopShmBegin
+void osqoopShmCommit(ShmProducer *producer, unsigned frameCount);
+
+//! Copy and publish frameCount frames, given as one buffer per channel
+void osqoopShmWritePlanar(ShmProducer *producer, const int16_t * const *channels, unsigned frameCount);
+//! Copy and publish frameCount frames, given as interleaved samples of all channels
+void osqoopShmWriteInterleaved(ShmProducer *producer, const int16_t *frames, unsigned frameCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SHM_RING_H
+#define __SHM_RING_H
+
+/*!	\file ShmRing.h
+	\brief Layout of the shared memory ring between external producers and the SharedMemory data source
+
+	A ring is a POSIX shared memory object, created by the producer with
+	shm_open, starting with a ShmRingHeader followed by the samples.
+	Samples are signed 16 bits integers, stored channel after channel:
+	channel c occupies frameCount consecutive samples starting at
+	dataOffset + c * frameCount * 2 bytes from the start of the object,
+	and frame i of the stream is at index i % frameCount of every channel.
+	This planar layout lets the data source copy each block of a channel
+	with a single memcpy from the shared memory to its destination.
+
+	The producer writes the samples of frames, then increments writeIndex.
+	A memory barrier must separate the two, so that the consumer never sees
+	the index before the samples. The producer writes at most
+	SHM_RING_MAX_UNCOMMITTED(frameCount) frames before incrementing
+	writeIndex, so that the consumer knows which frames may be being
+	overwritten. The producer never waits for the consumer: if the consumer
+	is late, the oldest frames are overwritten and the consumer skips them.
+	The ring holds at least 1024 frames.
+	The consumer reports its position in readIndex, for information only.
+
+	All fields are in the native byte order and are written only by the
+	producer, except readIndex.
+*/
+
+#include <stdint.h>
+
+#define SHM_RING_MAGIC 0x4D51534F /* "OSQM" in little endian */
+#define SHM_RING_VERSION 2
+/* maximum number of frames the producer writes beyond writeIndex before incrementing it */
+#define SHM_RING_MAX_UNCOMMITTED(frameCount) ((frameCount) / 4)
+
+//! Header at the beginning of the shared memory object
+typedef struct
+{
+	uint32_t magic; //!< SHM_RING_MAGIC, written last when the header is complete
+	uint32_t version; //!< SHM_RING_VERSION
+	uint32_t dataOffset; //!< offset of the samples from the start of the object, in bytes, multiple of 64
+	uint32_t channelCount; //!< number of channels
+	uint32_t samplingRate; //!< sampling rate in Hz
+	uint32_t unitPerVolt; //!< value of 1 V
+	uint32_t frameCount; //!< number of frames in the ring, multiple of 512 and at least 1024
+	uint32_t reserved; //!< 0
+	uint64_t startTime; //!< monotonic time in ns at which frame 0 was acquired, 0 if unknown
+	uint8_t padding0[24]; //!< keep writeIndex on its own cache line
+	volatile uint64_t writeIndex; //!< number of frames written since the creation of the ring
+	uint8_t padding1[56]; //!< keep readIndex on its own cache line
+	volatile uint64_t readIndex; //!< number of frames consumed or skipped by the consumer
+	uint8_t padding2[56]; //!< pad the header to 192 bytes
+} ShmRingHeader;
+
+#endif
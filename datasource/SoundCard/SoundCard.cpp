@@ -35,6 +35,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QMessageBox>
 #include "SoundCard.h"
 #include <SoundCard.moc>
+#include <SampleConversion.h>
+#include "Settings.h"
 
 
 //! Dialog box for choosing sound input
@@ -61,18 +63,286 @@ public:
 
 // Unix specific
 
-#ifdef Q_OS_UNIX
+#if defined(Q_OS_UNIX) && defined(HAVE_ALSA)
+	#include <alsa/asoundlib.h>
+	#include <time.h>
+	#include <vector>
+	#include <algorithm>
+	
+	// See:
+	//http://www.alsa-project.org/alsa-doc/alsa-lib/pcm.html
+	//http://www.alsa-project.org/alsa-doc/alsa-lib/_2test_2pcm_8c-example.html
+	
+	//! ALSA, Advanced Linux Sound Architecture. Samples are read in place from the device buffer when it can be memory mapped
+	class SoundCardSystemSpecificData
+	{
+	public:
+		static const int StallTimeout = 1000; //!< time in ms after which a device delivering no frame is considered stalled
+		
+		snd_pcm_t *pcm; //!< capture device
+		bool mmapAccess; //!< true if samples are de-interleaved in place from the memory mapped device buffer, false if they are copied by snd_pcm_readi first
+		unsigned channelCount; //!< number of channels negotiated with the device
+		unsigned rate; //!< sample rate negotiated with the device
+		mutable QMutex statisticsMutex; //!< protects xrunCount and stallCount, which the GUI thread reads
+		unsigned xrunCount; //!< number of overruns since the device was opened
+		unsigned stallCount; //!< number of times the device delivered no frame for StallTimeout
+		qint64 blockTimestamp; //!< monotonic time in ns at which the first sample of the last block was acquired
+		std::valarray<signed short> readBuffer; //!< interleaved frames, when the device buffer can't be memory mapped
+		std::vector<signed short *> dest; //!< destination of the next frame of every channel
+		
+		SoundCardSystemSpecificData()
+		{
+			pcm = NULL;
+			mmapAccess = false;
+			channelCount = 2;
+			rate = 44100;
+			xrunCount = 0;
+			stallCount = 0;
+			blockTimestamp = 0;
+		}
+		
+		~SoundCardSystemSpecificData()
+		{
+			if (pcm)
+			{
+				if (xrunCount)
+					qDebug() << "SoundCardSystemSpecificData : " << xrunCount << "overruns during acquisition";
+				if (stallCount)
+					qDebug() << "SoundCardSystemSpecificData : " << stallCount << "stalls during acquisition";
+				snd_pcm_close(pcm);
+			}
+		}
+		
+		//! Return the number of overruns and stalls so far
+		QString statistics() const
+		{
+			QMutexLocker locker(&statisticsMutex);
+			return QString("Overruns: %0\nStalls: %1").arg(xrunCount).arg(stallCount);
+		}
+		
+		//! Print the failed operation and the ALSA error, and close the device
+		bool failed(const char *operation, int error)
+		{
+			qDebug() << "SoundCardSystemSpecificData::openDevice() : can't" << operation << ":" << snd_strerror(error);
+			snd_pcm_close(pcm);
+			pcm = NULL;
+			return false;
+		}
+		
+		bool openDevice()
+		{
+			// read configuration, rate, channels and period may be adjusted to the nearest value supported by the device
+			QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+			const QString device = settings.value("soundCard/device", "default").toString();
+			rate = settings.value("soundCard/rate", 44100).toUInt();
+			channelCount = settings.value("soundCard/channels", 2).toUInt();
+			snd_pcm_uframes_t periodSize = settings.value("soundCard/periodSize", 512).toUInt();
+			unsigned periodCount = settings.value("soundCard/periodCount", 4).toUInt();
+			
+			int error = snd_pcm_open(&pcm, device.toLocal8Bit().constData(), SND_PCM_STREAM_CAPTURE, 0);
+			if (error < 0)
+			{
+				qDebug() << "SoundCardSystemSpecificData::openDevice() : can't open" << device << ":" << snd_strerror(error);
+				pcm = NULL;
+				return false;
+			}
+			
+			// hardware parameters
+			snd_pcm_hw_params_t *hwParams;
+			snd_pcm_hw_params_alloca(&hwParams);
+			snd_pcm_hw_params_any(pcm, hwParams);
+			mmapAccess = (snd_pcm_hw_params_set_access(pcm, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0);
+			if (!mmapAccess && ((error = snd_pcm_hw_params_set_access(pcm, hwParams, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0))
+				return failed("set access", error);
+			if ((error = snd_pcm_hw_params_set_format(pcm, hwParams, SND_PCM_FORMAT_S16)) < 0)
+				return failed("set format", error);
+			if ((error = snd_pcm_hw_params_set_channels_near(pcm, hwParams, &channelCount)) < 0)
+				return failed("set channel count", error);
+			if ((error = snd_pcm_hw_params_set_rate_near(pcm, hwParams, &rate, 0)) < 0)
+				return failed("set rate", error);
+			if ((error = snd_pcm_hw_params_set_period_size_near(pcm, hwParams, &periodSize, 0)) < 0)
+				return failed("set period size", error);
+			if ((error = snd_pcm_hw_params_set_periods_near(pcm, hwParams, &periodCount, 0)) < 0)
+				return failed("set period count", error);
+			if ((error = snd_pcm_hw_params(pcm, hwParams)) < 0)
+				return failed("set hardware parameters", error);
+			
+			// software parameters: wake up every period, and timestamp with the monotonic clock
+			snd_pcm_sw_params_t *swParams;
+			snd_pcm_sw_params_alloca(&swParams);
+			snd_pcm_sw_params_current(pcm, swParams);
+			snd_pcm_sw_params_set_avail_min(pcm, swParams, periodSize);
+			snd_pcm_sw_params_set_tstamp_mode(pcm, swParams, SND_PCM_TSTAMP_ENABLE);
+			snd_pcm_sw_params_set_tstamp_type(pcm, swParams, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+			if ((error = snd_pcm_sw_params(pcm, swParams)) < 0)
+				return failed("set software parameters", error);
+			
+			if (!mmapAccess)
+				readBuffer.resize(periodSize * channelCount);
+			dest.resize(channelCount);
+			
+			if ((error = snd_pcm_start(pcm)) < 0)
+				return failed("start capture", error);
+			
+			qDebug() << "SoundCardSystemSpecificData::openDevice() : capturing" << channelCount << "channels at" << rate << "Hz, periods of" << (unsigned)periodSize << "frames," << periodCount << "periods," << (mmapAccess ? "mmap access" : "read access");
+			return true;
+		}
+		
+		//! Recover from error, counting overruns. Return false if the device is unusable
+		bool recover(int error)
+		{
+			if (error == -EPIPE)
+			{
+				QMutexLocker locker(&statisticsMutex);
+				xrunCount++;
+			}
+			if (((error = snd_pcm_recover(pcm, error, 1)) < 0) || ((error = snd_pcm_start(pcm)) < 0))
+			{
+				qDebug() << "SoundCardSystemSpecificData::getRawData() : can't recover :" << snd_strerror(error);
+				return false;
+			}
+			return true;
+		}
+		
+		//! Restart a device which stalled, return false if it is unusable
+		bool restart()
+		{
+			{
+				QMutexLocker locker(&statisticsMutex);
+				stallCount++;
+			}
+			int error;
+			snd_pcm_drop(pcm);
+			if (((error = snd_pcm_prepare(pcm)) < 0) || ((error = snd_pcm_start(pcm)) < 0))
+			{
+				qDebug() << "SoundCardSystemSpecificData::getRawData() : can't restart stalled device :" << snd_strerror(error);
+				return false;
+			}
+			return true;
+		}
+		
+		//! Return the monotonic time in ns at which the first of the available frames was acquired
+		qint64 firstAvailableFrameTime()
+		{
+			snd_pcm_uframes_t available;
+			snd_htimestamp_t timestamp;
+			if ((snd_pcm_htimestamp(pcm, &available, &timestamp) < 0) || ((timestamp.tv_sec == 0) && (timestamp.tv_nsec == 0)))
+			{
+				// device does not timestamp, use current time instead
+				available = snd_pcm_avail_update(pcm);
+				clock_gettime(CLOCK_MONOTONIC, &timestamp);
+			}
+			return (qint64)timestamp.tv_sec * 1000000000LL + timestamp.tv_nsec - ((qint64)available * 1000000000LL) / rate;
+		}
+		
+		//! Read a block, return false if the device failed and the block was completed with silence
+		bool getRawData(std::valarray<std::valarray<signed short> > *data)
+		{
+			unsigned frameCount = 0;
+			while (frameCount < 512)
+			{
+				// wait until frames are available, an overrun restarts the block so that it is contiguous and its timestamp exact
+				snd_pcm_sframes_t available = snd_pcm_avail_update(pcm);
+				if (available == 0)
+				{
+					const int result = snd_pcm_wait(pcm, StallTimeout);
+					if ((result < 0) && !recover(result))
+						break;
+					// a stalled or unplugged device gives a silent block, and is restarted for the next one
+					if (result == 0)
+					{
+						restart();
+						break;
+					}
+					continue;
+				}
+				if (available < 0)
+				{
+					if (!recover(available))
+						break;
+					frameCount = 0;
+					continue;
+				}
+				
+				if (frameCount == 0)
+					blockTimestamp = firstAvailableFrameTime();
+				for (unsigned channel = 0; channel < channelCount; channel++)
+					dest[channel] = &(*data)[channel][frameCount];
+				
+				snd_pcm_uframes_t frames = std::min<snd_pcm_uframes_t>(available, 512 - frameCount);
+				if (mmapAccess)
+				{
+					// de-interleave directly from the device buffer
+					const snd_pcm_channel_area_t *areas;
+					snd_pcm_uframes_t offset;
+					int error = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
+					if (error < 0)
+					{
+						if (!recover(error))
+							break;
+						frameCount = 0;
+						continue;
+					}
+					const signed short *src = (const signed short *)((const char *)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8);
+					SampleConversion::deinterleave(src, channelCount, &dest[0], frames);
+					const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm, offset, frames);
+					if ((committed < 0) || ((snd_pcm_uframes_t)committed != frames))
+					{
+						if (!recover(committed < 0 ? committed : -EPIPE))
+							break;
+						frameCount = 0;
+						continue;
+					}
+				}
+				else
+				{
+					frames = std::min<snd_pcm_uframes_t>(frames, readBuffer.size() / channelCount);
+					const snd_pcm_sframes_t read = snd_pcm_readi(pcm, &readBuffer[0], frames);
+					if (read < 0)
+					{
+						if (!recover(read))
+							break;
+						frameCount = 0;
+						continue;
+					}
+					frames = read;
+					SampleConversion::deinterleave(&readBuffer[0], channelCount, &dest[0], frames);
+				}
+				frameCount += frames;
+			}
+			
+			// if the device failed, fill the rest of the block with silence
+			if (frameCount == 0)
+				blockTimestamp = 0;
+			for (unsigned channel = 0; channel < channelCount; channel++)
+				for (unsigned sample = frameCount; sample < 512; sample++)
+					(*data)[channel][sample] = 0;
+			return frameCount == 512;
+		}
+	};
+#elif defined(Q_OS_UNIX)
 	#include <fcntl.h>
 	#include <sys/ioctl.h>
 	#include <sys/soundcard.h>
 	#include <unistd.h>
-		
+	#include <vector>
+	#include <algorithm>
+	
+	//! OSS, Open Sound System, used when ALSA is not available
 	class SoundCardSystemSpecificData
 	{
 	public:
 		int dspDev;
+		unsigned channelCount;
+		unsigned rate;
+		qint64 blockTimestamp;
+		std::vector<signed short> buffer;
+		std::vector<signed short *> dest;
+		
+		SoundCardSystemSpecificData() { dspDev = -1; channelCount = 2; rate = 44100; blockTimestamp = 0; }
 		
-		SoundCardSystemSpecificData() { dspDev = -1; }
+		//! OSS keeps no statistics
+		QString statistics() const { return QString(); }
 		
 		~SoundCardSystemSpecificData()
 		{
@@ -82,34 +352,50 @@ public:
 		
 		bool openDevice()
 		{
-			// OSS, Open Sound System
-			int rate = 44100;
-			int channels = 2;
+			QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+			int requestedRate = settings.value("soundCard/rate", 44100).toInt();
+			int channels = settings.value("soundCard/channels", 2).toInt();
 			int format = AFMT_S16_NE;
 			
 			dspDev = open("/dev/dsp", O_RDONLY);
 			if (dspDev == -1)
 				return false;
 			
-			ioctl(dspDev, SNDCTL_DSP_SPEED , &rate);
-			ioctl(dspDev, SNDCTL_DSP_CHANNELS , &channels);
-			ioctl(dspDev, SOUND_PCM_READ_RATE , &rate);
 			ioctl(dspDev, SNDCTL_DSP_SETFMT , &format);
+			ioctl(dspDev, SNDCTL_DSP_CHANNELS , &channels);
+			ioctl(dspDev, SNDCTL_DSP_SPEED , &requestedRate);
+			ioctl(dspDev, SOUND_PCM_READ_RATE , &requestedRate);
+			
+			channelCount = channels;
+			rate = requestedRate;
+			buffer.resize(512 * channelCount);
+			dest.resize(channelCount);
 			
 			return true;
 		}
 		
-		void getRawData(std::valarray<std::valarray<signed short> > *data)
+		//! Read a block, return false if the device failed and the block was completed with silence
+		bool getRawData(std::valarray<std::valarray<signed short> > *data)
 		{
-			// Read buffer
-			size_t bufferSize = 512 * 2;
-			signed short buffer[bufferSize];
-			read(dspDev, buffer, bufferSize * 2);
+			// Read buffer, retrying on short reads
+			const size_t bufferBytes = buffer.size() * sizeof(signed short);
+			size_t readBytes = 0;
+			while (readBytes < bufferBytes)
+			{
+				const ssize_t result = read(dspDev, (char *)&buffer[0] + readBytes, bufferBytes - readBytes);
+				if (result <= 0)
+				{
+					std::fill((char *)&buffer[0] + readBytes, (char *)&buffer[0] + bufferBytes, 0);
+					break;
+				}
+				readBytes += result;
+			}
 			
 			// Deinterlace buffer 
-			for (size_t sample = 0; sample < 512; sample++)
-				for (size_t channel = 0; channel < 2; channel++)
-					(*data)[channel][sample] = buffer[sample * 2 + channel];    
+			for (unsigned channel = 0; channel < channelCount; channel++)
+				dest[channel] = &(*data)[channel][0];
+			SampleConversion::deinterleave(&buffer[0], channelCount, &dest[0], 512);
+			return readBytes == bufferBytes;
 		}
 	};
 #endif // Q_OS_UNIX
@@ -147,10 +433,19 @@ public:
 		signed short buffersData[bufferCount][bufferDataSize];
 		WAVEHDR buffers[bufferCount];
 		unsigned bufferPos;
+		unsigned channelCount;
+		unsigned rate;
+		qint64 blockTimestamp;
+	
+		//! WaveIn keeps no statistics
+		QString statistics() const { return QString(); }
 	
 		SoundCardSystemSpecificData()
 		{
 			waveIn = 0;
+			channelCount = 2;
+			rate = 44100;
+			blockTimestamp = 0;
 			event = CreateEvent(NULL, FALSE, FALSE, NULL);
 		}
 		
@@ -234,19 +529,19 @@ public:
 			return true;
 		}
 		
-		void getRawData(std::valarray<std::valarray<signed short> > *data)
+		//! Read a block, always succeeds as the buffers are filled by the driver
+		bool getRawData(std::valarray<std::valarray<signed short> > *data)
 		{
 			// Wait for buffer ready
 			WaitForSingleObject(event, INFINITE);
 			
 			// Deinterlace buffer 
-			for (size_t sample = 0; sample < 512; sample++)
-				for (size_t channel = 0; channel < 2; channel++)
-					(*data)[channel][sample] = buffersData[bufferPos][sample * 2 + channel];
+			SampleConversion::deinterleave2(buffersData[bufferPos], &(*data)[0][0], &(*data)[1][0], 512);
 			
 			// Put back buffer
 			waveInAddBuffer(waveIn, &buffers[bufferPos], sizeof(WAVEHDR));
 			bufferPos = (bufferPos + 1) % bufferCount;
+			return true;
 		}
 	};
 #endif  // Q_OS_WIN32
@@ -287,18 +582,30 @@ bool SoundCardDataSource::init(void)
 
 unsigned SoundCardDataSource::getRawData(std::valarray<std::valarray<signed short> > *data)
 {
-	privateData->getRawData(data);
+	// if the device failed, pace the silent blocks at the sampling rate instead of spinning
+	if (!privateData->getRawData(data))
+		return (unsigned)((512 * 1000000ULL) / privateData->rate);
 	return 0;
 }
 
+qint64 SoundCardDataSource::lastBlockTimestamp() const
+{
+	return privateData->blockTimestamp;
+}
+
+QString SoundCardDataSource::statistics() const
+{
+	return privateData->statistics();
+}
+
 unsigned SoundCardDataSource::inputCount() const
 {
-	return 2;
+	return privateData->channelCount;
 }
 
 unsigned SoundCardDataSource::samplingRate() const
 {
-	return 44100;
+	return privateData->rate;
 }
 
 unsigned SoundCardDataSource::unitPerVoltCount() const
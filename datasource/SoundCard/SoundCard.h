@@ -48,6 +48,17 @@ public:
 };
 
 //! SoundCard, a sound input capture source
+/*!
+	Under Linux, capture goes through ALSA when available, and OSS otherwise.
+	The device, rate, channel count, period size and number of periods are
+	read from the soundCard group of the settings, and adjusted to the nearest
+	values the device supports. Their defaults are "default", 44100 Hz,
+	2 channels and 4 periods of 512 frames.
+	With ALSA, samples are de-interleaved in place from the memory mapped
+	device buffer, overruns are counted and every block is timestamped.
+	Overruns and stalls are shown while acquiring and printed when the data
+	source is destroyed.
+*/
 class SoundCardDataSource : public DataSource
 {
 private:
@@ -60,6 +71,8 @@ public:
 	virtual ~SoundCardDataSource();
 	virtual bool init(void);
 	virtual unsigned getRawData(std::valarray<std::valarray<signed short> > *data);
+	virtual qint64 lastBlockTimestamp() const;
+	virtual QString statistics() const;
 	
 	virtual unsigned inputCount() const;
 	virtual unsigned samplingRate() const;
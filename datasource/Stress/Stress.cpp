@@ -0,0 +1,278 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include <QtCore>
+#include <QDialog>
+#include <QLabel>
+#include <QSpinBox>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include "Stress.h"
+#include <Stress.moc>
+#include "Settings.h"
+
+namespace StressDataSourceConstants
+{
+	const unsigned MaxChannelCount = 256; //!< maximum number of channels, all are converted and processed although views only show the first 32
+	const unsigned MaxSamplingRate = 50000000; //!< maximum sampling rate in Hz
+}
+
+//! Default configuration: 16 channels of mixed waveforms at 1 MHz with sequence counters
+StressConfiguration::StressConfiguration() :
+	channelCount(16),
+	samplingRate(1000000),
+	waveformMix(MIX_ALL),
+	burstLength(0),
+	burstGap(0),
+	sequenceCounters(true)
+{
+}
+
+//! Load configuration from the stress group of the settings
+void StressConfiguration::load()
+{
+	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+	settings.beginGroup("stress");
+	channelCount = qBound(1u, settings.value("channelCount", channelCount).toUInt(), StressDataSourceConstants::MaxChannelCount);
+	samplingRate = qBound(1u, settings.value("samplingRate", samplingRate).toUInt(), StressDataSourceConstants::MaxSamplingRate);
+	waveformMix = (WaveformMix)qBound(0u, settings.value("waveformMix", (unsigned)waveformMix).toUInt(), (unsigned)MIX_ALL);
+	burstLength = settings.value("burstLength", burstLength).toUInt();
+	burstGap = settings.value("burstGap", burstGap).toUInt();
+	sequenceCounters = settings.value("sequenceCounters", sequenceCounters).toBool();
+	settings.endGroup();
+}
+
+//! Save configuration to the stress group of the settings
+void StressConfiguration::save() const
+{
+	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+	settings.beginGroup("stress");
+	settings.setValue("channelCount", channelCount);
+	settings.setValue("samplingRate", samplingRate);
+	settings.setValue("waveformMix", (unsigned)waveformMix);
+	settings.setValue("burstLength", burstLength);
+	settings.setValue("burstGap", burstGap);
+	settings.setValue("sequenceCounters", sequenceCounters);
+	settings.endGroup();
+}
+
+
+//! Dialog box for configuring the stress data source
+class StressDialog : public QDialog
+{
+public:
+	QSpinBox *channelCount; //!< number of channels
+	QSpinBox *samplingRate; //!< sampling rate in Hz
+	QComboBox *waveformMix; //!< waveforms of the channels
+	QSpinBox *burstLength; //!< number of blocks with signal in a burst
+	QSpinBox *burstGap; //!< number of blocks without signal between bursts
+	QCheckBox *sequenceCounters; //!< whether channels 0 and 1 hold sequence counters
+
+	//! Creates the widgets, initialized from configuration
+	StressDialog(const StressConfiguration &configuration)
+	{
+		QGridLayout *layout = new QGridLayout(this);
+		
+		layout->addWidget(new QLabel(tr("Channels")), 0, 0);
+		channelCount = new QSpinBox();
+		channelCount->setRange(1, StressDataSourceConstants::MaxChannelCount);
+		channelCount->setValue(configuration.channelCount);
+		layout->addWidget(channelCount, 0, 1);
+		
+		layout->addWidget(new QLabel(tr("Sampling rate")), 1, 0);
+		samplingRate = new QSpinBox();
+		samplingRate->setRange(1, StressDataSourceConstants::MaxSamplingRate);
+		samplingRate->setSuffix(tr(" Hz"));
+		samplingRate->setValue(configuration.samplingRate);
+		layout->addWidget(samplingRate, 1, 1);
+		
+		layout->addWidget(new QLabel(tr("Waveforms")), 2, 0);
+		waveformMix = new QComboBox();
+		waveformMix->addItem(tr("Sine"));
+		waveformMix->addItem(tr("Square"));
+		waveformMix->addItem(tr("Triangle"));
+		waveformMix->addItem(tr("Noise"));
+		waveformMix->addItem(tr("Mixed"));
+		waveformMix->setCurrentIndex(configuration.waveformMix);
+		layout->addWidget(waveformMix, 2, 1);
+		
+		layout->addWidget(new QLabel(tr("Burst length (blocks, 0 for continuous)")), 3, 0);
+		burstLength = new QSpinBox();
+		burstLength->setRange(0, 1000000);
+		burstLength->setValue(configuration.burstLength);
+		layout->addWidget(burstLength, 3, 1);
+		
+		layout->addWidget(new QLabel(tr("Gap between bursts (blocks)")), 4, 0);
+		burstGap = new QSpinBox();
+		burstGap->setRange(0, 1000000);
+		burstGap->setValue(configuration.burstGap);
+		layout->addWidget(burstGap, 4, 1);
+		
+		sequenceCounters = new QCheckBox(tr("Sequence counters on channels 0 and 1"));
+		sequenceCounters->setChecked(configuration.sequenceCounters);
+		layout->addWidget(sequenceCounters, 5, 0, 1, 2);
+		
+		QHBoxLayout *buttonsLayout = new QHBoxLayout;
+		buttonsLayout->addStretch();
+		QPushButton *okButton = new QPushButton(tr("Ok"));
+		connect(okButton, SIGNAL(clicked()), SLOT(accept()));
+		buttonsLayout->addWidget(okButton);
+		QPushButton *cancelButton = new QPushButton(tr("Cancel"));
+		connect(cancelButton, SIGNAL(clicked()), SLOT(reject()));
+		buttonsLayout->addWidget(cancelButton);
+		layout->addLayout(buttonsLayout, 6, 0, 1, 2);
+		
+		setWindowTitle("Stress data source");
+	}
+	
+	//! Return the configuration chosen in the dialog
+	StressConfiguration configuration() const
+	{
+		StressConfiguration configuration;
+		configuration.channelCount = channelCount->value();
+		configuration.samplingRate = samplingRate->value();
+		configuration.waveformMix = (StressConfiguration::WaveformMix)waveformMix->currentIndex();
+		configuration.burstLength = burstLength->value();
+		configuration.burstGap = burstGap->value();
+		configuration.sequenceCounters = sequenceCounters->isChecked();
+		return configuration;
+	}
+};
+
+
+QString StressDataSourceDescription::name() const
+{
+	return "Stress generator";
+}
+
+QString StressDataSourceDescription::description() const
+{
+	return "A synthetic many-channel, high-rate data source with sequence counters, for load testing";
+}
+
+DataSource *StressDataSourceDescription::create() const
+{
+	StressConfiguration configuration;
+	configuration.load();
+	
+	StressDialog stressDialog(configuration);
+	if (stressDialog.exec() != QDialog::Rejected)
+	{
+		configuration = stressDialog.configuration();
+		configuration.save();
+	}
+	return new StressDataSource(this, configuration);
+}
+
+
+StressDataSource::StressDataSource(const DataSourceDescription *description, const StressConfiguration &configuration) :
+	DataSource(description),
+	configuration(configuration),
+	pacer(configuration.samplingRate)
+{
+	firstSignalChannel = (configuration.sequenceCounters && (configuration.channelCount >= 2)) ? 2 : 0;
+	sampleIndex = 0;
+	blockIndex = 0;
+	skippedBlocks = 0;
+	
+	// signal channels have periods from 64 to 1024 samples, so that they are visible at any rate
+	oscillators.resize(configuration.channelCount - firstSignalChannel);
+	for (size_t i = 0; i < oscillators.size(); i++)
+	{
+		StressConfiguration::WaveformMix waveform = configuration.waveformMix;
+		if (waveform == StressConfiguration::MIX_ALL)
+			waveform = (StressConfiguration::WaveformMix)(i % StressConfiguration::MIX_ALL);
+		if (waveform == StressConfiguration::MIX_SQUARE)
+			oscillators[i].setWaveform(Oscillator::WAVEFORM_SQUARE);
+		else if (waveform == StressConfiguration::MIX_TRIANGLE)
+			oscillators[i].setWaveform(Oscillator::WAVEFORM_TRIANGLE);
+		oscillators[i].setAmplitude(waveform == StressConfiguration::MIX_NOISE ? 0 : 1000);
+		oscillators[i].setFrequency(1, 64 * (double)(1 + i % 16));
+	}
+}
+
+StressDataSource::~StressDataSource()
+{
+	if (skippedBlocks)
+		qDebug() << "StressDataSource : skipped" << skippedBlocks << "blocks, that is" << skippedBlocks * 512 << "samples, because it was read too late";
+}
+
+unsigned StressDataSource::getRawData(std::valarray<std::valarray<signed short> > *data)
+{
+	Q_ASSERT(data->size() >= configuration.channelCount);
+	
+	// sequence counters
+	if (firstSignalChannel)
+	{
+		signed short *low = &(*data)[0][0];
+		signed short *high = &(*data)[1][0];
+		for (unsigned sample = 0; sample < 512; sample++)
+		{
+			const quint64 index = sampleIndex + sample;
+			low[sample] = (signed short)(index & 0x7FFF);
+			high[sample] = (signed short)((index >> 15) & 0x7FFF);
+		}
+	}
+	
+	// signals, silent between bursts
+	const bool inBurst = (configuration.burstLength == 0) || ((blockIndex % (configuration.burstLength + configuration.burstGap)) < configuration.burstLength);
+	for (size_t i = 0; i < oscillators.size(); i++)
+	{
+		signed short *dest = &(*data)[firstSignalChannel + i][0];
+		oscillators[i].generate(dest, 512);
+		if (!inBurst)
+			std::fill(dest, dest + 512, 0);
+		else if ((configuration.waveformMix == StressConfiguration::MIX_NOISE) || ((configuration.waveformMix == StressConfiguration::MIX_ALL) && (i % StressConfiguration::MIX_ALL == StressConfiguration::MIX_NOISE)))
+			noiseGenerator.add(dest, 512, 300, NoiseGenerator::DISTRIBUTION_GAUSSIAN);
+	}
+	
+	// wait until these samples would have been acquired, skipping the blocks a real device would have lost if we are too late
+	const unsigned skipped = pacer.wait();
+	if (skipped)
+	{
+		QMutexLocker locker(&statisticsMutex);
+		skippedBlocks += skipped;
+	}
+	sampleIndex += (quint64)(1 + skipped) * 512;
+	blockIndex += 1 + skipped;
+	
+	return 0;
+}
+
+//! Return the number of blocks skipped so far, followed by the statistics of the pacer
+QString StressDataSource::statistics() const
+{
+	QMutexLocker locker(&statisticsMutex);
+	return QString("Skipped blocks: %0\n").arg(skippedBlocks) + pacer.statistics();
+}
+
+Q_EXPORT_PLUGIN(StressDataSourceDescription)
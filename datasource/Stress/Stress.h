@@ -0,0 +1,121 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __STRESS_H
+#define __STRESS_H
+
+#include <DataSource.h>
+#include <QMutex>
+#include <Pacer.h>
+#include <SignalGeneration.h>
+#include <vector>
+
+//! Configuration of the stress data source
+struct StressConfiguration
+{
+	//! Waveforms of the channels
+	enum WaveformMix
+	{
+		MIX_SINE = 0, //!< sinus on all channels
+		MIX_SQUARE, //!< square on all channels
+		MIX_TRIANGLE, //!< triangle on all channels
+		MIX_NOISE, //!< Gaussian noise on all channels
+		MIX_ALL //!< sinus, square, triangle and noise, in turn on consecutive channels
+	};
+	
+	unsigned channelCount; //!< number of channels, including the sequence counters
+	unsigned samplingRate; //!< sampling rate in Hz
+	WaveformMix waveformMix; //!< waveforms of the channels
+	unsigned burstLength; //!< number of blocks with signal in a burst, 0 for a continuous signal
+	unsigned burstGap; //!< number of blocks without signal between bursts
+	bool sequenceCounters; //!< if true, channels 0 and 1 hold the low and high 15 bits of the sample index
+	
+	StressConfiguration();
+	void load();
+	void save() const;
+};
+
+//! Stress, a synthetic many-channel, high-rate data source for load testing
+/*!
+	This data source generates up to 256 channels at up to 50 MHz, with a
+	mix of waveforms and optional bursts, to check whether the data
+	converter, the processing plugins and the display hold up.
+
+	When sequence counters are enabled, channel 0 holds the 15 low bits
+	and channel 1 the 15 next bits of the index of every sample since
+	acquisition started. Downstream stages, such as the SequenceCheck
+	processing plugin, can thus detect lost or reordered samples.
+	As a real device would, the data source skips the blocks it could not
+	deliver when it is read too late, and the sequence counters jump
+	accordingly. The number of skipped blocks is shown while acquiring and
+	printed when the data source is destroyed.
+*/
+class StressDataSource : public DataSource
+{
+private:
+	friend class StressDataSourceDescription;
+	StressDataSource(const DataSourceDescription *description, const StressConfiguration &configuration);
+	
+public:
+	virtual ~StressDataSource();
+	virtual unsigned getRawData(std::valarray<std::valarray<signed short> > *data);
+	virtual qint64 lastBlockTimestamp() const { return pacer.blockTimestamp(); }
+	virtual bool init(void) { pacer.reset(); return true; }
+	
+	virtual unsigned inputCount() const { return configuration.channelCount; }
+	virtual unsigned samplingRate() const { return configuration.samplingRate; }
+	virtual unsigned unitPerVoltCount() const { return 1000; }
+	virtual QString statistics() const;
+	
+private:
+	StressConfiguration configuration; //!< configuration chosen by the user
+	unsigned firstSignalChannel; //!< first channel that is not a sequence counter
+	std::vector<Oscillator> oscillators; //!< generators of the channels from firstSignalChannel
+	NoiseGenerator noiseGenerator; //!< generator of noise channels
+	Pacer pacer; //!< deliver blocks at the sampling rate
+	quint64 sampleIndex; //!< index of the first sample of the next block since acquisition started
+	quint64 blockIndex; //!< index of the next block, to generate bursts
+	mutable QMutex statisticsMutex; //!< protects skippedBlocks, which the GUI thread reads
+	quint64 skippedBlocks; //!< number of blocks skipped because the data source was read too late
+};
+
+//! Description of Stress, a synthetic many-channel, high-rate data source for load testing
+class StressDataSourceDescription : public QObject, public DataSourceDescription
+{
+	Q_OBJECT
+	Q_INTERFACES(DataSourceDescription)
+
+public:
+	virtual QString name() const;
+	virtual QString description() const;
+	
+	virtual DataSource *create() const;
+};
+
+#endif
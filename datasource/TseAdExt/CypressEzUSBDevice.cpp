@@ -138,28 +138,175 @@ public:
 
 #if defined(Q_OS_UNIX)
 
-#include <usb.h>
+#include <libusb.h>
+#include <vector>
+#include <time.h>
 
 //! Private data for CypressEzUSB device
 class CypressEzUSBDevice::Private
 {
 public:
+	//! Time given to cancelled transfers to complete when stopping the stream, in ms
+	static const unsigned StopTimeout = 2000;
+	
 	//! Init lib usb
 	Private()
 	{
-		usb_init();
+		if (libusb_init(&context) != 0)
+		{
+			qDebug() << "CypressEzUSBDevice::Private::Private() : can't init libusb";
+			context = NULL;
+		}
 		dev = NULL;
+		claimedInterface = -1;
+		handler = NULL;
+		transferSize = 0;
+		activeTransfers = 0;
+		streamFailed = false;
+		stopping = false;
 	}
 	
-	//! Close device if opened
+	//! Stop stream and close device if opened
 	~Private()
 	{
+		stopStream();
 		if (dev)
-			usb_close(dev);
+		{
+			if (claimedInterface >= 0)
+				libusb_release_interface(dev, claimedInterface);
+			libusb_close(dev);
+		}
+		if (context)
+			libusb_exit(context);
+	}
+	
+	//! Return the time in microseconds from a monotonic clock
+	static double now()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
 	}
 	
-	//! Handle to device
-	usb_dev_handle *dev;
+	//! Submit transfer index of the stream, return false on error
+	bool submit(unsigned index)
+	{
+		submitTimes[index] = now();
+		int res = libusb_submit_transfer(transfers[index]);
+		if (res != 0)
+		{
+			qDebug() << "CypressEzUSBDevice::Private::submit(" << index << ") :" << libusb_error_name(res);
+			streamFailed = true;
+			return false;
+		}
+		inFlight[index] = true;
+		activeTransfers++;
+		return true;
+	}
+	
+	//! Called by libusb when a transfer of the stream completed
+	static void LIBUSB_CALL transferCallback(struct libusb_transfer *transfer)
+	{
+		Private *p = static_cast<Private *>(transfer->user_data);
+		// a transfer leaked by stopStream, nothing refers to it anymore
+		if (!p)
+			return;
+		const unsigned index = (transfer->buffer - &p->bufferPool[0]) / p->transferSize;
+		p->inFlight[index] = false;
+		p->activeTransfers--;
+		
+		// measure
+		const double latency = now() - p->submitTimes[index];
+		p->latencySum += latency;
+		if (latency > p->statistics.maxLatency)
+			p->statistics.maxLatency = latency;
+		
+		switch (transfer->status)
+		{
+			case LIBUSB_TRANSFER_COMPLETED:
+			if ((size_t)transfer->actual_length == p->transferSize)
+			{
+				p->statistics.completedTransfers++;
+				p->statistics.byteCount += transfer->actual_length;
+				p->handler->transferCompleted((const char *)transfer->buffer, transfer->actual_length);
+			}
+			else
+				p->statistics.missedTransfers++;
+			break;
+			
+			case LIBUSB_TRANSFER_CANCELLED:
+			return;
+			
+			case LIBUSB_TRANSFER_NO_DEVICE:
+			qDebug() << "CypressEzUSBDevice::Private::transferCallback() : device disconnected";
+			p->statistics.missedTransfers++;
+			p->streamFailed = true;
+			return;
+			
+			default:
+			p->statistics.missedTransfers++;
+			break;
+		}
+		
+		// keep the transfer in flight
+		if (!p->stopping)
+			p->submit(index);
+	}
+	
+	//! Cancel all transfers of the stream, wait at most StopTimeout until they are finished and free them. Transfers still in flight are leaked with their buffers, as libusb may still complete them
+	void stopStream()
+	{
+		if (transfers.empty())
+			return;
+		stopping = true;
+		for (size_t i = 0; i < transfers.size(); i++)
+			if (inFlight[i])
+				libusb_cancel_transfer(transfers[i]);
+		const double deadline = now() + StopTimeout * 1000.;
+		while ((activeTransfers > 0) && (now() < deadline))
+		{
+			struct timeval tv;
+			tv.tv_sec = 0;
+			tv.tv_usec = 100000;
+			const int res = libusb_handle_events_timeout(context, &tv);
+			if (res != 0)
+				qDebug() << "CypressEzUSBDevice::Private::stopStream() :" << libusb_error_name(res);
+		}
+		for (size_t i = 0; i < transfers.size(); i++)
+		{
+			if (inFlight[i])
+				transfers[i]->user_data = NULL;
+			else
+				libusb_free_transfer(transfers[i]);
+		}
+		if (activeTransfers > 0)
+		{
+			qDebug() << "CypressEzUSBDevice::Private::stopStream() :" << activeTransfers << "transfers did not complete, leaking them";
+			// the leaked transfers still point to the buffers
+			std::vector<unsigned char> *leakedBuffers = new std::vector<unsigned char>;
+			leakedBuffers->swap(bufferPool);
+			activeTransfers = 0;
+		}
+		transfers.clear();
+		stopping = false;
+	}
+	
+	libusb_context *context; //!< libusb context, NULL if libusb could not be initialised
+	libusb_device_handle *dev; //!< Handle to device
+	int claimedInterface; //!< interface claimed by setInterface, -1 if none
+	
+	std::vector<libusb_transfer *> transfers; //!< transfers of the stream, empty if no stream
+	std::vector<unsigned char> bufferPool; //!< buffers of all transfers of the stream, transferSize bytes each
+	std::vector<double> submitTimes; //!< time at which each transfer was submitted, in microseconds
+	std::vector<bool> inFlight; //!< whether each transfer is submitted and its callback has not run yet
+	USBStreamHandler *handler; //!< receiver of the stream data
+	size_t transferSize; //!< size of each transfer of the stream
+	unsigned activeTransfers; //!< number of transfers in flight
+	bool streamFailed; //!< true if the stream can't continue
+	bool stopping; //!< true when the stream is being stopped, transfers must not be resubmitted
+	double startTime; //!< time at which the stream was started, in microseconds
+	double latencySum; //!< sum of all transfer latencies, in microseconds
+	USBStreamStatistics statistics; //!< measurements of the stream
 };
 
 #endif // Q_OS_UNIX
@@ -232,26 +379,11 @@ bool CypressEzUSBDevice::open(const QString &firmwareFilename)
 	system(commandLine.toLocal8Bit().data());
 	#endif // TSEADEXT_NO_FX2_FW_LOAD
 	
-	// look at all devices
-	struct usb_bus *busses;
-	usb_find_busses();
-	usb_find_devices();
-	busses = usb_get_busses();
-	
-	// iterator on all buses
-	for (struct usb_bus *bus = busses; bus; bus = bus->next)
-	{
-		// iterate on all devices
-		for (struct usb_device *dev = bus->devices; dev; dev = dev->next)
-		{
-			if ((dev->descriptor.idVendor == 0x04b4) && (dev->descriptor.idProduct == 0x8613))
-			{
-				p->dev = usb_open(dev);
-				//qDebug() << "CypressEzUSBDevice::open(" << firmwareFilename << ") : opened device " << bus->dirname << dev->filename;
-				return true;
-			}
-		}
-	}
+	// look for the first fx2 device
+	if (p->context)
+		p->dev = libusb_open_device_with_vid_pid(p->context, 0x04b4, 0x8613);
+	if (p->dev)
+		return true;
 	
 	// print an error
 	qDebug() << "CypressEzUSBDevice::open(" << firmwareFilename << ") : no valid device found";
@@ -271,13 +403,17 @@ bool CypressEzUSBDevice::close(void)
 	
 	#if defined(Q_OS_UNIX)
 	
-	int res = usb_close(p->dev);
-	p->dev = NULL;
-	if (res != 0)
-	{
-		qDebug() << usb_strerror();
+	if (!p->dev)
 		return false;
+	
+	p->stopStream();
+	if (p->claimedInterface >= 0)
+	{
+		libusb_release_interface(p->dev, p->claimedInterface);
+		p->claimedInterface = -1;
 	}
+	libusb_close(p->dev);
+	p->dev = NULL;
 	
 	return true;
 	
@@ -310,14 +446,17 @@ bool CypressEzUSBDevice::setInterface(unsigned number, unsigned alternateSetting
 	
 	#if defined(Q_OS_UNIX)
 	
-	if (usb_claim_interface(p->dev, number) != 0)
+	int res = libusb_claim_interface(p->dev, number);
+	if (res != 0)
 	{
-		qDebug() << usb_strerror();
+		qDebug() << libusb_error_name(res);
 		return false;
 	}
-	if (usb_set_altinterface(p->dev, alternateSetting) != 0)
+	p->claimedInterface = number;
+	res = libusb_set_interface_alt_setting(p->dev, number, alternateSetting);
+	if (res != 0)
 	{
-		qDebug() << usb_strerror();
+		qDebug() << libusb_error_name(res);
 		return false;
 	}
 	return true;
@@ -353,11 +492,12 @@ unsigned CypressEzUSBDevice::bulkRead(unsigned pipeNum, char *buffer, size_t siz
 	
 	#if defined(Q_OS_UNIX)
 	
-	int count = usb_bulk_read(p->dev, pipeNum, buffer, size, 1000);
-	if (count < 0)
+	int count;
+	int res = libusb_bulk_transfer(p->dev, pipeNum | LIBUSB_ENDPOINT_IN, (unsigned char *)buffer, size, &count, 1000);
+	if (res != 0)
 	{
 		qDebug() << "CypressEzUSBDevice::bulkRead(" << pipeNum << "," << (size_t)buffer << "," << size << ")";
-		qDebug() << usb_strerror();
+		qDebug() << libusb_error_name(res);
 		return 0;
 	}
 	return (unsigned)count;
@@ -392,14 +532,101 @@ unsigned CypressEzUSBDevice::bulkWrite(unsigned pipeNum, const char *buffer, siz
 	
 	#if defined(Q_OS_UNIX)
 	
-	int count = usb_bulk_write(p->dev, pipeNum, (char *)buffer, size, 1000);
-	if (count < 0)
+	int count;
+	int res = libusb_bulk_transfer(p->dev, pipeNum & ~LIBUSB_ENDPOINT_IN, (unsigned char *)buffer, size, &count, 1000);
+	if (res != 0)
 	{
 		qDebug() << "CypressEzUSBDevice::bulkWrite(" << pipeNum << "," << (size_t)buffer << "," << size << ")";
-		qDebug() << usb_strerror();
+		qDebug() << libusb_error_name(res);
 		return 0;
 	}
 	return (unsigned)count;
 	
 	#endif // Q_OS_UNIX
 }
+
+#if defined(Q_OS_UNIX)
+
+//! Allocate transferCount transfers of transferSize bytes on pipeNum and submit them all
+bool CypressEzUSBDevice::startBulkReadStream(unsigned pipeNum, size_t transferSize, unsigned transferCount, USBStreamHandler *handler)
+{
+	Q_ASSERT(handler);
+	Q_ASSERT(transferCount > 0);
+	if (!p->dev || !p->transfers.empty())
+		return false;
+	
+	// preallocate the buffers and the transfers
+	p->handler = handler;
+	p->transferSize = transferSize;
+	p->bufferPool.resize(transferSize * transferCount);
+	p->submitTimes.resize(transferCount);
+	p->inFlight.assign(transferCount, false);
+	p->transfers.resize(transferCount);
+	for (unsigned i = 0; i < transferCount; i++)
+	{
+		p->transfers[i] = libusb_alloc_transfer(0);
+		if (!p->transfers[i])
+		{
+			qDebug() << "CypressEzUSBDevice::startBulkReadStream() : can't allocate transfer";
+			p->transfers.resize(i);
+			stopBulkReadStream();
+			return false;
+		}
+		libusb_fill_bulk_transfer(p->transfers[i], p->dev, pipeNum | LIBUSB_ENDPOINT_IN, &p->bufferPool[i * transferSize], transferSize, Private::transferCallback, p, 1000);
+	}
+	
+	// reset measurements
+	p->statistics = USBStreamStatistics();
+	p->latencySum = 0;
+	p->streamFailed = false;
+	p->startTime = Private::now();
+	
+	// put all transfers in flight
+	for (unsigned i = 0; i < transferCount; i++)
+		if (!p->submit(i))
+		{
+			stopBulkReadStream();
+			return false;
+		}
+	
+	return true;
+}
+
+//! Handle libusb events for at most timeout ms. Completed transfers are given to the handler and resubmitted from this call
+bool CypressEzUSBDevice::handleStreamEvents(unsigned timeout)
+{
+	if (p->transfers.empty() || p->streamFailed)
+		return false;
+	
+	struct timeval tv;
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+	int res = libusb_handle_events_timeout(p->context, &tv);
+	if (res != 0)
+	{
+		qDebug() << "CypressEzUSBDevice::handleStreamEvents() :" << libusb_error_name(res);
+		return false;
+	}
+	return !p->streamFailed;
+}
+
+//! Cancel all transfers and free them
+void CypressEzUSBDevice::stopBulkReadStream()
+{
+	p->stopStream();
+}
+
+//! Return the measurements of the stream, throughput and average latency are computed now
+USBStreamStatistics CypressEzUSBDevice::streamStatistics() const
+{
+	USBStreamStatistics statistics = p->statistics;
+	const double duration = Private::now() - p->startTime;
+	if (duration > 0)
+		statistics.throughput = (double)statistics.byteCount * 1e6 / duration;
+	const unsigned transferCount = statistics.completedTransfers + statistics.missedTransfers;
+	if (transferCount > 0)
+		statistics.averageLatency = p->latencySum / (double)transferCount;
+	return statistics;
+}
+
+#endif // Q_OS_UNIX
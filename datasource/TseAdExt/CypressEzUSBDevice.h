@@ -34,7 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "USBDevice.h"
 
-//! USB interface to the Cypress EzUSB FX/FX2 chip, using Cypres EzUSB driver
+//! USB interface to the Cypress EzUSB FX/FX2 chip, using Cypres EzUSB driver on Windows and libusb-1.0 on UNIX
 class CypressEzUSBDevice : public USBDevice
 {
 private:
@@ -49,6 +49,12 @@ public:
 	virtual bool setInterface(unsigned number, unsigned alternateSetting);
 	virtual unsigned bulkRead(unsigned pipeNum, char *buffer, size_t size);
 	virtual unsigned bulkWrite(unsigned pipeNum, const char *buffer, size_t size);
+	#if defined(Q_OS_UNIX)
+	virtual bool startBulkReadStream(unsigned pipeNum, size_t transferSize, unsigned transferCount, USBStreamHandler *handler);
+	virtual bool handleStreamEvents(unsigned timeout);
+	virtual void stopBulkReadStream();
+	virtual USBStreamStatistics streamStatistics() const;
+	#endif // Q_OS_UNIX
 };
 
 #endif
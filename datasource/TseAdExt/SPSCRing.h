@@ -0,0 +1,191 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SPSC_RING_H
+#define __SPSC_RING_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include <vector>
+#include <climits>
+
+//! Lock-free ring of T, for one producer thread and one consumer thread
+/*!
+	The producer gets a slot with writeSlot(), fills it and publishes it
+	with commit(). If the ring is full, writeSlot() returns NULL and
+	counts a dropped element: the producer never waits.
+
+	The consumer waits for elements with waitAvailable(), reads all
+	available ones with at() and frees them at once with release().
+	Waiting only involves the operating system when the ring is empty:
+	the consumer then sleeps, and the producer only wakes it if it
+	announced it was sleeping.
+
+	Indices written by each side lie in separate cache lines, and each
+	side keeps a copy of the other's index that is only refreshed when
+	the ring seems full (producer) or empty (consumer).
+*/
+template<typename T>
+class SPSCRing
+{
+public:
+	//! Construct a ring of at least depth elements, rounded up to a power of two
+	SPSCRing(unsigned depth) :
+		writeIndex(0),
+		producerWriteIndex(0),
+		producerReadIndex(0),
+		readIndex(0),
+		consumerReadIndex(0),
+		consumerWriteIndex(0),
+		consumerWaiting(0),
+		dropped(0),
+		slots(roundToPowerOfTwo(depth)),
+		mask(slots.size() - 1)
+	{
+		Q_ASSERT(depth > 0);
+	}
+	
+	//! Return the number of elements of the ring
+	unsigned depth() const { return slots.size(); }
+	
+	//! Producer: return the slot to fill next, or NULL if the ring is full, in which case the element is counted as dropped
+	T *writeSlot()
+	{
+		if (producerWriteIndex - producerReadIndex >= depth())
+		{
+			producerReadIndex = readIndex.fetchAndAddAcquire(0);
+			if (producerWriteIndex - producerReadIndex >= depth())
+			{
+				dropped.ref();
+				return NULL;
+			}
+		}
+		return &slots[producerWriteIndex & mask];
+	}
+	
+	//! Producer: publish the slot returned by writeSlot(), and wake the consumer if it is waiting
+	void commit()
+	{
+		producerWriteIndex++;
+		// ordered, so that the store is visible before we check whether consumer waits
+		writeIndex.fetchAndStoreOrdered(producerWriteIndex);
+		if (consumerWaiting.fetchAndAddOrdered(0))
+		{
+			QMutexLocker locker(&mutex);
+			notEmpty.wakeOne();
+		}
+	}
+	
+	//! Consumer: return the number of elements available for reading
+	unsigned available()
+	{
+		consumerWriteIndex = writeIndex.fetchAndAddAcquire(0);
+		return consumerWriteIndex - consumerReadIndex;
+	}
+	
+	//! Consumer: wait until at least count elements are available, or timeout ms if timeout is not 0. Return the number of available elements
+	unsigned waitAvailable(unsigned count, unsigned long timeout = 0)
+	{
+		Q_ASSERT(count <= depth());
+		unsigned n = consumerWriteIndex - consumerReadIndex;
+		if (n >= count)
+			return n;
+		n = available();
+		while (n < count)
+		{
+			QMutexLocker locker(&mutex);
+			// announce that we wait, ordered so that producer sees it before we check again
+			consumerWaiting.fetchAndStoreOrdered(1);
+			n = available();
+			bool signaled = true;
+			if (n < count)
+				signaled = notEmpty.wait(&mutex, timeout ? timeout : ULONG_MAX);
+			consumerWaiting.fetchAndStoreOrdered(0);
+			n = available();
+			if (!signaled)
+				break;
+		}
+		return n;
+	}
+	
+	//! Consumer: return the i-th available element
+	const T &at(unsigned i) const
+	{
+		Q_ASSERT(i < consumerWriteIndex - consumerReadIndex);
+		return slots[(consumerReadIndex + i) & mask];
+	}
+	
+	//! Consumer: free the count first available elements
+	void release(unsigned count)
+	{
+		Q_ASSERT(count <= consumerWriteIndex - consumerReadIndex);
+		consumerReadIndex += count;
+		readIndex.fetchAndStoreRelease(consumerReadIndex);
+	}
+	
+	//! Return the number of elements dropped by the producer because the ring was full
+	unsigned droppedCount() const { return (int)dropped; }
+	
+private:
+	//! Size of a cache line, used to put the data of each thread in its own line
+	enum { CacheLineSize = 64 };
+	
+	//! Return the smallest power of two greater or equal to v
+	static unsigned roundToPowerOfTwo(unsigned v)
+	{
+		unsigned result = 1;
+		while (result < v)
+			result <<= 1;
+		return result;
+	}
+	
+	char padding0[CacheLineSize]; //!< separate from preceding data
+	
+	// written by producer
+	QAtomicInt writeIndex; //!< number of elements ever published
+	unsigned producerWriteIndex; //!< producer's copy of writeIndex
+	unsigned producerReadIndex; //!< producer's copy of readIndex, refreshed when ring seems full
+	char padding1[CacheLineSize - sizeof(QAtomicInt) - 2 * sizeof(unsigned)]; //!< separate producer and consumer data
+	
+	// written by consumer
+	QAtomicInt readIndex; //!< number of elements ever released
+	unsigned consumerReadIndex; //!< consumer's copy of readIndex
+	unsigned consumerWriteIndex; //!< consumer's copy of writeIndex, refreshed when ring seems empty
+	QAtomicInt consumerWaiting; //!< 1 if the consumer sleeps or is about to, waiting for elements
+	char padding2[CacheLineSize - 2 * sizeof(QAtomicInt) - 2 * sizeof(unsigned)]; //!< separate producer and consumer data
+	
+	QAtomicInt dropped; //!< number of elements dropped because the ring was full
+	QMutex mutex; //!< mutex for notEmpty, only used when consumer sleeps
+	QWaitCondition notEmpty; //!< signaled when an element is published and the consumer sleeps
+	std::vector<T> slots; //!< storage of elements
+	const unsigned mask; //!< mask to get a slot from an index, indices wrap around naturally as the size is a power of two
+};
+
+#endif
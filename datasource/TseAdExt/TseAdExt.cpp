@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 
 #include <algorithm>
+#include <cstring>
 #include <QtCore>
 #include <QString>
 #include <QListWidget>
@@ -37,6 +38,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "TseAdExt.h"
 #include <TseAdExt.moc>
 #include "CypressEzUSBDevice.h"
+#include "Settings.h"
+#include <SampleConversion.h>
 
 //! Dialog box for choosing datasource frequency
 class FrequencyDialog : public QDialog
@@ -74,13 +77,20 @@ DataSource *TseAdExtDataSourceDescription::create() const
 }
 
 
+//! Return the number of chunks of the circular buffer, from settings. It must hold at least the 10 chunks of the lowest frequency
+static unsigned chunkBufferDepth()
+{
+	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+	return std::max(settings.value("tseAdExt/chunkBufferDepth", (unsigned)TseAdExtDataSourceConstants::ChunkBufferSize).toUInt(), 10u);
+}
+
 TseAdExtDataSource::TseAdExtDataSource(const DataSourceDescription *description, unsigned sliceLength) :
 	DataSource(description),
-	freeChunks(TseAdExtDataSourceConstants::ChunkBufferSize),
-	usedChunks(0),
+	chunks(chunkBufferDepth()),
+	decimator(8, 1, sliceLength),
 	sliceLength(sliceLength)
 {
-	chunk = 0;
+	deinterleavedChunk.resize(TseAdExtDataSourceConstants::DataChunkSize);
 	quit = false;
 	device = NULL;
 }
@@ -99,36 +109,37 @@ TseAdExtDataSource::~TseAdExtDataSource()
 unsigned TseAdExtDataSource::getRawData(std::valarray<std::valarray<signed short> > *data)
 {
 	Q_ASSERT(data->size() >= 8);
-	size_t destSample = 0;
+	signed short *dest[8];
+	for (size_t channel = 0; channel < 8; channel++)
+		dest[channel] = &(*data)[channel][0];
 
-	for (unsigned block = 0; block < sliceLength; block++)
+	if (sliceLength == 1)
 	{
-		// get data
-		usedChunks.acquire();
-	
-		// extend sign and linearise datas
-		for (size_t sample = 0; sample < 512;)
+		// extend sign from 14th bit to 16th bit and linearise datas directly into destination
+		chunks.waitAvailable(1);
+		SampleConversion::deinterleave8(chunks.at(0).data, dest, 512, TseAdExtDataSourceConstants::ConverterBits);
+		chunks.release(1);
+	}
+	else
+	{
+		signed short *linearChunk[8];
+		for (size_t channel = 0; channel < 8; channel++)
+			linearChunk[channel] = &deinterleavedChunk[channel * 512];
+		
+		// low-pass filter and decimate chunks until enough samples are available, waiting only if less chunks than required are available, and processing them all at once
+		while (decimator.available() < 512)
 		{
-			for (size_t channel = 0; channel < 8; channel++)
+			const unsigned chunkCount = ((512 - decimator.available()) * sliceLength + 511) / 512;
+			chunks.waitAvailable(chunkCount);
+			for (unsigned block = 0; block < chunkCount; block++)
 			{
-				unsigned short raw = (unsigned short)chunkBuffer[chunk % TseAdExtDataSourceConstants::ChunkBufferSize].data[(sample * 8 + channel)];
-	
-				// extend sign from 14th bit to 16th bit: this is because our converter is only 14 bits
-				if (raw & 0x2000)
-					raw |= 0xc000;
-	
-				signed short value = (signed short)raw;
-				(*data)[channel][destSample] = value;
+				// extend sign and linearise datas
+				SampleConversion::deinterleave8(chunks.at(block).data, linearChunk, 512, TseAdExtDataSourceConstants::ConverterBits);
+				decimator.push(linearChunk, 512);
 			}
-			sample += sliceLength;
-			destSample++;
+			chunks.release(chunkCount);
 		}
-	
-		// next chunk
-		chunk++;
-		
-		// release data
-		freeChunks.release();
+		decimator.pop(data, 512);
 	}
 
 	return 0;
@@ -189,7 +200,7 @@ bool TseAdExtDataSource::init()
 	return true;
 }
 
-//! USB thread: continuously poll data from USB and fill them into circular buffer
+//! USB thread: continuously stream data from USB and fill them into circular buffer
 void TseAdExtDataSource::run()
 {
 	#if defined(Q_OS_UNIX)
@@ -200,24 +211,75 @@ void TseAdExtDataSource::run()
 	const unsigned READ_PIPE = 4;
 	#endif
 
-	size_t sourceChunk = 0;
-	while (!quit)
+	// stream with several transfers in flight if device supports it
+	if (device->startBulkReadStream(READ_PIPE, TseAdExtDataSourceConstants::DataChunkSize * 2, TseAdExtDataSourceConstants::TransferCount, this))
 	{
-		if (!freeChunks.tryAcquire())
+		while (!quit)
 		{
-			//emit(statusUpdated(tr("Acquisition warning : no more free chunk, risk of loosing input data")));
-			freeChunks.acquire();
+			// transferCompleted is called from here
+			if (!device->handleStreamEvents(100))
+			{
+				qDebug() << "TseAdExtDataSource::run() : USB stream failed";
+				break;
+			}
+			
+			// publish statistics for the GUI thread
+			const USBStreamStatistics stream = device->streamStatistics();
+			QMutexLocker locker(&statisticsMutex);
+			streamStatistics = stream;
 		}
+		reportStatistics(device->streamStatistics());
+		device->stopBulkReadStream();
+		return;
+	}
+	
+	// otherwise read one chunk at a time, into a chunk of the buffer if there is one free
+	DataChunk overrunChunk;
+	while (!quit)
+	{
+		DataChunk *dest = chunks.writeSlot();
 		
-		bool result = device->bulkRead(READ_PIPE, (char *)chunkBuffer[sourceChunk % TseAdExtDataSourceConstants::ChunkBufferSize].data, 512 * 8 * 2);
+		bool result = device->bulkRead(READ_PIPE, (char *)(dest ? dest : &overrunChunk)->data, 512 * 8 * 2);
 		Q_ASSERT(result);
 		if (!result)
 			quit = true;
 
-		sourceChunk++;
-
-		usedChunks.release();
+		if (dest)
+			chunks.commit();
 	}
 }
 
+//! Called by the USB device from the USB thread when a chunk has been received, copy it into circular buffer
+void TseAdExtDataSource::transferCompleted(const char *buffer, size_t size)
+{
+	Q_ASSERT(size == TseAdExtDataSourceConstants::DataChunkSize * 2);
+	
+	// never wait in the USB thread, drop chunk if buffer is full
+	DataChunk *dest = chunks.writeSlot();
+	if (!dest)
+		return;
+	memcpy(dest->data, buffer, size);
+	chunks.commit();
+}
+
+//! Return the statistics of the USB stream so far
+QString TseAdExtDataSource::statistics() const
+{
+	QMutexLocker locker(&statisticsMutex);
+	const USBStreamStatistics &s = streamStatistics;
+	QString text;
+	text += QString("Throughput: %0 kB/s\n").arg(s.throughput / 1024., 0, 'f', 1);
+	text += QString("Completed transfers: %0\n").arg(s.completedTransfers);
+	text += QString("Missed transfers: %0\n").arg(s.missedTransfers);
+	text += QString("Latency: %0 us average, %1 us max\n").arg(s.averageLatency, 0, 'f', 0).arg(s.maxLatency, 0, 'f', 0);
+	text += QString("Chunks dropped on overrun: %0").arg(chunks.droppedCount());
+	return text;
+}
+
+//! Print statistics of the USB stream, when it stops
+void TseAdExtDataSource::reportStatistics(const USBStreamStatistics &stream)
+{
+	qDebug() << "TseAdExtDataSource : USB stream" << stream.throughput / 1024. << "kB/s," << stream.completedTransfers << "transfers," << stream.missedTransfers << "missed, latency" << stream.averageLatency << "us average," << stream.maxLatency << "us max," << chunks.droppedCount() << "chunks dropped on overrun";
+}
+
 Q_EXPORT_PLUGIN(TseAdExtDataSourceDescription)
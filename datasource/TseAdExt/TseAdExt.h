@@ -33,15 +33,18 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <DataSource.h>
 #include <QString>
 #include <QThread>
-#include <QSemaphore>
-
-class USBDevice;
+#include <QMutex>
+#include "USBDevice.h"
+#include "SPSCRing.h"
+#include <PolyphaseResampler.h>
 
 //! Constants for TseAdExtDataSource
 namespace TseAdExtDataSourceConstants
 {
 	const size_t DataChunkSize = 512*8; //!< the number of short int in a chunk
-	const size_t ChunkBufferSize = 32; //!< the number of chunk in the circular buffer
+	const unsigned ConverterBits = 14; //!< the number of bits of the analog to digital converter
+	const size_t ChunkBufferSize = 32; //!< the default number of chunk in the circular buffer, can be changed by the tseAdExt/chunkBufferDepth setting
+	const unsigned TransferCount = 8; //!< the number of USB transfers kept in flight when streaming
 }
 
 //! TseAdExt, an USB 2 based, 8 channel, 14 bits, ~ 25 KHz data source.
@@ -60,13 +63,23 @@ namespace TseAdExtDataSourceConstants
 	To compile the firmware, you'll need Cypress CY3681 EZ-USB FX2 Development Kit.
 	Please search the Cypress web site for it (http://www.cypress.com). 
 
+	When the USB device supports it, data are streamed with TransferCount
+	asynchronous transfers in flight, so that the bus is never idle between
+	two chunks. Otherwise, they are read with one synchronous transfer at a time.
+	Statistics of the USB stream are shown while acquiring and printed when
+	the stream stops.
+
+	Lower sampling rates are obtained by low-pass filtering and decimating
+	the data with a polyphase FIR filter, so that signals above the
+	new Nyquist frequency do not alias.
+
 	Under Windows, this data source automatically loads the firmware.
 	Under Linux, for security reason, you need to load the firmware while
 	in root using the setupfx2 program. If after this, you still have permission
 	problems, make sure that /dev/bus/usb/BUS/DEV is writable by the user executing
 	Osqoop.
  */
-class TseAdExtDataSource : public DataSource,  public QThread
+class TseAdExtDataSource : public DataSource,  public QThread, protected USBStreamHandler
 {
 public:
 	TseAdExtDataSource(const DataSourceDescription *description, unsigned sliceLength);
@@ -80,8 +93,12 @@ public:
 	virtual unsigned inputCount() const { return 8; }
 	virtual unsigned samplingRate() const { return 24500 / sliceLength; }
     virtual unsigned unitPerVoltCount() const { return 1638; }
+	virtual QString statistics() const;
 
 protected:
+	virtual void transferCompleted(const char *buffer, size_t size);
+	void reportStatistics(const USBStreamStatistics &stream);
+	
 	//! An element of the circular buffer containing datas
 	struct DataChunk
 	{
@@ -90,11 +107,12 @@ protected:
 
 	USBDevice *device; //!< USB device
 	bool quit; //!< true if USB thread must stop
-	unsigned chunk; //!< next chunk to be consumed by getRawData
-	QSemaphore freeChunks; //!< Semaphore that counts the number of free chunks in the buffer
-	QSemaphore usedChunks; //!< Semaphore that counts the number of eaten chunks in the buffer
-	DataChunk chunkBuffer[TseAdExtDataSourceConstants::ChunkBufferSize]; //!< Circular buffer, protected by freeChunks and usedChunks semaphore, for data transmission between the USB thread and the converter thread for the TSEADX data source
-	unsigned sliceLength; //!< every which number of source sample one is copied into destination. If 1, all sample are taken
+	SPSCRing<DataChunk> chunks; //!< Lock-free circular buffer for data transmission between the USB thread and the converter thread. Chunks that do not fit are dropped
+	mutable QMutex statisticsMutex; //!< protects streamStatistics
+	USBStreamStatistics streamStatistics; //!< copy of the statistics of the USB stream, updated by the USB thread
+	std::valarray<signed short> deinterleavedChunk; //!< a chunk de-interleaved, when sliceLength is more than 1
+	ResamplingStage decimator; //!< anti-aliasing filter and decimator, when sliceLength is more than 1
+	unsigned sliceLength; //!< decimation factor of the board sampling rate. If 1, all sample are taken unfiltered
 };
 
 //! Description of TseAdExt, an USB 2 based, 8 channel, 14 bits, ~ 25 KHz data source. 
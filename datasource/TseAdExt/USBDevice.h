@@ -32,7 +32,37 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include <QString>
 
+//! Receiver of the data of an asynchronous bulk read stream
+class USBStreamHandler
+{
+public:
+	//! Virtual destructor, do nothing
+	virtual ~USBStreamHandler() { }
+	//! Called by USBDevice::handleStreamEvents when a transfer of size bytes completed. buffer belongs to the device and is only valid during the call
+	virtual void transferCompleted(const char *buffer, size_t size) = 0;
+};
+
+//! Measurements of an asynchronous bulk read stream
+struct USBStreamStatistics
+{
+	//! Constructor, clear all measurements
+	USBStreamStatistics() : byteCount(0), completedTransfers(0), missedTransfers(0), throughput(0), averageLatency(0), maxLatency(0) { }
+	
+	unsigned long long byteCount; //!< number of bytes received since the stream started
+	unsigned completedTransfers; //!< number of transfers that completed with full data
+	unsigned missedTransfers; //!< number of transfers that failed, timed out or were short, and whose data were thus lost
+	double throughput; //!< bytes per second received since the stream started
+	double averageLatency; //!< average time in microseconds between the submission of a transfer and its completion
+	double maxLatency; //!< maximum time in microseconds between the submission of a transfer and its completion
+};
+
 //! Light interface for USB device. Used to abstract the OS specific calls
+/*!
+	Besides synchronous transfers, a device may support streaming bulk reads
+	asynchronously: several transfers are kept in flight using buffers from
+	a pool allocated when the stream starts, so that the bus is never idle.
+	Devices which do not support it return false in startBulkReadStream.
+*/
 class USBDevice
 {
 public:
@@ -48,6 +78,14 @@ public:
 	virtual unsigned bulkRead(unsigned pipeNum, char *buffer, size_t size) = 0;
 	//! Write size bytes on pipeNum from buffer using bulk transfer
 	virtual unsigned bulkWrite(unsigned pipeNum, const char *buffer, size_t size) = 0;
+	//! Start reading pipeNum continuously with transferCount transfers of transferSize bytes in flight. Data are given to handler. Return false if streaming is not supported or failed to start
+	virtual bool startBulkReadStream(unsigned, size_t, unsigned, USBStreamHandler *) { return false; }
+	//! Wait at most timeout ms for stream events, calling the handler for completed transfers and resubmitting them. Return false if the stream failed
+	virtual bool handleStreamEvents(unsigned) { return false; }
+	//! Cancel all transfers in flight and stop the stream
+	virtual void stopBulkReadStream() { }
+	//! Return the measurements of the current stream
+	virtual USBStreamStatistics streamStatistics() const { return USBStreamStatistics(); }
 };
 
 #endif
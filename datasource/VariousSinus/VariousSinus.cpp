@@ -48,24 +48,27 @@ DataSource *VariousSinusDataSourceDescription::create() const
 
 
 VariousSinusDataSource::VariousSinusDataSource(const DataSourceDescription *description) :
-	DataSource(description)
+	DataSource(description),
+	pacer(10000)
 {
-	t = 0;
+	// channel n has a period of 100 * (n + 1) samples
+	for (size_t channel = 0; channel < 8; channel++)
+	{
+		oscillators[channel].setAmplitude(1000);
+		oscillators[channel].setFrequency(1, 100 * (double)(channel + 1));
+	}
 }
 
 unsigned VariousSinusDataSource::getRawData(std::valarray<std::valarray<signed short> > *data)
 {
 	Q_ASSERT(data->size() >= 8);
 
-	for (size_t sample = 0; sample < 512; sample++)
-	{
-		for (size_t channel = 0; channel < 8; channel++)
-		{
-			(*data)[channel][sample] = (signed short)(1000.0 * sin( (t * 2 * M_PI) / (100 * (double)(channel + 1)) ));
-		}
-		t++;
-	}
-	return 1000000 / (10000 / 512);
+	for (size_t channel = 0; channel < 8; channel++)
+		oscillators[channel].generate(&(*data)[channel][0], 512);
+	
+	// wait until these samples would have been acquired
+	pacer.wait();
+	return 0;
 }
 
 unsigned VariousSinusDataSource::inputCount() const
@@ -31,6 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define __VARIOUS_SINUS_H
 
 #include <DataSource.h>
+#include <Pacer.h>
+#include <SignalGeneration.h>
 
 //! Description of VariousSinus, a simple sinus generator of various frequencies
 class VariousSinusDataSourceDescription : public QObject, public DataSourceDescription
@@ -51,11 +53,14 @@ class VariousSinusDataSource : public DataSource
 private:
 	friend class VariousSinusDataSourceDescription;
 	VariousSinusDataSource(const DataSourceDescription *description);
-	double t; //!< time
+	Oscillator oscillators[8]; //!< one sinus generator per channel
+	Pacer pacer; //!< deliver blocks at the sampling rate
 
 public:
 	virtual unsigned getRawData(std::valarray<std::valarray<signed short> > *data);
-	virtual bool init(void) { return true; }
+	virtual qint64 lastBlockTimestamp() const { return pacer.blockTimestamp(); }
+	virtual QString statistics() const { return pacer.statistics(); }
+	virtual bool init(void) { pacer.reset(); return true; }
 	
 	virtual unsigned inputCount() const;
 	virtual unsigned samplingRate() const;
@@ -0,0 +1,190 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "Pacer.h"
+#include "Settings.h"
+#include <QSettings>
+#include <QString>
+#include <QtDebug>
+#include <limits>
+#ifdef Q_OS_WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
+//! Constructor, pace blocks of blockSize samples at samplingRate, in the mode given by the settings
+Pacer::Pacer(unsigned samplingRate, unsigned blockSize)
+{
+	init(samplingRate, blockSize, configuredMode());
+}
+
+//! Constructor, pace blocks of blockSize samples at samplingRate, in mode
+Pacer::Pacer(unsigned samplingRate, unsigned blockSize, Mode mode)
+{
+	init(samplingRate, blockSize, mode);
+}
+
+//! Initialize members and start the schedule
+void Pacer::init(unsigned samplingRate, unsigned blockSize, Mode mode)
+{
+	Q_ASSERT(samplingRate > 0);
+	pacingMode = mode;
+	rate = samplingRate;
+	samplesPerBlock = blockSize;
+	lastLateness = 0;
+	maximumLateness = 0;
+	lateBlocks = 0;
+	resynchronizations = 0;
+	reset();
+}
+
+//! Return the pacing mode given by the dataSource/pacing setting
+Pacer::Mode Pacer::configuredMode()
+{
+	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
+	const QString mode = settings.value("dataSource/pacing", "catchUp").toString();
+	if (mode == "maxSpeed")
+		return MODE_MAX_SPEED;
+	else if (mode == "resynchronize")
+		return MODE_RESYNCHRONIZE;
+	else
+		return MODE_CATCH_UP;
+}
+
+//! Return the current monotonic time in ns
+qint64 Pacer::now()
+{
+	#ifdef Q_OS_WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (qint64)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+	#else
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (qint64)time.tv_sec * 1000000000LL + time.tv_nsec;
+	#endif
+}
+
+//! Restart the schedule at the next call to wait()
+void Pacer::reset()
+{
+	started = false;
+	scheduleStart = 0;
+	blockIndex = 0;
+	lastBlockStart = 0;
+}
+
+//! Return the number of late blocks, the last and maximum lateness and the number of restarts of the schedule, as "name: value" lines for DataSource::statistics
+QString Pacer::statistics() const
+{
+	QMutexLocker locker(&statisticsMutex);
+	QString text;
+	text += QString("Late blocks: %0\n").arg(lateBlocks);
+	text += QString("Lateness: %0 ms last, %1 ms max\n").arg(lastLateness / 1e6, 0, 'f', 1).arg(maximumLateness / 1e6, 0, 'f', 1);
+	text += QString("Resynchronizations: %0").arg(resynchronizations);
+	return text;
+}
+
+//! Return the time in ns from the schedule start to sample, split in whole seconds and remainder so that the product does not overflow
+qint64 Pacer::sampleTime(quint64 sample) const
+{
+	return (qint64)((sample / rate) * 1000000000ULL + ((sample % rate) * 1000000000ULL) / rate);
+}
+
+//! Wait until the current block is due, which is when all its samples would have been acquired by a real device. Return the number of blocks skipped if the schedule was restarted, 0 otherwise
+unsigned Pacer::wait()
+{
+	const qint64 currentTime = now();
+	if (!started)
+	{
+		scheduleStart = currentTime;
+		started = true;
+	}
+	
+	// block start and deadline, computed from the schedule start so that rounding errors do not accumulate
+	const qint64 blockStart = scheduleStart + sampleTime(blockIndex * samplesPerBlock);
+	const qint64 deadline = scheduleStart + sampleTime((blockIndex + 1) * samplesPerBlock);
+	blockIndex++;
+	
+	if (pacingMode == MODE_MAX_SPEED)
+	{
+		lastBlockStart = currentTime;
+		return 0;
+	}
+	lastBlockStart = blockStart;
+	
+	// late: catch up or restart the schedule
+	if (currentTime > deadline)
+	{
+		const qint64 blockLateness = currentTime - deadline;
+		const bool restart = (pacingMode == MODE_RESYNCHRONIZE) || (blockLateness > maxCatchUp);
+		{
+			QMutexLocker locker(&statisticsMutex);
+			lastLateness = blockLateness;
+			maximumLateness = qMax(maximumLateness, blockLateness);
+			lateBlocks++;
+			if (restart)
+				resynchronizations++;
+		}
+		if (restart)
+		{
+			if (pacingMode == MODE_CATCH_UP)
+				qDebug() << "Pacer::wait() : late by" << blockLateness / 1000000 << "ms, restarting schedule";
+			scheduleStart = currentTime;
+			blockIndex = 0;
+			// missed blocks, split like sampleTime() and clamped, as the lateness can be arbitrary after a stall
+			const quint64 lateness = qMin<quint64>(blockLateness, 86400ULL * 1000000000ULL);
+			const quint64 missedSamples = (lateness / 1000000000ULL) * rate + ((lateness % 1000000000ULL) * rate) / 1000000000ULL;
+			return (unsigned)qMin<quint64>(missedSamples / samplesPerBlock, std::numeric_limits<unsigned>::max());
+		}
+		return 0;
+	}
+	
+	// on time, only the thread calling wait() writes lastLateness, so it can be tested without locking
+	if (lastLateness)
+	{
+		QMutexLocker locker(&statisticsMutex);
+		lastLateness = 0;
+	}
+	
+	// on time: sleep until the deadline
+	#ifdef Q_OS_WIN32
+	Sleep((DWORD)((deadline - currentTime) / 1000000));
+	#else
+	struct timespec wakeUp;
+	wakeUp.tv_sec = deadline / 1000000000LL;
+	wakeUp.tv_nsec = deadline % 1000000000LL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, NULL) == EINTR)
+		;
+	#endif
+	return 0;
+}
@@ -0,0 +1,109 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __PACER_H
+#define __PACER_H
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QString>
+
+//! Real-time pacing of synthetic data sources
+/*!
+	Data sources that generate their data, instead of acquiring them,
+	must not produce them faster than their sampling rate. Returning
+	a fixed duration from getRawData is not enough: the DataConverter
+	sleeps after reading and processing, so the actual rate drifts by
+	the processing time, and integer rounding of the block duration
+	adds its own drift.
+
+	A Pacer keeps a schedule of absolute deadlines on the monotonic clock,
+	the deadline of block n being exactly n blocks after the start,
+	and wait() sleeps until the deadline of the current block. When
+	the caller is late, depending on the mode, the pacer either catches
+	up by not sleeping until back on schedule, or restarts the schedule
+	from now. The schedule starts at the first call to wait() after
+	construction or reset(). In MODE_MAX_SPEED, it never sleeps, which is useful to
+	benchmark the processing chain. When the schedule is restarted, wait()
+	returns the number of whole blocks that were missed, so that data
+	sources can behave like a device losing data when it is not read in time.
+	The late blocks, their lateness and the restarts of the schedule are
+	counted, and statistics() can be called from another thread than wait().
+
+	The mode is read from the dataSource/pacing setting, which can be
+	"catchUp" (default), "resynchronize" or "maxSpeed".
+*/
+class Pacer
+{
+public:
+	//! How to pace blocks
+	enum Mode
+	{
+		MODE_CATCH_UP = 0, //!< follow the schedule, producing late blocks without sleeping; restart it if more than maxCatchUp late
+		MODE_RESYNCHRONIZE, //!< restart the schedule from now whenever a block is late
+		MODE_MAX_SPEED //!< never sleep
+	};
+	
+	Pacer(unsigned samplingRate, unsigned blockSize = 512);
+	Pacer(unsigned samplingRate, unsigned blockSize, Mode mode);
+	
+	static Mode configuredMode();
+	
+	void reset();
+	unsigned wait();
+	
+	//! Return the pacing mode
+	Mode mode() const { return pacingMode; }
+	//! Return the monotonic time in ns at which the last block started, suitable for DataSource::lastBlockTimestamp
+	qint64 blockTimestamp() const { return lastBlockStart; }
+	QString statistics() const;
+	
+	static qint64 now();
+	
+	static const qint64 maxCatchUp = 100000000; //!< in MODE_CATCH_UP, maximum lateness in ns that is caught up
+	
+private:
+	void init(unsigned samplingRate, unsigned blockSize, Mode mode);
+	qint64 sampleTime(quint64 sample) const;
+	
+	Mode pacingMode; //!< the pacing mode
+	bool started; //!< true once the schedule has started
+	unsigned rate; //!< sampling rate in Hz
+	unsigned samplesPerBlock; //!< number of samples in a block
+	qint64 scheduleStart; //!< monotonic time in ns at which the schedule started
+	quint64 blockIndex; //!< number of blocks since the schedule started
+	qint64 lastBlockStart; //!< monotonic time in ns at which the last block started
+	mutable QMutex statisticsMutex; //!< protects the statistics below, which statistics() reads from another thread
+	qint64 lastLateness; //!< lateness of the last block in ns
+	qint64 maximumLateness; //!< maximum lateness in ns
+	unsigned lateBlocks; //!< number of late blocks
+	unsigned resynchronizations; //!< number of restarts of the schedule
+};
+
+#endif
@@ -0,0 +1,182 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "PolyphaseResampler.h"
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+//! Return the dot product of count samples of x and coefficients c, in Q15, count being a multiple of 8
+static inline int dotProduct(const signed short *c, const signed short *x, unsigned count)
+{
+	#ifdef __SSE2__
+	__m128i sum = _mm_setzero_si128();
+	for (unsigned i = 0; i < count; i += 8)
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(c + i)), _mm_loadu_si128((const __m128i *)(x + i))));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+	#else
+	int sum = 0;
+	for (unsigned i = 0; i < count; i++)
+		sum += (int)c[i] * (int)x[i];
+	return sum;
+	#endif
+}
+
+//! Constructor. If tapsPerPhase is 0, choose it so that the filter spans 16 periods of its cutoff frequency
+PolyphaseResampler::PolyphaseResampler(unsigned interpolation, unsigned decimation, unsigned tapsPerPhase) :
+	L(interpolation),
+	M(decimation)
+{
+	assert(L > 0);
+	assert(M > 0);
+	
+	// number of taps per phase, a multiple of 8 for SIMD
+	const unsigned factor = std::max(L, M);
+	if (tapsPerPhase == 0)
+		tapsPerPhase = (16 * factor + L - 1) / L;
+	T = (std::max(tapsPerPhase, 1u) + 7) & ~7;
+	
+	// design a Blackman windowed sinc low-pass filter at the upsampled rate, a bit below the lowest Nyquist frequency
+	const unsigned N = T * L;
+	const double cutoff = 0.45 / (double)factor;
+	std::vector<double> h(N);
+	double sum = 0;
+	for (unsigned i = 0; i < N; i++)
+	{
+		const double t = (double)i - (double)(N - 1) / 2.;
+		const double sinc = (t == 0) ? 2. * cutoff : sin(2. * M_PI * cutoff * t) / (M_PI * t);
+		const double window = 0.42 - 0.5 * cos(2. * M_PI * (i + 0.5) / N) + 0.08 * cos(4. * M_PI * (i + 0.5) / N);
+		h[i] = sinc * window;
+		sum += h[i];
+	}
+	
+	// split into phases with unity DC gain each, reversed, in Q15
+	coefficients.resize(N);
+	for (unsigned phase = 0; phase < L; phase++)
+		for (unsigned k = 0; k < T; k++)
+		{
+			const double value = h[phase + k * L] * (double)L / sum;
+			coefficients[phase * T + (T - 1 - k)] = (signed short)std::max(-32768., std::min(32767., floor(value * 32768. + 0.5)));
+		}
+	
+	reset();
+}
+
+//! Clear the history, as if the signal was 0 before
+void PolyphaseResampler::reset()
+{
+	historyCount = T - 1;
+	if (history.size() < historyCount)
+		history.resize(historyCount);
+	std::fill(history.begin(), history.begin() + historyCount, 0);
+	position = (T - 1) * L;
+}
+
+//! Return the maximum number of samples process() can produce out of srcCount input samples
+unsigned PolyphaseResampler::maxOutputCount(unsigned srcCount) const
+{
+	return (srcCount * L) / M + 1;
+}
+
+//! Resample srcCount samples of src into dest, which must hold maxOutputCount(srcCount) samples. Return the number of samples written
+unsigned PolyphaseResampler::process(const signed short *src, unsigned srcCount, signed short *dest)
+{
+	// append the input, only allocating when this block is larger than all previous ones
+	if (history.size() < historyCount + srcCount)
+		history.resize(historyCount + srcCount);
+	std::copy(src, src + srcCount, history.begin() + historyCount);
+	historyCount += srcCount;
+	
+	// compute all outputs whose input is available
+	unsigned count = 0;
+	const unsigned end = historyCount * L;
+	while (position < end)
+	{
+		const unsigned base = position / L;
+		const unsigned phase = position % L;
+		const int value = (dotProduct(&coefficients[phase * T], &history[base - (T - 1)], T) + (1 << 14)) >> 15;
+		dest[count++] = (signed short)std::max(-32768, std::min(32767, value));
+		position += M;
+	}
+	
+	// forget inputs that no further output needs; when decimating with fewer taps than M/L,
+	// the next output can start beyond the available input, so keep position past the end
+	const unsigned consumed = std::min(position / L - (T - 1), historyCount);
+	std::copy(history.begin() + consumed, history.begin() + historyCount, history.begin());
+	historyCount -= consumed;
+	position -= consumed * L;
+	
+	return count;
+}
+
+
+//! Constructor, resample channelCount channels by interpolation/decimation
+ResamplingStage::ResamplingStage(unsigned channelCount, unsigned interpolation, unsigned decimation) :
+	resamplers(channelCount, PolyphaseResampler(interpolation, decimation)),
+	outputs(channelCount),
+	availableCount(0)
+{
+}
+
+//! Resample frameCount samples of each of the channels, and append the results to their outputs
+void ResamplingStage::push(const signed short * const *channels, unsigned frameCount)
+{
+	unsigned count = 0;
+	for (size_t channel = 0; channel < resamplers.size(); channel++)
+	{
+		std::vector<signed short> &output = outputs[channel];
+		output.resize(availableCount + resamplers[channel].maxOutputCount(frameCount));
+		count = resamplers[channel].process(channels[channel], frameCount, &output[availableCount]);
+		output.resize(availableCount + count);
+	}
+	// all resamplers have the same ratio and history length, so they produce the same number of outputs
+	availableCount += count;
+}
+
+//! Move count samples of every channel to data, count must be at most available()
+void ResamplingStage::pop(std::valarray<std::valarray<signed short> > *data, unsigned count)
+{
+	assert(count <= availableCount);
+	for (size_t channel = 0; channel < outputs.size(); channel++)
+	{
+		std::vector<signed short> &output = outputs[channel];
+		std::copy(output.begin(), output.begin() + count, &(*data)[channel][0]);
+		output.erase(output.begin(), output.begin() + count);
+	}
+	availableCount -= count;
+}
@@ -0,0 +1,100 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __POLYPHASE_RESAMPLER_H
+#define __POLYPHASE_RESAMPLER_H
+
+#include <vector>
+#include <valarray>
+
+//! Rational sample rate converter for a single channel, using a polyphase FIR filter
+/*!
+	Change the sample rate by interpolation/decimation: conceptually, the
+	signal is upsampled by interpolation, low-pass filtered below the lowest
+	of the two Nyquist frequencies, and downsampled by decimation. The
+	polyphase implementation only computes the output samples, each one
+	being the dot product of a single phase of the filter with the input,
+	so filtering and downsampling are done in one pass.
+
+	Filter taps are 16 bits fixed point and dot products use SSE2 when
+	available. History is kept between calls to process(), so the input
+	can be given in blocks of any size. Its buffer only grows when a block
+	larger than all previous ones arrives, so once the block size is
+	stable process() does not allocate.
+*/
+class PolyphaseResampler
+{
+public:
+	PolyphaseResampler(unsigned interpolation = 1, unsigned decimation = 1, unsigned tapsPerPhase = 0);
+	
+	void reset();
+	unsigned process(const signed short *src, unsigned srcCount, signed short *dest);
+	unsigned maxOutputCount(unsigned srcCount) const;
+	
+	//! Return the interpolation factor
+	unsigned interpolation() const { return L; }
+	//! Return the decimation factor
+	unsigned decimation() const { return M; }
+	//! Return the number of taps of each phase of the filter
+	unsigned tapsPerPhase() const { return T; }
+	
+private:
+	unsigned L; //!< interpolation factor
+	unsigned M; //!< decimation factor
+	unsigned T; //!< number of taps per phase, multiple of 8
+	std::vector<signed short> coefficients; //!< L phases of T taps each, in reverse order so that they apply to consecutive increasing samples, Q15
+	std::vector<signed short> history; //!< linear buffer of input samples not yet consumed, starting with the T-1 needed by the next output, only grows
+	unsigned historyCount; //!< number of valid samples at the start of history
+	unsigned position; //!< position of the next output in the upsampled history
+};
+
+//! Rational sample rate conversion of several channels, buffering outputs until they are read
+/*!
+	This is a stage that data sources can put between their acquisition
+	and getRawData, when they offer sample rates lower than the one
+	of their hardware: push() frames as they arrive and pop() blocks
+	of samples once enough are available().
+*/
+class ResamplingStage
+{
+public:
+	ResamplingStage(unsigned channelCount = 0, unsigned interpolation = 1, unsigned decimation = 1);
+	
+	void push(const signed short * const *channels, unsigned frameCount);
+	//! Return the number of output samples available in every channel
+	unsigned available() const { return availableCount; }
+	void pop(std::valarray<std::valarray<signed short> > *data, unsigned count);
+	
+private:
+	std::vector<PolyphaseResampler> resamplers; //!< one resampler per channel
+	std::vector<std::vector<signed short> > outputs; //!< output samples not read yet, per channel
+	unsigned availableCount; //!< number of samples in each of outputs
+};
+
+#endif
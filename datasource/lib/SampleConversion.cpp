@@ -0,0 +1,129 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "SampleConversion.h"
+#include <cassert>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace SampleConversion
+{
+	void deinterleave(const signed short *src, unsigned channelCount, signed short * const *dest, unsigned frameCount, unsigned bits)
+	{
+		if (channelCount == 8)
+		{
+			deinterleave8(src, dest, frameCount, bits);
+			return;
+		}
+		if ((channelCount == 2) && (bits == 16))
+		{
+			deinterleave2(src, dest[0], dest[1], frameCount);
+			return;
+		}
+		for (unsigned frame = 0; frame < frameCount; frame++)
+			for (unsigned channel = 0; channel < channelCount; channel++)
+				dest[channel][frame] = signExtend((unsigned short)*src++, bits);
+	}
+	
+	void deinterleave8(const signed short *src, signed short * const *dest, unsigned frameCount, unsigned bits)
+	{
+		assert((bits > 0) && (bits <= 16));
+		unsigned frame = 0;
+		
+		#ifdef __SSE2__
+		const __m128i shift = _mm_cvtsi32_si128(16 - bits);
+		for (; frame + 8 <= frameCount; frame += 8)
+		{
+			// load 8 frames and extend sign by shifting left then arithmetically right
+			__m128i r[8];
+			for (unsigned i = 0; i < 8; i++)
+				r[i] = _mm_sra_epi16(_mm_sll_epi16(_mm_loadu_si128((const __m128i *)(src + (frame + i) * 8)), shift), shift);
+			
+			// transpose 8x8, so that row i holds channel i
+			const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+			const __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+			const __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+			const __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+			const __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+			const __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+			const __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+			const __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+			
+			const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+			const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+			const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+			const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+			const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+			const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+			const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+			const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+			
+			_mm_storeu_si128((__m128i *)(dest[0] + frame), _mm_unpacklo_epi64(b0, b4));
+			_mm_storeu_si128((__m128i *)(dest[1] + frame), _mm_unpackhi_epi64(b0, b4));
+			_mm_storeu_si128((__m128i *)(dest[2] + frame), _mm_unpacklo_epi64(b1, b5));
+			_mm_storeu_si128((__m128i *)(dest[3] + frame), _mm_unpackhi_epi64(b1, b5));
+			_mm_storeu_si128((__m128i *)(dest[4] + frame), _mm_unpacklo_epi64(b2, b6));
+			_mm_storeu_si128((__m128i *)(dest[5] + frame), _mm_unpackhi_epi64(b2, b6));
+			_mm_storeu_si128((__m128i *)(dest[6] + frame), _mm_unpacklo_epi64(b3, b7));
+			_mm_storeu_si128((__m128i *)(dest[7] + frame), _mm_unpackhi_epi64(b3, b7));
+		}
+		#endif
+		
+		for (; frame < frameCount; frame++)
+			for (unsigned channel = 0; channel < 8; channel++)
+				dest[channel][frame] = signExtend((unsigned short)src[frame * 8 + channel], bits);
+	}
+	
+	void deinterleave2(const signed short *src, signed short *left, signed short *right, unsigned frameCount)
+	{
+		unsigned frame = 0;
+		
+		#ifdef __SSE2__
+		for (; frame + 8 <= frameCount; frame += 8)
+		{
+			const __m128i v0 = _mm_loadu_si128((const __m128i *)(src + frame * 2));
+			const __m128i v1 = _mm_loadu_si128((const __m128i *)(src + frame * 2 + 8));
+			// left samples are the low halves of 32 bits lanes, right ones the high halves
+			const __m128i l0 = _mm_srai_epi32(_mm_slli_epi32(v0, 16), 16);
+			const __m128i l1 = _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16);
+			const __m128i r0 = _mm_srai_epi32(v0, 16);
+			const __m128i r1 = _mm_srai_epi32(v1, 16);
+			_mm_storeu_si128((__m128i *)(left + frame), _mm_packs_epi32(l0, l1));
+			_mm_storeu_si128((__m128i *)(right + frame), _mm_packs_epi32(r0, r1));
+		}
+		#endif
+		
+		for (; frame < frameCount; frame++)
+		{
+			left[frame] = src[frame * 2];
+			right[frame] = src[frame * 2 + 1];
+		}
+	}
+}
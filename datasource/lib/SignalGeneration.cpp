@@ -0,0 +1,253 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "SignalGeneration.h"
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+//! Constructor, a sinus of amplitude 1000 at DC
+Oscillator::Oscillator() :
+	currentWaveform(WAVEFORM_ARBITRARY),
+	amplitude(1000),
+	offset(0),
+	phase(0),
+	increment(0)
+{
+	setWaveform(WAVEFORM_SINE);
+}
+
+//! Set one of the predefined waveforms
+void Oscillator::setWaveform(Waveform waveform)
+{
+	if ((waveform == WAVEFORM_ARBITRARY) || (waveform == currentWaveform))
+		return;
+	currentWaveform = waveform;
+	shape.resize(TableSize);
+	for (unsigned i = 0; i < TableSize; i++)
+	{
+		const double x = (double)i / (double)TableSize;
+		switch (waveform)
+		{
+			case WAVEFORM_SINE: shape[i] = (float)sin(2 * M_PI * x); break;
+			case WAVEFORM_SQUARE: shape[i] = x < 0.5 ? 1.f : -1.f; break;
+			case WAVEFORM_TRIANGLE: shape[i] = (float)(x < 0.25 ? 4 * x : (x < 0.75 ? 2 - 4 * x : 4 * x - 4)); break;
+			default: break;
+		}
+	}
+	updateTable();
+}
+
+//! Set an arbitrary waveform from count samples of one period, between -1 and 1
+void Oscillator::setArbitraryWaveform(const float *period, unsigned count)
+{
+	assert(count > 0);
+	currentWaveform = WAVEFORM_ARBITRARY;
+	shape.resize(TableSize);
+	for (unsigned i = 0; i < TableSize; i++)
+	{
+		// linear interpolation of the period at the table resolution
+		const double position = ((double)i * count) / TableSize;
+		const unsigned index = (unsigned)position;
+		const double frac = position - index;
+		shape[i] = (float)((1 - frac) * period[index] + frac * period[(index + 1) % count]);
+	}
+	updateTable();
+}
+
+//! Set the peak amplitude, in units
+void Oscillator::setAmplitude(float amplitude)
+{
+	amplitude = std::min(std::max(amplitude, -32767.f), 32767.f);
+	if (amplitude == this->amplitude)
+		return;
+	this->amplitude = amplitude;
+	updateTable();
+}
+
+//! Set the offset, in units
+void Oscillator::setOffset(int offset)
+{
+	if (offset == this->offset)
+		return;
+	this->offset = offset;
+	updateTable();
+}
+
+//! Set the frequency, in the same unit as samplingRate
+void Oscillator::setFrequency(double frequency, double samplingRate)
+{
+	const double cycles = frequency / samplingRate;
+	increment = (unsigned)(long long)floor((cycles - floor(cycles)) * 4294967296.0 + 0.5);
+}
+
+//! Set the phase, 1 being a full period
+void Oscillator::setPhase(double phase)
+{
+	this->phase = (unsigned)(long long)floor((phase - floor(phase)) * 4294967296.0 + 0.5);
+}
+
+//! Scale the waveform to the amplitude and offset, and compute differences for interpolation
+void Oscillator::updateTable()
+{
+	table.resize(2 * TableSize);
+	for (unsigned i = 0; i < TableSize; i++)
+	{
+		const int value = (int)floor(amplitude * shape[i] + 0.5) + offset;
+		const int next = (int)floor(amplitude * shape[(i + 1) % TableSize] + 0.5) + offset;
+		table[2 * i] = value;
+		table[2 * i + 1] = next - value;
+	}
+}
+
+//! Generate count samples into dest, saturating to 16 bits
+void Oscillator::generate(signed short *dest, unsigned count)
+{
+	const int *entries = &table[0];
+	unsigned p = phase;
+	for (unsigned i = 0; i < count; i++)
+	{
+		const int *entry = entries + 2 * (p >> (32 - TableBits));
+		const int frac = (p >> (32 - TableBits - 15)) & 0x7FFF;
+		const int value = entry[0] + ((entry[1] * frac) >> 15);
+		dest[i] = (signed short)std::min(std::max(value, -32768), 32767);
+		p += increment;
+	}
+	phase = p;
+}
+
+
+std::vector<signed short> NoiseGenerator::gaussianTable;
+
+//! Constructor, seed must not be 0
+NoiseGenerator::NoiseGenerator(unsigned seed)
+{
+	// decorrelate the four generators by seeding them from a linear congruential sequence
+	for (unsigned i = 0; i < 4; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		state[i] = seed ? seed : 1;
+	}
+	
+	// inverse of the normal cumulative distribution at the middle of each interval, by bisection
+	if (gaussianTable.empty())
+	{
+		const unsigned size = 1 << GaussianTableBits;
+		gaussianTable.resize(size);
+		for (unsigned i = 0; i < size; i++)
+		{
+			const double p = (i + 0.5) / size;
+			double low = -10, high = 10;
+			for (unsigned step = 0; step < 50; step++)
+			{
+				const double x = (low + high) / 2;
+				if (0.5 * erfc(-x / sqrt(2.)) < p)
+					low = x;
+				else
+					high = x;
+			}
+			gaussianTable[i] = (signed short)floor((low + high) / 2 * GaussianScale + 0.5);
+		}
+	}
+}
+
+//! Fill dest with count random numbers, count being a multiple of 4
+void NoiseGenerator::fillRandom(unsigned *dest, unsigned count)
+{
+	#ifdef __SSE2__
+	__m128i x = _mm_loadu_si128((const __m128i *)state);
+	for (unsigned i = 0; i < count; i += 4)
+	{
+		x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+		x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+		_mm_storeu_si128((__m128i *)(dest + i), x);
+	}
+	_mm_storeu_si128((__m128i *)state, x);
+	#else
+	for (unsigned i = 0; i < count; i += 4)
+		for (unsigned lane = 0; lane < 4; lane++)
+		{
+			unsigned x = state[lane];
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			state[lane] = x;
+			dest[i + lane] = x;
+		}
+	#endif
+}
+
+//! Add count samples of noise to dest, saturating to 16 bits
+void NoiseGenerator::add(signed short *dest, unsigned count, float amplitude, Distribution distribution)
+{
+	const unsigned roundedCount = (count + 7) & ~7;
+	randomBuffer.resize(roundedCount);
+	fillRandom(&randomBuffer[0], roundedCount);
+	
+	if (distribution == DISTRIBUTION_UNIFORM)
+	{
+		// the signed 16 most significant bits, times the amplitude, divided by 2^16
+		const int scale = (int)std::min(std::max(floor(fabs(amplitude) + 0.5), 0.), 32767.);
+		unsigned i = 0;
+		#ifdef __SSE2__
+		const __m128i scaleVector = _mm_set1_epi16((short)scale);
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i low = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)&randomBuffer[i]), 16);
+			const __m128i high = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)&randomBuffer[i + 4]), 16);
+			const __m128i noise = _mm_mulhi_epi16(_mm_packs_epi32(low, high), scaleVector);
+			_mm_storeu_si128((__m128i *)(dest + i), _mm_adds_epi16(_mm_loadu_si128((const __m128i *)(dest + i)), noise));
+		}
+		#endif
+		for (; i < count; i++)
+		{
+			const int noise = (int)(signed short)(randomBuffer[i] >> 16) * scale;
+			dest[i] = (signed short)std::min(std::max((int)dest[i] + (noise >> 16), -32768), 32767);
+		}
+	}
+	else
+	{
+		// table lookup of the most significant bits, scaled to the standard deviation
+		const int scale = (int)std::min(std::max(floor(fabs(amplitude) * 16 + 0.5), 0.), 32767. * 16);
+		const signed short *table = &gaussianTable[0];
+		for (unsigned i = 0; i < count; i++)
+		{
+			const int noise = (int)(((long long)table[randomBuffer[i] >> (32 - GaussianTableBits)] * scale) >> 16);
+			dest[i] = (signed short)std::min(std::max((int)dest[i] + noise, -32768), 32767);
+		}
+	}
+}
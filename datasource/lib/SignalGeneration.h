@@ -0,0 +1,127 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SIGNAL_GENERATION_H
+#define __SIGNAL_GENERATION_H
+
+#include <vector>
+
+/*!	\file SignalGeneration.h
+	\brief Fast waveform and noise generation for synthetic data sources
+*/
+
+//! Numerically controlled oscillator reading an interpolated wavetable
+/*!
+	The phase is a 32 bits accumulator incremented at every sample, so
+	that the frequency resolution is the sampling rate divided by 2^32.
+	Its 10 most significant bits index a table of one period of the
+	waveform, and the next 15 bits interpolate linearly between
+	consecutive entries. The table is scaled to the amplitude and offset
+	when they change, so that generating a sample only costs a lookup,
+	a multiplication and a saturation.
+	This generates several hundred megasamples per second, about twenty
+	times more than calling sin and rand for every sample, as measured by
+	the datasource library benchmark, in benchmark/.
+*/
+class Oscillator
+{
+public:
+	//! Predefined waveforms
+	enum Waveform
+	{
+		WAVEFORM_SINE = 0, //!< sinus
+		WAVEFORM_SQUARE, //!< square, starting high
+		WAVEFORM_TRIANGLE, //!< triangle, starting at 0 and rising
+		WAVEFORM_ARBITRARY //!< waveform given to setArbitraryWaveform
+	};
+	
+	Oscillator();
+	
+	void setWaveform(Waveform waveform);
+	void setArbitraryWaveform(const float *period, unsigned count);
+	void setAmplitude(float amplitude);
+	void setOffset(int offset);
+	void setFrequency(double frequency, double samplingRate);
+	void setPhase(double phase);
+	
+	void generate(signed short *dest, unsigned count);
+	
+	//! Return the current waveform
+	Waveform waveform() const { return currentWaveform; }
+	
+	static const unsigned TableBits = 10; //!< log2 of the number of entries in the wavetable
+	static const unsigned TableSize = 1 << TableBits; //!< number of entries in the wavetable
+	
+private:
+	void updateTable();
+	
+	Waveform currentWaveform; //!< current waveform
+	std::vector<float> shape; //!< one period of the waveform, between -1 and 1, TableSize entries
+	float amplitude; //!< peak amplitude in units
+	int offset; //!< offset in units
+	unsigned phase; //!< phase accumulator, one period is 2^32
+	unsigned increment; //!< phase increment per sample
+	std::vector<int> table; //!< pairs of value and difference to the next value, scaled to the amplitude and offset
+};
+
+//! Fast uniform and Gaussian noise generator
+/*!
+	Random numbers come from four interleaved xorshift generators, which
+	SSE2 steps in parallel. Gaussian noise is obtained by looking up the
+	inverse of the normal cumulative distribution in a table, instead of
+	costly transcendental functions. With SSE2, uniform noise is added
+	at about a gigasample per second, according to the datasource library
+	benchmark.
+*/
+class NoiseGenerator
+{
+public:
+	//! Distribution of the noise
+	enum Distribution
+	{
+		DISTRIBUTION_UNIFORM = 0, //!< uniform between -amplitude/2 and amplitude/2
+		DISTRIBUTION_GAUSSIAN //!< normal, of standard deviation amplitude
+	};
+	
+	NoiseGenerator(unsigned seed = 1);
+	
+	void add(signed short *dest, unsigned count, float amplitude, Distribution distribution = DISTRIBUTION_UNIFORM);
+	
+	static const unsigned GaussianTableBits = 12; //!< log2 of the number of entries in the inverse normal distribution table
+	static const int GaussianScale = 4096; //!< value of one standard deviation in the inverse normal distribution table
+	
+private:
+	void fillRandom(unsigned *dest, unsigned count);
+	
+	unsigned state[4]; //!< states of the four xorshift generators
+	std::vector<unsigned> randomBuffer; //!< random numbers for Gaussian noise
+	static std::vector<signed short> gaussianTable; //!< inverse of the normal cumulative distribution, shared by all generators
+};
+
+#endif
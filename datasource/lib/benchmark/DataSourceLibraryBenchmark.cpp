@@ -0,0 +1,213 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+// Benchmark of the datasource library kernels, against the scalar loops they replaced.
+// It is not built by default, configure with -DBUILD_DATASOURCE_BENCHMARK=ON to build it.
+// The SSE2 kernels are measured unless the library and the benchmark are built without
+// SSE2, for instance with CMAKE_CXX_FLAGS set to -mno-sse2, which measures their scalar
+// fallbacks instead. Blocks are of 512 frames, so that they stay in cache.
+
+#include <SampleConversion.h>
+#include <PolyphaseResampler.h>
+#include <SignalGeneration.h>
+#include <Pacer.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// number of blocks of 512 frames processed by each measurement
+static const unsigned BlockCount = 20000;
+
+// sum of outputs, printed so that the compiler can't remove the measured loops
+static unsigned checksum = 0;
+
+// return the sum of count samples
+static unsigned sum(const signed short *samples, unsigned count)
+{
+	unsigned result = 0;
+	for (unsigned i = 0; i < count; i++)
+		result += (unsigned short)samples[i];
+	return result;
+}
+
+// print the duration in ms per megasample of sampleCount samples processed in duration ns, and the throughput
+static void report(const char *name, double duration, double sampleCount)
+{
+	printf("%-44s %8.3f ms per megasample, %8.1f megasamples per second\n", name, duration / sampleCount, sampleCount * 1e3 / duration);
+}
+
+// fill count samples with a random 14 bits signal
+static void fillRandom(signed short *samples, unsigned count)
+{
+	for (unsigned i = 0; i < count; i++)
+		samples[i] = (signed short)(rand() & 0x3fff);
+}
+
+// de-interleave 8 channels of 14 bits, with the library kernel and with the former TseAdExt loop
+static void benchmarkDeinterleave8()
+{
+	std::vector<signed short> src(512 * 8);
+	fillRandom(&src[0], src.size());
+	std::vector<std::vector<signed short> > channels(8, std::vector<signed short>(512));
+	signed short *dest[8];
+	for (unsigned channel = 0; channel < 8; channel++)
+		dest[channel] = &channels[channel][0];
+	
+	qint64 start = Pacer::now();
+	for (unsigned block = 0; block < BlockCount; block++)
+	{
+		SampleConversion::deinterleave8(&src[0], dest, 512, 14);
+		checksum += dest[block % 8][block % 512];
+	}
+	report("deinterleave8, 14 bits", Pacer::now() - start, BlockCount * 512. * 8);
+	
+	start = Pacer::now();
+	for (unsigned block = 0; block < BlockCount; block++)
+	{
+		for (unsigned sample = 0; sample < 512; sample++)
+			for (unsigned channel = 0; channel < 8; channel++)
+			{
+				unsigned short raw = (unsigned short)src[sample * 8 + channel];
+				if (raw & 0x2000)
+					raw |= 0xc000;
+				dest[channel][sample] = (signed short)raw;
+			}
+		checksum += dest[block % 8][block % 512];
+	}
+	report("former scalar loop, 8 channels of 14 bits", Pacer::now() - start, BlockCount * 512. * 8);
+}
+
+// de-interleave stereo, with the library kernel and with the former SoundCard loop
+static void benchmarkDeinterleave2()
+{
+	std::vector<signed short> src(512 * 2);
+	fillRandom(&src[0], src.size());
+	std::vector<signed short> left(512), right(512);
+	signed short *dest[2] = { &left[0], &right[0] };
+	
+	qint64 start = Pacer::now();
+	for (unsigned block = 0; block < BlockCount; block++)
+	{
+		SampleConversion::deinterleave2(&src[0], dest[0], dest[1], 512);
+		checksum += dest[block % 2][block % 512];
+	}
+	report("deinterleave2", Pacer::now() - start, BlockCount * 512. * 2);
+	
+	start = Pacer::now();
+	for (unsigned block = 0; block < BlockCount; block++)
+	{
+		for (unsigned sample = 0; sample < 512; sample++)
+			for (unsigned channel = 0; channel < 2; channel++)
+				dest[channel][sample] = src[sample * 2 + channel];
+		checksum += dest[block % 2][block % 512];
+	}
+	report("former scalar loop, stereo", Pacer::now() - start, BlockCount * 512. * 2);
+}
+
+// decimate by 10 as TseAdExt does at its lowest rate, the duration is per input megasample
+static void benchmarkResampler()
+{
+	std::vector<signed short> src(512 * 10);
+	fillRandom(&src[0], src.size());
+	PolyphaseResampler resampler(1, 10);
+	std::vector<signed short> dest(resampler.maxOutputCount(src.size()));
+	
+	const unsigned blockCount = BlockCount / 10;
+	const qint64 start = Pacer::now();
+	for (unsigned block = 0; block < blockCount; block++)
+	{
+		const unsigned count = resampler.process(&src[0], src.size(), &dest[0]);
+		checksum += sum(&dest[0], count);
+	}
+	report("PolyphaseResampler, decimation by 10", Pacer::now() - start, blockCount * (double)src.size());
+}
+
+// generate a sine with the oscillator and with the former VariousSinus loop, and add noise
+static void benchmarkGeneration()
+{
+	std::vector<signed short> dest(512);
+	
+	Oscillator oscillator;
+	oscillator.setAmplitude(1000);
+	oscillator.setFrequency(1, 100);
+	qint64 start = Pacer::now();
+	for (unsigned block = 0; block < BlockCount; block++)
+	{
+		oscillator.generate(&dest[0], 512);
+		checksum += dest[block % 512];
+	}
+	report("Oscillator, sine", Pacer::now() - start, BlockCount * 512.);
+	
+	start = Pacer::now();
+	unsigned t = 0;
+	for (unsigned block = 0; block < BlockCount; block++)
+	{
+		for (unsigned sample = 0; sample < 512; sample++, t++)
+			dest[sample] = (signed short)(1000.0 * sin((t * 2 * M_PI) / 100.) + (rand() % 100) - 50);
+		checksum += dest[block % 512];
+	}
+	report("former sin and rand loop", Pacer::now() - start, BlockCount * 512.);
+	
+	NoiseGenerator noise;
+	start = Pacer::now();
+	for (unsigned block = 0; block < BlockCount; block++)
+	{
+		noise.add(&dest[0], 512, 100, NoiseGenerator::DISTRIBUTION_UNIFORM);
+		checksum += dest[block % 512];
+	}
+	report("NoiseGenerator, uniform", Pacer::now() - start, BlockCount * 512.);
+	
+	start = Pacer::now();
+	for (unsigned block = 0; block < BlockCount; block++)
+	{
+		noise.add(&dest[0], 512, 100, NoiseGenerator::DISTRIBUTION_GAUSSIAN);
+		checksum += dest[block % 512];
+	}
+	report("NoiseGenerator, Gaussian", Pacer::now() - start, BlockCount * 512.);
+}
+
+int main()
+{
+	#ifdef __SSE2__
+	printf("SSE2 kernels\n");
+	#else
+	printf("scalar kernels\n");
+	#endif
+	benchmarkDeinterleave8();
+	benchmarkDeinterleave2();
+	benchmarkResampler();
+	benchmarkGeneration();
+	printf("checksum %u\n", checksum);
+	return 0;
+}
@@ -0,0 +1,233 @@
+/*
+	Generator of framed sample streams for the Network data source of Osqoop,
+	see NetworkProtocol.h for the format.
+
+	By default, frames are sent in UDP datagrams to localhost:7878.
+	With -t, the generator listens on the port and streams to every
+	TCP client that connects, one at a time.
+	Channel n holds a sinus of period 100 * (n + 1) samples.
+	Loss and reordering can be simulated to test the receiver.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "NetworkProtocol.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-t] [-h host] [-p port] [-c channels] [-r rate] [-f frame length] [-l loss %%] [-o reorder %%]\n", name);
+	fprintf(stderr, "  -t  listen for a TCP client instead of sending UDP datagrams to host\n");
+	fprintf(stderr, "  -l  percentage of frames not sent, in UDP\n");
+	fprintf(stderr, "  -o  percentage of frames sent after the next one, in UDP\n");
+}
+
+// open the UDP socket connected to host:port, or the TCP listening socket on port
+static int openSocket(int tcp, const char *host, const char *port)
+{
+	struct addrinfo hints, *addresses, *address;
+	int fd = -1;
+	
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = tcp ? SOCK_STREAM : SOCK_DGRAM;
+	hints.ai_flags = tcp ? AI_PASSIVE : 0;
+	if (getaddrinfo(tcp ? NULL : host, port, &hints, &addresses) != 0)
+	{
+		fprintf(stderr, "error: can't resolve %s\n", host);
+		return -1;
+	}
+	for (address = addresses; address; address = address->ai_next)
+	{
+		fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (fd < 0)
+			continue;
+		if (tcp)
+		{
+			int reuse = 1;
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+			if ((bind(fd, address->ai_addr, address->ai_addrlen) == 0) && (listen(fd, 1) == 0))
+				break;
+		}
+		else if (connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+			break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(addresses);
+	if (fd < 0)
+		perror("error: can't open socket");
+	return fd;
+}
+
+// send size bytes of frame, return 0 if the TCP client disconnected
+static int sendFrame(int fd, int tcp, const unsigned char *frame, size_t size)
+{
+	size_t done = 0;
+	if (!tcp)
+	{
+		send(fd, frame, size, 0);
+		return 1;
+	}
+	while (done < size)
+	{
+		ssize_t result = send(fd, frame + done, size - done, MSG_NOSIGNAL);
+		if (result < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return 0;
+		}
+		done += result;
+	}
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int tcp = 0;
+	const char *host = "localhost";
+	const char *port = "7878";
+	unsigned channelCount = 8;
+	unsigned rate = 100000;
+	unsigned frameLength = 512;
+	double lossPercent = 0, reorderPercent = 0;
+	int option, listenFd, fd;
+	size_t frameSize;
+	unsigned char *frame, *heldFrame;
+	int holding = 0;
+	NetworkFrameHeader header;
+	struct timespec start, deadline, now;
+	unsigned long long sampleIndex = 0;
+	unsigned long long sentFrames = 0, droppedFrames = 0, reorderedFrames = 0;
+	
+	while ((option = getopt(argc, argv, "th:p:c:r:f:l:o:")) != -1)
+	{
+		switch (option)
+		{
+			case 't': tcp = 1; break;
+			case 'h': host = optarg; break;
+			case 'p': port = optarg; break;
+			case 'c': channelCount = atoi(optarg); break;
+			case 'r': rate = atoi(optarg); break;
+			case 'f': frameLength = atoi(optarg); break;
+			case 'l': lossPercent = atof(optarg); break;
+			case 'o': reorderPercent = atof(optarg); break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if ((channelCount == 0) || (channelCount > NETWORK_MAX_PAYLOAD_SIZE / 2) || (rate == 0) || (frameLength == 0) || (frameLength > 65535))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	
+	// a frame must fit in a datagram, receivers reject larger ones over TCP too
+	if ((size_t)channelCount * frameLength * 2 > NETWORK_MAX_PAYLOAD_SIZE)
+	{
+		frameLength = NETWORK_MAX_PAYLOAD_SIZE / (channelCount * 2);
+		fprintf(stderr, "warning: frame length reduced to %u samples to fit in a datagram\n", frameLength);
+	}
+	frameSize = NETWORK_FRAME_HEADER_SIZE + (size_t)channelCount * frameLength * 2;
+	frame = (unsigned char *)malloc(frameSize);
+	heldFrame = (unsigned char *)malloc(frameSize);
+	
+	listenFd = openSocket(tcp, host, port);
+	if (listenFd < 0)
+		return 2;
+	signal(SIGPIPE, SIG_IGN);
+	
+	header.magic = NETWORK_FRAME_MAGIC;
+	header.version = NETWORK_FRAME_VERSION;
+	header.channelCount = channelCount;
+	header.samplingRate = rate;
+	header.sequence = 0;
+	header.frameLength = frameLength;
+	
+	while (1)
+	{
+		if (tcp)
+		{
+			fprintf(stderr, "waiting for a client on port %s\n", port);
+			fd = accept(listenFd, NULL, NULL);
+			if (fd < 0)
+				continue;
+		}
+		else
+		{
+			fd = listenFd;
+			fprintf(stderr, "sending to %s:%s\n", host, port);
+		}
+		fprintf(stderr, "%u channels at %u Hz, frames of %u samples\n", channelCount, rate, frameLength);
+		
+		// send frames on an absolute schedule, so that the rate does not drift
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		sampleIndex = 0;
+		while (1)
+		{
+			unsigned channel, sample;
+			unsigned long long deadlineNs;
+			
+			// wall clock time of the first sample, as if the frame had just been acquired
+			clock_gettime(CLOCK_REALTIME, &now);
+			header.timestamp = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec - ((unsigned long long)frameLength * 1000000000ULL) / rate;
+			networkEncodeFrameHeader(&header, frame);
+			for (channel = 0; channel < channelCount; channel++)
+			{
+				unsigned char *dest = frame + NETWORK_FRAME_HEADER_SIZE + (size_t)channel * frameLength * 2;
+				for (sample = 0; sample < frameLength; sample++)
+				{
+					const int value = (int)(1000.0 * sin((2 * M_PI * (double)(sampleIndex + sample)) / (100 * (double)(channel + 1))));
+					networkWriteLittleEndian(dest + 2 * sample, (uint16_t)(int16_t)value, 2);
+				}
+			}
+			header.sequence++;
+			sampleIndex += frameLength;
+			
+			// simulate loss and reordering in UDP
+			if (!tcp && (rand() < lossPercent * 0.01 * RAND_MAX))
+				droppedFrames++;
+			else if (!tcp && !holding && (rand() < reorderPercent * 0.01 * RAND_MAX))
+			{
+				memcpy(heldFrame, frame, frameSize);
+				holding = 1;
+			}
+			else
+			{
+				if (!sendFrame(fd, tcp, frame, frameSize))
+					break;
+				if (holding)
+				{
+					sendFrame(fd, tcp, heldFrame, frameSize);
+					holding = 0;
+					reorderedFrames++;
+				}
+				sentFrames++;
+			}
+			if ((header.sequence % 1000) == 0)
+				fprintf(stderr, "\r%llu frames sent, %llu dropped, %llu reordered", sentFrames, droppedFrames, reorderedFrames);
+			
+			deadlineNs = (unsigned long long)start.tv_sec * 1000000000ULL + start.tv_nsec + (sampleIndex * 1000000000ULL) / rate;
+			deadline.tv_sec = deadlineNs / 1000000000ULL;
+			deadline.tv_nsec = deadlineNs % 1000000000ULL;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+				;
+		}
+		fprintf(stderr, "\nclient disconnected\n");
+		close(fd);
+	}
+	return 0;
+}
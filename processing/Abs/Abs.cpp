@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtCore>
 #include "Abs.h"
 #include <Abs.moc>
+#include <SaturatingArithmetic.h>
 
 QString ProcessingAbsDescription::systemName() const
 {
@@ -59,18 +60,14 @@ ProcessingPlugin *ProcessingAbsDescription::create(const DataSource *dataSource)
 	return new ProcessingAbs(this);
 }
 
+unsigned ProcessingAbsDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
 void ProcessingAbs::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
 {
-	signed short *srcPtr = inputs[0];
-	signed short *destPtr = outputs[0];
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-	{
-		signed short val = *srcPtr++;
-		if (val < 0)
-			*destPtr++ = - val;
-		else
-			*destPtr++ = val;
-	}
+	SaturatingArithmetic::abs(inputs[0], outputs[0], sampleCount);
 }
 
 Q_EXPORT_PLUGIN(ProcessingAbsDescription)
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QSpinBox>
 #include "CropBelowLevel.h"
 #include <CropBelowLevel.moc>
+#include <SaturatingArithmetic.h>
 
 QString ProcessingCropBelowLevelDescription::systemName() const
 {
@@ -62,6 +63,11 @@ ProcessingPlugin *ProcessingCropBelowLevelDescription::create(const DataSource *
 	return new ProcessingCropBelowLevel(this);
 }
 
+unsigned ProcessingCropBelowLevelDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
 
 ProcessingCropBelowLevel::ProcessingCropBelowLevel(const ProcessingPluginDescription *description) :
 	ProcessingPlugin(description)
@@ -86,18 +92,7 @@ QWidget *ProcessingCropBelowLevel::createGUI(void)
 
 void ProcessingCropBelowLevel::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
 {
-	signed short *srcPtr = inputs[0];
-	signed short *destPtr = outputs[0];
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-	{
-		signed short value = *srcPtr++;
-		if (value > level)
-			*destPtr++ = value - level;
-		else if (value < -level)
-			*destPtr++ = value + level;
-		else
-			*destPtr++ = 0;
-	}
+	SaturatingArithmetic::cropBelowLevel(inputs[0], outputs[0], sampleCount, (signed short)level);
 }
 
 void ProcessingCropBelowLevel::load(QTextStream *stream)
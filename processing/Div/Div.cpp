@@ -28,7 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtCore>
 #include "Div.h"
 #include <Div.moc>
-#include <limits>
+#include <SaturatingArithmetic.h>
 
 QString ProcessingDivDescription::systemName() const
 {
@@ -60,27 +60,14 @@ ProcessingPlugin *ProcessingDivDescription::create(const DataSource *dataSource)
 	return new ProcessingDiv(this);
 }
 
+unsigned ProcessingDivDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
 void ProcessingDiv::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
 {
-	signed short *srcPtr0 = inputs[0];
-	signed short *srcPtr1 = inputs[1];
-	signed short *destPtr = outputs[0];
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-    {
-        signed short op1 = (*srcPtr0++);
-        signed short op2 = (*srcPtr1++);
-        signed short result;
-        if (op2 == 0)
-        {
-            if (op1 > 0)
-                result == std::numeric_limits<signed short>::max();
-            else
-                result == std::numeric_limits<signed short>::min();
-        }
-        else
-            result = op1 / op2;
-        *destPtr++ = result;
-    }
+	SaturatingArithmetic::div(inputs[0], inputs[1], outputs[0], sampleCount);
 }
 
 Q_EXPORT_PLUGIN(ProcessingDivDescription)
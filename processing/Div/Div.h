@@ -33,10 +33,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <ProcessingPlugin.h>
 
 //! Description of the Div plugin
-class ProcessingDivDescription : public QObject, public ProcessingPluginDescription
+class ProcessingDivDescription : public QObject, public ProcessingPluginDescription, public ProcessingPluginCapabilities
 {
 	Q_OBJECT
-	Q_INTERFACES(ProcessingPluginDescription)
+	Q_INTERFACES(ProcessingPluginDescription ProcessingPluginCapabilities)
 
 public:
 	QString systemName() const;
@@ -45,6 +45,7 @@ public:
 	unsigned inputCount() const;
 	unsigned outputCount() const;
 	ProcessingPlugin *create(const DataSource *dataSource) const;
+	unsigned capabilities() const;
 };
 
 //! Div plugin. divide two signals
@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <EMGMouseBackpropNNClassifier.moc>
 #include <FeedForwardNeuralNetwork.h>
 #include <fstream>
+#include <algorithm>
 
 void SettableQPushButton::setButtonState(const QString &text, bool enable)
 {
@@ -205,144 +206,46 @@ void ProcessingEMGMouseBackpropNNClassifier::processData(const std::valarray<sig
 			calibrationPos = 0;
 
 			// calibrate normalization
-			estimateMeanAndStdVarOfInput();
-			
-			// randomize NN
-			double randomRange = 1.0 / sqrt((double)nn->inputNum()); // 1 on sqrt of fan-in
-			nn->randomize(-randomRange, randomRange);
-
-			// shuffle learning samples
-			for (unsigned i = 0; i < EMGMouseBackpropNNLearningStepCount; i++)
-			{
-				unsigned exchange = rand() % EMGMouseBackpropNNLearningStepCount;
-				for (unsigned j = 0; j < EMGMouseBackpropNNInputCount; j++)
-				{
-					std::swap(calibrationDataIdle[i][j], calibrationDataIdle[exchange][j]);
-					std::swap(calibrationDataIdle2[i][j], calibrationDataIdle2[exchange][j]);
-					std::swap(calibrationDataXP[i][j], calibrationDataXP[exchange][j]);
-					std::swap(calibrationDataXN[i][j], calibrationDataXN[exchange][j]);
-					std::swap(calibrationDataYP[i][j], calibrationDataYP[exchange][j]);
-					std::swap(calibrationDataYN[i][j], calibrationDataYN[exchange][j]);
-					std::swap(calibrationDataLC[i][j], calibrationDataLC[exchange][j]);
-					std::swap(calibrationDataRC[i][j], calibrationDataRC[exchange][j]);
-				}
-			}
-
-			// do the learning !
-			std::ofstream errorLog("error.log.txt");
-			for (unsigned learningStep = 0; learningStep < EMGMouseBackpropNNLearningStepCount; learningStep++)
-			{
-				const double learningTargetValue = 0.6;
-				
-				// decrease learning rate with time
-				nn->setLearningRate(((double)(EMGMouseBackpropNNLearningStepCount - learningStep)) / (double)(EMGMouseBackpropNNLearningStepCount * 10));
-
-				// Idle
-				for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
-					nn->setInput(i, normalizeNNInput(calibrationDataIdle[learningStep][i]));
-				nn->step();
-				nn->setError(0, 0 - nn->getOutput(0));
-				nn->setError(1, 0 - nn->getOutput(1));
-				nn->setError(2, 0 - nn->getOutput(2));
-				errorLog << (0 - nn->getOutput(0)) << " " << (0 - nn->getOutput(1)) << " " << (0 - nn->getOutput(2)) << std::endl;
-				nn->stepBackward();
-
-				// XP
-				for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
-					nn->setInput(i, normalizeNNInput(calibrationDataXP[learningStep][i]));
-				nn->step();
-				nn->setError(0, learningTargetValue - nn->getOutput(0));
-				nn->setError(1, 0 - nn->getOutput(1));
-				nn->setError(2, 0 - nn->getOutput(2));
-				errorLog << (learningTargetValue - nn->getOutput(0)) << " " << (0 - nn->getOutput(1)) << " " << (0 - nn->getOutput(2)) << std::endl;
-				nn->stepBackward();
-				
-				// XN
-				for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
-					nn->setInput(i, normalizeNNInput(calibrationDataXN[learningStep][i]));
-				nn->step();
-				nn->setError(0, (-learningTargetValue) - nn->getOutput(0));
-				nn->setError(1, 0 - nn->getOutput(1));
-				nn->setError(2, 0 - nn->getOutput(2));
-				errorLog << (-learningTargetValue - nn->getOutput(0)) << " " << (0 - nn->getOutput(1)) << " " << (0 - nn->getOutput(2)) << std::endl;
-				nn->stepBackward();
-
-				// Idle 2
-				for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
-					nn->setInput(i, normalizeNNInput(calibrationDataIdle2[learningStep][i]));
-				nn->step();
-				nn->setError(0, 0 - nn->getOutput(0));
-				nn->setError(1, 0 - nn->getOutput(1));
-				nn->setError(2, 0 - nn->getOutput(2));
-				errorLog << (0 - nn->getOutput(0)) << " " << (0 - nn->getOutput(1)) << " " << (0 - nn->getOutput(2)) << std::endl;
-				nn->stepBackward();
-
-				// YP
-				for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
-					nn->setInput(i, normalizeNNInput(calibrationDataYP[learningStep][i]));
-				nn->step();
-				nn->setError(0, 0 - nn->getOutput(0));
-				nn->setError(1, learningTargetValue - nn->getOutput(1));
-				nn->setError(2, 0 - nn->getOutput(2));
-				errorLog << (0 - nn->getOutput(0)) << " " << (learningTargetValue - nn->getOutput(1)) << " " << (0 - nn->getOutput(2)) << std::endl;
-				nn->stepBackward();
-				
-				// YN
-				for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
-					nn->setInput(i, normalizeNNInput(calibrationDataYN[learningStep][i]));
-				nn->step();
-				nn->setError(0, 0 - nn->getOutput(0));
-				nn->setError(1, (-learningTargetValue) - nn->getOutput(1));
-				nn->setError(2, 0 - nn->getOutput(2));
-				errorLog << (0 - nn->getOutput(0)) << " " << ((-learningTargetValue) - nn->getOutput(1)) << " " << (0 - nn->getOutput(2)) << std::endl;
-				nn->stepBackward();
-
-				// Left click
-				for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
-					nn->setInput(i, normalizeNNInput(calibrationDataLC[learningStep][i]));
-				nn->step();
-				nn->setError(0, 0 - nn->getOutput(0));
-				nn->setError(1, 0 - nn->getOutput(1));
-				nn->setError(2, learningTargetValue - nn->getOutput(2));
-				errorLog << (0 - nn->getOutput(0)) << " " << (0 - nn->getOutput(1)) << " " << (learningTargetValue - nn->getOutput(2)) << std::endl;
-				nn->stepBackward();
-
-				// Right click
-				for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
-					nn->setInput(i, normalizeNNInput(calibrationDataRC[learningStep][i]));
-				nn->step();
-				nn->setError(0, 0 - nn->getOutput(0));
-				nn->setError(1, 0 - nn->getOutput(1));
-				nn->setError(2, (-learningTargetValue) - nn->getOutput(2));
-				errorLog << (0 - nn->getOutput(0)) << " " << (0 - nn->getOutput(1)) << " " << ((-learningTargetValue) - nn->getOutput(2)) << std::endl;
-				nn->stepBackward();
-			}
+			double newMean, newStddev;
+			estimateMeanAndStdVarOfInput(&newMean, &newStddev);
 
-			// dump the weights
-			std::ofstream nnLog("nn.log.txt");
-			// for each layer
-			for (size_t layer = 0; layer < nn->layerNum(); layer++)
+			// learn in background, the current network, if any, is kept until then
+			short (* const learningSets[EMGMouseBackpropNNLearningSetCount])[EMGMouseBackpropNNInputCount] =
 			{
-				nnLog << "Layer " << layer << std::endl;
-				// for each neurone
-				for (size_t y = 0; y < nn->getWeightsMatrixHeight(layer); y++)
-				{
-					// for each connection
-					for (size_t x = 0; x < nn->getWeightsMatrixWidth(layer); x++)
-						nnLog << nn->getWeight(layer, x, y) << " ";
-					nnLog << nn->getBiasWeight(layer, y) << " ";
-					nnLog << "\n" << std::endl;
-				}
-			}
+				calibrationDataIdle,
+				calibrationDataXP,
+				calibrationDataXN,
+				calibrationDataIdle2,
+				calibrationDataYP,
+				calibrationDataYN,
+				calibrationDataLC,
+				calibrationDataRC
+			};
+			trainer->train(learningSets, newMean, newStddev);
 
 			// change the state
+			state = STATE_TRAINING;
+			buttonTextFromState();
+		}
+	}
+	
+	// if learning is finished, swap the trained network in at block boundary
+	if (state == STATE_TRAINING)
+	{
+		Teem::BackPropFeedForwardNeuralNetwork *trainedNN = trainer->takeTrainedNetwork();
+		if (trainedNN)
+		{
+			delete nn;
+			nn = trainedNN;
+			mean = trainer->trainedMean();
+			stddev = trainer->trainedStddev();
 			state = STATE_RUNNING;
 			buttonTextFromState();
 		}
 	}
 	
-	// write output if running
-	if (state == STATE_RUNNING)
+	// write output if running, or if training with a previously learnt network
+	if ((state == STATE_RUNNING || state == STATE_TRAINING) && nn)
 	{
 		for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
 			nn->setInput(i, normalizeNNInput(inputs[i][0]));
@@ -357,40 +260,43 @@ void ProcessingEMGMouseBackpropNNClassifier::processData(const std::valarray<sig
 	}
 }
 
-void ProcessingEMGMouseBackpropNNClassifier::estimateMeanAndStdVarOfInput(void)
+void ProcessingEMGMouseBackpropNNClassifier::estimateMeanAndStdVarOfInput(double *mean, double *stddev)
 {
 	// compute mean from calibration data
-	mean = 0;
+	double m = 0;
 	for (unsigned i = 0; i < EMGMouseBackpropNNLearningStepCount; i++)
 		for (unsigned j = 0; j < EMGMouseBackpropNNInputCount; j++)
 		{
-			mean += (double)calibrationDataXP[i][j];
-			mean += (double)calibrationDataXN[i][j];
-			mean += (double)calibrationDataYP[i][j];
-			mean += (double)calibrationDataYN[i][j];
-			mean += (double)calibrationDataLC[i][j];
-			mean += (double)calibrationDataRC[i][j];
+			m += (double)calibrationDataXP[i][j];
+			m += (double)calibrationDataXN[i][j];
+			m += (double)calibrationDataYP[i][j];
+			m += (double)calibrationDataYN[i][j];
+			m += (double)calibrationDataLC[i][j];
+			m += (double)calibrationDataRC[i][j];
 		}
-	mean /= (EMGMouseBackpropNNLearningStepCount*6*EMGMouseBackpropNNInputCount);
+	m /= (EMGMouseBackpropNNLearningStepCount*6*EMGMouseBackpropNNInputCount);
 
 	// compute stddev from calibration data
-	stddev = 0;
+	double s = 0;
 	for (unsigned i = 0; i < EMGMouseBackpropNNLearningStepCount; i++)
 		for (unsigned j = 0; j < EMGMouseBackpropNNInputCount; j++)
 		{
-			stddev += ((double)calibrationDataXP[i][j] - mean) * ((double)calibrationDataXP[i][j] - mean);
-			stddev += ((double)calibrationDataXN[i][j] - mean) * ((double)calibrationDataXN[i][j] - mean);
-			stddev += ((double)calibrationDataYP[i][j] - mean) * ((double)calibrationDataYP[i][j] - mean);
-			stddev += ((double)calibrationDataYN[i][j] - mean) * ((double)calibrationDataYN[i][j] - mean);
-			stddev += ((double)calibrationDataLC[i][j] - mean) * ((double)calibrationDataLC[i][j] - mean);
-			stddev += ((double)calibrationDataRC[i][j] - mean) * ((double)calibrationDataRC[i][j] - mean);
+			s += ((double)calibrationDataXP[i][j] - m) * ((double)calibrationDataXP[i][j] - m);
+			s += ((double)calibrationDataXN[i][j] - m) * ((double)calibrationDataXN[i][j] - m);
+			s += ((double)calibrationDataYP[i][j] - m) * ((double)calibrationDataYP[i][j] - m);
+			s += ((double)calibrationDataYN[i][j] - m) * ((double)calibrationDataYN[i][j] - m);
+			s += ((double)calibrationDataLC[i][j] - m) * ((double)calibrationDataLC[i][j] - m);
+			s += ((double)calibrationDataRC[i][j] - m) * ((double)calibrationDataRC[i][j] - m);
 		}
-	stddev /= (EMGMouseBackpropNNLearningStepCount*6*EMGMouseBackpropNNInputCount);
-	stddev = sqrt(stddev);
+	s /= (EMGMouseBackpropNNLearningStepCount*6*EMGMouseBackpropNNInputCount);
+	s = sqrt(s);
 
 	// log
 	std::ofstream calibrationLog("calibration.log.txt");
-	calibrationLog << "mean " << mean << " stddev " << stddev << std::endl;
+	calibrationLog << "mean " << m << " stddev " << s << std::endl;
+
+	*mean = m;
+	*stddev = s;
 }
 
 void ProcessingEMGMouseBackpropNNClassifier::buttonClicked()
@@ -475,6 +381,11 @@ void ProcessingEMGMouseBackpropNNClassifier::buttonTextFromState(void)
 			emit setProgressVisible(true);
 			emit setProgressValue(0);
 		break;
+		case STATE_TRAINING:
+			emit setButtonState(tr("Learning, please wait"), false);
+			emit setProgressVisible(true);
+			emit setProgressValue(0);
+		break;
 		case STATE_RUNNING:
 			emit setButtonState(tr("Running. Click resets"), true);
 			emit setProgressVisible(false);
@@ -494,13 +405,147 @@ ProcessingEMGMouseBackpropNNClassifier::ProcessingEMGMouseBackpropNNClassifier(c
 	// init calibration
 	calibrationPos = 0;
 
-	// create NN
-	nn = new Teem::BackPropFeedForwardNeuralNetwork(EMGMouseBackpropNNInputCount, 3);
+	// no NN until first learning
+	nn = NULL;
+	mean = 0;
+	stddev = 1;
+
+	// create trainer, learning progress is shown as calibration progress
+	trainer = new EMGMouseBackpropNNTrainer();
+	connect(trainer, SIGNAL(progressed(int)), SIGNAL(setProgressValue(int)));
 }
 
 ProcessingEMGMouseBackpropNNClassifier::~ProcessingEMGMouseBackpropNNClassifier()
 {
+	delete trainer;
 	delete nn;
 }
 
+
+//! Constructor, the trainer is idle until train() is called
+EMGMouseBackpropNNTrainer::EMGMouseBackpropNNTrainer() :
+	mean(0),
+	stddev(1),
+	abort(false),
+	trainedNetwork(0)
+{
+}
+
+//! Destructor, abort learning if any is in progress and delete the network if it was not taken
+EMGMouseBackpropNNTrainer::~EMGMouseBackpropNNTrainer()
+{
+	abort = true;
+	wait();
+	delete takeTrainedNetwork();
+}
+
+//! Copy learningSets (idle, X+, X-, idle 2, Y+, Y-, left click, right click) and start learning a new network with them in background
+void EMGMouseBackpropNNTrainer::train(short (* const learningSets[EMGMouseBackpropNNLearningSetCount])[EMGMouseBackpropNNInputCount], double mean, double stddev)
+{
+	// wait for any previous learning and discard its result
+	wait();
+	delete takeTrainedNetwork();
+
+	for (unsigned set = 0; set < EMGMouseBackpropNNLearningSetCount; set++)
+		std::copy(&learningSets[set][0][0], &learningSets[set][0][0] + EMGMouseBackpropNNLearningStepCount * EMGMouseBackpropNNInputCount, &learningData[set][0][0]);
+	this->mean = mean;
+	this->stddev = stddev;
+	abort = false;
+
+	start(QThread::LowPriority);
+}
+
+//! Return the trained network and pass its ownership to the caller if learning is finished, return NULL otherwise
+Teem::BackPropFeedForwardNeuralNetwork *EMGMouseBackpropNNTrainer::takeTrainedNetwork()
+{
+	return trainedNetwork.fetchAndStoreOrdered(0);
+}
+
+//! Learning thread, learn a new network on a shuffled copy of the calibration data and publish it
+void EMGMouseBackpropNNTrainer::run()
+{
+	Teem::BackPropFeedForwardNeuralNetwork *nn = new Teem::BackPropFeedForwardNeuralNetwork(EMGMouseBackpropNNInputCount, 3);
+
+	// randomize NN
+	double randomRange = 1.0 / sqrt((double)nn->inputNum()); // 1 on sqrt of fan-in
+	nn->randomize(-randomRange, randomRange);
+
+	// shuffle learning samples
+	for (unsigned i = 0; i < EMGMouseBackpropNNLearningStepCount; i++)
+	{
+		unsigned exchange = rand() % EMGMouseBackpropNNLearningStepCount;
+		for (unsigned set = 0; set < EMGMouseBackpropNNLearningSetCount; set++)
+			for (unsigned j = 0; j < EMGMouseBackpropNNInputCount; j++)
+				std::swap(learningData[set][i][j], learningData[set][exchange][j]);
+	}
+
+	// target outputs of the learning sets
+	const double learningTargetValue = 0.6;
+	const double learningTargets[EMGMouseBackpropNNLearningSetCount][3] =
+	{
+		{ 0, 0, 0 },
+		{ learningTargetValue, 0, 0 },
+		{ -learningTargetValue, 0, 0 },
+		{ 0, 0, 0 },
+		{ 0, learningTargetValue, 0 },
+		{ 0, -learningTargetValue, 0 },
+		{ 0, 0, learningTargetValue },
+		{ 0, 0, -learningTargetValue }
+	};
+
+	// do the learning, each step is a minibatch with one sample of every set !
+	std::ofstream errorLog("error.log.txt");
+	double batchInputs[EMGMouseBackpropNNLearningSetCount * EMGMouseBackpropNNInputCount];
+	double batchErrors[EMGMouseBackpropNNLearningSetCount * 3];
+	for (unsigned learningStep = 0; learningStep < EMGMouseBackpropNNLearningStepCount; learningStep++)
+	{
+		if (abort)
+		{
+			delete nn;
+			return;
+		}
+
+		// decrease learning rate with time
+		nn->setLearningRate(((double)(EMGMouseBackpropNNLearningStepCount - learningStep)) / (double)(EMGMouseBackpropNNLearningStepCount * 10));
+
+		for (unsigned set = 0; set < EMGMouseBackpropNNLearningSetCount; set++)
+			for (unsigned i = 0; i < EMGMouseBackpropNNInputCount; i++)
+				batchInputs[set * EMGMouseBackpropNNInputCount + i] = normalizeNNInput(learningData[set][learningStep][i]);
+		nn->stepBatch(batchInputs, EMGMouseBackpropNNLearningSetCount);
+
+		for (unsigned set = 0; set < EMGMouseBackpropNNLearningSetCount; set++)
+		{
+			for (unsigned i = 0; i < 3; i++)
+			{
+				batchErrors[set * 3 + i] = learningTargets[set][i] - nn->getBatchOutput(set, i);
+				errorLog << batchErrors[set * 3 + i] << (i < 2 ? " " : "");
+			}
+			errorLog << std::endl;
+		}
+		nn->stepBackwardBatch(batchErrors);
+
+		emit progressed(learningStep);
+	}
+
+	// dump the weights
+	std::ofstream nnLog("nn.log.txt");
+	// for each layer
+	for (size_t layer = 0; layer < nn->layerNum(); layer++)
+	{
+		nnLog << "Layer " << layer << std::endl;
+		// for each neurone
+		for (size_t y = 0; y < nn->getWeightsMatrixHeight(layer); y++)
+		{
+			// for each connection
+			for (size_t x = 0; x < nn->getWeightsMatrixWidth(layer); x++)
+				nnLog << nn->getWeight(layer, x, y) << " ";
+			nnLog << nn->getBiasWeight(layer, y) << " ";
+			nnLog << "\n" << std::endl;
+		}
+	}
+
+	// publish the network, the plugin will swap it in at next block
+	trainedNetwork.fetchAndStoreOrdered(nn);
+}
+
 Q_EXPORT_PLUGIN(ProcessingEMGMouseBackpropNNClassifierDescription)
@@ -33,9 +33,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <ProcessingPlugin.h>
 #include <QString>
 #include <QPushButton>
+#include <QThread>
+#include <QAtomicPointer>
 
 const unsigned EMGMouseBackpropNNInputCount = 6;
 const unsigned EMGMouseBackpropNNLearningStepCount = 64;
+const unsigned EMGMouseBackpropNNLearningSetCount = 8;
 
 //! Description of the EMGMouse Neural network with back-propagation plugin
 class ProcessingEMGMouseBackpropNNClassifierDescription : public QObject, public ProcessingPluginDescription
@@ -57,12 +60,52 @@ namespace Teem
 	class BackPropFeedForwardNeuralNetwork;
 }
 
+//! Background trainer of the EMGMouse neural network.
+/*!
+	Train a shadow network on a copy of the calibration data, so that
+	the data converter thread is never blocked by learning.
+	Once learning is finished, the trained network is published and
+	can be taken by the plugin using takeTrainedNetwork().
+*/
+class EMGMouseBackpropNNTrainer : public QThread
+{
+	Q_OBJECT
+
+public:
+	EMGMouseBackpropNNTrainer();
+	~EMGMouseBackpropNNTrainer();
+	void train(short (* const learningSets[EMGMouseBackpropNNLearningSetCount])[EMGMouseBackpropNNInputCount], double mean, double stddev);
+	Teem::BackPropFeedForwardNeuralNetwork *takeTrainedNetwork();
+	double trainedMean() const { return mean; } //!< Return the input mean the network was trained with
+	double trainedStddev() const { return stddev; } //!< Return the input standard deviation the network was trained with
+
+signals:
+	//! Emitted after each learning step
+	void progressed(int);
+
+protected:
+	void run();
+
+private:
+	inline double normalizeNNInput(short sample) { return (((double)sample) - mean) / stddev; }
+
+private:
+	short learningData[EMGMouseBackpropNNLearningSetCount][EMGMouseBackpropNNLearningStepCount][EMGMouseBackpropNNInputCount]; //!< copy of the calibration data
+	double mean; //!< mean of the calibration data
+	double stddev; //!< standard deviation of the calibration data
+	volatile bool abort; //!< if true, stop learning as soon as possible
+	QAtomicPointer<Teem::BackPropFeedForwardNeuralNetwork> trainedNetwork; //!< network published when learning is finished
+};
+
 //! EMGMouse Neural network with back-propagation plugin.
 /*!
 	Learn the association of inputs to outputs suitable for mouse control.
 	The three output channels correspond to x axis, y axis and mouse buttons
 	(>0 left button, <0 right button, 0 = no button).
 
+	Learning is done by an EMGMouseBackpropNNTrainer in background. Until it
+	is finished, classification continues with the previous network, if any.
+
 	This plugin has been developed for the EMGMouse
 	(Traitement de Signaux Electromyographiques) project.
 	It is distributed with Osqoop as an example of signal processing filter.
@@ -106,6 +149,7 @@ private:
 		STATE_CALIBRATION_RC,
 		STATE_WAITING_CALIBRATION_IDLE2,
 		STATE_CALIBRATION_IDLE2,
+		STATE_TRAINING,
 		STATE_RUNNING,
 		STATE_COUNT
 	};
@@ -113,7 +157,7 @@ private:
 private:
 	inline double normalizeNNInput(short sample) { return (((double)sample) - mean) / stddev; }
 	void buttonTextFromState(void);
-	void estimateMeanAndStdVarOfInput(void);
+	void estimateMeanAndStdVarOfInput(double *mean, double *stddev);
 
 private:
 	State state;
@@ -129,6 +173,7 @@ private:
 	double stddev;
 	unsigned calibrationPos;
 	Teem::BackPropFeedForwardNeuralNetwork *nn;
+	EMGMouseBackpropNNTrainer *trainer;
 
 private:
 	friend class ProcessingEMGMouseBackpropNNClassifierDescription;
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QDoubleSpinBox>
 #include "Gain.h"
 #include <Gain.moc>
+#include <SaturatingArithmetic.h>
 
 QString ProcessingGainDescription::systemName() const
 {
@@ -62,6 +63,11 @@ ProcessingPlugin *ProcessingGainDescription::create(const DataSource *dataSource
 	return new ProcessingGain(this);
 }
 
+unsigned ProcessingGainDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
 
 ProcessingGain::ProcessingGain(const ProcessingPluginDescription *description) :
 	ProcessingPlugin(description)
@@ -86,10 +92,11 @@ QWidget *ProcessingGain::createGUI(void)
 
 void ProcessingGain::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
 {
-	signed short *srcPtr = inputs[0];
-	signed short *destPtr = outputs[0];
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-		*destPtr++ = (short)((gain * (int)(*srcPtr++)) / 100);
+	// gain is in hundredths, apply it in fixed point
+	signed short multiplier;
+	unsigned shift;
+	SaturatingArithmetic::toFixedPoint((double)gain / 100.0, &multiplier, &shift);
+	SaturatingArithmetic::scale(inputs[0], outputs[0], sampleCount, multiplier, shift);
 }
 
 void ProcessingGain::load(QTextStream *stream)
@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtCore>
 #include "Greater.h"
 #include <Greater.moc>
+#include <SaturatingArithmetic.h>
 
 QString ProcessingGreaterDescription::systemName() const
 {
@@ -59,22 +60,14 @@ ProcessingPlugin *ProcessingGreaterDescription::create(const DataSource *dataSou
 	return new ProcessingGreater(this);
 }
 
+unsigned ProcessingGreaterDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
 void ProcessingGreater::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
 {
-	signed short *srcPtr0 = inputs[0];
-	signed short *srcPtr1 = inputs[1];
-    signed short *srcPtr2 = inputs[2];
-    signed short *srcPtr3 = inputs[3];
-	signed short *destPtr = outputs[0];
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-    {
-        if ((*srcPtr0++) > (*srcPtr1++))
-		    *destPtr++ = *srcPtr2;
-        else
-            *destPtr++ = *srcPtr3;
-        srcPtr2++;
-        srcPtr3++;
-    }
+	SaturatingArithmetic::greaterSelect(inputs[0], inputs[1], inputs[2], inputs[3], outputs[0], sampleCount);
 }
 
 Q_EXPORT_PLUGIN(ProcessingGreaterDescription)
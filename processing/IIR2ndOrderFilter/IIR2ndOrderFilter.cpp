@@ -77,11 +77,16 @@ ProcessingPlugin *IIR2ndOrderFilterDescription::create(const DataSource *dataSou
 	return new IIR2ndOrderFilter(this);
 }
 
+unsigned IIR2ndOrderFilterDescription::capabilities() const
+{
+	return CAPABILITY_FLOAT_SAMPLES;
+}
+
 
 // ------------------------------------------------------------------------------------------------------------------------------
 
 IIR2ndOrderFilter::IIR2ndOrderFilter(const ProcessingPluginDescription *description) :
-	ProcessingPlugin(description)
+	BlockProcessingPlugin(description)
 {
 	filter = new IIRFilter(2);
 	std::fill(b, b+3, 0);
@@ -167,22 +172,14 @@ void IIR2ndOrderFilter::a2Changed(double value)
     filter->setCoeffs(b, a);
 }
 
-void IIR2ndOrderFilter::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
+void IIR2ndOrderFilter::processBlock(const ProcessingBlock &block)
 {
-	signed short *srcPtr0 = inputs[0];
-	signed short *destPtr0 = outputs[0];
+	const float *srcPtr0 = block.inputs[0].float32;
+	float *destPtr0 = block.outputs[0].float32;
 
 	filter->lock();
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-	{
-		double sourceValue = (double)(*srcPtr0);
-
-		double filteredValue = filter->getNext(sourceValue);
-		*destPtr0 = (signed short)(filteredValue);
-
-		srcPtr0++;
-		destPtr0++;
-	}
+	for (unsigned sample = 0; sample < block.sampleCount; sample++)
+		*destPtr0++ = (float)filter->getNext(*srcPtr0++);
 	filter->unlock();
 }
 
@@ -39,10 +39,10 @@ class QSliderDoubleDisplay;
 class IIRFilter;
 
 //! Description of a IIR 2nd order filter with user defined coefficient
-class IIR2ndOrderFilterDescription : public QObject, public ProcessingPluginDescription
+class IIR2ndOrderFilterDescription : public QObject, public BlockProcessingPluginDescription
 {
 	Q_OBJECT
-	Q_INTERFACES(ProcessingPluginDescription)
+	Q_INTERFACES(ProcessingPluginDescription BlockProcessingPluginDescription ProcessingPluginCapabilities)
 
 public:
 	QString systemName() const;
@@ -51,16 +51,17 @@ public:
 	unsigned inputCount() const;
 	unsigned outputCount() const;
 	ProcessingPlugin *create(const DataSource *dataSource) const;
+	unsigned capabilities() const;
 };
 
-//! IIR 2nd order filter with user defined coefficient
-class IIR2ndOrderFilter : public QObject, public ProcessingPlugin
+//! IIR 2nd order filter with user defined coefficient, filtering float samples so that chained filters do not accumulate rounding
+class IIR2ndOrderFilter : public QObject, public BlockProcessingPlugin
 {
     Q_OBJECT
     
 public:
 	QWidget *createGUI(void);
-	void processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount);
+	void processBlock(const ProcessingBlock &block);
 	void terminate(void) { deleteLater(); }
 	void load(QTextStream *stream);
 	void save(QTextStream *stream);
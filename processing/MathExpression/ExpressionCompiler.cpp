@@ -0,0 +1,542 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "ExpressionCompiler.h"
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! Flag marking a register index as a constant register, until their final position is known
+static const unsigned ConstantRegisterFlag = 0x80000000;
+//! Maximum number of working registers an expression may use
+static const unsigned MaxWorkingRegisterCount = 32;
+
+//! Recursive descent parser, generating the program of a CompiledExpression while parsing
+class CompiledExpression::Parser
+{
+public:
+	//! Construct a parser of source, emitting instructions to target
+	Parser(const std::string &source, unsigned inputCount, CompiledExpression *target) :
+		source(source),
+		inputCount(inputCount),
+		target(target),
+		pos(0),
+		depth(0),
+		maxDepth(0)
+	{
+	}
+	
+	//! Parse the whole source, return false and set error if it is not a valid expression
+	bool parse(Operand *result, unsigned *workingRegisterCount, std::string *error)
+	{
+		*result = expression();
+		skipSpaces();
+		if (this->error.empty() && pos < source.size())
+			fail("unexpected character");
+		if (!this->error.empty())
+		{
+			*error = this->error;
+			return false;
+		}
+		*workingRegisterCount = maxDepth;
+		return true;
+	}
+	
+	//! Return the register holding o, creating a constant register if required
+	unsigned registerOf(const Operand &o)
+	{
+		if (!o.isConstant)
+			return o.reg;
+		target->constants.push_back(o.value);
+		return ConstantRegisterFlag | (unsigned)(target->constants.size() - 1);
+	}
+	
+private:
+	const std::string &source; //!< text of the expression
+	const unsigned inputCount; //!< number of inputs, ch0 to ch(inputCount-1)
+	CompiledExpression *target; //!< expression receiving the instructions
+	size_t pos; //!< current parsing position in source
+	unsigned depth; //!< number of working registers in use
+	unsigned maxDepth; //!< maximum of depth during parsing
+	std::string error; //!< first error encountered, empty if none
+	
+	//! Record error message at current position, unless an error was already recorded
+	Operand fail(const std::string &message)
+	{
+		if (error.empty())
+		{
+			char position[32];
+			sprintf(position, " at character %u", (unsigned)pos + 1);
+			error = message + position;
+		}
+		return constant(0);
+	}
+	
+	//! Return an operand holding value
+	static Operand constant(float value)
+	{
+		Operand o;
+		o.isConstant = true;
+		o.value = value;
+		o.reg = 0;
+		return o;
+	}
+	
+	//! Return a new working register
+	Operand allocate()
+	{
+		Operand o;
+		o.isConstant = false;
+		o.value = 0;
+		o.reg = depth++;
+		maxDepth = std::max(maxDepth, depth);
+		if (depth > MaxWorkingRegisterCount)
+			fail("expression too complex");
+		return o;
+	}
+	
+	//! Emit op on the given operands, or fold it if they are all constants. Return the result
+	Operand emit(OpCode op, const Operand *operands, unsigned count)
+	{
+		// fold constants
+		bool allConstants = true;
+		for (unsigned i = 0; i < count; i++)
+			allConstants = allConstants && operands[i].isConstant;
+		if (allConstants)
+			return constant(evaluate(op, operands[0].value, count > 1 ? operands[1].value : 0, count > 2 ? operands[2].value : 0));
+		
+		// the result goes to the first working register, which is at the bottom of the ones used by operands
+		Operand result;
+		result.isConstant = false;
+		result.value = 0;
+		result.reg = depth;
+		for (unsigned i = 0; i < count; i++)
+			if (!operands[i].isConstant)
+				result.reg = std::min(result.reg, operands[i].reg);
+		Instruction instruction;
+		instruction.op = op;
+		instruction.dest = result.reg;
+		instruction.a = registerOf(operands[0]);
+		instruction.b = count > 1 ? registerOf(operands[1]) : 0;
+		instruction.c = count > 2 ? registerOf(operands[2]) : 0;
+		target->program.push_back(instruction);
+		
+		// free the registers of the operands
+		depth = result.reg + 1;
+		return result;
+	}
+	
+	//! Emit a unary operation
+	Operand emit(OpCode op, const Operand &a)
+	{
+		return emit(op, &a, 1);
+	}
+	
+	//! Emit a binary operation
+	Operand emit(OpCode op, const Operand &a, const Operand &b)
+	{
+		const Operand operands[2] = { a, b };
+		return emit(op, operands, 2);
+	}
+	
+	//! Skip white spaces
+	void skipSpaces()
+	{
+		while (pos < source.size() && isspace((unsigned char)source[pos]))
+			pos++;
+	}
+	
+	//! Skip spaces and consume c if it is the next character. Return whether it was consumed
+	bool accept(char c)
+	{
+		skipSpaces();
+		if (pos < source.size() && source[pos] == c)
+		{
+			pos++;
+			return true;
+		}
+		return false;
+	}
+	
+	//! expression := term (('+' | '-') term)*
+	Operand expression()
+	{
+		Operand result = term();
+		while (error.empty())
+		{
+			if (accept('+'))
+				result = emit(OP_ADD, result, term());
+			else if (accept('-'))
+				result = emit(OP_SUB, result, term());
+			else
+				break;
+		}
+		return result;
+	}
+	
+	//! term := unary (('*' | '/') unary)*
+	Operand term()
+	{
+		Operand result = unary();
+		while (error.empty())
+		{
+			if (accept('*'))
+				result = emit(OP_MUL, result, unary());
+			else if (accept('/'))
+				result = emit(OP_DIV, result, unary());
+			else
+				break;
+		}
+		return result;
+	}
+	
+	//! unary := '-' unary | '+' unary | primary
+	Operand unary()
+	{
+		if (accept('-'))
+			return emit(OP_NEG, unary());
+		if (accept('+'))
+			return unary();
+		return primary();
+	}
+	
+	//! primary := number | input | function '(' arguments ')' | '(' expression ')'
+	Operand primary()
+	{
+		skipSpaces();
+		if (pos >= source.size())
+			return fail("unexpected end of expression");
+		
+		// parenthesised expression
+		if (accept('('))
+		{
+			Operand result = expression();
+			if (!accept(')'))
+				return fail("expected )");
+			return result;
+		}
+		
+		// number
+		const char c = source[pos];
+		if (isdigit((unsigned char)c) || c == '.')
+		{
+			const char *start = source.c_str() + pos;
+			char *end;
+			const double value = strtod(start, &end);
+			if (end == start)
+				return fail("invalid number");
+			pos += end - start;
+			return constant((float)value);
+		}
+		
+		// identifier
+		if (!isalpha((unsigned char)c))
+			return fail("unexpected character");
+		const size_t start = pos;
+		while (pos < source.size() && isalnum((unsigned char)source[pos]))
+			pos++;
+		const std::string identifier = source.substr(start, pos - start);
+		
+		// input
+		if (identifier.size() > 2 && identifier.compare(0, 2, "ch") == 0 && identifier.find_first_not_of("0123456789", 2) == std::string::npos)
+		{
+			const unsigned input = (unsigned)atoi(identifier.c_str() + 2);
+			if (input >= inputCount)
+				return fail("no input " + identifier);
+			Operand result = allocate();
+			Instruction instruction;
+			instruction.op = OP_LOAD;
+			instruction.dest = result.reg;
+			instruction.a = input;
+			instruction.b = 0;
+			instruction.c = 0;
+			target->program.push_back(instruction);
+			return result;
+		}
+		
+		// function
+		OpCode op;
+		unsigned argumentCount;
+		if (identifier == "abs")
+			op = OP_ABS, argumentCount = 1;
+		else if (identifier == "sqrt")
+			op = OP_SQRT, argumentCount = 1;
+		else if (identifier == "min")
+			op = OP_MIN, argumentCount = 2;
+		else if (identifier == "max")
+			op = OP_MAX, argumentCount = 2;
+		else if (identifier == "crop")
+			op = OP_CROP, argumentCount = 2;
+		else if (identifier == "clamp")
+			op = OP_CLAMP, argumentCount = 3;
+		else
+			return fail("unknown function " + identifier);
+		
+		Operand arguments[3];
+		if (!accept('('))
+			return fail("expected (");
+		for (unsigned i = 0; i < argumentCount; i++)
+		{
+			if (i > 0 && !accept(','))
+				return fail("expected ,");
+			arguments[i] = expression();
+			if (!error.empty())
+				return arguments[i];
+		}
+		if (!accept(')'))
+			return fail("expected )");
+		return emit(op, arguments, argumentCount);
+	}
+};
+
+
+//! Constructor, the expression is 0 until compile() is called
+CompiledExpression::CompiledExpression() :
+	constants(1, 0.f),
+	workingRegisterCount(0),
+	resultRegister(0),
+	registers(TileSize, 0.f)
+{
+}
+
+//! Compile source for inputCount inputs. If source is invalid, return false, set error and leave this expression unchanged
+bool CompiledExpression::compile(const std::string &source, unsigned inputCount, std::string *error)
+{
+	CompiledExpression compiled;
+	compiled.constants.clear();
+	
+	Operand result;
+	unsigned workingCount;
+	Parser parser(source, inputCount, &compiled);
+	if (!parser.parse(&result, &workingCount, error))
+		return false;
+	
+	// place the constant registers after the working ones
+	compiled.resultRegister = parser.registerOf(result);
+	for (size_t i = 0; i < compiled.program.size(); i++)
+	{
+		Instruction &instruction = compiled.program[i];
+		if (instruction.a & ConstantRegisterFlag)
+			instruction.a = workingCount + (instruction.a & ~ConstantRegisterFlag);
+		if (instruction.b & ConstantRegisterFlag)
+			instruction.b = workingCount + (instruction.b & ~ConstantRegisterFlag);
+		if (instruction.c & ConstantRegisterFlag)
+			instruction.c = workingCount + (instruction.c & ~ConstantRegisterFlag);
+	}
+	if (compiled.resultRegister & ConstantRegisterFlag)
+		compiled.resultRegister = workingCount + (compiled.resultRegister & ~ConstantRegisterFlag);
+	compiled.workingRegisterCount = workingCount;
+	
+	// allocate registers and fill constant ones once for all
+	compiled.registers.assign((workingCount + compiled.constants.size()) * TileSize, 0.f);
+	for (size_t i = 0; i < compiled.constants.size(); i++)
+		std::fill(&compiled.registers[(workingCount + i) * TileSize], &compiled.registers[(workingCount + i) * TileSize] + TileSize, compiled.constants[i]);
+	
+	*this = compiled;
+	return true;
+}
+
+//! Evaluate the expression on sampleCount samples of inputs and write the result to output
+void CompiledExpression::run(const std::valarray<signed short *> &inputs, signed short *output, unsigned sampleCount)
+{
+	for (unsigned offset = 0; offset < sampleCount; offset += TileSize)
+		runTile(inputs, offset, output + offset, std::min(TileSize, sampleCount - offset));
+}
+
+//! Return the result of op on a, b and c; used for folding constants and by the scalar implementation
+float CompiledExpression::evaluate(OpCode op, float a, float b, float c)
+{
+	switch (op)
+	{
+		case OP_ADD: return a + b;
+		case OP_SUB: return a - b;
+		case OP_MUL: return a * b;
+		case OP_DIV: return a / b;
+		case OP_NEG: return -a;
+		case OP_ABS: return fabsf(a);
+		case OP_SQRT: return sqrtf(a);
+		case OP_MIN: return a < b ? a : b;
+		case OP_MAX: return a > b ? a : b;
+		case OP_CROP:
+		{
+			float clamped = a > -b ? a : -b;
+			clamped = clamped < b ? clamped : b;
+			return a - clamped;
+		}
+		case OP_CLAMP:
+		{
+			const float low = a > b ? a : b;
+			return low < c ? low : c;
+		}
+		default: assert(false); return 0;
+	}
+}
+
+//! Run the program on count samples, starting at offset
+void CompiledExpression::runTile(const std::valarray<signed short *> &inputs, unsigned offset, signed short *output, unsigned count)
+{
+	float *r = &registers[0];
+	
+	#ifdef __SSE2__
+	// registers are larger than the tile, so count can be rounded to full vectors
+	const unsigned vectorCount = (count + 3) & ~3;
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	#endif
+	
+	for (size_t i = 0; i < program.size(); i++)
+	{
+		const Instruction &instruction = program[i];
+		float *d = r + instruction.dest * TileSize;
+		const float *a = r + instruction.a * TileSize;
+		const float *b = r + instruction.b * TileSize;
+		const float *c = r + instruction.c * TileSize;
+		
+		if (instruction.op == OP_LOAD)
+		{
+			load(inputs[instruction.a] + offset, d, count);
+			continue;
+		}
+		
+		#ifdef __SSE2__
+		switch (instruction.op)
+		{
+			case OP_ADD:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_add_ps(_mm_loadu_ps(a + s), _mm_loadu_ps(b + s)));
+			break;
+			case OP_SUB:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_sub_ps(_mm_loadu_ps(a + s), _mm_loadu_ps(b + s)));
+			break;
+			case OP_MUL:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_mul_ps(_mm_loadu_ps(a + s), _mm_loadu_ps(b + s)));
+			break;
+			case OP_DIV:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_div_ps(_mm_loadu_ps(a + s), _mm_loadu_ps(b + s)));
+			break;
+			case OP_NEG:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_xor_ps(_mm_loadu_ps(a + s), signMask));
+			break;
+			case OP_ABS:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_andnot_ps(signMask, _mm_loadu_ps(a + s)));
+			break;
+			case OP_SQRT:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_sqrt_ps(_mm_loadu_ps(a + s)));
+			break;
+			case OP_MIN:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_min_ps(_mm_loadu_ps(a + s), _mm_loadu_ps(b + s)));
+			break;
+			case OP_MAX:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_max_ps(_mm_loadu_ps(a + s), _mm_loadu_ps(b + s)));
+			break;
+			case OP_CROP:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+				{
+					const __m128 x = _mm_loadu_ps(a + s);
+					const __m128 level = _mm_loadu_ps(b + s);
+					const __m128 clamped = _mm_min_ps(_mm_max_ps(x, _mm_xor_ps(level, signMask)), level);
+					_mm_storeu_ps(d + s, _mm_sub_ps(x, clamped));
+				}
+			break;
+			case OP_CLAMP:
+				for (unsigned s = 0; s < vectorCount; s += 4)
+					_mm_storeu_ps(d + s, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(a + s), _mm_loadu_ps(b + s)), _mm_loadu_ps(c + s)));
+			break;
+			default:
+				assert(false);
+			break;
+		}
+		#else
+		for (unsigned s = 0; s < count; s++)
+			d[s] = evaluate(instruction.op, a[s], b[s], c[s]);
+		#endif
+	}
+	
+	store(r + resultRegister * TileSize, output, count);
+}
+
+//! Convert count samples from src to float into dest
+void CompiledExpression::load(const signed short *src, float *dest, unsigned count)
+{
+	unsigned s = 0;
+	#ifdef __SSE2__
+	for (; s + 8 <= count; s += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(src + s));
+		const __m128i sign = _mm_srai_epi16(v, 15);
+		_mm_storeu_ps(dest + s, _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, sign)));
+		_mm_storeu_ps(dest + s + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, sign)));
+	}
+	#endif
+	for (; s < count; s++)
+		dest[s] = (float)src[s];
+}
+
+//! Convert count values from src to dest, truncating toward 0, saturating, and replacing NaN by 0
+void CompiledExpression::store(const float *src, signed short *dest, unsigned count)
+{
+	unsigned s = 0;
+	#ifdef __SSE2__
+	const __m128 minValue = _mm_set1_ps(-32768.f);
+	const __m128 maxValue = _mm_set1_ps(32767.f);
+	for (; s + 8 <= count; s += 8)
+	{
+		__m128 v0 = _mm_loadu_ps(src + s);
+		__m128 v1 = _mm_loadu_ps(src + s + 4);
+		v0 = _mm_min_ps(_mm_max_ps(_mm_and_ps(v0, _mm_cmpord_ps(v0, v0)), minValue), maxValue);
+		v1 = _mm_min_ps(_mm_max_ps(_mm_and_ps(v1, _mm_cmpord_ps(v1, v1)), minValue), maxValue);
+		_mm_storeu_si128((__m128i *)(dest + s), _mm_packs_epi32(_mm_cvttps_epi32(v0), _mm_cvttps_epi32(v1)));
+	}
+	#endif
+	for (; s < count; s++)
+	{
+		const float v = src[s];
+		if (v != v)
+			dest[s] = 0;
+		else if (v <= -32768.f)
+			dest[s] = -32768;
+		else if (v >= 32767.f)
+			dest[s] = 32767;
+		else
+			dest[s] = (signed short)v;
+	}
+}
@@ -0,0 +1,120 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __EXPRESSION_COMPILER_H
+#define __EXPRESSION_COMPILER_H
+
+#include <string>
+#include <vector>
+#include <valarray>
+
+//! An arithmetic expression over input channels, compiled into a fused per-block kernel
+/*!
+	The expression is parsed and compiled once by compile() into a short
+	program whose instructions operate on registers of TileSize floats.
+	run() cuts the block in tiles and runs the whole program on each of
+	them, so that all intermediate values remain in L1 cache and no
+	intermediate channel is ever written. Each instruction is a tight loop
+	over a register, using SSE when available.
+
+	The syntax is the usual infix notation, with the following elements:
+	- inputs: ch0, ch1, ... up to the number of inputs given to compile()
+	- constants: decimal numbers such as 200 or 1.5
+	- operators: + - * / and unary -, with usual precedences, and parentheses
+	- functions: abs(x), sqrt(x), min(a, b), max(a, b), clamp(x, low, high)
+	  and crop(x, level), which is x brought toward 0 by level and 0 if within [-level;level]
+
+	For instance abs(crop(ch0*1.5 + ch1, 200)).
+	Results are truncated toward 0 and saturated to the range of signed short.
+*/
+class CompiledExpression
+{
+public:
+	//! Number of samples processed at once by each instruction
+	static const unsigned TileSize = 64;
+	
+	CompiledExpression();
+	
+	bool compile(const std::string &source, unsigned inputCount, std::string *error);
+	void run(const std::valarray<signed short *> &inputs, signed short *output, unsigned sampleCount);
+	
+	//! Return the number of instructions of the compiled program
+	size_t instructionCount() const { return program.size(); }
+	
+private:
+	//! Operation of an instruction
+	enum OpCode
+	{
+		OP_LOAD, //!< dest = input a
+		OP_ADD, //!< dest = a + b
+		OP_SUB, //!< dest = a - b
+		OP_MUL, //!< dest = a * b
+		OP_DIV, //!< dest = a / b
+		OP_NEG, //!< dest = -a
+		OP_ABS, //!< dest = |a|
+		OP_SQRT, //!< dest = sqrt(a)
+		OP_MIN, //!< dest = min(a, b)
+		OP_MAX, //!< dest = max(a, b)
+		OP_CROP, //!< dest = a - clamp(a, -b, b)
+		OP_CLAMP //!< dest = clamp(a, b, c)
+	};
+	
+	//! An instruction of the compiled program, operands are register indices
+	struct Instruction
+	{
+		OpCode op; //!< operation
+		unsigned dest; //!< destination register
+		unsigned a; //!< first operand
+		unsigned b; //!< second operand
+		unsigned c; //!< third operand
+	};
+	
+	//! Result of the compilation of a subexpression, either a known constant or a register
+	struct Operand
+	{
+		bool isConstant; //!< true if value is known at compile time
+		float value; //!< value if isConstant
+		unsigned reg; //!< register holding the value otherwise
+	};
+	
+	class Parser;
+	
+	std::vector<Instruction> program; //!< instructions, run in order on each tile
+	std::vector<float> constants; //!< value of constant registers, which follow the working registers
+	unsigned workingRegisterCount; //!< number of registers written by the program
+	unsigned resultRegister; //!< register holding the result at the end of the program
+	std::vector<float> registers; //!< storage of all registers, TileSize floats each
+	
+	void runTile(const std::valarray<signed short *> &inputs, unsigned offset, signed short *output, unsigned count);
+	static float evaluate(OpCode op, float a, float b, float c);
+	static void load(const signed short *src, float *dest, unsigned count);
+	static void store(const float *src, signed short *dest, unsigned count);
+};
+
+#endif
@@ -0,0 +1,140 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include <QtCore>
+#include <QLineEdit>
+#include "MathExpression.h"
+#include <MathExpression.moc>
+
+QString ProcessingMathExpressionDescription::systemName() const
+{
+	return QString("MathExpression");
+}
+
+QString ProcessingMathExpressionDescription::name() const
+{
+	return QString("Math expression");
+}
+
+QString ProcessingMathExpressionDescription::description() const
+{
+	return QString("Compute an expression of inputs ch0 to ch3, such as abs(crop(ch0*1.5 + ch1, 200))");
+}
+
+unsigned ProcessingMathExpressionDescription::inputCount() const
+{
+	return 4;
+}
+
+unsigned ProcessingMathExpressionDescription::outputCount() const
+{
+	return 1;
+}
+
+ProcessingPlugin *ProcessingMathExpressionDescription::create(const DataSource *dataSource) const
+{
+	return new ProcessingMathExpression(this);
+}
+
+unsigned ProcessingMathExpressionDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
+
+ProcessingMathExpression::ProcessingMathExpression(const ProcessingPluginDescription *description) :
+	ProcessingPlugin(description),
+	lineEdit(NULL)
+{
+	QString error;
+	setExpression("ch0", &error);
+}
+
+//! Compile expression and use it if it is valid, otherwise keep the current one and set error
+bool ProcessingMathExpression::setExpression(const QString &expression, QString *error)
+{
+	CompiledExpression newCompiled;
+	std::string compileError;
+	if (!newCompiled.compile(expression.toStdString(), description()->inputCount(), &compileError))
+	{
+		*error = QString::fromStdString(compileError);
+		return false;
+	}
+	
+	QMutexLocker locker(&mutex);
+	this->expression = expression;
+	compiled = newCompiled;
+	return true;
+}
+
+//! called through signal/slot system when GUI has finished editing the expression
+void ProcessingMathExpression::expressionEdited()
+{
+	QString error;
+	if (setExpression(lineEdit->text().trimmed(), &error))
+	{
+		lineEdit->setStyleSheet("");
+		lineEdit->setToolTip(tr("Compiled to %0 instructions").arg(compiled.instructionCount()));
+	}
+	else
+	{
+		lineEdit->setStyleSheet("color: red");
+		lineEdit->setToolTip(error);
+	}
+}
+
+QWidget *ProcessingMathExpression::createGUI(void)
+{
+	lineEdit = new QLineEdit(expression);
+	lineEdit->setToolTip(tr("Compiled to %0 instructions").arg(compiled.instructionCount()));
+	connect(lineEdit, SIGNAL(editingFinished()), SLOT(expressionEdited()));
+	return lineEdit;
+}
+
+void ProcessingMathExpression::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
+{
+	QMutexLocker locker(&mutex);
+	compiled.run(inputs, outputs[0], sampleCount);
+}
+
+void ProcessingMathExpression::load(QTextStream *stream)
+{
+	// the expression may contain spaces, so it spans the rest of the line
+	QString error;
+	const QString newExpression = stream->readLine().trimmed();
+	if (!setExpression(newExpression, &error))
+		qDebug() << "Invalid math expression" << newExpression << ":" << error;
+}
+
+void ProcessingMathExpression::save(QTextStream *stream)
+{
+	(*stream) << expression;
+}
+
+Q_EXPORT_PLUGIN(ProcessingMathExpressionDescription)
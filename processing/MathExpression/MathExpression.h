@@ -0,0 +1,86 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __PROCESSING_MATH_EXPRESSION
+#define __PROCESSING_MATH_EXPRESSION
+
+#include <ProcessingPlugin.h>
+#include <QMutex>
+#include "ExpressionCompiler.h"
+
+class QLineEdit;
+
+//! Description of math expression plugin
+class ProcessingMathExpressionDescription : public QObject, public ProcessingPluginDescription, public ProcessingPluginCapabilities
+{
+	Q_OBJECT
+	Q_INTERFACES(ProcessingPluginDescription ProcessingPluginCapabilities)
+
+public:
+	QString systemName() const;
+	QString name() const;
+	QString description() const;
+	unsigned inputCount() const;
+	unsigned outputCount() const;
+	ProcessingPlugin *create(const DataSource *dataSource) const;
+	unsigned capabilities() const;
+};
+
+/*!
+	Math expression plugin. Compute an arbitrary expression of its inputs, such as abs(crop(ch0*1.5 + ch1, 200)).
+	The expression is compiled once when edited, and then evaluated in a single pass over the block, without
+	the intermediate buffers that a chain of elementary plugins would require.
+*/
+class ProcessingMathExpression : public QObject, public ProcessingPlugin
+{
+	Q_OBJECT
+	
+public:
+	QWidget *createGUI(void);
+	void processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount);
+	void terminate(void) { deleteLater(); }
+	void load(QTextStream *stream);
+	void save(QTextStream *stream);
+	
+private slots:
+	void expressionEdited();
+	
+private:
+	friend class ProcessingMathExpressionDescription;
+	ProcessingMathExpression(const ProcessingPluginDescription *description);
+	bool setExpression(const QString &expression, QString *error);
+	
+private:
+	QString expression; //!< source of the last valid expression
+	CompiledExpression compiled; //!< compiled version of expression
+	QMutex mutex; //!< protects compiled, which is replaced by the GUI thread
+	QLineEdit *lineEdit; //!< expression editor, NULL if GUI was not created
+};
+
+#endif
@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtCore>
 #include "Negate.h"
 #include <Negate.moc>
+#include <SaturatingArithmetic.h>
 
 QString ProcessingNegateDescription::systemName() const
 {
@@ -59,12 +60,14 @@ ProcessingPlugin *ProcessingNegateDescription::create(const DataSource *dataSour
 	return new ProcessingNegate(this);
 }
 
+unsigned ProcessingNegateDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
 void ProcessingNegate::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
 {
-	signed short *srcPtr = inputs[0];
-	signed short *destPtr = outputs[0];
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-		*destPtr++ = - (*srcPtr++);
+	SaturatingArithmetic::negate(inputs[0], outputs[0], sampleCount);
 }
 
 Q_EXPORT_PLUGIN(ProcessingNegateDescription)
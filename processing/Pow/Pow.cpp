@@ -31,6 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QDoubleSpinBox>
 #include "Pow.h"
 #include <Pow.moc>
+#include <SaturatingArithmetic.h>
+#include <cmath>
 
 QString ProcessingPowDescription::systemName() const
 {
@@ -62,11 +64,18 @@ ProcessingPlugin *ProcessingPowDescription::create(const DataSource *dataSource)
 	return new ProcessingPow(this);
 }
 
+unsigned ProcessingPowDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
 
 ProcessingPow::ProcessingPow(const ProcessingPluginDescription *description) :
 	ProcessingPlugin(description)
 {
 	exponent = 1;
+	table.resize(65536);
+	updateTable();
 }
 
 //! called through signal/slot system when GUI changes the exponent
@@ -86,13 +95,29 @@ QWidget *ProcessingPow::createGUI(void)
 
 void ProcessingPow::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
 {
-	signed short *srcPtr = inputs[0];
-	signed short *destPtr = outputs[0];
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-    {
-        float fVal = (*srcPtr++);
-		*destPtr++ = (short)powf(fVal, exponent);
-    }
+	if (exponent != tableExponent)
+		updateTable();
+	SaturatingArithmetic::lookup(inputs[0], outputs[0], sampleCount, &table[0]);
+}
+
+//! Compute the result of every possible input for the actual exponent
+void ProcessingPow::updateTable()
+{
+	tableExponent = exponent;
+	for (unsigned i = 0; i < table.size(); i++)
+	{
+		float fVal = (signed short)i;
+		float result = powf(fVal, tableExponent);
+		// negative values with non-integer exponents have no real result
+		if (result != result)
+			table[i] = 0;
+		else if (result > 32767.f)
+			table[i] = 32767;
+		else if (result < -32768.f)
+			table[i] = -32768;
+		else
+			table[i] = (signed short)result;
+	}
 }
 
 void ProcessingPow::load(QTextStream *stream)
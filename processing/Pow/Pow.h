@@ -33,10 +33,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <ProcessingPlugin.h>
 
 //! Description of Pow plugin
-class ProcessingPowDescription : public QObject, public ProcessingPluginDescription
+class ProcessingPowDescription : public QObject, public ProcessingPluginDescription, public ProcessingPluginCapabilities
 {
 	Q_OBJECT
-	Q_INTERFACES(ProcessingPluginDescription)
+	Q_INTERFACES(ProcessingPluginDescription ProcessingPluginCapabilities)
 
 public:
 	QString systemName() const;
@@ -45,6 +45,7 @@ public:
 	unsigned inputCount() const;
 	unsigned outputCount() const;
 	ProcessingPlugin *create(const DataSource *dataSource) const;
+	unsigned capabilities() const;
 };
 
 //! Pow plugin. elevate the signal to a specific power
@@ -66,8 +67,12 @@ private:
 	friend class ProcessingPowDescription;
 	ProcessingPow(const ProcessingPluginDescription *description);
 	
+	void updateTable();
+	
 private:
 	float exponent;
+	float tableExponent; //!< exponent table was computed for
+	std::valarray<signed short> table; //!< result for every possible input, indexed by its unsigned representation
 };
 
 #endif
@@ -0,0 +1,143 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include <QtCore>
+#include <QLabel>
+#include <QTimer>
+#include "SequenceCheck.h"
+#include <SequenceCheck.moc>
+
+QString ProcessingSequenceCheckDescription::systemName() const
+{
+	return QString("SequenceCheck");
+}
+
+QString ProcessingSequenceCheckDescription::name() const
+{
+	return QString("Sequence check");
+}
+
+QString ProcessingSequenceCheckDescription::description() const
+{
+	return QString("Check the sequence counters of the stress data source and report lost samples");
+}
+
+unsigned ProcessingSequenceCheckDescription::inputCount() const
+{
+	return 2;
+}
+
+unsigned ProcessingSequenceCheckDescription::outputCount() const
+{
+	return 1;
+}
+
+ProcessingPlugin *ProcessingSequenceCheckDescription::create(const DataSource *dataSource) const
+{
+	return new ProcessingSequenceCheck(this);
+}
+
+
+ProcessingSequenceCheck::ProcessingSequenceCheck(const ProcessingPluginDescription *description) :
+	ProcessingPlugin(description)
+{
+	started = false;
+	expected = 0;
+	checkedSamples = 0;
+	lostSamples = 0;
+	lossCount = 0;
+	reorderCount = 0;
+}
+
+QWidget *ProcessingSequenceCheck::createGUI(void)
+{
+	statisticsLabel = new QLabel;
+	QTimer *timer = new QTimer(statisticsLabel);
+	connect(timer, SIGNAL(timeout()), SLOT(updateGUI()));
+	timer->start(500);
+	updateGUI();
+	return statisticsLabel;
+}
+
+//! called periodically to display statistics
+void ProcessingSequenceCheck::updateGUI()
+{
+	if (!statisticsLabel)
+		return;
+	// copy the statistics, the acquisition thread updates them
+	mutex.lock();
+	const quint64 checked = checkedSamples;
+	const quint64 lost = lostSamples;
+	const unsigned gaps = lossCount;
+	const unsigned reorderings = reorderCount;
+	mutex.unlock();
+	const double lossRatio = checked ? (double)lost / (double)(checked + lost) : 0;
+	statisticsLabel->setText(tr("%1 samples checked\n%2 samples lost (%3 %) in %4 gaps\n%5 reorderings").arg(checked).arg(lost).arg(lossRatio * 100, 0, 'g', 3).arg(gaps).arg(reorderings));
+}
+
+void ProcessingSequenceCheck::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
+{
+	const signed short *lowPtr = inputs[0];
+	const signed short *highPtr = inputs[1];
+	signed short *destPtr = outputs[0];
+	const unsigned mask = (1 << 30) - 1;
+	quint64 blockLostSamples = 0;
+	unsigned blockLossCount = 0;
+	unsigned blockReorderCount = 0;
+	
+	for (unsigned sample = 0; sample < sampleCount; sample++)
+	{
+		const unsigned index = ((unsigned)(highPtr[sample] & 0x7FFF) << 15) | (unsigned)(lowPtr[sample] & 0x7FFF);
+		const unsigned difference = (index - expected) & mask;
+		if (started && (difference != 0))
+		{
+			// half of the counter range forward is a loss, backward a reordering
+			if (difference < (1 << 29))
+			{
+				blockLostSamples += difference;
+				blockLossCount++;
+			}
+			else
+				blockReorderCount++;
+			destPtr[sample] = 1000;
+		}
+		else
+			destPtr[sample] = 0;
+		started = true;
+		expected = (index + 1) & mask;
+	}
+	
+	QMutexLocker locker(&mutex);
+	checkedSamples += sampleCount;
+	lostSamples += blockLostSamples;
+	lossCount += blockLossCount;
+	reorderCount += blockReorderCount;
+}
+
+Q_EXPORT_PLUGIN(ProcessingSequenceCheckDescription)
@@ -0,0 +1,90 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __PROCESSING_SEQUENCE_CHECK
+#define __PROCESSING_SEQUENCE_CHECK
+
+#include <ProcessingPlugin.h>
+#include <QPointer>
+#include <QMutex>
+#include <valarray>
+
+class QLabel;
+
+//! Description of SequenceCheck plugin
+class ProcessingSequenceCheckDescription : public QObject, public ProcessingPluginDescription
+{
+	Q_OBJECT
+	Q_INTERFACES(ProcessingPluginDescription)
+
+public:
+	QString systemName() const;
+	QString name() const;
+	QString description() const;
+	unsigned inputCount() const;
+	unsigned outputCount() const;
+	ProcessingPlugin *create(const DataSource *dataSource) const;
+};
+
+//! SequenceCheck plugin. Check the sequence counters of the stress data source and report lost and reordered samples
+/*!
+	The inputs are the low and high 15 bits of the sample index, as
+	generated by the stress data source on its channels 0 and 1.
+	Every sample is expected to follow the previous one; a jump forward
+	means samples were lost, a jump backward that they were reordered.
+	The output is 1000 at each discontinuity and 0 elsewhere.
+*/
+class ProcessingSequenceCheck : public QObject, public ProcessingPlugin
+{
+	Q_OBJECT
+	
+public:
+	QWidget *createGUI(void);
+	void processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount);
+	void terminate(void) { deleteLater(); }
+	
+private slots:
+	void updateGUI();
+	
+private:
+	friend class ProcessingSequenceCheckDescription;
+	ProcessingSequenceCheck(const ProcessingPluginDescription *description);
+	
+private:
+	QPointer<QLabel> statisticsLabel; //!< label displaying the statistics
+	QMutex mutex; //!< protects the statistics, which are updated by the acquisition thread and displayed by the GUI thread
+	bool started; //!< true once the first sample has been received
+	unsigned expected; //!< expected index of the next sample, on 30 bits
+	quint64 checkedSamples; //!< number of samples received
+	quint64 lostSamples; //!< number of samples missing in the sequence
+	unsigned lossCount; //!< number of jumps forward
+	unsigned reorderCount; //!< number of jumps backward
+};
+
+#endif
@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtCore>
 #include "Sum.h"
 #include <Sum.moc>
+#include <SaturatingArithmetic.h>
 
 QString ProcessingSumDescription::systemName() const
 {
@@ -59,13 +60,14 @@ ProcessingPlugin *ProcessingSumDescription::create(const DataSource *dataSource)
 	return new ProcessingSum(this);
 }
 
+unsigned ProcessingSumDescription::capabilities() const
+{
+	return CAPABILITY_ELEMENT_WISE;
+}
+
 void ProcessingSum::processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
 {
-	signed short *srcPtr0 = inputs[0];
-	signed short *srcPtr1 = inputs[1];
-	signed short *destPtr = outputs[0];
-	for (unsigned sample = 0; sample < sampleCount; sample++)
-		*destPtr++ = (*srcPtr0++) + (*srcPtr1++);
+	SaturatingArithmetic::add(inputs[0], inputs[1], outputs[0], sampleCount);
 }
 
 Q_EXPORT_PLUGIN(ProcessingSumDescription)
@@ -32,11 +32,114 @@
 
 namespace Teem
 {
+	namespace
+	{
+		//! Number of rows of the left operand processed together, to share loads of the right operand
+		const size_t gemmRowBlock = 4;
+		//! Size of the tiles the matrices are cut in, so that the working set remains in L1
+		const size_t gemmTileSize = 64;
+		
+		//! Compute C = A B^T, with A (m x k), B (n x k) and C (m x n) all contiguous row-major
+		void gemmABt(const double *A, const double *B, double *C, size_t m, size_t n, size_t k)
+		{
+			for (size_t i0 = 0; i0 < m; i0 += gemmTileSize)
+			{
+				const size_t iEnd = std::min(i0 + gemmTileSize, m);
+				for (size_t j0 = 0; j0 < n; j0 += gemmTileSize)
+				{
+					const size_t jEnd = std::min(j0 + gemmTileSize, n);
+					size_t i = i0;
+					// gemmRowBlock rows of A against each row of B
+					for (; i + gemmRowBlock <= iEnd; i += gemmRowBlock)
+					{
+						const double *a0 = A + (i + 0) * k;
+						const double *a1 = A + (i + 1) * k;
+						const double *a2 = A + (i + 2) * k;
+						const double *a3 = A + (i + 3) * k;
+						for (size_t j = j0; j < jEnd; j++)
+						{
+							const double *b = B + j * k;
+							double c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+							for (size_t p = 0; p < k; p++)
+							{
+								const double bp = b[p];
+								c0 += a0[p] * bp;
+								c1 += a1[p] * bp;
+								c2 += a2[p] * bp;
+								c3 += a3[p] * bp;
+							}
+							C[(i + 0) * n + j] = c0;
+							C[(i + 1) * n + j] = c1;
+							C[(i + 2) * n + j] = c2;
+							C[(i + 3) * n + j] = c3;
+						}
+					}
+					// remaining rows
+					for (; i < iEnd; i++)
+					{
+						const double *a = A + i * k;
+						for (size_t j = j0; j < jEnd; j++)
+						{
+							const double *b = B + j * k;
+							double c = 0;
+							for (size_t p = 0; p < k; p++)
+								c += a[p] * b[p];
+							C[i * n + j] = c;
+						}
+					}
+				}
+			}
+		}
+		
+		//! Compute C = A B, with A (m x k), B (k x n) and C (m x n) all contiguous row-major
+		void gemmAB(const double *A, const double *B, double *C, size_t m, size_t n, size_t k)
+		{
+			std::fill(C, C + m * n, 0.0);
+			for (size_t p0 = 0; p0 < k; p0 += gemmTileSize)
+			{
+				const size_t pEnd = std::min(p0 + gemmTileSize, k);
+				for (size_t i = 0; i < m; i++)
+				{
+					double *c = C + i * n;
+					for (size_t p = p0; p < pEnd; p++)
+					{
+						const double a = A[i * k + p];
+						const double *b = B + p * n;
+						for (size_t j = 0; j < n; j++)
+							c[j] += a * b[j];
+					}
+				}
+			}
+		}
+		
+		//! Compute C += alpha A^T B, with A (k x m), B (k x n) and C (m x n) all contiguous row-major
+		void gemmAtBAdd(const double *A, const double *B, double *C, size_t m, size_t n, size_t k, double alpha)
+		{
+			for (size_t i0 = 0; i0 < m; i0 += gemmTileSize)
+			{
+				const size_t iEnd = std::min(i0 + gemmTileSize, m);
+				for (size_t p = 0; p < k; p++)
+				{
+					const double *a = A + p * m;
+					const double *b = B + p * n;
+					for (size_t i = i0; i < iEnd; i++)
+					{
+						const double s = alpha * a[i];
+						double *c = C + i * n;
+						for (size_t j = 0; j < n; j++)
+							c[j] += s * b[j];
+					}
+				}
+			}
+		}
+	}
+	
 	FeedForwardNeuralNetwork::FeedForwardNeuralNetwork(size_t inputCount, size_t outputCount, unsigned hiddenLayerCount, const size_t *hidderLayerSizes, double biasValue, const char *activationFunction, double activationFunctionParameter) :
 		hiddenLayerCount(hiddenLayerCount),
 		biasValue(biasValue),
 		activationFunction(activationFunction),
-		activationFunctionParameter(activationFunctionParameter)
+		activationFunctionParameter(activationFunctionParameter),
+		batchSize(0)
 	{
 		assert(inputCount > 0);
 		
@@ -54,19 +157,18 @@ namespace Teem
 		// init state variables
 		for(unsigned i = 0; i < layerCount; i++)
 		{
-			unsigned layerInCount = (i == 0 ? inputCount : layerSizes[i-1]);
-			unsigned layerOutCount = layerSizes[i];
-			weights.push_back(Matrix<double>(layerInCount, layerOutCount));
-			biasWeights.push_back(std::valarray<double>(layerOutCount));
-			activations.push_back(std::valarray<double>(layerOutCount));
-			outputs.push_back(std::valarray<double>(layerOutCount));
+			weights.push_back(std::valarray<double>(layerSizes[i] * layerInputSize(i)));
+			biasWeights.push_back(std::valarray<double>(layerSizes[i]));
+			activations.push_back(std::valarray<double>());
+			outputs.push_back(std::valarray<double>());
 		}
 		
 		input.resize(inputCount);
+		resizeBatch(1);
 		
 		std::string s = activationFunction;
 		if (s == "tanh")
-			forwardActFunc = &TanhForwardActivationFunction;
+			activationFunctionType = ACTIVATION_TANH;
 		else
 			assert(false);
 	}
@@ -80,25 +182,75 @@ namespace Teem
 	
 	double FeedForwardNeuralNetwork::getOutput(unsigned index)
 	{
-		assert(index < outputs[outputs.size()-1].size());
+		return getBatchOutput(0, index);
+	}
+	
+	double FeedForwardNeuralNetwork::getBatchOutput(size_t sample, unsigned index) const
+	{
+		assert(sample < batchSize);
+		assert(index < outputCount);
 		
-		return outputs[outputs.size()-1][index];
+		return outputs[layerCount-1][sample * outputCount + index];
 	}
 
 	void FeedForwardNeuralNetwork::step()
 	{
+		stepBatch(&input[0], 1);
+	}
+	
+	void FeedForwardNeuralNetwork::stepBatch(const double *batchInputs, size_t batchSize)
+	{
+		assert(batchSize > 0);
+		
+		resizeBatch(batchSize);
+		std::copy(batchInputs, batchInputs + batchSize * inputCount, &batchInput[0]);
+		
+		switch (activationFunctionType)
+		{
+			case ACTIVATION_TANH: forward<TanhActivation>(); break;
+			default: assert(false);
+		}
+	}
+	
+	void FeedForwardNeuralNetwork::resizeBatch(size_t batchSize)
+	{
+		if (batchSize == this->batchSize)
+			return;
+		
+		this->batchSize = batchSize;
+		batchInput.resize(batchSize * inputCount);
+		for (size_t i = 0; i < layerCount; i++)
+		{
+			activations[i].resize(batchSize * layerSizes[i]);
+			outputs[i].resize(batchSize * layerSizes[i]);
+		}
+	}
+	
+	template<typename Activation>
+	void FeedForwardNeuralNetwork::forward()
+	{
+		const double b = activationFunctionParameter;
+		
 		// for each layer...
-		for (unsigned i = 0; i < layerCount; i++)
+		for (size_t i = 0; i < layerCount; i++)
 		{
-			// output from previous layer
-			std::valarray<double> &layerInput = (i == 0 ? input : outputs[i-1]);
+			const size_t inCount = layerInputSize(i);
+			const size_t outCount = layerSizes[i];
+			double *act = &activations[i][0];
+			double *out = &outputs[i][0];
+			const double *bias = &biasWeights[i][0];
 			
-			// compute activation for this layer
-			activations[i] = weights[i] * layerInput;
-			activations[i] += biasWeights[i] * ((double) biasValue);
-
-			// compute output for this layer
-			std::for_each(&activations[i][0], &activations[i][activations[i].size()], ActivationFunctor(forwardActFunc, outputs[i], activationFunctionParameter));
+			// compute activation for this layer, for all samples at once
+			gemmABt(layerInput(i), &weights[i][0], act, batchSize, outCount, inCount);
+			
+			// add bias and compute output for this layer
+			for (size_t sample = 0; sample < batchSize; sample++)
+				for (size_t j = 0; j < outCount; j++)
+				{
+					const size_t k = sample * outCount + j;
+					act[k] += bias[j] * biasValue;
+					out[k] = Activation::forward(act[k], b);
+				}
 		}
 	}
 	
@@ -106,7 +258,7 @@ namespace Teem
 	{
 		for(size_t i = 0; i < weights.size(); i++)
 		{
-			std::generate(&weights[i].flat()[0], &weights[i].flat()[weights[i].flat().size()], An::UniformRand(from, to));
+			std::generate(&weights[i][0], &weights[i][weights[i].size()], An::UniformRand(from, to));
 			std::generate(&biasWeights[i][0], &biasWeights[i][biasWeights[i].size()], An::UniformRand(from, to));
 		}
 	}
@@ -120,49 +272,65 @@ namespace Teem
 	{
 		// init state variables
 		for(unsigned i = 0; i < layerCount; i++)
-			deltas.push_back(std::valarray<double>( layerSizes[i]));
+			deltas.push_back(std::valarray<double>());
 		
 		error.resize(outputCount);
-		
-		std::string s = activationFunction;
-		if(s == "tanh")
-			backwardActFunc = &TanhBackwardActivationFunction;
-		else
-			assert(false);
 	}
 	
 	void BackPropFeedForwardNeuralNetwork::stepBackward()
-	{	
+	{
+		assert(batchSize == 1);
+		
+		stepBackwardBatch(&error[0]);
+	}
+	
+	void BackPropFeedForwardNeuralNetwork::stepBackwardBatch(const double *batchErrors)
+	{
+		assert(batchSize > 0);
+		
+		for (size_t i = 0; i < layerCount; i++)
+			if (deltas[i].size() != batchSize * layerSizes[i])
+				deltas[i].resize(batchSize * layerSizes[i]);
+		
+		switch (activationFunctionType)
+		{
+			case ACTIVATION_TANH: backward<TanhActivation>(batchErrors); break;
+			default: assert(false);
+		}
+	}
+	
+	template<typename Activation>
+	void BackPropFeedForwardNeuralNetwork::backward(const double *batchErrors)
+	{
+		const double b = activationFunctionParameter;
+		
 		// Compute deltas for output layer
-		size_t idx = activations.size()-1;
-		std::for_each(&activations[idx][0], &activations[idx][activations[idx].size()], ActivationFunctor(backwardActFunc, deltas[idx], activationFunctionParameter));
-		//deltas[idx] += 0.1;	// suggested by Fahlman (1989), as mentionned in Herz, Krogh & Palmer, pg. 122
-		deltas[idx] *= error;
+		const size_t idx = layerCount-1;
+		for (size_t k = 0; k < batchSize * outputCount; k++)
+			deltas[idx][k] = Activation::backward(outputs[idx][k], b) * batchErrors[k];
 		
 		// Compute deltas for every other layers
-		for(int i = idx-1; i >= 0; i--)
+		for (int i = idx-1; i >= 0; i--)
 		{
-			std::for_each(&activations[i][0], &activations[i][activations[i].size()], ActivationFunctor(backwardActFunc, deltas[i], activationFunctionParameter));
-			deltas[i] *= deltas[i+1] * weights[i+1];
+			const size_t count = batchSize * layerSizes[i];
+			gemmAB(&deltas[i+1][0], &weights[i+1][0], &deltas[i][0], batchSize, layerSizes[i], layerSizes[i+1]);
+			for (size_t k = 0; k < count; k++)
+				deltas[i][k] *= Activation::backward(outputs[i][k], b);
 		}
 		
 		// Update all weights
-		for(unsigned i = 0; i < weights.size(); i++)
+		for (size_t i = 0; i < layerCount; i++)
 		{
-			Matrix<double> &W = weights[i];
-			size_t fromCount = W.columnNum();
-			size_t toCount = W.rowNum();
-			std::valarray<double> &fromLayer = (i == 0 ? input : outputs[i-1]);
+			const size_t toCount = layerSizes[i];
+			const double *delta = &deltas[i][0];
 			
 			// update weights coming from previous layer
-			for(size_t to = 0; to < toCount; to++)
-				for(size_t from = 0; from < fromCount; from++)
-				{
-					W(from, to) += learningRate * deltas[i][to] * fromLayer[from];
-				}
+			gemmAtBAdd(delta, layerInput(i), &weights[i][0], toCount, layerInputSize(i), batchSize, learningRate);
 			
 			// update weights coming from bias.
-			biasWeights[i] += learningRate * biasValue * deltas[i];
+			for (size_t sample = 0; sample < batchSize; sample++)
+				for (size_t to = 0; to < toCount; to++)
+					biasWeights[i][to] += learningRate * biasValue * delta[sample * toCount + to];
 		}
 	}
 }
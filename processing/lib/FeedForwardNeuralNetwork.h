@@ -27,7 +27,8 @@
 #include <valarray>
 #include <vector>
 #include <string>
-#include "Matrix.h"
+#include <cassert>
+#include <cmath>
 
 /*!	\file FeedForwardNeuralNetwork.h
 	\brief Interface of feed-forward only neural networks
@@ -37,7 +38,14 @@ namespace Teem
 {
 	//! Class that implement a simple multilayer feedforward neural network
 	//! without using the abstract NN architecture.
-	//! \ingroup controllers
+	/*!
+		Weights are stored per layer in a contiguous row-major matrix, one row of
+		fan-in weights per neuron. Inputs can be propagated one vector at a time
+		using setInput(), step() and getOutput() or as a whole minibatch using
+		stepBatch() and getBatchOutput(). Both go through the same blocked
+		matrix-matrix kernels, a single vector being a batch of size 1.
+		\ingroup controllers
+	*/
 	class FeedForwardNeuralNetwork
 	{
 	public:
@@ -57,6 +65,13 @@ namespace Teem
 		//! Propagate the input values to the output through all the layers.
 		void step();
 		
+		//! Propagate batchSize input vectors stored row-major in batchInputs (batchSize x inputCount) through all the layers.
+		void stepBatch(const double *batchInputs, size_t batchSize);
+		//! Read the output value index of sample in the last propagated batch.
+		double getBatchOutput(size_t sample, unsigned index) const;
+		//! Return the number of samples in the last propagated batch.
+		size_t getBatchSize() const { return batchSize; }
+		
 		//! Return the number of layers.
 		size_t layerNum() { return layerCount; }
 		//! Return the size of the nth layer. Layer 0 is the fist layer after input.
@@ -68,13 +83,13 @@ namespace Teem
 		
 		//! Set the weight of a particular synapse to a particular layer. Using layer 0,
 		//! synpases from input to layer 0 are set.
-		void setWeight(size_t toLayer, size_t from, size_t to, double w) { weights[toLayer](from, to) = w; }
+		void setWeight(size_t toLayer, size_t from, size_t to, double w) { weights[toLayer][to * layerInputSize(toLayer) + from] = w; }
 		//! Get the value for a particular weight.
-		double getWeight(size_t toLayer, size_t from, size_t to) const { return weights[toLayer](from, to); }
+		double getWeight(size_t toLayer, size_t from, size_t to) const { return weights[toLayer][to * layerInputSize(toLayer) + from]; }
 		//! Return the width (number of columns) of the weights matrix for a given layer
-		size_t getWeightsMatrixWidth(size_t layer) { return weights[layer].columnNum(); }
+		size_t getWeightsMatrixWidth(size_t layer) { return layerInputSize(layer); }
 		//! Return the height (number of rows) of the weights matrix for a given layer
-		size_t getWeightsMatrixHeight(size_t layer) { return weights[layer].rowNum(); }
+		size_t getWeightsMatrixHeight(size_t layer) { return layerSizes[layer]; }
 		
 		//! Set weight from bias to neuron.
 		void setBiasWeight(size_t toLayer, size_t to, double w) { biasWeights[toLayer][to] = w; }
@@ -85,14 +100,20 @@ namespace Teem
 		void randomize(double from, double to);
 	
 	protected:
+		//! Available activation functions, each one is a policy class the propagation kernels are instantiated with
+		enum ActivationFunctionType
+		{
+			ACTIVATION_TANH = 0 //!< hyperbolic tangent
+		};
 		
-		//! Activation function y = g(x)
-		//! @param x activation
-		//! @param b activation function parameter (slope)
-		//! @return output
-		typedef double (*ActivationFunction)(double x, double b);
-	
-		class ActivationFunctor;
+		//! Tanh activation function policy, y = tanh(b x)
+		struct TanhActivation
+		{
+			//! Activation function y = g(x) with b the activation function parameter (slope)
+			static inline double forward(double x, double b) { return tanh(x * b); }
+			//! Derivative of the activation function, expressed from the output y = g(x)
+			static inline double backward(double y, double b) { return b * (1.0 - y * y); }
+		};
 		
 		size_t inputCount; //!< number of input
 		size_t outputCount; //!< number of output
@@ -102,51 +123,29 @@ namespace Teem
 		double biasValue;  //!< value of the bias neuron
 		std::string activationFunction;  //!< name of the activation function
 		double activationFunctionParameter;  //!< parameter for the activation function
+		ActivationFunctionType activationFunctionType;  //!< activation function selected by activationFunction
 		
-		std::vector<Matrix<double> > weights;  //!< weight matrix for each layer
+		std::vector<std::valarray<double> > weights;  //!< row-major weight matrix (layerSize x layerInputSize) for each layer
 		std::vector<std::valarray<double> > biasWeights;  //!< weight from the bias to each layer
-		std::vector<std::valarray<double> > activations;  //!< activation of each neuron
-		std::vector<std::valarray<double> > outputs;  //!< output of each neuron
+		std::vector<std::valarray<double> > activations;  //!< activation of each neuron, row-major (batchSize x layerSize)
+		std::vector<std::valarray<double> > outputs;  //!< output of each neuron, row-major (batchSize x layerSize)
 		std::valarray<double> input;  //!< input vector
-		ActivationFunction forwardActFunc;  //!< pointer to activation function
+		std::valarray<double> batchInput;  //!< copy of the inputs of the last propagated batch, row-major (batchSize x inputCount)
+		size_t batchSize;  //!< number of samples in the last propagated batch
 		
-		//! Tanh activation function.
-		static double TanhForwardActivationFunction(double x, double b)
-		{
-			return tanh(x * b);
-		}
-	};
-	
-	//! Functor to compute activation function on std::valarray<double>
-	//! unsing std::for_each.
-	class FeedForwardNeuralNetwork::ActivationFunctor
-	{
-	protected:
-		ActivationFunction function;  //!< pointer to activation function
-		double b;  //!< activation function parameter
-		std::valarray<double>& result;  //!< array to hold result
-		size_t pos;  //!< position in the result array
-		
-	public:
-		//! Constructor, use function func and parameter b, and return result in res and 
-		ActivationFunctor(ActivationFunction func, std::valarray<double> &res, double b)
-			: result(res)
-		{
-			this->function = func;
-			this->pos = 0;
-			this->b = b;
-		}
-		
-		//! Do the operation, store value in result[pos] and increment pos
-		void operator()(double x)
-		{
-			result[pos++] = function(x, b);
-		}
+		//! Return the number of inputs of layer, that is the size of the previous layer or the number of inputs
+		size_t layerInputSize(size_t layer) const { return layer == 0 ? inputCount : layerSizes[layer-1]; }
+		//! Return the outputs of the layer feeding layer, that is the previous layer or the batch inputs
+		const double *layerInput(size_t layer) const { return layer == 0 ? &batchInput[0] : &outputs[layer-1][0]; }
+		//! Resize the per-sample buffers so that they can hold batchSize samples
+		void resizeBatch(size_t batchSize);
+		//! Propagate batchInput through all layers using activation function Activation
+		template<typename Activation> void forward();
 	};
 	
 	
 	/**
-	Feed forward neural network with online back-propagation. Use that way:
+	Feed forward neural network with back-propagation. Use that way for online learning:
 	
 \code
 for i in inputs
@@ -156,6 +155,18 @@ for i in outputs
 	nn.setError(i, errorValue);
 nn.stepBackward();
 \endcode
+
+	or that way for minibatch learning, with inputs and errors stored row-major:
+
+\code
+nn.stepBatch(inputs, batchSize);
+for s in samples, i in outputs
+	errors[s * outputCount + i] = targets[s * outputCount + i] - nn.getBatchOutput(s, i);
+nn.stepBackwardBatch(errors);
+\endcode
+	
+	In minibatch mode, the weight change is the sum of the changes the samples
+	would have caused individually, all being computed with the same weights.
 	\ingroup controllers
 	*/
 	class BackPropFeedForwardNeuralNetwork : public FeedForwardNeuralNetwork
@@ -168,6 +179,8 @@ nn.stepBackward();
 		
 		//! Backpropagate the error on the weight.
 		void stepBackward();
+		//! Backpropagate errors of the last propagated batch, stored row-major (batchSize x outputCount), on the weight.
+		void stepBackwardBatch(const double *batchErrors);
 		
 		//! Set the output error (desired value minus obtained value)
 		void setError(size_t index, double val)
@@ -185,15 +198,10 @@ nn.stepBackward();
 		
 		double learningRate;  //!< learning rate constant
 		std::valarray<double> error;  //!< desired output
-		ActivationFunction backwardActFunc;  //!< derivative of the activation function
-		std::vector<std::valarray<double> > deltas;  //!< deltas (see backprop algorithm)
-	
-		//! Tanh backward activation function.
-		static double TanhBackwardActivationFunction(double x, double b)
-		{
-			double t = tanh(x * b);
-			return b * (1.0 - t * t);
-		}
+		std::vector<std::valarray<double> > deltas;  //!< deltas (see backprop algorithm), row-major (batchSize x layerSize)
+		
+		//! Backpropagate batchErrors and update weights using activation function Activation
+		template<typename Activation> void backward(const double *batchErrors);
 	};
 }
 
@@ -0,0 +1,275 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "SaturatingArithmetic.h"
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*!	\file SaturatingArithmetic.cpp
+	\brief Implementation of saturating arithmetic kernels
+*/
+
+namespace SaturatingArithmetic
+{
+	#ifdef __SSE2__
+	//! Number of signed short in a SSE2 register
+	const unsigned vectorSize = 8;
+	
+	//! Load 8 samples from unaligned memory
+	static inline __m128i load(const signed short *src) { return _mm_loadu_si128((const __m128i *)src); }
+	//! Store 8 samples to unaligned memory
+	static inline void store(signed short *dest, __m128i v) { _mm_storeu_si128((__m128i *)dest, v); }
+	
+	//! Return the saturated, rounded, (a * b) >> shift of 8 samples
+	static inline __m128i mulShift(__m128i a, __m128i b, __m128i shift, __m128i round)
+	{
+		const __m128i lo = _mm_mullo_epi16(a, b);
+		const __m128i hi = _mm_mulhi_epi16(a, b);
+		__m128i p0 = _mm_unpacklo_epi16(lo, hi);
+		__m128i p1 = _mm_unpackhi_epi16(lo, hi);
+		p0 = _mm_sra_epi32(_mm_add_epi32(p0, round), shift);
+		p1 = _mm_sra_epi32(_mm_add_epi32(p1, round), shift);
+		return _mm_packs_epi32(p0, p1);
+	}
+	#else
+	//! Without SIMD, the whole block is processed by the scalar tail loops
+	const unsigned vectorSize = 1;
+	#endif
+	
+	//! Return the number of samples that are processed using vector instructions
+	static inline unsigned vectorCount(unsigned sampleCount)
+	{
+		#ifdef __SSE2__
+		return sampleCount & ~(vectorSize - 1);
+		#else
+		return 0;
+		#endif
+	}
+	
+	//! Return the rounding offset to add before shifting right by shift
+	static inline int roundingOffset(unsigned shift)
+	{
+		return shift ? (1 << (shift - 1)) : 0;
+	}
+	
+	void toFixedPoint(double factor, signed short *multiplier, unsigned *shift)
+	{
+		// find the largest shift such that the multiplier still fits
+		const double magnitude = std::fabs(factor);
+		unsigned s = 0;
+		while ((s < 30) && (magnitude * (double)(1 << (s + 1)) < 32767.5))
+			s++;
+		double m = floor(factor * (double)(1 << s) + 0.5);
+		if (m > 32767)
+			m = 32767;
+		if (m < -32768)
+			m = -32768;
+		*multiplier = (signed short)m;
+		*shift = s;
+	}
+	
+	void add(const signed short *src0, const signed short *src1, signed short *dest, unsigned sampleCount)
+	{
+		unsigned i = 0;
+		#ifdef __SSE2__
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+			store(dest + i, _mm_adds_epi16(load(src0 + i), load(src1 + i)));
+		#endif
+		for (; i < sampleCount; i++)
+			dest[i] = saturate((int)src0[i] + (int)src1[i]);
+	}
+	
+	void sub(const signed short *src0, const signed short *src1, signed short *dest, unsigned sampleCount)
+	{
+		unsigned i = 0;
+		#ifdef __SSE2__
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+			store(dest + i, _mm_subs_epi16(load(src0 + i), load(src1 + i)));
+		#endif
+		for (; i < sampleCount; i++)
+			dest[i] = saturate((int)src0[i] - (int)src1[i]);
+	}
+	
+	void mul(const signed short *src0, const signed short *src1, signed short *dest, unsigned sampleCount, unsigned shift)
+	{
+		const int round = roundingOffset(shift);
+		unsigned i = 0;
+		#ifdef __SSE2__
+		const __m128i vShift = _mm_cvtsi32_si128(shift);
+		const __m128i vRound = _mm_set1_epi32(round);
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+			store(dest + i, mulShift(load(src0 + i), load(src1 + i), vShift, vRound));
+		#endif
+		for (; i < sampleCount; i++)
+			dest[i] = saturate(((int)src0[i] * (int)src1[i] + round) >> shift);
+	}
+	
+	void div(const signed short *src0, const signed short *src1, signed short *dest, unsigned sampleCount)
+	{
+		unsigned i = 0;
+		#ifdef __SSE2__
+		// int16 quotients are exact once truncated when computed in float
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i maxValue = _mm_set1_epi16(32767);
+		const __m128i minValue = _mm_set1_epi16(-32768);
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+		{
+			const __m128i a = load(src0 + i);
+			const __m128i b = load(src1 + i);
+			const __m128i divByZero = _mm_cmpeq_epi16(b, zero);
+			// replace zero divisors by one to keep the float division defined
+			const __m128i safeB = _mm_or_si128(_mm_andnot_si128(divByZero, b), _mm_and_si128(divByZero, _mm_set1_epi16(1)));
+			const __m128i aSign = _mm_cmpgt_epi16(zero, a);
+			const __m128i bSign = _mm_cmpgt_epi16(zero, safeB);
+			const __m128 q0 = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(a, aSign)), _mm_cvtepi32_ps(_mm_unpacklo_epi16(safeB, bSign)));
+			const __m128 q1 = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(a, aSign)), _mm_cvtepi32_ps(_mm_unpackhi_epi16(safeB, bSign)));
+			const __m128i q = _mm_packs_epi32(_mm_cvttps_epi32(q0), _mm_cvttps_epi32(q1));
+			const __m128i zeroResult = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi16(a, zero), maxValue), _mm_andnot_si128(_mm_cmpgt_epi16(a, zero), minValue));
+			store(dest + i, _mm_or_si128(_mm_andnot_si128(divByZero, q), _mm_and_si128(divByZero, zeroResult)));
+		}
+		#endif
+		for (; i < sampleCount; i++)
+		{
+			if (src1[i] == 0)
+				dest[i] = src0[i] > 0 ? 32767 : -32768;
+			else
+				dest[i] = saturate((int)src0[i] / (int)src1[i]);
+		}
+	}
+	
+	void scale(const signed short *src, signed short *dest, unsigned sampleCount, signed short multiplier, unsigned shift)
+	{
+		const int round = roundingOffset(shift);
+		unsigned i = 0;
+		#ifdef __SSE2__
+		const __m128i vMultiplier = _mm_set1_epi16(multiplier);
+		const __m128i vShift = _mm_cvtsi32_si128(shift);
+		const __m128i vRound = _mm_set1_epi32(round);
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+			store(dest + i, mulShift(load(src + i), vMultiplier, vShift, vRound));
+		#endif
+		for (; i < sampleCount; i++)
+			dest[i] = saturate(((int)src[i] * (int)multiplier + round) >> shift);
+	}
+	
+	void negate(const signed short *src, signed short *dest, unsigned sampleCount)
+	{
+		unsigned i = 0;
+		#ifdef __SSE2__
+		const __m128i zero = _mm_setzero_si128();
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+			store(dest + i, _mm_subs_epi16(zero, load(src + i)));
+		#endif
+		for (; i < sampleCount; i++)
+			dest[i] = saturate(-(int)src[i]);
+	}
+	
+	void abs(const signed short *src, signed short *dest, unsigned sampleCount)
+	{
+		unsigned i = 0;
+		#ifdef __SSE2__
+		const __m128i zero = _mm_setzero_si128();
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+		{
+			const __m128i v = load(src + i);
+			store(dest + i, _mm_max_epi16(v, _mm_subs_epi16(zero, v)));
+		}
+		#endif
+		for (; i < sampleCount; i++)
+			dest[i] = src[i] < 0 ? saturate(-(int)src[i]) : src[i];
+	}
+	
+	void greaterSelect(const signed short *src0, const signed short *src1, const signed short *ifGreater, const signed short *otherwise, signed short *dest, unsigned sampleCount)
+	{
+		unsigned i = 0;
+		#ifdef __SSE2__
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+		{
+			const __m128i mask = _mm_cmpgt_epi16(load(src0 + i), load(src1 + i));
+			store(dest + i, _mm_or_si128(_mm_and_si128(mask, load(ifGreater + i)), _mm_andnot_si128(mask, load(otherwise + i))));
+		}
+		#endif
+		for (; i < sampleCount; i++)
+			dest[i] = src0[i] > src1[i] ? ifGreater[i] : otherwise[i];
+	}
+	
+	void clamp(const signed short *src, signed short *dest, unsigned sampleCount, signed short minValue, signed short maxValue)
+	{
+		unsigned i = 0;
+		#ifdef __SSE2__
+		const __m128i vMin = _mm_set1_epi16(minValue);
+		const __m128i vMax = _mm_set1_epi16(maxValue);
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+			store(dest + i, _mm_min_epi16(_mm_max_epi16(load(src + i), vMin), vMax));
+		#endif
+		for (; i < sampleCount; i++)
+			dest[i] = src[i] < minValue ? minValue : (src[i] > maxValue ? maxValue : src[i]);
+	}
+	
+	void cropBelowLevel(const signed short *src, signed short *dest, unsigned sampleCount, signed short level)
+	{
+		const signed short minValue = -level;
+		unsigned i = 0;
+		#ifdef __SSE2__
+		const __m128i vMin = _mm_set1_epi16(minValue);
+		const __m128i vMax = _mm_set1_epi16(level);
+		for (; i < vectorCount(sampleCount); i += vectorSize)
+		{
+			const __m128i v = load(src + i);
+			store(dest + i, _mm_subs_epi16(v, _mm_min_epi16(_mm_max_epi16(v, vMin), vMax)));
+		}
+		#endif
+		for (; i < sampleCount; i++)
+		{
+			const signed short clamped = src[i] < minValue ? minValue : (src[i] > level ? level : src[i]);
+			dest[i] = saturate((int)src[i] - (int)clamped);
+		}
+	}
+	
+	void lookup(const signed short *src, signed short *dest, unsigned sampleCount, const signed short *table)
+	{
+		// no gather in SSE2, but unrolling lets the loads of the table overlap
+		unsigned i = 0;
+		for (; i + 4 <= sampleCount; i += 4)
+		{
+			const signed short v0 = table[(unsigned short)src[i + 0]];
+			const signed short v1 = table[(unsigned short)src[i + 1]];
+			const signed short v2 = table[(unsigned short)src[i + 2]];
+			const signed short v3 = table[(unsigned short)src[i + 3]];
+			dest[i + 0] = v0;
+			dest[i + 1] = v1;
+			dest[i + 2] = v2;
+			dest[i + 3] = v3;
+		}
+		for (; i < sampleCount; i++)
+			dest[i] = table[(unsigned short)src[i]];
+	}
+}
@@ -0,0 +1,84 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SATURATING_ARITHMETIC_H
+#define __SATURATING_ARITHMETIC_H
+
+/*!	\file SaturatingArithmetic.h
+	\brief Saturating arithmetic kernels on blocks of signed short samples
+*/
+
+//! Saturating arithmetic on blocks of signed short samples.
+/*!
+	All kernels process sampleCount samples and clamp their results
+	to [-32768;32767] instead of wrapping around. They use SSE2 when
+	available and a scalar implementation otherwise.
+	Destination may be the same as any of the sources, so they can be
+	used in place.
+*/
+namespace SaturatingArithmetic
+{
+	//! Return value clamped to the range of signed short
+	inline signed short saturate(int value)
+	{
+		if (value > 32767)
+			return 32767;
+		if (value < -32768)
+			return -32768;
+		return (signed short)value;
+	}
+	
+	//! Approximate factor by multiplier * 2^-shift, with multiplier as large as possible for precision
+	void toFixedPoint(double factor, signed short *multiplier, unsigned *shift);
+	
+	//! dest = src0 + src1
+	void add(const signed short *src0, const signed short *src1, signed short *dest, unsigned sampleCount);
+	//! dest = src0 - src1
+	void sub(const signed short *src0, const signed short *src1, signed short *dest, unsigned sampleCount);
+	//! dest = (src0 * src1) >> shift, rounded to nearest
+	void mul(const signed short *src0, const signed short *src1, signed short *dest, unsigned sampleCount, unsigned shift = 0);
+	//! dest = src0 / src1, truncated toward zero, division by 0 giving the largest value of the sign of src0, or the smallest if src0 is 0
+	void div(const signed short *src0, const signed short *src1, signed short *dest, unsigned sampleCount);
+	//! dest = (src * multiplier) >> shift, rounded to nearest; see toFixedPoint()
+	void scale(const signed short *src, signed short *dest, unsigned sampleCount, signed short multiplier, unsigned shift);
+	//! dest = -src
+	void negate(const signed short *src, signed short *dest, unsigned sampleCount);
+	//! dest = |src|
+	void abs(const signed short *src, signed short *dest, unsigned sampleCount);
+	//! dest = src0 > src1 ? ifGreater : otherwise
+	void greaterSelect(const signed short *src0, const signed short *src1, const signed short *ifGreater, const signed short *otherwise, signed short *dest, unsigned sampleCount);
+	//! dest = src clamped to [minValue;maxValue]
+	void clamp(const signed short *src, signed short *dest, unsigned sampleCount, signed short minValue, signed short maxValue);
+	//! dest = src - clamp(src, -level, level), that is src brought toward 0 by level and 0 if within [-level;level]; level must be positive
+	void cropBelowLevel(const signed short *src, signed short *dest, unsigned sampleCount, signed short level);
+	//! dest = table[src], with table holding 65536 entries indexed by the unsigned representation of src
+	void lookup(const signed short *src, signed short *dest, unsigned sampleCount, const signed short *table);
+}
+
+#endif
@@ -31,6 +31,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <DataConverter.moc>
 #include "DataSource.h"
 #include "ProcessingPlugin.h"
+#include "ProcessingPipeline.h"
+#include "SampleArena.h"
+#include "SegmentPool.h"
+#include "TriggerEngine.h"
+#include "Decimator.h"
+#include "FrameAverager.h"
 #include "DataConverter.h"
 #include <set>
 #include <QStringList>
@@ -41,6 +47,85 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 const unsigned sampleCountForIncremental = 16384;
 const unsigned toSendIncrementalThreshold = 4096;
+const unsigned rollUpdatesPerSecond = 25;
+const unsigned maxSegmentCount = 100000;
+const unsigned maxHistorySize = 1024 * 1024;
+const unsigned maxTriggerTime = 60000000;
+const unsigned maxTriggerEventCount = 1000000;
+const unsigned decimatedBucketCount = 2048;
+const unsigned maxAveragingCount = 65536;
+
+#ifdef OSQOOP_COUNT_ALLOCATIONS
+//! Emit a signal, the allocations of its queued arguments being expected
+#define EMIT_UNCOUNTED(signal) \
+	do { \
+		const unsigned long allocationsBeforeEmit = threadAllocationCount(); \
+		emit signal; \
+		expectedAllocations += threadAllocationCount() - allocationsBeforeEmit; \
+	} while (0)
+#else
+#define EMIT_UNCOUNTED(signal) emit signal
+#endif
+
+//! Compute the layout of frames in acquisition mode: decimation is the number of source samples per bucket, 1 if every sample is kept, and frameSampleCount the number of values per channel in a frame. When decimating, outputSampleCount is rounded up to whole buckets
+static void computeFrameLayout(DataConverter::AcquisitionMode mode, unsigned *outputSampleCount, unsigned *decimation, unsigned *frameSampleCount)
+{
+	*decimation = 1;
+	if (mode != DataConverter::ACQUISITION_NORMAL)
+		*decimation = (*outputSampleCount + decimatedBucketCount - 1) / decimatedBucketCount;
+	if (*decimation <= 1)
+	{
+		*decimation = 1;
+		*frameSampleCount = *outputSampleCount;
+		return;
+	}
+	const unsigned bucketCount = (*outputSampleCount + *decimation - 1) / *decimation;
+	*outputSampleCount = bucketCount * *decimation;
+	*frameSampleCount = bucketCount * ((mode == DataConverter::ACQUISITION_PEAK_DETECT) ? 2 : 1);
+}
+
+//! Configure engine to look for the events of trigger type on channel, or on the output of pattern if it is enabled. Reset engine if its input changed since last call
+static void configureTriggerEngine(TriggerEngine *engine, unsigned *engineChannel, DataConverter::TriggerType type, unsigned channel, signed short value, const TriggerCondition &condition, const TriggerPattern &pattern, unsigned samplingRate)
+{
+	unsigned directions = 0;
+	if ((type == DataConverter::TRIGGER_UP) || (type == DataConverter::TRIGGER_BOTH))
+		directions |= TriggerEngine::RISING;
+	if ((type == DataConverter::TRIGGER_DOWN) || (type == DataConverter::TRIGGER_BOTH))
+		directions |= TriggerEngine::FALLING;
+	if (pattern.isEnabled())
+	{
+		// the pattern output crosses 0 when it changes, levels and hysteresis do not apply, runt and slope are edges
+		TriggerCondition patternCondition = condition;
+		patternCondition.hysteresis = 0;
+		if ((condition.mode == TriggerCondition::MODE_RUNT) || (condition.mode == TriggerCondition::MODE_SLOPE) || (pattern.logic == TriggerPattern::LOGIC_SEQUENCE))
+			patternCondition.mode = TriggerCondition::MODE_EDGE;
+		// a sequence completes in a single sample, trig on its start
+		if ((pattern.logic == TriggerPattern::LOGIC_SEQUENCE) && directions)
+			directions = TriggerEngine::RISING;
+		engine->configure(directions, 0, patternCondition, samplingRate);
+		channel = (unsigned)-1;
+	}
+	else
+		engine->configure(directions, value, condition, samplingRate);
+	// a disabled trigger is not fed with samples, so its state is stale once enabled again
+	if ((channel != *engineChannel) || (directions == 0))
+		engine->reset();
+	*engineChannel = channel;
+}
+
+//! Return the mask of channels the pipeline must compute: displayed ones and those of the pattern. History records the others as zero
+static unsigned computedChannelMask(unsigned displayedChannels, const TriggerPattern &pattern)
+{
+	return displayedChannels | pattern.channelMask();
+}
+
+//! Configure averager for averaging mode, its buffers are only allocated if averaging is enabled. Return true if it changed
+static bool configureAverager(FrameAverager *averager, DataConverter::AveragingMode mode, unsigned count, unsigned frameSampleCount, unsigned channelCount)
+{
+	if (mode == DataConverter::AVERAGING_NONE)
+		return averager->configure(false, 1, 0, 0);
+	return averager->configure(mode == DataConverter::AVERAGING_EXPONENTIAL, count, frameSampleCount, channelCount);
+}
 
 //! Constructor. channelCount is the initial number of channel to create and timescale the initial acquisition duration
 DataConverter::DataConverter(DataSource *dataSource, unsigned channelCount, unsigned timescale)
@@ -71,6 +156,38 @@ DataConverter::DataConverter(DataSource *dataSource, unsigned channelCount, unsi
 			_triggerChannel = 0;
 		_triggerValue = settings.value("triggerValue").toInt();
 		_triggerPos = std::min(settings.value("triggerPos").toUInt(), _outputSampleCount);
+		_segmentCount = std::min(settings.value("segmentCount").toUInt(), maxSegmentCount);
+		_triggerCondition.mode = (TriggerCondition::Mode)std::min(settings.value("triggerMode").toUInt(), (unsigned)TriggerCondition::MODE_COUNT - 1);
+		_triggerCondition.hysteresis = std::min(settings.value("triggerHysteresis").toUInt(), 65535u);
+		_triggerCondition.secondValue = settings.value("triggerSecondValue").toInt();
+		_triggerCondition.comparison = (TriggerCondition::Comparison)std::min(settings.value("triggerComparison").toUInt(), (unsigned)TriggerCondition::GREATER_THAN);
+		_triggerCondition.time = std::min(settings.value("triggerTime").toUInt(), maxTriggerTime);
+		_triggerCondition.holdoff = std::min(settings.value("triggerHoldoff").toUInt(), maxTriggerTime);
+		_triggerCondition.eventCount = std::max(std::min(settings.value("triggerEventCount", 1).toUInt(), maxTriggerEventCount), 1u);
+		_triggerPattern.logic = (TriggerPattern::Logic)std::min(settings.value("patternLogic").toUInt(), (unsigned)TriggerPattern::LOGIC_COUNT - 1);
+		_acquisitionMode = (AcquisitionMode)std::min(settings.value("acquisitionMode").toUInt(), (unsigned)ACQUISITION_HIGH_RESOLUTION);
+		_averagingMode = (AveragingMode)std::min(settings.value("averagingMode").toUInt(), (unsigned)AVERAGING_EXPONENTIAL);
+		_averagingCount = std::max(std::min(settings.value("averagingCount", 16).toUInt(), maxAveragingCount), 1u);
+		_rollMode = settings.value("rollMode").toBool();
+		int size = settings.beginReadArray("pattern");
+		for (int i = 0; i < size; i++)
+		{
+			settings.setArrayIndex(i);
+			unsigned id = logicChannelIdToPhysic(settings.value("channel").toInt(), &ok);
+			if (ok && (id < _channelCount))
+			{
+				if (id >= _triggerPattern.conditions.size())
+				{
+					_triggerPattern.conditions.resize(id + 1, TriggerPattern::CHANNEL_IGNORED);
+					_triggerPattern.levels.resize(id + 1, 0);
+				}
+				_triggerPattern.conditions[id] = (TriggerPattern::ChannelCondition)std::min(settings.value("condition").toUInt(), (unsigned)TriggerPattern::CHANNEL_CONDITION_COUNT - 1);
+				_triggerPattern.levels[id] = settings.value("level").toInt();
+				_triggerPattern.order.push_back(id);
+			}
+		}
+		settings.endArray();
+		_triggerPattern.order = _triggerPattern.terms();
 		settings.endGroup();
 	}
 	else
@@ -80,10 +197,22 @@ DataConverter::DataConverter(DataSource *dataSource, unsigned channelCount, unsi
 		_triggerChannel = 0;
 		_triggerValue = 0;
 		_triggerPos = _outputSampleCount >> 1;
+		_segmentCount = 0;
+		_acquisitionMode = ACQUISITION_NORMAL;
+		_averagingMode = AVERAGING_NONE;
+		_averagingCount = 16;
+		_rollMode = false;
 	}
 
+	// load history settings, history is allocated by the acquisition thread
+	settings.beginGroup("history");
+	_historySize = std::min(settings.value("size", 64).toUInt(), maxHistorySize);
+	historyFileName = settings.value("file").toString();
+	settings.endGroup();
+
 	// internal parameters initialisation
 	pluginConfigurationChanged = false;
+	_displayedChannels = (unsigned)-1;
 	quit = false;
 }
 
@@ -98,6 +227,35 @@ DataConverter::~DataConverter()
 	settings.setValue("triggerChannel", physicChannelIdToLogic(_triggerChannel));
 	settings.setValue("triggerValue", _triggerValue);
 	settings.setValue("triggerPos", _triggerPos);
+	settings.setValue("segmentCount", _segmentCount);
+	settings.setValue("triggerMode", (unsigned)_triggerCondition.mode);
+	settings.setValue("triggerHysteresis", _triggerCondition.hysteresis);
+	settings.setValue("triggerSecondValue", _triggerCondition.secondValue);
+	settings.setValue("triggerComparison", (unsigned)_triggerCondition.comparison);
+	settings.setValue("triggerTime", _triggerCondition.time);
+	settings.setValue("triggerHoldoff", _triggerCondition.holdoff);
+	settings.setValue("triggerEventCount", _triggerCondition.eventCount);
+	settings.setValue("patternLogic", (unsigned)_triggerPattern.logic);
+	settings.setValue("acquisitionMode", (unsigned)_acquisitionMode);
+	settings.setValue("averagingMode", (unsigned)_averagingMode);
+	settings.setValue("averagingCount", _averagingCount);
+	settings.setValue("rollMode", _rollMode);
+	// pattern conditions in the order of the sequence
+	const std::vector<unsigned> patternTerms = _triggerPattern.terms();
+	settings.beginWriteArray("pattern");
+	for (unsigned i = 0; i < patternTerms.size(); i++)
+	{
+		const unsigned channel = patternTerms[i];
+		settings.setArrayIndex(i);
+		settings.setValue("channel", physicChannelIdToLogic(channel));
+		settings.setValue("condition", (unsigned)_triggerPattern.conditions[channel]);
+		settings.setValue("level", _triggerPattern.levels[channel]);
+	}
+	settings.endArray();
+	settings.endGroup();
+	settings.beginGroup("history");
+	settings.setValue("size", _historySize);
+	settings.setValue("file", historyFileName);
 	settings.endGroup();
 
 	// first stop consumer
@@ -129,6 +287,70 @@ void DataConverter::setTrigger(TriggerType type, bool timeout, unsigned channel,
 	_triggerPos = pos;
 }
 
+//! Set the advanced trigger condition, used from the next trigger search on. Times are bounded to one minute
+void DataConverter::setTriggerCondition(const TriggerCondition &condition)
+{
+	QMutexLocker locker(&mutex);
+	_triggerCondition = condition;
+	_triggerCondition.hysteresis = std::min(condition.hysteresis, 65535u);
+	_triggerCondition.time = std::min(condition.time, maxTriggerTime);
+	_triggerCondition.holdoff = std::min(condition.holdoff, maxTriggerTime);
+	_triggerCondition.eventCount = std::max(std::min(condition.eventCount, maxTriggerEventCount), 1u);
+}
+
+//! Set the multi-channel trigger pattern, used from the next trigger search on. If enabled, it replaces the trigger channel and value
+void DataConverter::setTriggerPattern(const TriggerPattern &pattern)
+{
+	QMutexLocker locker(&mutex);
+	_triggerPattern = pattern;
+	_triggerPattern.levels.resize(pattern.conditions.size(), 0);
+	// complete the order, so that patterns of equal sequences compare equal
+	_triggerPattern.order = pattern.terms();
+}
+
+//! Set the mask of channels that are displayed. Channels not in mask and only used as intermediate results by plugins are not computed, and read as zero in frames and history
+void DataConverter::setDisplayedChannels(unsigned mask)
+{
+	QMutexLocker locker(&mutex);
+	_displayedChannels = mask;
+}
+
+//! Set the number of trigger-aligned segments to acquire before emitting them with segmentsReady. 0 disables segmented acquisition. Ignored if trigger is disabled
+void DataConverter::setSegmentCount(unsigned count)
+{
+	QMutexLocker locker(&mutex);
+	_segmentCount = std::min(count, maxSegmentCount);
+}
+
+//! Set how samples are stored in frames, used from the next frame on. Decimating modes only apply to timescales of more than a few thousand samples
+void DataConverter::setAcquisitionMode(AcquisitionMode mode)
+{
+	QMutexLocker locker(&mutex);
+	_acquisitionMode = mode;
+}
+
+//! Set how successive frames are averaged and over how many frames, used from the next frame on. Averaging restarts whenever the frame layout or any trigger setting changes, and does not apply to segmented acquisition
+void DataConverter::setAveraging(AveragingMode mode, unsigned count)
+{
+	QMutexLocker locker(&mutex);
+	_averagingMode = mode;
+	_averagingCount = std::max(std::min(count, maxAveragingCount), 1u);
+}
+
+//! Enable or disable roll mode, in which samples are sent continuously and appended at the right of the display. The frame in progress is dropped, and the trigger is ignored while rolling
+void DataConverter::setRollMode(bool enabled)
+{
+	QMutexLocker locker(&mutex);
+	_rollMode = enabled;
+}
+
+//! Set the size of the history of all channels in MB, 0 disables it. History is reallocated and emptied by the acquisition thread
+void DataConverter::setHistorySize(unsigned megabytes)
+{
+	QMutexLocker locker(&mutex);
+	_historySize = std::min(megabytes, maxHistorySize);
+}
+
 //! Get the actual plugin configuration. Simply copy our configuration to the caller's pointer
 void DataConverter::getPluginMapping(ActivePlugins *configuration, unsigned *channelCount) const
 {
@@ -160,26 +382,84 @@ void DataConverter::run()
 	unsigned triggerChannel = _triggerChannel;
 	signed short triggerValue = _triggerValue;
 	unsigned triggerPos = _triggerPos;
+	TriggerCondition triggerCondition = _triggerCondition;
+	TriggerPattern triggerPattern = _triggerPattern;
 	unsigned channelCount = _channelCount;
+	unsigned displayedChannels = _displayedChannels;
+	unsigned segmentCount = _segmentCount;
+	AcquisitionMode acquisitionMode = _acquisitionMode;
+	AveragingMode averagingMode = _averagingMode;
+	unsigned averagingCount = _averagingCount;
+	bool rollMode = _rollMode;
+	unsigned historySize = _historySize;
 	ActivePlugins plugins = _plugins;
 	mutex.unlock();
+	// in roll mode, frames are only used to send increments
+	if (rollMode)
+		triggerType = TRIGGER_NONE;
+	// number of samples per increment in roll mode, so that the display scrolls smoothly
+	const unsigned rollSendThreshold = std::max(samplingRate / rollUpdatesPerSecond, 1u);
+	_history.allocate((quint64)historySize << 20, channelCount, historyFileName);
+	
+	// in decimating modes, frames hold buckets of decimation samples, and outputSampleCount is in samples of the source
+	unsigned decimation;
+	unsigned frameSampleCount;
+	computeFrameLayout(rollMode ? ACQUISITION_NORMAL : acquisitionMode, &outputSampleCount, &decimation, &frameSampleCount);
+	Decimator decimator;
+	decimator.configure(acquisitionMode == ACQUISITION_PEAK_DETECT, channelCount);
+	// trigger-aligned frames are averaged before being emitted, the average restarts if the trigger changes
+	FrameAverager averager;
+	configureAverager(&averager, averagingMode, averagingCount, frameSampleCount, channelCount);
 	
 	unsigned actOutputSample = 0;
 	bool triggerLocked = false;
-	bool incremental = outputSampleCount > sampleCountForIncremental;
+	// in segmented mode, frames are stored in the pool and emitted all together once it is full
+	bool segmented = (segmentCount != 0) && (triggerType != TRIGGER_NONE);
+	SegmentPool segments;
+	if (segmented)
+		segments.configure(segmentCount, frameSampleCount, channelCount);
+	qint64 triggerTime = 0;
+	quint64 acquiredSamples = 0;
+	bool incremental = rollMode || ((outputSampleCount > sampleCountForIncremental) && !segmented && (decimation == 1) && (averagingMode == AVERAGING_NONE));
 	unsigned toSendIncremental = 0;
 	bool firstIncrementalSent = true;
+	// when roll mode continues from the previous frame, increments do not start a new frame on display
+	bool rollContinued = false;
+	// set when roll mode changes, the frame in progress is dropped
+	bool restartFrame = false;
 	unsigned leftToGet = 0;
 	std::valarray<std::valarray<signed short> > linearSamples(channelCount);
 	for (size_t i = 0; i < linearSamples.size(); i++)
 		linearSamples[i].resize(512);
-	std::valarray<signed short> outputSamples(outputSampleCount * channelCount);
-	std::valarray<signed short> previousValues((signed short)0, (size_t)channelCount);
+	std::valarray<signed short> outputSamples(frameSampleCount * channelCount);
+	// the trigger engine is fed with all samples of the trigger channel, so that its state is continuous across frames
+	TriggerEngine trigger;
+	unsigned triggerEngineChannel = triggerChannel;
+	configureTriggerEngine(&trigger, &triggerEngineChannel, triggerType, triggerChannel, triggerValue, triggerCondition, triggerPattern, samplingRate);
+	// with a pattern, the engine is fed with its output instead of the trigger channel
+	TriggerPatternEvaluator pattern;
+	pattern.configure(triggerPattern);
+	std::valarray<signed short> patternSamples((size_t)512);
+	// buffers of incremental sends, which are split in chunks of at most toSendIncrementalThreshold samples per channel
+	SampleArena sendArena;
+	sendArena.setCapacity(toSendIncrementalThreshold * channelCount);
+	
+	// plugins pointers are bound to linearSamples, the pipeline is rebuilt whenever it is reallocated
+	ProcessingPipeline pipeline;
+	pipeline.build(plugins, &linearSamples, dataSource->inputCount(), samplingRate, computedChannelMask(displayedChannels, triggerPattern), triggerChannel);
 
 	while (!quit)
 	{
+		#ifdef OSQOOP_COUNT_ALLOCATIONS
+		// allocations of this block, except those of the queued signal arguments
+		const unsigned long allocationsAtBlockStart = threadAllocationCount();
+		unsigned long expectedAllocations = 0;
+		bool reconfigured = false;
+		#endif
+		
 		// process plugin add/remove
 		unsigned oldChannelCount = channelCount;
+		bool pipelineChanged = false;
 		mutex.lock();
 		// if plugin configuration has changed
 		if (pluginConfigurationChanged)
@@ -201,6 +481,7 @@ void DataConverter::run()
 			for (std::set<ProcessingPlugin *>::iterator i = toDelete.begin(); i != toDelete.end(); ++i)
 				(*i)->terminate();
 			pluginConfigurationChanged = false;
+			pipelineChanged = true;
 		}
 		// if trigger enabled and no trigger found, reread trigger datas position, channel, value
 		if ((triggerType != TRIGGER_NONE) && (!triggerLocked))
@@ -210,134 +491,267 @@ void DataConverter::run()
 			triggerChannel = _triggerChannel;
 			triggerValue = _triggerValue;
 			triggerPos = _triggerPos;
+			triggerCondition = _triggerCondition;
+			triggerPattern = _triggerPattern;
+			segmentCount = _segmentCount;
+			configureTriggerEngine(&trigger, &triggerEngineChannel, triggerType, triggerChannel, triggerValue, triggerCondition, triggerPattern, samplingRate);
+			pattern.configure(triggerPattern);
 		}
+		displayedChannels = _displayedChannels;
+		if (_rollMode != rollMode)
+			restartFrame = true;
+		const unsigned oldHistorySize = historySize;
+		historySize = _historySize;
 		mutex.unlock();
+		if ((channelCount != oldChannelCount) || (historySize != oldHistorySize))
+		{
+			_history.allocate((quint64)historySize << 20, channelCount, historyFileName);
+			#ifdef OSQOOP_COUNT_ALLOCATIONS
+			reconfigured = true;
+			#endif
+		}
 		if (channelCount != oldChannelCount)
 		{
 			linearSamples.resize(channelCount);
 			for (size_t i = 0; i < linearSamples.size(); i++)
 				linearSamples[i].resize(512);
-			outputSamples.resize(outputSampleCount * channelCount);
-			previousValues.resize(channelCount, 0);
+			outputSamples.resize(frameSampleCount * channelCount);
+			decimator.configure(acquisitionMode == ACQUISITION_PEAK_DETECT, channelCount);
+			configureAverager(&averager, averagingMode, averagingCount, frameSampleCount, channelCount);
+			sendArena.setCapacity(toSendIncrementalThreshold * channelCount);
+		}
+		const unsigned computedChannels = computedChannelMask(displayedChannels, triggerPattern);
+		if (pipelineChanged || !pipeline.isBuiltFor(computedChannels, triggerChannel))
+		{
+			pipeline.build(plugins, &linearSamples, dataSource->inputCount(), samplingRate, computedChannels, triggerChannel);
+			#ifdef OSQOOP_COUNT_ALLOCATIONS
+			reconfigured = true;
+			#endif
+		}
+		// segmented mode may only change while waiting for trigger, stored segments are lost if the pool changes
+		if (segmented != ((segmentCount != 0) && (triggerType != TRIGGER_NONE)))
+		{
+			segmented = !segmented;
+			segments.clear();
+			incremental = rollMode || ((outputSampleCount > sampleCountForIncremental) && !segmented && (decimation == 1) && (averagingMode == AVERAGING_NONE));
+		}
+		if (segmented && segments.configure(segmentCount, frameSampleCount, channelCount))
+		{
+			#ifdef OSQOOP_COUNT_ALLOCATIONS
+			reconfigured = true;
+			#endif
 		}
 
 		// read data from source
 		unsigned microSecondToSleep = dataSource->getRawData(&linearSamples);
 		if (microSecondToSleep)
 			QThread::usleep(microSecondToSleep);
+		const qint64 blockTimestamp = dataSource->lastBlockTimestamp();
 		
 		// apply plugins
-		for (unsigned plugin = 0; plugin < plugins.size(); plugin++)
-		{
-			ActivePlugin &p = plugins[plugin];
-			std::valarray<signed short *> inputs(p.inputs.size());
-			std::valarray<signed short *> outputs(p.outputs.size());
-
-			// assign inputs
-			for (size_t i = 0; i < inputs.size(); i++)
-				inputs[i] = &linearSamples[p.inputs[i]][0];
-
-			// assign outputs
-			for (size_t i = 0; i < outputs.size(); i++)
-				outputs[i] = &linearSamples[p.outputs[i]][0];
-
-			// call plugin
-			Q_ASSERT(p.plugin);
-			p.plugin->processData(inputs, outputs, 512);
-		}
+		pipeline.process(512, blockTimestamp);
+		_history.append(linearSamples);
+		if (triggerPattern.isEnabled())
+			pattern.evaluate(linearSamples, 512, &patternSamples[0]);
 
 		// trigger
+		// the engine scans ahead up to the next event or the next sample where frame state changes, [triggerSearchPos, 512) is not yet scanned
+		unsigned triggerSearchPos = 0;
+		unsigned triggerEventSample = 512;
+		// when decimating, samples from decimationRunStart are not yet in the decimator
+		unsigned decimationRunStart = 0;
 		for (size_t sample = 0; sample < 512; sample++)
 		{
-			unsigned actOutputSamplePos = actOutputSample % outputSampleCount;
-			for (size_t channel = 0; channel < channelCount; channel++)
+			if ((triggerType != TRIGGER_NONE) && (sample >= triggerSearchPos) && (triggerPattern.isEnabled() || (triggerChannel < channelCount)))
 			{
-				signed short value = linearSamples[channel][sample];
-				
-				if (
-					!triggerLocked &&
-					(triggerType != TRIGGER_NONE) && 
-					(triggerChannel == channel) &&
-					(actOutputSample >= triggerPos)
-					)
+				unsigned searchEnd = 512;
+				unsigned armedFrom = 512;
+				if (triggerLocked)
 				{
-					if (	(	(triggerType == TRIGGER_UP || triggerType == TRIGGER_BOTH) &&
-								(previousValues[channel] <= triggerValue) && (value > triggerValue)
-							)
-							||
-							(	(triggerType == TRIGGER_DOWN || triggerType == TRIGGER_BOTH) &&
-								(previousValues[channel] >= triggerValue) && (value < triggerValue)
-							)
-						)
+					// keep the state up to date until the end of the frame, events are ignored
+					searchEnd = std::min(512u, (unsigned)sample + std::max(leftToGet, 1u));
+				}
+				else
+				{
+					// trig only once enough samples before trigger are stored, and not after timeout
+					if (actOutputSample >= triggerPos)
+						armedFrom = sample;
+					else
+						armedFrom = std::min(512u, (unsigned)sample + triggerPos - actOutputSample);
+					if (triggerTimeout && !segmented)
 					{
-						// triger event
-						triggerLocked = true;
-						// what we still have to get
-						if (outputSampleCount >= triggerPos)
-							leftToGet = outputSampleCount - triggerPos;
-						else
-							leftToGet = 0;
+						const unsigned timeoutSample = outputSampleCount + triggerPos;
+						searchEnd = std::min(512u, (unsigned)sample + (timeoutSample >= actOutputSample ? timeoutSample - actOutputSample + 1 : 1));
 					}
 				}
-				
-				outputSamples[channel * outputSampleCount + actOutputSamplePos] = value;
-				previousValues[channel] = value;
+				const signed short *triggerSamples = triggerPattern.isEnabled() ? &patternSamples[0] : &linearSamples[triggerChannel][0];
+				const unsigned found = trigger.find(triggerSamples, sample, searchEnd, armedFrom, acquiredSamples);
+				triggerEventSample = (found < searchEnd) ? found : 512;
+				triggerSearchPos = (found < searchEnd) ? found + 1 : searchEnd;
 			}
-
-			// incremental send
-			if (incremental && (triggerLocked || (triggerType == TRIGGER_NONE)) && (toSendIncremental >= toSendIncrementalThreshold))
+			
+			if (
+				!triggerLocked &&
+				(triggerType != TRIGGER_NONE) && 
+				(sample == triggerEventSample)
+				)
+			{
+				// triger event
+				triggerLocked = true;
+				// time of trigger in ns, from the source if it provides timestamps
+				if (blockTimestamp)
+					triggerTime = blockTimestamp + ((qint64)sample * 1000000000LL) / samplingRate;
+				else
+					triggerTime = ((qint64)(acquiredSamples + sample) * 1000000000LL) / samplingRate;
+				// what we still have to get
+				if (outputSampleCount >= triggerPos)
+					leftToGet = outputSampleCount - triggerPos;
+				else
+					leftToGet = 0;
+			}
+			
+			unsigned actOutputSamplePos = actOutputSample % outputSampleCount;
+			if (decimation == 1)
 			{
-				// fill buffer
-				std::valarray<signed short> toSendBuffer(toSendIncremental * channelCount);
 				for (size_t channel = 0; channel < channelCount; channel++)
-					for (unsigned sample = 0; sample < toSendIncremental; sample ++)
-					{
-						unsigned actOutputSamplePos = (actOutputSample + sample - toSendIncremental + 1) % outputSampleCount;
-						toSendBuffer[channel * toSendIncremental + sample] = outputSamples[channel * outputSampleCount + actOutputSamplePos];
-					}
-				// emit
-				emit dataReady(toSendBuffer, outputSampleCount, outputTime, channelCount, 0, firstIncrementalSent ? DATA_FRAME_START : 0);
+				{
+					signed short value = linearSamples[channel][sample];
+					outputSamples[channel * frameSampleCount + actOutputSamplePos] = value;
+				}
+			}
+
+			// incremental send, of the samples written since the last one including this one
+			toSendIncremental++;
+			if (incremental && (triggerLocked || (triggerType == TRIGGER_NONE)) && (toSendIncremental >= (rollMode ? rollSendThreshold : toSendIncrementalThreshold)))
+			{
+				// samples waited for before the trigger are sent together, in chunks that fit the buffers of the arena
+				for (unsigned sent = 0; sent < toSendIncremental; )
+				{
+					// fill buffer
+					const unsigned chunkSize = std::min(toSendIncremental - sent, toSendIncrementalThreshold);
+					std::valarray<signed short> &toSendBuffer = sendArena.acquire();
+					for (size_t channel = 0; channel < channelCount; channel++)
+						for (unsigned sample = 0; sample < chunkSize; sample ++)
+						{
+							unsigned actOutputSamplePos = (actOutputSample + sent + sample - toSendIncremental + 1) % outputSampleCount;
+							toSendBuffer[channel * chunkSize + sample] = outputSamples[channel * outputSampleCount + actOutputSamplePos];
+						}
+					// emit
+					unsigned flags = (firstIncrementalSent && !rollContinued) ? DATA_FRAME_START : 0;
+					if (rollMode)
+						flags |= DATA_FRAME_ROLL;
+					EMIT_UNCOUNTED(dataReady(toSendBuffer, chunkSize, outputSampleCount, outputTime, channelCount, 0, flags));
+					firstIncrementalSent = false;
+					sent += chunkSize;
+				}
 				// reset incremental
 				toSendIncremental = 0;
-				firstIncrementalSent = false;
 			}
 			
 			// counters
 			actOutputSample++;
-			toSendIncremental++;
 			if (triggerLocked)
 			{
 				if (leftToGet > 0)
                     leftToGet--;
 			}
+			// a bucket is complete, reduce it into the frame
+			if ((decimation > 1) && (actOutputSample % decimation == 0))
+			{
+				decimator.accumulate(linearSamples, decimationRunStart, sample + 1);
+				decimator.write(&outputSamples, frameSampleCount, actOutputSamplePos / decimation);
+				decimator.clear();
+				decimationRunStart = sample + 1;
+			}
 
 			// we have either get all the samples or we have elapsed time
 			if (
 				(triggerLocked && (leftToGet == 0)) || // all sample got
-				((triggerType != TRIGGER_NONE) && (!triggerLocked) && (triggerTimeout) && (actOutputSample > outputSampleCount + triggerPos)) || // no trigger found, timeout and send anyway
-				((triggerType == TRIGGER_NONE) && (actOutputSample > outputSampleCount)) // triggerDisabled
+				((triggerType != TRIGGER_NONE) && (!triggerLocked) && (triggerTimeout) && (!segmented) && (actOutputSample > outputSampleCount + triggerPos)) || // no trigger found, timeout and send anyway
+				((triggerType == TRIGGER_NONE) && (actOutputSample > outputSampleCount)) || // triggerDisabled
+				(rollMode && (actOutputSample >= outputSampleCount)) || // rolling, send before the ring wraps
+				restartFrame // roll mode changed
 				)
 			{
 				// packet full, emit it
-				if (incremental)
+				// the last bucket is written even if incomplete, it is completed if the frame is continued
+				if ((decimation > 1) && (actOutputSample % decimation != 0))
 				{
-					// fill buffer
-					std::valarray<signed short> toSendBuffer(toSendIncremental * channelCount);
-					for (size_t channel = 0; channel < channelCount; channel++)
-						for (unsigned sample = 0; sample < toSendIncremental; sample ++)
-						{
-							unsigned actOutputSamplePos = (actOutputSample + sample - toSendIncremental + 1) % outputSampleCount;
-							toSendBuffer[channel * toSendIncremental + sample] = outputSamples[channel * outputSampleCount + actOutputSamplePos];
-						}
-					// emit
-					emit dataReady(toSendBuffer, outputSampleCount, outputTime, channelCount, 0, firstIncrementalSent ? DATA_FRAME_START_END : DATA_FRAME_END);
+					decimator.accumulate(linearSamples, decimationRunStart, sample + 1);
+					decimator.write(&outputSamples, frameSampleCount, actOutputSamplePos / decimation);
+					decimationRunStart = sample + 1;
+				}
+				// position in frame of the oldest sample or bucket
+				const unsigned bucketCount = outputSampleCount / decimation;
+				const unsigned frameStart = ((actOutputSamplePos / decimation + 1) % bucketCount) * (frameSampleCount / bucketCount);
+				if (restartFrame)
+				{
+					// the frame is dropped, acquisition restarts in the new mode
+				}
+				else if (segmented)
+				{
+					// store the segment and re-arm at once, the ring already holds the pre-trigger samples of the next one
+					segments.store(outputSamples, frameStart, triggerTime);
+					triggerLocked = false;
+					if (!segments.isFull())
+					{
+						actOutputSample = (actOutputSample % outputSampleCount) + outputSampleCount;
+						continue;
+					}
+					EMIT_UNCOUNTED(segmentsReady(segments.samples(), segments.timestamps(), frameSampleCount, outputTime, segments.count(), channelCount));
+					segments.clear();
+				}
+				else if (incremental)
+				{
+					// the rest of the frame, in chunks that fit the buffers of the arena, the last one ending the frame even if empty
+					unsigned sent = 0;
+					do
+					{
+						// fill buffer
+						const unsigned chunkSize = std::min(toSendIncremental - sent, toSendIncrementalThreshold);
+						std::valarray<signed short> &toSendBuffer = sendArena.acquire();
+						for (size_t channel = 0; channel < channelCount; channel++)
+							for (unsigned sample = 0; sample < chunkSize; sample ++)
+							{
+								unsigned actOutputSamplePos = (actOutputSample + sent + sample - toSendIncremental) % outputSampleCount;
+								toSendBuffer[channel * chunkSize + sample] = outputSamples[channel * outputSampleCount + actOutputSamplePos];
+							}
+						sent += chunkSize;
+						// emit
+						unsigned flags = (firstIncrementalSent && !rollContinued) ? DATA_FRAME_START : 0;
+						if (sent == toSendIncremental)
+							flags |= DATA_FRAME_END;
+						if (rollMode)
+							flags |= DATA_FRAME_ROLL;
+						EMIT_UNCOUNTED(dataReady(toSendBuffer, chunkSize, outputSampleCount, outputTime, channelCount, 0, flags));
+						firstIncrementalSent = false;
+					}
+					while (sent < toSendIncremental);
+				}
+				else if (averagingMode != AVERAGING_NONE)
+				{
+					// frames sent on timeout are not aligned on the trigger, they do not enter the average and only show while it is empty
+					if (triggerLocked || (triggerType == TRIGGER_NONE))
+						averager.add(outputSamples, frameStart);
+					if (averager.frameCount() > 0)
+						EMIT_UNCOUNTED(dataReady(averager.samples(), frameSampleCount, frameSampleCount, outputTime, channelCount, 0, DATA_FRAME_START_END));
+					else
+						EMIT_UNCOUNTED(dataReady(outputSamples, frameSampleCount, frameSampleCount, outputTime, channelCount, frameStart, DATA_FRAME_START_END));
 				}
 				else
-					emit dataReady(outputSamples, outputSampleCount, outputTime, channelCount, ((actOutputSamplePos + 1) % outputSampleCount), DATA_FRAME_START_END);
+					EMIT_UNCOUNTED(dataReady(outputSamples, frameSampleCount, frameSampleCount, outputTime, channelCount, frameStart, DATA_FRAME_START_END));
 				
 				// get new size and params
-				unsigned oldOutputSampleCount = outputSampleCount;
+				const unsigned oldOutputSampleCount = outputSampleCount;
+				const unsigned oldDecimation = decimation;
+				const unsigned oldFrameSampleCount = frameSampleCount;
+				const TriggerType oldTriggerType = triggerType;
+				const unsigned oldTriggerChannel = triggerChannel;
+				const signed short oldTriggerValue = triggerValue;
+				const unsigned oldTriggerPos = triggerPos;
 				mutex.lock();
+				// compared before assignment, copying them could allocate
+				const bool triggerSettingsChanged = (_triggerCondition != triggerCondition) || (_triggerPattern != triggerPattern);
 				outputSampleCount = _outputSampleCount;
 				outputTime = _outputTime;
 				triggerType = _triggerType;
@@ -345,19 +759,79 @@ void DataConverter::run()
 				triggerChannel = _triggerChannel;
 				triggerValue = _triggerValue;
 				triggerPos = _triggerPos;
+				triggerCondition = _triggerCondition;
+				triggerPattern = _triggerPattern;
+				segmentCount = _segmentCount;
+				acquisitionMode = _acquisitionMode;
+				averagingMode = _averagingMode;
+				averagingCount = _averagingCount;
+				const bool wasRolling = rollMode;
+				rollMode = _rollMode;
 				mutex.unlock();
+				if (rollMode)
+					triggerType = TRIGGER_NONE;
+				// frames aligned on another event would smear the average
+				const bool triggerChanged = triggerSettingsChanged || (triggerType != oldTriggerType) || (triggerChannel != oldTriggerChannel) || (triggerValue != oldTriggerValue) || (triggerPos != oldTriggerPos);
+				computeFrameLayout(rollMode ? ACQUISITION_NORMAL : acquisitionMode, &outputSampleCount, &decimation, &frameSampleCount);
+				const bool layoutChanged = (outputSampleCount != oldOutputSampleCount) || (decimation != oldDecimation) || (frameSampleCount != oldFrameSampleCount);
+				configureTriggerEngine(&trigger, &triggerEngineChannel, triggerType, triggerChannel, triggerValue, triggerCondition, triggerPattern, samplingRate);
+				// the rest of the block is searched with the new pattern
+				if (pattern.configure(triggerPattern) && triggerPattern.isEnabled())
+					pattern.evaluate(linearSamples, 512, &patternSamples[0]);
 				
 				// reset output samples
-				if (outputSampleCount != oldOutputSampleCount)
-					outputSamples.resize(outputSampleCount * channelCount);
+				if (layoutChanged)
+				{
+					outputSamples.resize(frameSampleCount * channelCount);
+					decimator.configure(acquisitionMode == ACQUISITION_PEAK_DETECT, channelCount);
+					#ifdef OSQOOP_COUNT_ALLOCATIONS
+					reconfigured = true;
+					#endif
+				}
+				if (configureAverager(&averager, averagingMode, averagingCount, frameSampleCount, channelCount))
+				{
+					#ifdef OSQOOP_COUNT_ALLOCATIONS
+					reconfigured = true;
+					#endif
+				}
+				else if (triggerChanged)
+					averager.clear();
 				Q_ASSERT(outputSamples.size() > channelCount);
-				actOutputSample = 0;
+				// in segmented mode, keep the history to re-arm at once for the next set of segments
+				const bool wasSegmented = segmented;
+				segmented = (segmentCount != 0) && (triggerType != TRIGGER_NONE);
+				if (segmented != wasSegmented)
+					segments.clear();
+				if (segmented && segments.configure(segmentCount, frameSampleCount, channelCount))
+				{
+					#ifdef OSQOOP_COUNT_ALLOCATIONS
+					reconfigured = true;
+					#endif
+				}
+				if (wasSegmented && segmented && !layoutChanged)
+					actOutputSample = (actOutputSample % outputSampleCount) + outputSampleCount;
+				else
+				{
+					actOutputSample = 0;
+					decimator.clear();
+					decimationRunStart = sample + 1;
+				}
 				triggerLocked = false;
-				incremental = outputSampleCount > sampleCountForIncremental;
+				incremental = rollMode || ((outputSampleCount > sampleCountForIncremental) && !segmented && (decimation == 1) && (averagingMode == AVERAGING_NONE));
 				toSendIncremental = 0;
 				firstIncrementalSent = true;
+				rollContinued = rollMode && wasRolling;
+				restartFrame = false;
 			}
 		}
+		if (decimation > 1)
+			decimator.accumulate(linearSamples, decimationRunStart, 512);
+		acquiredSamples += 512;
+		
+		#ifdef OSQOOP_COUNT_ALLOCATIONS
+		// unless reconfigured, source, plugins, trigger and the send arena must not allocate, in every trigger mode
+		Q_ASSERT(reconfigured || (threadAllocationCount() - allocationsAtBlockStart == expectedAllocations));
+		#endif
 	}
 
 	deleteActivePlugins(&plugins);
@@ -32,8 +32,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include <QThread>
 #include <QMutex>
+#include <QString>
 #include <valarray>
 #include <vector>
+#include "HistoryBuffer.h"
+#include "TriggerEngine.h"
 
 class ProcessingPlugin;
 class DataSource;
@@ -53,12 +56,29 @@ public:
 		TRIGGER_BOTH //!< trig whenever the signal cross the value
 	};
 	
+	//! How samples of the data source are stored in frames
+	enum AcquisitionMode
+	{
+		ACQUISITION_NORMAL = 0, //!< keep every sample
+		ACQUISITION_PEAK_DETECT, //!< at long timescales, keep the minimum and maximum of each bucket of samples
+		ACQUISITION_HIGH_RESOLUTION //!< at long timescales, keep the average of each bucket of samples
+	};
+	
+	//! How successive frames are averaged before being emitted
+	enum AveragingMode
+	{
+		AVERAGING_NONE = 0, //!< emit every frame
+		AVERAGING_LINEAR, //!< emit the average of up to averagingCount() frames, then restart
+		AVERAGING_EXPONENTIAL //!< emit a running average in which each frame weights 1/averagingCount()
+	};
+	
 	//! Flags to qualify data frame sent for viewing
 	enum DataFrameFlags
 	{
 		DATA_FRAME_START = 0x1, //!< start of a new data frame, reread parameters
 		DATA_FRAME_END = 0x2, //!< end of the data frame
-		DATA_FRAME_START_END = 0x3 //!< both start and end
+		DATA_FRAME_START_END = 0x3, //!< both start and end
+		DATA_FRAME_ROLL = 0x4 //!< samples are appended at the end of the frame, scrolling the oldest ones out
 	};
 
 	//! the state of an active plugin
@@ -67,6 +87,8 @@ public:
 		ProcessingPlugin *plugin; //!< which pluging
 		std::vector<unsigned> inputs; //!< which channel goes to which input
 		std::vector<unsigned> outputs; //!< which output goes to which channel
+		unsigned capabilities; //!< capabilities of the plugin, a or-ed combination of ProcessingPluginCapabilities::Capability
+		bool blockPlugin; //!< whether plugin is a BlockProcessingPlugin, as its description is a BlockProcessingPluginDescription
 	};
 
 	//! A vector of all plugins 
@@ -74,8 +96,10 @@ public:
 
 
 signals:
-	//! Emit data which should be displayed
-	void dataReady(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned);
+	//! Emit data which should be displayed: samples, number of valid samples per channel in them, which can be less than their size allows, samples per channel in the frame, duration of the frame in ms, number of channels, position of the oldest sample, flags
+	void dataReady(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned);
+	//! Emit the segments of a segmented acquisition: samples, trigger times in ns, samples per channel in a segment, duration of a segment in ms, number of segments, number of channels
+	void segmentsReady(const std::valarray<signed short> &, const std::valarray<qint64> &, unsigned, unsigned, unsigned, unsigned);
 	
 public:
 	DataConverter(DataSource *dataSource, unsigned channelCount, unsigned timescale);
@@ -84,6 +108,14 @@ public:
 	// Parameters changes
 	void setTimeScale(unsigned ms);
 	void setTrigger(TriggerType type, bool timeout, unsigned channel, unsigned pos, signed short value);
+	void setTriggerCondition(const TriggerCondition &condition);
+	void setTriggerPattern(const TriggerPattern &pattern);
+	void setDisplayedChannels(unsigned mask);
+	void setSegmentCount(unsigned count);
+	void setAcquisitionMode(AcquisitionMode mode);
+	void setAveraging(AveragingMode mode, unsigned count);
+	void setRollMode(bool enabled);
+	void setHistorySize(unsigned megabytes);
 
 	// Plugin changes
 	void getPluginMapping(ActivePlugins *configuration, unsigned *channelCount) const;
@@ -95,7 +127,16 @@ public:
 	unsigned triggerChannel() const { return _triggerChannel; } //!< Return the trigger channel
 	signed short triggerValue() const { return _triggerValue; } //!< Return the trigger value
 	unsigned triggerPos() const { return _triggerPos; } //!< Return the trigger position
+	TriggerCondition triggerCondition() const { return _triggerCondition; } //!< Return the advanced trigger condition
+	TriggerPattern triggerPattern() const { return _triggerPattern; } //!< Return the multi-channel trigger pattern
 	unsigned outputSampleCount() const { return _outputSampleCount; } //!< Return the number of output sample
+	unsigned segmentCount() const { return _segmentCount; } //!< Return the number of segments of segmented acquisition, 0 if disabled
+	AcquisitionMode acquisitionMode() const { return _acquisitionMode; } //!< Return how samples are stored in frames
+	AveragingMode averagingMode() const { return _averagingMode; } //!< Return how successive frames are averaged
+	unsigned averagingCount() const { return _averagingCount; } //!< Return the number of frames averaged
+	bool rollMode() const { return _rollMode; } //!< Return whether samples scroll continuously instead of being sent in frames
+	unsigned historySize() const { return _historySize; } //!< Return the size of history in MB, 0 if disabled
+	const HistoryBuffer *history() const { return &_history; } //!< Return the history of all samples, readable while acquisition runs
 	
 	void run();
 
@@ -110,6 +151,7 @@ protected:
 	ActivePlugins _plugins; //!< processing plugins
 	unsigned _channelCount; //!< the number of channel
 	bool pluginConfigurationChanged; //!< has setPluginMapping been called
+	unsigned _displayedChannels; //!< mask of channels that are displayed, others need not be computed if only used as intermediate results
 	
 	unsigned _outputSampleCount; //!< number of sample to output
 	unsigned _outputTime; //!< the time of output in ms
@@ -119,6 +161,17 @@ protected:
 	unsigned _triggerChannel; //!< channel of which to trigger
 	signed short _triggerValue; //!< value of the trigger
 	unsigned _triggerPos; //!< position of trigger within output buffer
+	TriggerCondition _triggerCondition; //!< advanced trigger condition, such as hysteresis, pulse width or holdoff
+	TriggerPattern _triggerPattern; //!< if enabled, combination of conditions on channels replacing the trigger channel
+	unsigned _segmentCount; //!< number of trigger-aligned segments to acquire before emitting them, 0 if segmented acquisition is disabled
+	AcquisitionMode _acquisitionMode; //!< how samples are stored in frames
+	AveragingMode _averagingMode; //!< how successive frames are averaged, ignored in segmented acquisition
+	unsigned _averagingCount; //!< number of frames averaged
+	bool _rollMode; //!< if true, samples are sent continuously and scroll from the right, trigger is ignored
+	
+	HistoryBuffer _history; //!< the last samples of all channels, written by the acquisition thread
+	unsigned _historySize; //!< size of history in MB, 0 if disabled
+	QString historyFileName; //!< file backing history, in memory if empty
 	
 	mutable QMutex mutex; //!< mutex for protecting access from GUI
 };
@@ -70,6 +70,10 @@ public:
 	virtual bool init() = 0;
 	//! Read the raw data from source. Return the number of microsecond the data converter should sleep. If 0, do not sleep
 	virtual unsigned getRawData(std::valarray<std::valarray<signed short> > *data) = 0;
+	//! Return the monotonic time in nanoseconds at which the first sample of the last block returned by getRawData was acquired, or 0 if the data source does not know
+	virtual qint64 lastBlockTimestamp() const { return 0; }
+	//! Return the statistics of the acquisition so far, one "name: value" line each, or an empty string if the data source keeps none. Called from the GUI thread while getRawData runs in another one
+	virtual QString statistics() const { return QString(); }
 	
 	//! Return the number of inputs of the data source
 	virtual unsigned inputCount() const = 0;
@@ -108,6 +112,6 @@ public:
 	virtual DataSource *create() const = 0;
 };
 
-Q_DECLARE_INTERFACE(DataSourceDescription, "ch.eig.lsn.Oscilloscope.DataSourceDescription/1.0")
+Q_DECLARE_INTERFACE(DataSourceDescription, "ch.eig.lsn.Oscilloscope.DataSourceDescription/1.2")
 
 #endif
@@ -0,0 +1,162 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "Decimator.h"
+#include <algorithm>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! Compute the minimum and maximum of count samples, merging them into minimum and maximum
+static void runMinMax(const signed short *src, unsigned count, signed short *minimum, signed short *maximum)
+{
+	unsigned i = 0;
+	signed short low = *minimum;
+	signed short high = *maximum;
+	#ifdef __SSE2__
+	if (count >= 8)
+	{
+		__m128i vlow = _mm_set1_epi16(low);
+		__m128i vhigh = _mm_set1_epi16(high);
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+			vlow = _mm_min_epi16(vlow, v);
+			vhigh = _mm_max_epi16(vhigh, v);
+		}
+		// reduce the eight lanes
+		vlow = _mm_min_epi16(vlow, _mm_srli_si128(vlow, 8));
+		vhigh = _mm_max_epi16(vhigh, _mm_srli_si128(vhigh, 8));
+		vlow = _mm_min_epi16(vlow, _mm_srli_si128(vlow, 4));
+		vhigh = _mm_max_epi16(vhigh, _mm_srli_si128(vhigh, 4));
+		vlow = _mm_min_epi16(vlow, _mm_srli_si128(vlow, 2));
+		vhigh = _mm_max_epi16(vhigh, _mm_srli_si128(vhigh, 2));
+		low = (signed short)_mm_cvtsi128_si32(vlow);
+		high = (signed short)_mm_cvtsi128_si32(vhigh);
+	}
+	#endif
+	for (; i < count; i++)
+	{
+		low = std::min(low, src[i]);
+		high = std::max(high, src[i]);
+	}
+	*minimum = low;
+	*maximum = high;
+}
+
+//! Return the sum of count samples, count being at most a block
+static qint64 runSum(const signed short *src, unsigned count)
+{
+	unsigned i = 0;
+	qint64 sum = 0;
+	#ifdef __SSE2__
+	// pairs of samples are summed to 32 bits, which cannot overflow for a block
+	__m128i vsum = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+	for (; i + 8 <= count; i += 8)
+		vsum = _mm_add_epi32(vsum, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(src + i)), ones));
+	vsum = _mm_add_epi32(vsum, _mm_srli_si128(vsum, 8));
+	vsum = _mm_add_epi32(vsum, _mm_srli_si128(vsum, 4));
+	sum = _mm_cvtsi128_si32(vsum);
+	#endif
+	for (; i < count; i++)
+		sum += src[i];
+	return sum;
+}
+
+//! Constructor, decimates no channel until configure() is called
+Decimator::Decimator() :
+	peakDetect(true),
+	sampleCount(0)
+{
+}
+
+//! Set the mode and the number of channels, and empty the current bucket
+void Decimator::configure(bool peakDetect, unsigned channelCount)
+{
+	this->peakDetect = peakDetect;
+	if (minimums.size() != channelCount)
+	{
+		minimums.resize(channelCount);
+		maximums.resize(channelCount);
+		sums.resize(channelCount);
+	}
+	clear();
+}
+
+//! Empty the current bucket
+void Decimator::clear()
+{
+	sampleCount = 0;
+	minimums = std::numeric_limits<signed short>::max();
+	maximums = std::numeric_limits<signed short>::min();
+	sums = 0;
+}
+
+//! Add samples [start, end) of every channel to the current bucket
+void Decimator::accumulate(const std::valarray<std::valarray<signed short> > &samples, unsigned start, unsigned end)
+{
+	if (end <= start)
+		return;
+	const size_t channelCount = std::min(samples.size(), minimums.size());
+	for (size_t channel = 0; channel < channelCount; channel++)
+	{
+		const signed short *src = &samples[channel][start];
+		if (peakDetect)
+			runMinMax(src, end - start, &minimums[channel], &maximums[channel]);
+		else
+			sums[channel] += runSum(src, end - start);
+	}
+	sampleCount += end - start;
+}
+
+//! Write the values of the current bucket of every channel at position bucket of frame, which has frameSampleCount values per channel. The bucket is kept, so that it can be completed and written again
+void Decimator::write(std::valarray<signed short> *frame, unsigned frameSampleCount, unsigned bucket) const
+{
+	if (sampleCount == 0)
+		return;
+	const unsigned pos = bucket * valuesPerBucket();
+	for (size_t channel = 0; channel < minimums.size(); channel++)
+	{
+		signed short *dest = &(*frame)[channel * frameSampleCount + pos];
+		if (peakDetect)
+		{
+			dest[0] = minimums[channel];
+			dest[1] = maximums[channel];
+		}
+		else
+		{
+			// round to nearest, halves away from zero
+			const qint64 sum = sums[channel];
+			const qint64 half = sampleCount / 2;
+			dest[0] = (signed short)((sum >= 0) ? (sum + half) / (qint64)sampleCount : -((-sum + half) / (qint64)sampleCount));
+		}
+	}
+}
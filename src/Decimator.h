@@ -0,0 +1,66 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __DECIMATOR_H
+#define __DECIMATOR_H
+
+#include <QtGlobal>
+#include <valarray>
+
+//! Reduce each channel to one or two values per bucket of consecutive samples
+/*!
+	In peak detect mode, a bucket gives its minimum and maximum, so that
+	glitches narrower than a bucket stay visible. In high resolution mode,
+	it gives the rounded average of its samples, reducing noise by the
+	square root of the bucket size. The average is rounded to the units of
+	the data source, as frames hold 16 bits samples and data sources may
+	use their whole range, so it gains no extra bits of resolution.
+	
+	Samples are accumulated by runs of consecutive samples of a block, so
+	that a bucket can span several blocks, and runs are reduced with SIMD.
+*/
+class Decimator
+{
+public:
+	Decimator();
+	void configure(bool peakDetect, unsigned channelCount);
+	void clear();
+	void accumulate(const std::valarray<std::valarray<signed short> > &samples, unsigned start, unsigned end);
+	void write(std::valarray<signed short> *frame, unsigned frameSampleCount, unsigned bucket) const;
+	unsigned valuesPerBucket() const { return peakDetect ? 2 : 1; } //!< Return the number of values written per bucket and channel
+	
+private:
+	bool peakDetect; //!< whether buckets give their minimum and maximum instead of their average
+	unsigned sampleCount; //!< number of samples per channel in the current bucket
+	std::valarray<signed short> minimums; //!< minimum of each channel in the current bucket
+	std::valarray<signed short> maximums; //!< maximum of each channel in the current bucket
+	std::valarray<qint64> sums; //!< sum of each channel in the current bucket
+};
+
+#endif
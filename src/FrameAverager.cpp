@@ -0,0 +1,180 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "FrameAverager.h"
+#include <algorithm>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! Add count samples to sums, or replace sums if restart is true, and if dest is not 0, write the sums multiplied by scale, rounded, to it
+static void runLinear(const signed short *src, unsigned count, qint32 *sums, signed short *dest, float scale, bool restart)
+{
+	unsigned i = 0;
+	#ifdef __SSE2__
+	const __m128 vscale = _mm_set1_ps(scale);
+	for (; i + 8 <= count; i += 8)
+	{
+		// sign-extend eight samples to two vectors of 32 bits
+		const __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		if (!restart)
+		{
+			low = _mm_add_epi32(low, _mm_loadu_si128((const __m128i *)(sums + i)));
+			high = _mm_add_epi32(high, _mm_loadu_si128((const __m128i *)(sums + i + 4)));
+		}
+		_mm_storeu_si128((__m128i *)(sums + i), low);
+		_mm_storeu_si128((__m128i *)(sums + i + 4), high);
+		if (!dest)
+			continue;
+		// conversion rounds to nearest, as lrintf does
+		low = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low), vscale));
+		high = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high), vscale));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(low, high));
+	}
+	#endif
+	for (; i < count; i++)
+	{
+		sums[i] = restart ? src[i] : sums[i] + src[i];
+		if (dest)
+			dest[i] = (signed short)lrintf((float)sums[i] * scale);
+	}
+}
+
+//! Move averages towards count samples by weight of their difference, and write the averages, rounded, to dest
+static void runExponential(const signed short *src, unsigned count, float *averages, signed short *dest, float weight)
+{
+	unsigned i = 0;
+	#ifdef __SSE2__
+	const __m128 vweight = _mm_set1_ps(weight);
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		const __m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+		__m128 averageLow = _mm_loadu_ps(averages + i);
+		__m128 averageHigh = _mm_loadu_ps(averages + i + 4);
+		averageLow = _mm_add_ps(averageLow, _mm_mul_ps(_mm_sub_ps(low, averageLow), vweight));
+		averageHigh = _mm_add_ps(averageHigh, _mm_mul_ps(_mm_sub_ps(high, averageHigh), vweight));
+		_mm_storeu_ps(averages + i, averageLow);
+		_mm_storeu_ps(averages + i + 4, averageHigh);
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(_mm_cvtps_epi32(averageLow), _mm_cvtps_epi32(averageHigh)));
+	}
+	#endif
+	for (; i < count; i++)
+	{
+		averages[i] += ((float)src[i] - averages[i]) * weight;
+		dest[i] = (signed short)lrintf(averages[i]);
+	}
+}
+
+//! Constructor, averages empty frames until configure() is called
+FrameAverager::FrameAverager() :
+	exponential(false),
+	count(1),
+	sampleCount(0),
+	channelCount(0),
+	_frameCount(0),
+	accumulatedCount(0)
+{
+}
+
+//! Set the mode, the number of frames averaged, which is at most 65536 in linear mode, and the size of frames. Return true if anything changed, in which case the average is emptied
+bool FrameAverager::configure(bool exponential, unsigned count, unsigned sampleCount, unsigned channelCount)
+{
+	count = std::max(count, 1u);
+	if (!exponential)
+		count = std::min(count, 65536u);
+	if ((exponential == this->exponential) && (count == this->count) && (sampleCount == this->sampleCount) && (channelCount == this->channelCount))
+		return false;
+	
+	this->exponential = exponential;
+	this->count = count;
+	this->sampleCount = sampleCount;
+	this->channelCount = channelCount;
+	const size_t size = (size_t)sampleCount * (size_t)channelCount;
+	sums.resize(exponential ? 0 : size);
+	averages.resize(exponential ? size : 0);
+	_samples.resize(size);
+	clear();
+	return true;
+}
+
+//! Empty the average, the next frame restarts it
+void FrameAverager::clear()
+{
+	_frameCount = 0;
+	accumulatedCount = 0;
+}
+
+//! Add frame, a ring buffer of sampleCount samples per channel whose oldest sample is at startingPos, to the average, and update samples()
+void FrameAverager::add(const std::valarray<signed short> &frame, unsigned startingPos)
+{
+	Q_ASSERT(frame.size() == _samples.size());
+	Q_ASSERT(startingPos < std::max(sampleCount, 1u));
+	
+	// a full linear sum restarts, an exponential average goes on with a constant weight
+	const bool restart = (accumulatedCount == 0) || (!exponential && (accumulatedCount >= count));
+	if (restart)
+		accumulatedCount = 0;
+	accumulatedCount++;
+	
+	// a linear average is output while the first group builds, then each time a group completes
+	const bool output = exponential || (_frameCount < count) || (accumulatedCount == count);
+	if (output)
+		_frameCount = std::min(accumulatedCount, count);
+	
+	const float weight = 1.0f / (float)std::min(accumulatedCount, count);
+	for (unsigned channel = 0; channel < channelCount; channel++)
+	{
+		// the ring is unrolled in two runs, from startingPos to its end, then from its start
+		const size_t offset = (size_t)channel * sampleCount;
+		const unsigned runs[2][2] = { { startingPos, sampleCount - startingPos }, { 0, startingPos } };
+		size_t dest = offset;
+		for (unsigned run = 0; run < 2; run++)
+		{
+			const unsigned length = runs[run][1];
+			if (length == 0)
+				continue;
+			const signed short *src = &frame[offset + runs[run][0]];
+			if (exponential)
+			{
+				// the first frame replaces the average
+				if (restart)
+					std::copy(src, src + length, &averages[dest]);
+				runExponential(src, length, &averages[dest], &_samples[dest], weight);
+			}
+			else
+				runLinear(src, length, &sums[dest], output ? &_samples[dest] : 0, weight, restart);
+			dest += length;
+		}
+	}
+}
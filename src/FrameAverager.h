@@ -0,0 +1,74 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __FRAME_AVERAGER_H
+#define __FRAME_AVERAGER_H
+
+#include <QtGlobal>
+#include <valarray>
+
+//! Average of successive trigger-aligned data frames
+/*!
+	In linear mode, frames are summed into 32 bits accumulators. Until
+	count() frames have been added, the average of the frames added so far
+	is output; then the average of the last completed group of count()
+	frames is held while the next group is summed, so the output always
+	averages count() frames. In exponential mode, each frame moves
+	a floating point running average by 1/count() of its difference with it,
+	after a warm-up during which it is a linear average.
+	
+	Adding a frame accumulates it and computes the output in a single SIMD
+	pass, without allocation.
+*/
+class FrameAverager
+{
+public:
+	FrameAverager();
+	bool configure(bool exponential, unsigned count, unsigned sampleCount, unsigned channelCount);
+	void clear();
+	void add(const std::valarray<signed short> &frame, unsigned startingPos);
+	
+	//! Return the number of frames in the average returned by samples()
+	unsigned frameCount() const { return _frameCount; }
+	//! Return the average, a data frame whose oldest sample is at 0
+	const std::valarray<signed short> &samples() const { return _samples; }
+	
+private:
+	bool exponential; //!< whether the average is exponential instead of linear
+	unsigned count; //!< number of frames averaged
+	unsigned sampleCount; //!< number of samples per channel in a frame
+	unsigned channelCount; //!< number of channels in a frame
+	unsigned _frameCount; //!< number of frames in samples()
+	unsigned accumulatedCount; //!< number of frames in sums or averages
+	std::valarray<qint32> sums; //!< in linear mode, sum of frames
+	std::valarray<float> averages; //!< in exponential mode, running average of frames
+	std::valarray<signed short> _samples; //!< rounded average
+};
+
+#endif
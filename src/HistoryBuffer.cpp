@@ -0,0 +1,266 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "HistoryBuffer.h"
+#include <QFile>
+#include <QtDebug>
+#include <algorithm>
+#include <limits>
+#include <new>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! Compute the minimum and maximum of count samples, count being a multiple of 8
+static void blockMinMax(const signed short *src, unsigned count, signed short *minimum, signed short *maximum)
+{
+	#ifdef __SSE2__
+	__m128i low = _mm_set1_epi16(std::numeric_limits<signed short>::max());
+	__m128i high = _mm_set1_epi16(std::numeric_limits<signed short>::min());
+	for (unsigned i = 0; i < count; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		low = _mm_min_epi16(low, v);
+		high = _mm_max_epi16(high, v);
+	}
+	// reduce the eight lanes
+	low = _mm_min_epi16(low, _mm_srli_si128(low, 8));
+	high = _mm_max_epi16(high, _mm_srli_si128(high, 8));
+	low = _mm_min_epi16(low, _mm_srli_si128(low, 4));
+	high = _mm_max_epi16(high, _mm_srli_si128(high, 4));
+	low = _mm_min_epi16(low, _mm_srli_si128(low, 2));
+	high = _mm_max_epi16(high, _mm_srli_si128(high, 2));
+	*minimum = (signed short)_mm_cvtsi128_si32(low);
+	*maximum = (signed short)_mm_cvtsi128_si32(high);
+	#else
+	signed short low = src[0];
+	signed short high = src[0];
+	for (unsigned i = 1; i < count; i++)
+	{
+		low = std::min(low, src[i]);
+		high = std::max(high, src[i]);
+	}
+	*minimum = low;
+	*maximum = high;
+	#endif
+}
+
+//! Constructor, the buffer is empty until allocate() is called
+HistoryBuffer::HistoryBuffer() :
+	samples(NULL),
+	file(NULL),
+	_channelCount(0),
+	capacity(0),
+	firstBlock(0),
+	endBlock(0)
+{
+}
+
+//! Destructor, release storage
+HistoryBuffer::~HistoryBuffer()
+{
+	release();
+}
+
+//! Release storage, must be called with storageMutex and mutex locked
+void HistoryBuffer::release()
+{
+	if (file)
+	{
+		file->unmap((uchar *)samples);
+		delete file;
+		file = NULL;
+	}
+	else
+		delete[] samples;
+	samples = NULL;
+	index.resize(0);
+	capacity = 0;
+}
+
+//! Allocate byteCount bytes of history for channelCount channels, in memory or in a file mapped in memory if fileName is not empty. Previous history is lost. Return false and leave history disabled on failure
+bool HistoryBuffer::allocate(quint64 byteCount, unsigned channelCount, const QString &fileName)
+{
+	QMutexLocker storageLocker(&storageMutex);
+	QMutexLocker locker(&mutex);
+	release();
+	_channelCount = channelCount;
+	firstBlock = 0;
+	endBlock = 0;
+	
+	const size_t blockByteCount = (size_t)channelCount * BlockSize * sizeof(signed short);
+	if (!blockByteCount || (byteCount < blockByteCount))
+		return byteCount == 0;
+	const quint64 maxBlockCount = std::min((quint64)std::numeric_limits<unsigned>::max(), (quint64)(std::numeric_limits<size_t>::max() / blockByteCount));
+	const unsigned blockCount = (unsigned)std::min(byteCount / blockByteCount, maxBlockCount);
+	const size_t sampleCount = (size_t)blockCount * channelCount * BlockSize;
+	
+	if (fileName.isEmpty())
+	{
+		// pages are only touched when written, so a large history costs nothing until filled
+		samples = new (std::nothrow) signed short[sampleCount];
+		if (!samples)
+		{
+			qDebug() << "HistoryBuffer: cannot allocate" << byteCount << "bytes";
+			return false;
+		}
+	}
+	else
+	{
+		file = new QFile(fileName);
+		if (!file->open(QIODevice::ReadWrite) || !file->resize(sampleCount * sizeof(signed short)))
+		{
+			qDebug() << "HistoryBuffer: cannot create" << fileName << ":" << file->errorString();
+			delete file;
+			file = NULL;
+			return false;
+		}
+		samples = (signed short *)file->map(0, sampleCount * sizeof(signed short));
+		if (!samples)
+		{
+			qDebug() << "HistoryBuffer: cannot map" << fileName << ":" << file->errorString();
+			delete file;
+			file = NULL;
+			return false;
+		}
+	}
+	index.resize((size_t)blockCount * channelCount * 2);
+	capacity = blockCount;
+	return true;
+}
+
+//! Append one block of BlockSize samples per channel. Called by the acquisition thread only, does not allocate
+void HistoryBuffer::append(const std::valarray<std::valarray<signed short> > &samples)
+{
+	if (!capacity)
+		return;
+	Q_ASSERT(samples.size() >= _channelCount);
+	
+	// endBlock is only changed by this thread, invalidate the block we will overwrite first
+	const quint64 block = endBlock;
+	if (block - firstBlock >= capacity)
+	{
+		QMutexLocker locker(&mutex);
+		firstBlock = block + 1 - capacity;
+	}
+	
+	const size_t slot = block % capacity;
+	signed short *dest = this->samples + slot * _channelCount * BlockSize;
+	signed short *blockIndex = &index[slot * _channelCount * 2];
+	for (unsigned channel = 0; channel < _channelCount; channel++)
+	{
+		const signed short *src = &samples[channel][0];
+		std::copy(src, src + BlockSize, dest + channel * BlockSize);
+		blockMinMax(src, BlockSize, &blockIndex[channel * 2], &blockIndex[channel * 2 + 1]);
+	}
+	
+	QMutexLocker locker(&mutex);
+	endBlock = block + 1;
+}
+
+//! Return the number of channel stored in history
+unsigned HistoryBuffer::channelCount() const
+{
+	QMutexLocker locker(&mutex);
+	return _channelCount;
+}
+
+//! Return the positions of the first valid sample and of the sample after the last valid one
+void HistoryBuffer::range(quint64 *first, quint64 *end) const
+{
+	QMutexLocker locker(&mutex);
+	*first = firstBlock * BlockSize;
+	*end = endBlock * BlockSize;
+}
+
+//! Return whether [start, end) was valid at the beginning of a copy, and is still valid, as its first block was not invalidated by append() meanwhile
+bool HistoryBuffer::isValidRange(quint64 start, quint64 end) const
+{
+	QMutexLocker locker(&mutex);
+	return (start >= firstBlock * BlockSize) && (end <= endBlock * BlockSize);
+}
+
+//! Copy count samples per channel starting at position start into data, channel after channel. Return false if these samples are not, or not anymore, in history
+bool HistoryBuffer::read(quint64 start, unsigned count, std::valarray<signed short> *data) const
+{
+	QMutexLocker storageLocker(&storageMutex);
+	if (!isValidRange(start, start + count))
+		return false;
+	
+	if (data->size() != (size_t)count * _channelCount)
+		data->resize((size_t)count * _channelCount);
+	for (unsigned channel = 0; channel < _channelCount; channel++)
+	{
+		signed short *dest = &(*data)[channel * count];
+		quint64 pos = start;
+		const quint64 end = start + count;
+		while (pos < end)
+		{
+			// copy up to the end of the block
+			const quint64 block = pos / BlockSize;
+			const unsigned offset = pos % BlockSize;
+			const unsigned length = (unsigned)std::min((quint64)(BlockSize - offset), end - pos);
+			const signed short *src = samples + ((size_t)(block % capacity) * _channelCount + channel) * BlockSize + offset;
+			dest = std::copy(src, src + length, dest);
+			pos += length;
+		}
+	}
+	return isValidRange(start, start + count);
+}
+
+//! Compute the envelope of channel between positions start and end, for as many columns as the size of minimums and maximums, using the block index. Return false if the range is not in history
+bool HistoryBuffer::readMinMax(quint64 start, quint64 end, unsigned channel, std::valarray<signed short> *minimums, std::valarray<signed short> *maximums) const
+{
+	Q_ASSERT(minimums->size() == maximums->size());
+	QMutexLocker storageLocker(&storageMutex);
+	if ((channel >= _channelCount) || (start >= end) || !isValidRange(start, end))
+		return false;
+	
+	const size_t columnCount = minimums->size();
+	const quint64 startBlock = start / BlockSize;
+	const quint64 blockCount = (end - 1) / BlockSize + 1 - startBlock;
+	for (size_t column = 0; column < columnCount; column++)
+	{
+		// each column covers at least one block
+		quint64 block = startBlock + (column * blockCount) / columnCount;
+		const quint64 columnEnd = std::max(startBlock + ((column + 1) * blockCount) / columnCount, block + 1);
+		const signed short *blockIndex = &index[((size_t)(block % capacity) * _channelCount + channel) * 2];
+		signed short low = blockIndex[0];
+		signed short high = blockIndex[1];
+		for (block++; block < columnEnd; block++)
+		{
+			blockIndex = &index[((size_t)(block % capacity) * _channelCount + channel) * 2];
+			low = std::min(low, blockIndex[0]);
+			high = std::max(high, blockIndex[1]);
+		}
+		(*minimums)[column] = low;
+		(*maximums)[column] = high;
+	}
+	return isValidRange(start, end);
+}
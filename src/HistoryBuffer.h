@@ -0,0 +1,96 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __HISTORY_BUFFER_H
+#define __HISTORY_BUFFER_H
+
+#include <QMutex>
+#include <QString>
+#include <valarray>
+
+class QFile;
+
+//! A large ring keeping the last samples of all channels, with a min/max index for overview
+/*!
+	The acquisition thread appends each block of BlockSize samples per
+	channel, as delivered by the data source and processed by plugins.
+	Channels created by plugins that were neither displayed nor triggered
+	on when the block was acquired are not computed, and are recorded as
+	zero.
+	Samples are stored block after block and, within a block, channel
+	after channel, either in memory or in a file mapped in memory.
+	For each block and channel the minimum and maximum values are kept
+	in a small index, so that an overview of the whole history can be
+	drawn without touching the samples.
+	
+	Samples are identified by their absolute position since allocation.
+	Readers from the GUI thread get copies. The mutex protecting the valid
+	range is only held to take a snapshot of it, the copy is done without
+	it, and the range is checked again afterwards: as append() invalidates
+	a block before overwriting it, the copy is valid if its first block is
+	still in the range. Reads of samples that have been overwritten, before
+	or during the copy, fail. Acquisition thus never waits for a reader,
+	except in allocate(), which waits for the copy in progress to finish
+	before releasing the storage.
+*/
+class HistoryBuffer
+{
+public:
+	//! Number of samples per channel in a block
+	static const unsigned BlockSize = 512;
+	
+	HistoryBuffer();
+	~HistoryBuffer();
+	
+	// acquisition thread
+	bool allocate(quint64 byteCount, unsigned channelCount, const QString &fileName);
+	void append(const std::valarray<std::valarray<signed short> > &samples);
+	
+	// GUI thread
+	unsigned channelCount() const;
+	void range(quint64 *first, quint64 *end) const;
+	bool read(quint64 start, unsigned count, std::valarray<signed short> *data) const;
+	bool readMinMax(quint64 start, quint64 end, unsigned channel, std::valarray<signed short> *minimums, std::valarray<signed short> *maximums) const;
+	
+private:
+	void release();
+	bool isValidRange(quint64 start, quint64 end) const;
+	
+	signed short *samples; //!< capacity blocks of channelCount times BlockSize samples
+	std::valarray<signed short> index; //!< minimum and maximum of each channel of each block
+	QFile *file; //!< file backing samples, if any
+	unsigned _channelCount; //!< number of channel in each block
+	unsigned capacity; //!< number of blocks the ring can hold
+	quint64 firstBlock; //!< first valid block
+	quint64 endBlock; //!< block after the last valid one
+	mutable QMutex mutex; //!< protects firstBlock and endBlock, only held briefly
+	mutable QMutex storageMutex; //!< held by readers while copying and by allocate(), so that storage is not released during a copy; taken before mutex
+};
+
+#endif
@@ -0,0 +1,220 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "HistoryOverviewWidget.h"
+#include <HistoryOverviewWidget.moc>
+#include "HistoryBuffer.h"
+#include "Utilities.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <algorithm>
+
+//! Constructor. history is read when frozen, samplingRate is used to display times
+HistoryOverviewWidget::HistoryOverviewWidget(const HistoryBuffer *history, unsigned samplingRate, QWidget *parent) :
+	QWidget(parent),
+	history(history),
+	samplingRate(samplingRate),
+	first(0),
+	end(0),
+	_windowStart(0),
+	_windowLength(0),
+	envelopeChannelCount(0)
+{
+	setFocusPolicy(Qt::StrongFocus);
+	setSizePolicy(QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed));
+}
+
+//! Return the preferred size of the strip
+QSize HistoryOverviewWidget::sizeHint() const
+{
+	return QSize(300, 48);
+}
+
+//! Return the minimal size of the strip
+QSize HistoryOverviewWidget::minimumSizeHint() const
+{
+	return QSize(100, 32);
+}
+
+//! Take a snapshot of history, with a window of windowLength samples at its end. Return false if history does not hold such a window
+bool HistoryOverviewWidget::freeze(unsigned windowLength)
+{
+	history->range(&first, &end);
+	_windowLength = windowLength;
+	if (!windowLength || (end - first < windowLength))
+		return false;
+	_windowStart = end - windowLength;
+	updateEnvelope();
+	update();
+	return true;
+}
+
+//! Recompute the envelope of the snapshot, one column per pixel
+void HistoryOverviewWidget::updateEnvelope()
+{
+	// drop the part of the snapshot overwritten since freeze
+	quint64 currentFirst, currentEnd;
+	history->range(&currentFirst, &currentEnd);
+	first = std::min(std::max(first, currentFirst), end);
+	
+	envelopeChannelCount = history->channelCount();
+	const unsigned columnCount = std::max(width(), 1);
+	std::valarray<signed short> channelMinimums(columnCount), channelMaximums(columnCount);
+	minimums.resize(columnCount * envelopeChannelCount);
+	maximums.resize(columnCount * envelopeChannelCount);
+	for (unsigned channel = 0; channel < envelopeChannelCount; channel++)
+	{
+		if (!history->readMinMax(first, end, channel, &channelMinimums, &channelMaximums))
+		{
+			envelopeChannelCount = 0;
+			return;
+		}
+		minimums[std::slice(channel * columnCount, columnCount, 1)] = channelMinimums;
+		maximums[std::slice(channel * columnCount, columnCount, 1)] = channelMaximums;
+	}
+}
+
+//! Move the window to start, bounded to the snapshot, and emit windowChanged if it moved
+void HistoryOverviewWidget::moveWindow(qint64 start)
+{
+	quint64 currentFirst, currentEnd;
+	history->range(&currentFirst, &currentEnd);
+	if (currentFirst > first)
+	{
+		first = std::min(currentFirst, end);
+		updateEnvelope();
+	}
+	if (end - first < _windowLength)
+		return;
+	
+	const quint64 newStart = (quint64)std::min(std::max(start, (qint64)first), (qint64)(end - _windowLength));
+	if (newStart != _windowStart)
+	{
+		_windowStart = newStart;
+		update();
+		emit windowChanged(_windowStart);
+	}
+}
+
+//! Convert a screen coordinate to a sample position
+quint64 HistoryOverviewWidget::screenToSample(int x) const
+{
+	return first + ((end - first) * (quint64)std::max(x, 0)) / (quint64)std::max(width(), 1);
+}
+
+//! Convert a sample position to a screen coordinate
+int HistoryOverviewWidget::sampleToScreen(quint64 sample) const
+{
+	if (end <= first)
+		return 0;
+	return (int)(((sample - first) * (quint64)width()) / (end - first));
+}
+
+//! Draw envelope of all channels, each one scaled to its own extent, and the displayed window
+void HistoryOverviewWidget::paintEvent(QPaintEvent *event)
+{
+	QPainter painter(this);
+	painter.setClipRect(event->rect());
+	painter.fillRect(rect(), Qt::white);
+	
+	const int columnCount = minimums.size() / std::max(envelopeChannelCount, 1u);
+	const int h = height() - 1;
+	for (unsigned channel = 0; channel < envelopeChannelCount; channel++)
+	{
+		const signed short *channelMinimums = &minimums[channel * columnCount];
+		const signed short *channelMaximums = &maximums[channel * columnCount];
+		const int low = *std::min_element(channelMinimums, channelMinimums + columnCount);
+		const int high = *std::max_element(channelMaximums, channelMaximums + columnCount);
+		const int extent = std::max(high - low, 1);
+		
+		painter.setPen(getChannelColor(channel).light());
+		for (int column = std::max(event->rect().left(), 0); column <= std::min(event->rect().right(), columnCount - 1); column++)
+			painter.drawLine(column, h - ((channelMinimums[column] - low) * h) / extent, column, h - ((channelMaximums[column] - low) * h) / extent);
+	}
+	
+	// displayed window
+	const int left = sampleToScreen(_windowStart);
+	const int right = std::max(sampleToScreen(_windowStart + _windowLength), left + 2);
+	painter.setPen(Qt::darkGray);
+	painter.setBrush(QColor(127, 127, 127, 64));
+	painter.drawRect(left, 0, right - left - 1, h);
+	
+	// time span of history, relative to freeze
+	painter.setPen(Qt::black);
+	painter.drawText(rect().adjusted(4, 0, -4, 0), Qt::AlignLeft | Qt::AlignVCenter, tr("%0 of history").arg(timeScaleToString((1000. * (end - first)) / samplingRate)));
+	painter.drawText(rect().adjusted(4, 0, -4, 0), Qt::AlignRight | Qt::AlignVCenter, tr("-%0").arg(timeScaleToString((1000. * (end - _windowStart - _windowLength)) / samplingRate)));
+}
+
+//! Center the window on the clicked position
+void HistoryOverviewWidget::mousePressEvent(QMouseEvent *event)
+{
+	if (event->button() == Qt::LeftButton)
+		moveWindow((qint64)screenToSample(event->x()) - _windowLength / 2);
+}
+
+//! Drag the window
+void HistoryOverviewWidget::mouseMoveEvent(QMouseEvent *event)
+{
+	if (event->buttons() & Qt::LeftButton)
+		moveWindow((qint64)screenToSample(event->x()) - _windowLength / 2);
+}
+
+//! Move the window by a tenth of its length with arrows, by its length with control, to the ends with home and end
+void HistoryOverviewWidget::keyPressEvent(QKeyEvent *event)
+{
+	qint64 delta = std::max(_windowLength / 10, 1u);
+	if (event->modifiers() & Qt::ControlModifier)
+		delta = _windowLength;
+	switch (event->key())
+	{
+	case Qt::Key_Left:
+		moveWindow((qint64)_windowStart - delta);
+		break;
+	case Qt::Key_Right:
+		moveWindow((qint64)_windowStart + delta);
+		break;
+	case Qt::Key_Home:
+		moveWindow(0);
+		break;
+	case Qt::Key_End:
+		moveWindow((qint64)end);
+		break;
+	default:
+		QWidget::keyPressEvent(event);
+	}
+}
+
+//! Widget has been resized, recompute envelope for the new number of columns
+void HistoryOverviewWidget::resizeEvent(QResizeEvent *)
+{
+	if (end > first)
+		updateEnvelope();
+}
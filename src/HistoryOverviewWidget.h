@@ -0,0 +1,93 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __HISTORY_OVERVIEW_WIDGET_H
+#define __HISTORY_OVERVIEW_WIDGET_H
+
+#include <QWidget>
+#include <valarray>
+
+class HistoryBuffer;
+
+//! Strip showing the envelope of the whole history, to choose which part of it is displayed
+/*!
+	When the display is frozen, freeze() takes a snapshot of the range
+	of history, and the envelope of all channels is drawn from the
+	min/max index of the history. The window of history to display is
+	moved with the mouse or the arrow keys, and windowChanged() is
+	emitted with its first sample. Acquisition continues meanwhile, so
+	the oldest part of the snapshot may be overwritten; it is then
+	dropped from the strip.
+*/
+class HistoryOverviewWidget : public QWidget
+{
+	Q_OBJECT
+
+public:
+	HistoryOverviewWidget(const HistoryBuffer *history, unsigned samplingRate, QWidget *parent = 0);
+	
+	virtual QSize sizeHint() const;
+	virtual QSize minimumSizeHint() const;
+	bool freeze(unsigned windowLength);
+	//! Return the first sample of the displayed window
+	quint64 windowStart() const { return _windowStart; }
+	//! Return the number of samples of the displayed window
+	unsigned windowLength() const { return _windowLength; }
+	//! Return the sample after the last one of history when it was frozen
+	quint64 frozenEnd() const { return end; }
+
+signals:
+	void windowChanged(quint64 start); //!< The displayed window has been moved by the user
+
+protected:
+	// events
+	void paintEvent(QPaintEvent *event);
+	void mousePressEvent(QMouseEvent *event);
+	void mouseMoveEvent(QMouseEvent *event);
+	void keyPressEvent(QKeyEvent *event);
+	void resizeEvent(QResizeEvent *event);
+	
+	// helper methods
+	void updateEnvelope();
+	void moveWindow(qint64 start);
+	quint64 screenToSample(int x) const;
+	int sampleToScreen(quint64 sample) const;
+
+	const HistoryBuffer *history; //!< history of all samples
+	unsigned samplingRate; //!< sampling rate of the source, for time display
+	quint64 first; //!< first sample of the snapshot still in history
+	quint64 end; //!< sample after the last one of the snapshot
+	quint64 _windowStart; //!< first sample of the displayed window
+	unsigned _windowLength; //!< number of samples of the displayed window
+	std::valarray<signed short> minimums; //!< minimum of each column, channel after channel
+	std::valarray<signed short> maximums; //!< maximum of each column, channel after channel
+	unsigned envelopeChannelCount; //!< number of channel in minimums and maximums
+};
+
+#endif
@@ -0,0 +1,364 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "MeasurementEngine.h"
+#include "SampleScan.h"
+#include <algorithm>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! Number of samples scanned at once, so that a block stays in the L1 cache between the passes of the edge detectors
+static const unsigned blockSize = 512;
+
+//! Clear the statistics
+void RunningStatistics::clear()
+{
+	count = 0;
+	mean = 0;
+	minimum = 0;
+	maximum = 0;
+	squaredDeviations = 0;
+}
+
+//! Add value to the statistics, using Welford's method
+void RunningStatistics::add(double value)
+{
+	count++;
+	if (count == 1)
+	{
+		minimum = value;
+		maximum = value;
+	}
+	else
+	{
+		minimum = std::min(minimum, value);
+		maximum = std::max(maximum, value);
+	}
+	const double delta = value - mean;
+	mean += delta / count;
+	squaredDeviations += delta * (value - mean);
+}
+
+//! Return the standard deviation of the values
+double RunningStatistics::standardDeviation() const
+{
+	if (count < 2)
+		return 0;
+	return sqrt(squaredDeviations / (count - 1));
+}
+
+//! Merge the minimum, maximum, sum and sum of squares of count samples into the given accumulators
+static void runAmplitude(const signed short *src, unsigned count, signed short *minimum, signed short *maximum, qint64 *sum, quint64 *sumSquares)
+{
+	unsigned i = 0;
+	signed short low = *minimum;
+	signed short high = *maximum;
+	qint64 s = 0;
+	quint64 s2 = 0;
+	#ifdef __SSE2__
+	if (count >= 8)
+	{
+		const __m128i ones = _mm_set1_epi16(1);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i vlow = _mm_set1_epi16(low);
+		__m128i vhigh = _mm_set1_epi16(high);
+		__m128i vsum = zero;
+		__m128i vsumSquares = zero;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+			vlow = _mm_min_epi16(vlow, v);
+			vhigh = _mm_max_epi16(vhigh, v);
+			// pairs of samples are summed in 32 bits, which cannot overflow within a block
+			vsum = _mm_add_epi32(vsum, _mm_madd_epi16(v, ones));
+			// pairs of squares fit in 32 bits unsigned, they are accumulated in 64 bits
+			const __m128i squares = _mm_madd_epi16(v, v);
+			vsumSquares = _mm_add_epi64(vsumSquares, _mm_unpacklo_epi32(squares, zero));
+			vsumSquares = _mm_add_epi64(vsumSquares, _mm_unpackhi_epi32(squares, zero));
+		}
+		// reduce the lanes
+		vlow = _mm_min_epi16(vlow, _mm_srli_si128(vlow, 8));
+		vhigh = _mm_max_epi16(vhigh, _mm_srli_si128(vhigh, 8));
+		vlow = _mm_min_epi16(vlow, _mm_srli_si128(vlow, 4));
+		vhigh = _mm_max_epi16(vhigh, _mm_srli_si128(vhigh, 4));
+		vlow = _mm_min_epi16(vlow, _mm_srli_si128(vlow, 2));
+		vhigh = _mm_max_epi16(vhigh, _mm_srli_si128(vhigh, 2));
+		low = (signed short)_mm_cvtsi128_si32(vlow);
+		high = (signed short)_mm_cvtsi128_si32(vhigh);
+		qint32 sums[4];
+		quint64 sumsSquares[2];
+		_mm_storeu_si128((__m128i *)sums, vsum);
+		_mm_storeu_si128((__m128i *)sumsSquares, vsumSquares);
+		s = (qint64)sums[0] + sums[1] + sums[2] + sums[3];
+		s2 = sumsSquares[0] + sumsSquares[1];
+	}
+	#endif
+	for (; i < count; i++)
+	{
+		const int v = src[i];
+		low = std::min(low, src[i]);
+		high = std::max(high, src[i]);
+		s += v;
+		s2 += (quint64)(v * v);
+	}
+	*minimum = low;
+	*maximum = high;
+	*sum += s;
+	*sumSquares += s2;
+}
+
+//! Constructor, no level is known yet
+MeasurementEngine::Channel::Channel()
+{
+	levelsValid = false;
+	middleLow = middleHigh = riseLow = riseHigh = 0;
+	for (unsigned m = 0; m < MEASUREMENT_COUNT; m++)
+	{
+		valid[m] = false;
+		values[m] = 0;
+	}
+}
+
+//! Constructor, no channel is measured until configure() is called
+MeasurementEngine::MeasurementEngine()
+{
+}
+
+//! Set the number of channels to measure. Return true if it changed, in which case all states and statistics are cleared
+bool MeasurementEngine::configure(unsigned channelCount)
+{
+	if (channels.size() == channelCount)
+		return false;
+	channels.clear();
+	channels.resize(channelCount);
+	return true;
+}
+
+//! Clear the statistics of all channels
+void MeasurementEngine::resetStatistics()
+{
+	for (size_t channel = 0; channel < channels.size(); channel++)
+		for (unsigned m = 0; m < MEASUREMENT_COUNT; m++)
+			channels[channel].statistics[m].clear();
+}
+
+//! Start a new frame of channel
+void MeasurementEngine::begin(unsigned channel)
+{
+	Q_ASSERT(channel < channels.size());
+	Channel &state = channels[channel];
+	state.sampleCount = 0;
+	state.minimum = 32767;
+	state.maximum = -32768;
+	state.sum = 0;
+	state.sumSquares = 0;
+	state.crossingState = CROSSING_UNKNOWN;
+	state.risingCount = 0;
+	state.firstRising = 0;
+	state.lastRising = 0;
+	state.highTime = 0;
+	state.pendingHighTime = 0;
+	state.riseState = RISE_UNKNOWN;
+	state.riseStart = 0;
+	state.riseTimeSum = 0;
+	state.riseCount = 0;
+}
+
+//! Add count samples to the current frame of channel
+void MeasurementEngine::add(unsigned channel, const signed short *samples, unsigned count)
+{
+	Q_ASSERT(channel < channels.size());
+	Channel &state = channels[channel];
+	for (unsigned i = 0; i < count; i += blockSize)
+	{
+		const unsigned n = std::min(count - i, blockSize);
+		runAmplitude(samples + i, n, &state.minimum, &state.maximum, &state.sum, &state.sumSquares);
+		if (state.levelsValid)
+		{
+			scanCrossings(state, samples + i, n);
+			scanRises(state, samples + i, n);
+		}
+		state.sampleCount += n;
+	}
+}
+
+//! Follow the crossings of the middle level by count samples, which start at state.sampleCount in the frame
+void MeasurementEngine::scanCrossings(Channel &state, const signed short *samples, unsigned count)
+{
+	unsigned i = 0;
+	while (i < count)
+	{
+		switch (state.crossingState)
+		{
+			case CROSSING_UNKNOWN:
+			i = findOutside(samples, i, count, state.middleLow, state.middleHigh);
+			if (i < count)
+				state.crossingState = (samples[i] <= state.middleLow) ? CROSSING_LOW : CROSSING_HIGH;
+			break;
+			
+			case CROSSING_LOW:
+			i = findAbove(samples, i, count, state.middleHigh - 1);
+			if (i < count)
+			{
+				// rising edge, the high time of the previous period is complete
+				const quint64 pos = state.sampleCount + i;
+				if (state.risingCount == 0)
+					state.firstRising = pos;
+				else
+					state.highTime += state.pendingHighTime;
+				state.pendingHighTime = 0;
+				state.lastRising = pos;
+				state.risingCount++;
+				state.crossingState = CROSSING_HIGH;
+			}
+			break;
+			
+			case CROSSING_HIGH:
+			i = findBelow(samples, i, count, state.middleLow + 1);
+			if (i < count)
+			{
+				if (state.risingCount > 0)
+					state.pendingHighTime = state.sampleCount + i - state.lastRising;
+				state.crossingState = CROSSING_LOW;
+			}
+			break;
+		}
+	}
+}
+
+//! Follow the rising edges from the 10% to the 90% levels of count samples, which start at state.sampleCount in the frame
+void MeasurementEngine::scanRises(Channel &state, const signed short *samples, unsigned count)
+{
+	unsigned i = 0;
+	while (i < count)
+	{
+		switch (state.riseState)
+		{
+			case RISE_UNKNOWN:
+			case RISE_HIGH:
+			// an edge is only timed if it starts below 10%
+			i = findBelow(samples, i, count, state.riseLow + 1);
+			if (i < count)
+				state.riseState = RISE_LOW;
+			break;
+			
+			case RISE_LOW:
+			i = findAbove(samples, i, count, state.riseLow);
+			if (i < count)
+			{
+				state.riseStart = state.sampleCount + i;
+				state.riseState = RISE_MIDDLE;
+			}
+			break;
+			
+			case RISE_MIDDLE:
+			i = findOutside(samples, i, count, state.riseLow, state.riseHigh);
+			if (i < count)
+			{
+				if (samples[i] <= state.riseLow)
+					state.riseState = RISE_LOW;
+				else
+				{
+					state.riseTimeSum += state.sampleCount + i - state.riseStart;
+					state.riseCount++;
+					state.riseState = RISE_HIGH;
+				}
+			}
+			break;
+		}
+	}
+}
+
+//! End the current frame of channel, whose samples are samplePeriod seconds apart. Compute its measurements, add them to the statistics, and update the levels for the next frame
+void MeasurementEngine::end(unsigned channel, double samplePeriod)
+{
+	Q_ASSERT(channel < channels.size());
+	Channel &state = channels[channel];
+	
+	for (unsigned m = 0; m < MEASUREMENT_COUNT; m++)
+		state.valid[m] = false;
+	if (state.sampleCount == 0)
+		return;
+	
+	// amplitude
+	state.values[MEASUREMENT_PEAK_TO_PEAK] = (int)state.maximum - (int)state.minimum;
+	state.values[MEASUREMENT_MEAN] = (double)state.sum / state.sampleCount;
+	state.values[MEASUREMENT_RMS] = sqrt((double)state.sumSquares / state.sampleCount);
+	state.valid[MEASUREMENT_PEAK_TO_PEAK] = true;
+	state.valid[MEASUREMENT_MEAN] = true;
+	state.valid[MEASUREMENT_RMS] = true;
+	
+	// timing, only if the levels of the previous frame are within the range of this one
+	if (state.levelsValid && (state.middleLow > state.minimum) && (state.middleHigh < state.maximum))
+	{
+		if (state.risingCount >= 2)
+		{
+			const quint64 span = state.lastRising - state.firstRising;
+			const double period = (double)span * samplePeriod / (state.risingCount - 1);
+			state.values[MEASUREMENT_PERIOD] = period;
+			state.values[MEASUREMENT_FREQUENCY] = 1. / period;
+			state.values[MEASUREMENT_DUTY_CYCLE] = 100. * (double)state.highTime / (double)span;
+			state.valid[MEASUREMENT_PERIOD] = true;
+			state.valid[MEASUREMENT_FREQUENCY] = true;
+			state.valid[MEASUREMENT_DUTY_CYCLE] = true;
+		}
+		if (state.riseCount > 0)
+		{
+			state.values[MEASUREMENT_RISE_TIME] = (double)state.riseTimeSum * samplePeriod / state.riseCount;
+			state.valid[MEASUREMENT_RISE_TIME] = true;
+		}
+	}
+	
+	for (unsigned m = 0; m < MEASUREMENT_COUNT; m++)
+		if (state.valid[m])
+			state.statistics[m].add(state.values[m]);
+	
+	// levels for the next frame, edges of signals of less than 8 units would only be noise
+	const int range = (int)state.maximum - (int)state.minimum;
+	state.levelsValid = range >= 8;
+	if (state.levelsValid)
+	{
+		const int middle = (int)state.minimum + range / 2;
+		const int hysteresis = std::max(1, range / 20);
+		state.middleLow = (signed short)(middle - hysteresis);
+		state.middleHigh = (signed short)(middle + hysteresis);
+		state.riseLow = (signed short)((int)state.minimum + range / 10);
+		state.riseHigh = (signed short)((int)state.maximum - range / 10);
+	}
+}
+
+//! Measure a whole frame of channel of count samples, samplePeriod seconds apart
+void MeasurementEngine::measure(unsigned channel, const signed short *samples, unsigned count, double samplePeriod)
+{
+	begin(channel);
+	add(channel, samples, count);
+	end(channel, samplePeriod);
+}
@@ -0,0 +1,159 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __MEASUREMENT_ENGINE_H
+#define __MEASUREMENT_ENGINE_H
+
+#include <QtGlobal>
+#include <vector>
+
+//! Statistics of a measurement over successive frames
+struct RunningStatistics
+{
+	unsigned count; //!< number of values
+	double mean; //!< mean of values
+	double minimum; //!< smallest value
+	double maximum; //!< largest value
+	double squaredDeviations; //!< sum of squared deviations from the mean
+	
+	RunningStatistics() { clear(); }
+	void clear();
+	void add(double value);
+	double standardDeviation() const;
+};
+
+//! Automatic measurements of the channels of data frames
+/*!
+	The samples of a channel are streamed block by block in a single pass:
+	the SIMD part accumulates the minimum, maximum, sum and sum of squares,
+	and edges are found with the vectorised scans shared with the trigger
+	engine. Edges are detected on levels computed from the minimum and
+	maximum of the previous frame of the channel: the middle level, with
+	a hysteresis of 5% of the peak to peak amplitude, for the frequency,
+	period and duty cycle, and 10% and 90% for the rise time. Timing
+	measurements are therefore available from the second frame.
+	
+	Each valid measurement of a frame is added to the running statistics
+	of the channel, until resetStatistics() is called.
+*/
+class MeasurementEngine
+{
+public:
+	//! Measurements of a channel
+	enum Measurement
+	{
+		MEASUREMENT_PEAK_TO_PEAK = 0, //!< difference between maximum and minimum, in units
+		MEASUREMENT_MEAN, //!< mean, in units
+		MEASUREMENT_RMS, //!< root mean square, in units
+		MEASUREMENT_FREQUENCY, //!< frequency, in Hz
+		MEASUREMENT_PERIOD, //!< mean period between rising edges, in s
+		MEASUREMENT_DUTY_CYCLE, //!< time above the middle level over the period, in %
+		MEASUREMENT_RISE_TIME, //!< mean time from 10% to 90% of rising edges, in s
+		MEASUREMENT_COUNT //!< number of measurements
+	};
+	
+	MeasurementEngine();
+	bool configure(unsigned channelCount);
+	void resetStatistics();
+	void begin(unsigned channel);
+	void add(unsigned channel, const signed short *samples, unsigned count);
+	void end(unsigned channel, double samplePeriod);
+	void measure(unsigned channel, const signed short *samples, unsigned count, double samplePeriod);
+	
+	//! Return the number of channels measured
+	unsigned channelCount() const { return channels.size(); }
+	//! Return whether measurement m of channel is valid for the last frame
+	bool isValid(unsigned channel, Measurement m) const { return channels[channel].valid[m]; }
+	//! Return measurement m of channel for the last frame
+	double value(unsigned channel, Measurement m) const { return channels[channel].values[m]; }
+	//! Return the statistics of measurement m of channel over frames
+	const RunningStatistics &statistics(unsigned channel, Measurement m) const { return channels[channel].statistics[m]; }
+	
+private:
+	//! Side of the middle level the signal is on
+	enum CrossingState
+	{
+		CROSSING_UNKNOWN = 0,
+		CROSSING_LOW,
+		CROSSING_HIGH
+	};
+	
+	//! Position of the signal relative to the 10% and 90% levels
+	enum RiseState
+	{
+		RISE_UNKNOWN = 0,
+		RISE_LOW,
+		RISE_MIDDLE,
+		RISE_HIGH
+	};
+	
+	//! Measurement state of a channel
+	struct Channel
+	{
+		// amplitude accumulators of the current frame
+		quint64 sampleCount; //!< number of samples of the current frame so far
+		signed short minimum; //!< smallest sample of the current frame
+		signed short maximum; //!< largest sample of the current frame
+		qint64 sum; //!< sum of samples of the current frame
+		quint64 sumSquares; //!< sum of squared samples of the current frame
+		
+		// levels computed from the previous frame
+		bool levelsValid; //!< whether the previous frame had enough amplitude for edge detection
+		signed short middleLow; //!< bottom of the hysteresis around the middle level
+		signed short middleHigh; //!< top of the hysteresis around the middle level
+		signed short riseLow; //!< 10% level
+		signed short riseHigh; //!< 90% level
+		
+		// edges of the current frame
+		CrossingState crossingState; //!< side of the middle level
+		unsigned risingCount; //!< number of rising edges
+		quint64 firstRising; //!< position of first rising edge
+		quint64 lastRising; //!< position of last rising edge
+		quint64 highTime; //!< time above the middle level between first and last rising edges
+		quint64 pendingHighTime; //!< time above the middle level since last rising edge, known once the signal fell
+		RiseState riseState; //!< position relative to the 10% and 90% levels
+		quint64 riseStart; //!< position of the sample above 10% of the current rising edge
+		quint64 riseTimeSum; //!< sum of the rise times
+		unsigned riseCount; //!< number of complete rising edges
+		
+		// results
+		bool valid[MEASUREMENT_COUNT]; //!< whether measurements are valid for the last frame
+		double values[MEASUREMENT_COUNT]; //!< measurements of the last frame
+		RunningStatistics statistics[MEASUREMENT_COUNT]; //!< statistics over frames
+		
+		Channel();
+	};
+	
+	void scanCrossings(Channel &state, const signed short *samples, unsigned count);
+	void scanRises(Channel &state, const signed short *samples, unsigned count);
+	
+	std::vector<Channel> channels; //!< state of each channel
+};
+
+#endif
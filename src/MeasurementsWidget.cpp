@@ -0,0 +1,189 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "MeasurementsWidget.h"
+#include <MeasurementsWidget.moc>
+#include "SignalDisplayData.h"
+#include "Utilities.h"
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <math.h>
+
+//! Number of columns of the table: channel, measurement, value, mean, min, max and standard deviation
+static const int columnCount = 7;
+
+//! Constructor. unitPerVoltCount is used to display amplitudes in volts
+MeasurementsWidget::MeasurementsWidget(unsigned unitPerVoltCount, QWidget *parent) :
+	QWidget(parent),
+	unitPerVoltCount(unitPerVoltCount),
+	rowsChannelCount(0),
+	rowsChannelMask(0),
+	lastSampleCount(0),
+	lastDuration(0)
+{
+	QVBoxLayout *layout = new QVBoxLayout(this);
+	table = new QTableWidget(0, columnCount);
+	table->setHorizontalHeaderLabels(QStringList() << tr("Channel") << tr("Measurement") << tr("Value") << tr("Mean") << tr("Min") << tr("Max") << tr("Std dev"));
+	table->verticalHeader()->hide();
+	table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	table->setSelectionMode(QAbstractItemView::NoSelection);
+	layout->addWidget(table);
+	
+	QPushButton *resetButton = new QPushButton(tr("&Reset statistics"));
+	connect(resetButton, SIGNAL(clicked()), SLOT(resetStatistics()));
+	layout->addWidget(resetButton);
+}
+
+//! Measure the channels of channelMask in the frame of signalInfo, whose channels are in time order, and update the table
+void MeasurementsWidget::measure(const SignalDisplayData *signalInfo, unsigned channelMask)
+{
+	const unsigned sampleCount = signalInfo->samplePerChannelCount;
+	const unsigned channelCount = signalInfo->displayableChannelCount();
+	if (!sampleCount || !signalInfo->duration)
+		return;
+	if (engine.configure(channelCount) || (sampleCount != lastSampleCount) || (signalInfo->duration != lastDuration))
+		resetStatistics();
+	lastSampleCount = sampleCount;
+	lastDuration = signalInfo->duration;
+	if ((channelCount != rowsChannelCount) || (channelMask != rowsChannelMask))
+		recreateRows(channelCount, channelMask);
+	
+	const double samplePeriod = (double)signalInfo->duration / 1000. / sampleCount;
+	int row = 0;
+	for (unsigned channel = 0; channel < channelCount; channel++)
+	{
+		if (!(channelMask & (1 << channel)))
+			continue;
+		engine.measure(channel, &signalInfo->data[channel * sampleCount], sampleCount, samplePeriod);
+		for (unsigned i = 0; i < MeasurementEngine::MEASUREMENT_COUNT; i++, row++)
+		{
+			const MeasurementEngine::Measurement m = (MeasurementEngine::Measurement)i;
+			const RunningStatistics &statistics = engine.statistics(channel, m);
+			table->item(row, 2)->setText(engine.isValid(channel, m) ? valueToString(m, engine.value(channel, m)) : QString("-"));
+			if (statistics.count)
+			{
+				table->item(row, 3)->setText(valueToString(m, statistics.mean));
+				table->item(row, 4)->setText(valueToString(m, statistics.minimum));
+				table->item(row, 5)->setText(valueToString(m, statistics.maximum));
+				table->item(row, 6)->setText(valueToString(m, statistics.standardDeviation()));
+			}
+			else
+			{
+				for (int column = 3; column < columnCount; column++)
+					table->item(row, column)->setText("-");
+			}
+		}
+	}
+}
+
+//! Clear the statistics of all channels
+void MeasurementsWidget::resetStatistics()
+{
+	engine.resetStatistics();
+	for (int row = 0; row < table->rowCount(); row++)
+		for (int column = 3; column < columnCount; column++)
+			table->item(row, column)->setText("-");
+}
+
+//! Create one row per measurement of the channels of channelMask
+void MeasurementsWidget::recreateRows(unsigned channelCount, unsigned channelMask)
+{
+	const QString names[MeasurementEngine::MEASUREMENT_COUNT] =
+	{
+		tr("Peak to peak"),
+		tr("Mean"),
+		tr("RMS"),
+		tr("Frequency"),
+		tr("Period"),
+		tr("Duty cycle"),
+		tr("Rise time")
+	};
+	
+	table->setRowCount(0);
+	for (unsigned channel = 0; channel < channelCount; channel++)
+	{
+		if (!(channelMask & (1 << channel)))
+			continue;
+		for (unsigned i = 0; i < MeasurementEngine::MEASUREMENT_COUNT; i++)
+		{
+			const int row = table->rowCount();
+			table->insertRow(row);
+			QTableWidgetItem *channelItem = new QTableWidgetItem(i == 0 ? channelNumberToString(channel) : QString());
+			channelItem->setForeground(getChannelColor(channel));
+			table->setItem(row, 0, channelItem);
+			table->setItem(row, 1, new QTableWidgetItem(names[i]));
+			for (int column = 2; column < columnCount; column++)
+			{
+				QTableWidgetItem *item = new QTableWidgetItem("-");
+				item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+				table->setItem(row, column, item);
+			}
+		}
+	}
+	rowsChannelCount = channelCount;
+	rowsChannelMask = channelMask;
+}
+
+//! Return value of measurement m as a string with its unit
+QString MeasurementsWidget::valueToString(MeasurementEngine::Measurement m, double value) const
+{
+	switch (m)
+	{
+		case MeasurementEngine::MEASUREMENT_PEAK_TO_PEAK:
+		case MeasurementEngine::MEASUREMENT_MEAN:
+		case MeasurementEngine::MEASUREMENT_RMS:
+		{
+			const double volts = value / unitPerVoltCount;
+			if (fabs(volts) < 1)
+				return QString("%1 mV").arg(volts * 1000, 0, 'g', 4);
+			else
+				return QString("%1 V").arg(volts, 0, 'g', 4);
+		}
+		
+		case MeasurementEngine::MEASUREMENT_FREQUENCY:
+		if (fabs(value) < 1000)
+			return QString("%1 Hz").arg(value, 0, 'g', 5);
+		else if (fabs(value) < 1000000)
+			return QString("%1 kHz").arg(value / 1000, 0, 'g', 5);
+		else
+			return QString("%1 MHz").arg(value / 1000000, 0, 'g', 5);
+		
+		case MeasurementEngine::MEASUREMENT_PERIOD:
+		case MeasurementEngine::MEASUREMENT_RISE_TIME:
+		return timeScaleToString(value * 1000);
+		
+		case MeasurementEngine::MEASUREMENT_DUTY_CYCLE:
+		return QString("%1 %").arg(value, 0, 'f', 1);
+		
+		default:
+		return QString();
+	}
+}
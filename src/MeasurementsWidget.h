@@ -0,0 +1,71 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __MEASUREMENTS_WIDGET_H
+#define __MEASUREMENTS_WIDGET_H
+
+#include "MeasurementEngine.h"
+#include <QWidget>
+
+struct SignalDisplayData;
+class QTableWidget;
+
+//! Table of the automatic measurements of the displayed channels, with their statistics over frames
+/*!
+	measure() is called with each complete frame. Only the channels of
+	the given mask are measured, and the table is only rebuilt when they
+	change; otherwise the texts of its items are updated in place.
+	Statistics are cleared by the reset button, and when the number of
+	samples or the duration of frames changes.
+*/
+class MeasurementsWidget : public QWidget
+{
+	Q_OBJECT
+
+public:
+	MeasurementsWidget(unsigned unitPerVoltCount, QWidget *parent = 0);
+	void measure(const SignalDisplayData *signalInfo, unsigned channelMask);
+
+public slots:
+	void resetStatistics();
+
+private:
+	void recreateRows(unsigned channelCount, unsigned channelMask);
+	QString valueToString(MeasurementEngine::Measurement m, double value) const;
+
+	MeasurementEngine engine; //!< measurements of each channel
+	QTableWidget *table; //!< one row per measurement of each measured channel
+	unsigned unitPerVoltCount; //!< number of units of samples per volt
+	unsigned rowsChannelCount; //!< number of channels when rows were created
+	unsigned rowsChannelMask; //!< channels measured when rows were created
+	unsigned lastSampleCount; //!< number of samples per channel of the last frame
+	unsigned lastDuration; //!< duration of the last frame, in ms
+};
+
+#endif
@@ -30,8 +30,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "OscilloscopeWindow.h"
 #include <OscilloscopeWindow.moc>
 #include "SignalViewWidget.h"
+#include "HistoryOverviewWidget.h"
+#include "MeasurementsWidget.h"
 #include "ProcessingPlugin.h"
 #include "ProcessingPluginDialog.h"
+#include "TriggerDialog.h"
 #include "DataConverter.h"
 #include "DataSource.h"
 #include "Version.h"
@@ -64,9 +67,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QTextStream>
 #include <QStringList>
 #include <QSettings>
+#include <QInputDialog>
+#include <QTimer>
 #include "Settings.h"
 #include <QtDebug>
 #include <cassert>
+#include <algorithm>
 
 using namespace std;
 
@@ -118,6 +124,17 @@ OscilloscopeWindow::OscilloscopeWindow()
 		// create converter
 		signalInfo.dataConverter = new DataConverter(dataSource, signalInfo.channelCount, signalInfo.duration);
 
+		// not rolling yet
+		signalInfo.rollStart = 0;
+
+		// no segments yet
+		signalInfo.segmentCount = 0;
+		signalInfo.displayedSegment = 0;
+		signalInfo.overlaySegments = false;
+		segmentSampleCount = 0;
+		segmentDuration = 0;
+		segmentChannelCount = 0;
+		
 		// create widgets
 		wasFrozen = false;
 		splitter = new QSplitter(Qt::Vertical, this);
@@ -125,15 +142,39 @@ OscilloscopeWindow::OscilloscopeWindow()
 		zoomedView = new SignalViewWidget(&signalInfo, dataSource->unitPerVoltCount(), true);
 		zoomedView->setVisible(false);
 		connect(mainView, SIGNAL(zoomPosChanged(int,int)), zoomedView, SLOT(setZoomPos(int,int)));
+		historyView = new HistoryOverviewWidget(signalInfo.dataConverter->history(), dataSource->samplingRate());
+		historyView->setVisible(false);
+		connect(historyView, SIGNAL(windowChanged(quint64)), SLOT(showHistory(quint64)));
 		
 		splitter->addWidget(mainView);
 		splitter->addWidget(zoomedView);
+		splitter->addWidget(historyView);
 		
 		setCentralWidget(splitter);
 		
 		// plugin dock area
 		pluginDock = NULL;
 		
+		// measurements dock, hidden until requested
+		measurementsDock = new QDockWidget(tr("Measurements"), this);
+		measurementsView = new MeasurementsWidget(dataSource->unitPerVoltCount(), measurementsDock);
+		measurementsDock->setWidget(measurementsView);
+		addDockWidget(Qt::BottomDockWidgetArea, measurementsDock);
+		measurementsDock->hide();
+		
+		// data source statistics dock, hidden until requested, refreshed every second while visible
+		sourceStatisticsDock = new QDockWidget(tr("Source statistics"), this);
+		sourceStatisticsLabel = new QLabel(sourceStatisticsDock);
+		sourceStatisticsLabel->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+		sourceStatisticsLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+		sourceStatisticsDock->setWidget(sourceStatisticsLabel);
+		addDockWidget(Qt::BottomDockWidgetArea, sourceStatisticsDock);
+		sourceStatisticsDock->hide();
+		connect(sourceStatisticsDock, SIGNAL(visibilityChanged(bool)), SLOT(updateSourceStatistics()));
+		sourceStatisticsTimer = new QTimer(this);
+		connect(sourceStatisticsTimer, SIGNAL(timeout()), SLOT(updateSourceStatistics()));
+		sourceStatisticsTimer->start(1000);
+		
 		createActionsAndMenus();
 
 		resize(600, 440);
@@ -148,6 +189,7 @@ OscilloscopeWindow::OscilloscopeWindow()
 
 		qRegisterMetaType<std::valarray<signed short> >("std::valarray<signed short>");
 		qRegisterMetaType<valarray<signed short> >("valarray<signed short>");
+		qRegisterMetaType<std::valarray<qint64> >("std::valarray<qint64>");
 
 
 		qRegisterMetaType<unsigned>("unsigned");
@@ -157,9 +199,12 @@ OscilloscopeWindow::OscilloscopeWindow()
 		connect(mainView, SIGNAL(customChannelNameChanged()), this, SLOT(recreateChannelActionsAndMenu()));
 		connect(zoomedView, SIGNAL(timeScaleChanged(unsigned)), this, SLOT(zoomedTimeScaleChanged(unsigned)));
 		connect(zoomedView, SIGNAL(customChannelNameChanged()), this, SLOT(recreateChannelActionsAndMenu()));
+		connect(mainView, SIGNAL(channelEnabledChanged()), this, SLOT(updateDisplayedChannels()));
+		connect(zoomedView, SIGNAL(channelEnabledChanged()), this, SLOT(updateDisplayedChannels()));
 		
 		// restore GUI states
 		loadGUISettings();
+		updateDisplayedChannels();
 
 		// start acquisition
 		signalInfo.dataConverter->start(QThread::HighestPriority);
@@ -234,10 +279,13 @@ bool OscilloscopeWindow::createDataSource()
 	}
 }
 
-//! Set new datas. If fullSampleCount is 0, set is incremental, and no resize is required. Otherwise each channel are resized to fullSampleCount
-void OscilloscopeWindow::setData(const std::valarray<signed short> &data, unsigned fullSampleCount, unsigned fullSampleDuration, unsigned channelCount, unsigned startingPos, unsigned flags)
+//! Set new datas, of which dataSampleCount per channel are valid. If fullSampleCount is 0, set is incremental, and no resize is required. Otherwise each channel are resized to fullSampleCount. In roll mode, datas are appended at the end of the frame
+void OscilloscopeWindow::setData(const std::valarray<signed short> &data, unsigned dataSampleCount, unsigned fullSampleCount, unsigned fullSampleDuration, unsigned channelCount, unsigned startingPos, unsigned flags)
 {
-	if (flags & DataConverter::DATA_FRAME_START)
+	// roll mode has no frame, the displayed one restarts only if its layout changes
+	const bool roll = (flags & DataConverter::DATA_FRAME_ROLL) != 0;
+	const bool rollRestart = roll && ((signalInfo.channelCount != channelCount) || (signalInfo.samplePerChannelCount != fullSampleCount));
+	if ((flags & DataConverter::DATA_FRAME_START) || rollRestart)
 	{
 		// resize
 		unsigned oldChannelCount = signalInfo.channelCount;
@@ -246,6 +294,7 @@ void OscilloscopeWindow::setData(const std::valarray<signed short> &data, unsign
 		signalInfo.channelCount = channelCount;
 		signalInfo.samplePerChannelCount = fullSampleCount;
 		signalInfo.incrementalPos = 0;
+		signalInfo.rollStart = 0;
 		signalInfo.duration = fullSampleDuration;
 
 		// recreate menu
@@ -264,13 +313,51 @@ void OscilloscopeWindow::setData(const std::valarray<signed short> &data, unsign
 		wasFrozen = false;
 	}
 	
-	if (!wasFrozen)
+	if (roll)
+	{
+		// copy new samples over the oldest ones, only the last frame of samples is kept
+		const size_t frameSampleCount = signalInfo.samplePerChannelCount;
+		const size_t sampleCount = std::min(dataSampleCount, frameSampleCount);
+		const size_t firstPartCount = std::min(sampleCount, frameSampleCount - signalInfo.rollStart);
+		for (size_t channel = 0; channel < channelCount; channel++)
+		{
+			const signed short *newData = &data[channel * dataSampleCount + dataSampleCount - sampleCount];
+			signed short *alignedData = &signalInfo.data[channel * frameSampleCount];
+			std::copy(newData, newData + firstPartCount, alignedData + signalInfo.rollStart);
+			std::copy(newData + firstPartCount, newData + sampleCount, alignedData);
+		}
+		signalInfo.rollStart = (signalInfo.rollStart + sampleCount) % frameSampleCount;
+		
+		// measure the displayed window once per frame duration, in time order
+		if ((flags & DataConverter::DATA_FRAME_END) && measurementsDock->isVisible())
+		{
+			signalInfo.linearize();
+			measurementsView->measure(&signalInfo, mainView->channelEnabledMask | zoomedView->channelEnabledMask);
+		}
+		
+		// if single, stop getting datas
+		if ((flags & DataConverter::DATA_FRAME_END) && (triggerSingleAct->isChecked()))
+			displayFreezeAct->setChecked(true);
+		
+		// inform widgets, which only redraw new samples unless the frame restarted
+		if ((flags & DataConverter::DATA_FRAME_START) || rollRestart)
+		{
+			mainView->newDataReady(0, frameSampleCount);
+			zoomedView->newDataReady(0, frameSampleCount);
+		}
+		else
+		{
+			mainView->rollDataReady(sampleCount);
+			zoomedView->rollDataReady(sampleCount);
+		}
+	}
+	else if (!wasFrozen)
 	{
 		// new datas
-		Q_ASSERT(data.size() / channelCount <= signalInfo.samplePerChannelCount);
+		Q_ASSERT(dataSampleCount <= signalInfo.samplePerChannelCount);
 
 		// copy data
-		size_t sampleCount = data.size() / channelCount;
+		size_t sampleCount = dataSampleCount;
 		int startSample = signalInfo.incrementalPos;
 		for (size_t channel = 0; channel < channelCount; channel++)
 		{
@@ -284,6 +371,10 @@ void OscilloscopeWindow::setData(const std::valarray<signed short> &data, unsign
 		signalInfo.incrementalPos += sampleCount;
 		int endSample = signalInfo.incrementalPos;
 
+		// measure complete frames
+		if ((flags & DataConverter::DATA_FRAME_END) && measurementsDock->isVisible())
+			measurementsView->measure(&signalInfo, mainView->channelEnabledMask | zoomedView->channelEnabledMask);
+
 		// if single, stop getting datas
 		if ((flags & DataConverter::DATA_FRAME_END) && (triggerSingleAct->isChecked()))
 			displayFreezeAct->setChecked(true);
@@ -295,6 +386,43 @@ void OscilloscopeWindow::setData(const std::valarray<signed short> &data, unsign
 }
 
 
+//! Set new segments from a segmented acquisition, and display the last one
+void OscilloscopeWindow::setSegments(const std::valarray<signed short> &segments, const std::valarray<qint64> &timestamps, unsigned sampleCount, unsigned duration, unsigned segmentCount, unsigned channelCount)
+{
+	Q_ASSERT(segments.size() == segmentCount * sampleCount * channelCount);
+	Q_ASSERT(timestamps.size() == segmentCount);
+	
+	if (signalInfo.segments.size() != segments.size())
+		signalInfo.segments.resize(segments.size());
+	signalInfo.segments = segments;
+	if (signalInfo.segmentTimestamps.size() != timestamps.size())
+		signalInfo.segmentTimestamps.resize(timestamps.size());
+	signalInfo.segmentTimestamps = timestamps;
+	signalInfo.segmentCount = segmentCount;
+	segmentSampleCount = sampleCount;
+	segmentDuration = duration;
+	segmentChannelCount = channelCount;
+	
+	showSegment(segmentCount - 1);
+}
+
+//! Copy segment to the displayed data and show its time relative to the first segment in the status bar
+void OscilloscopeWindow::showSegment(unsigned segment)
+{
+	if (segment >= signalInfo.segmentCount)
+		return;
+	
+	signalInfo.displayedSegment = segment;
+	const size_t frameSize = segmentSampleCount * segmentChannelCount;
+	std::valarray<signed short> frame(signalInfo.segments[std::slice(segment * frameSize, frameSize, 1)]);
+	setData(frame, segmentSampleCount, segmentSampleCount, segmentDuration, segmentChannelCount, 0, DataConverter::DATA_FRAME_START_END);
+	
+	const double delay = (double)(signalInfo.segmentTimestamps[segment] - signalInfo.segmentTimestamps[0]) / 1e6;
+	statusBar()->showMessage(tr("Segment %0/%1, +%2 ms").arg(segment + 1).arg(signalInfo.segmentCount).arg(delay, 0, 'f', 3));
+	mainView->update();
+	zoomedView->update();
+}
+
 //! Print display
 void OscilloscopeWindow::print()
 {
@@ -360,7 +488,7 @@ void OscilloscopeWindow::exportData()
 			{
 				for (unsigned channel = 0; channel < signalInfo.channelCount; channel++)
 				{
-					out << signalInfo.data[channel*rowCount + row] << " ";
+					out << signalInfo.sample(channel, row) << " ";
 				}
 				out << "\n";
 			}
@@ -384,7 +512,7 @@ void OscilloscopeWindow::exportVisibleData()
 				for (unsigned channel = 0; channel < signalInfo.channelCount; channel++)
 				{
 					if (mainView->channelEnabled(channel))
-						out << signalInfo.data[channel*rowCount + row] << " ";
+						out << signalInfo.sample(channel, row) << " ";
 				}
 				out << "\n";
 			}
@@ -397,6 +525,7 @@ void OscilloscopeWindow::zoomAction()
 {
 	zoomedView->channelEnabledMask = mainView->channelEnabledMask;
 	zoomedView->autoLayoutChannels();
+	updateDisplayedChannels();
 }
 
 //! Freeze/unfreeze display
@@ -406,9 +535,40 @@ void OscilloscopeWindow::freezeDisplayToggled(bool toggeled)
 	{
 		disconnectFromDataConverter();
 		wasFrozen = true;
+		// acquisition continues into history, which can be browsed meanwhile
+		historyView->setVisible(historyView->freeze(signalInfo.dataConverter->outputSampleCount()));
 	}
 	else
+	{
+		historyView->setVisible(false);
 		connectToDataConverter();
+	}
+}
+
+//! Display the window of history starting at sample start, of the length of the frozen frame
+void OscilloscopeWindow::showHistory(quint64 start)
+{
+	const HistoryBuffer *history = signalInfo.dataConverter->history();
+	const unsigned sampleCount = historyView->windowLength();
+	std::valarray<signed short> frame;
+	if (!history->read(start, sampleCount, &frame))
+	{
+		statusBar()->showMessage(tr("This part of history has been overwritten"));
+		return;
+	}
+	setData(frame, sampleCount, sampleCount, signalInfo.duration, history->channelCount(), 0, DataConverter::DATA_FRAME_START_END);
+	
+	const double delay = (double)(historyView->frozenEnd() - start - sampleCount) / (double)dataSource->samplingRate();
+	statusBar()->showMessage(tr("History, %0 s before freeze").arg(delay, 0, 'f', 3));
+}
+
+//! Ask the size of history in MB, 0 to disable it
+void OscilloscopeWindow::historySize()
+{
+	bool ok;
+	int size = QInputDialog::getInteger(this, tr("History"), tr("Size of history of all channels in MB, 0 to disable"), signalInfo.dataConverter->historySize(), 0, 1024 * 1024, 64, &ok);
+	if (ok)
+		signalInfo.dataConverter->setHistorySize(size);
 }
 
 //! Change the drawing mode
@@ -421,6 +581,22 @@ void OscilloscopeWindow::changeDrawingMode()
 	mainView->drawingMode = (SignalViewWidget::DrawingMode)(mode);
 }
 
+//! Change how the data converter stores samples in frames
+void OscilloscopeWindow::acquisitionModeAction()
+{
+	QAction *action = static_cast<QAction *>(sender());
+	bool conversionResult;
+	unsigned mode = action->data().toUInt(&conversionResult);
+	assert(conversionResult);
+	signalInfo.dataConverter->setAcquisitionMode((DataConverter::AcquisitionMode)mode);
+}
+
+//! Enable or disable roll mode, in which new samples appear at the right of the display
+void OscilloscopeWindow::rollModeToggled(bool toggled)
+{
+	signalInfo.dataConverter->setRollMode(toggled);
+}
+
 //! Enable/disable a channel
 void OscilloscopeWindow::channelAction()
 {
@@ -434,7 +610,7 @@ void OscilloscopeWindow::channelAction()
 //! Show all channels
 void OscilloscopeWindow::channelAllAction()
 {
-	for (size_t channel = 0; channel < signalInfo.channelCount; channel ++)
+	for (size_t channel = 0; channel < channelAct.size(); channel ++)
 	{
 		channelAct[channel]->setChecked(true);
 		mainView->enableChannel(channel);
@@ -445,8 +621,15 @@ void OscilloscopeWindow::channelAllAction()
 void OscilloscopeWindow::channelNoneAction()
 {
 	mainView->channelEnabledMask = 0;
-	for (size_t channel = 0; channel < signalInfo.channelCount; channel ++)
+	for (size_t channel = 0; channel < channelAct.size(); channel ++)
 		channelAct[channel]->setChecked(false);
+	updateDisplayedChannels();
+}
+
+//! Tell the converter which channels are displayed in any view, so that it can skip computing the others
+void OscilloscopeWindow::updateDisplayedChannels()
+{
+	signalInfo.dataConverter->setDisplayedChannels(mainView->channelEnabledMask | zoomedView->channelEnabledMask);
 }
 
 //! Change timescale. Timescale action will provide the data width in ms as a QVariant in its data() member
@@ -611,6 +794,77 @@ void OscilloscopeWindow::triggerReset()
 	);
 }
 
+//! Edit the advanced trigger condition and the multi-channel pattern
+void OscilloscopeWindow::triggerAdvanced()
+{
+	TriggerDialog dialog(signalInfo.dataConverter->triggerCondition(), signalInfo.dataConverter->triggerPattern(), signalInfo.channelCount, dataSource->unitPerVoltCount(), this);
+	if (dialog.exec() == QDialog::Accepted)
+	{
+		signalInfo.dataConverter->setTriggerCondition(dialog.condition());
+		signalInfo.dataConverter->setTriggerPattern(dialog.pattern());
+	}
+}
+
+//! Ask how successive frames are averaged and over how many frames
+void OscilloscopeWindow::averaging()
+{
+	QStringList modes;
+	modes << tr("None") << tr("Linear, restarts after the number of frames") << tr("Exponential, running average");
+	bool ok;
+	QString mode = QInputDialog::getItem(this, tr("Averaging"), tr("Average of successive trigger-aligned frames"), modes, signalInfo.dataConverter->averagingMode(), false, &ok);
+	if (!ok)
+		return;
+	const int index = modes.indexOf(mode);
+	int count = signalInfo.dataConverter->averagingCount();
+	if (index != DataConverter::AVERAGING_NONE)
+	{
+		count = QInputDialog::getInteger(this, tr("Averaging"), tr("Number of frames averaged"), count, 1, 65536, 1, &ok);
+		if (!ok)
+			return;
+	}
+	signalInfo.dataConverter->setAveraging((DataConverter::AveragingMode)index, count);
+}
+
+//! Ask the number of segments of segmented acquisition, 0 to disable it
+void OscilloscopeWindow::segmentedAcquisition()
+{
+	bool ok;
+	int count = QInputDialog::getInteger(this, tr("Segmented acquisition"), tr("Number of trigger-aligned segments to acquire, 0 to disable"), signalInfo.dataConverter->segmentCount(), 0, 100000, 1, &ok);
+	if (!ok)
+		return;
+	signalInfo.dataConverter->setSegmentCount(count);
+	if (count == 0)
+	{
+		signalInfo.segmentCount = 0;
+		signalInfo.segments.resize(0);
+		signalInfo.segmentTimestamps.resize(0);
+		statusBar()->clearMessage();
+		mainView->update();
+		zoomedView->update();
+	}
+}
+
+//! Draw or not the other segments behind the displayed one
+void OscilloscopeWindow::overlaySegmentsToggled(bool toggled)
+{
+	signalInfo.overlaySegments = toggled;
+	mainView->update();
+	zoomedView->update();
+}
+
+//! Display the previous segment of the last segmented acquisition
+void OscilloscopeWindow::previousSegment()
+{
+	if (signalInfo.displayedSegment > 0)
+		showSegment(signalInfo.displayedSegment - 1);
+}
+
+//! Display the next segment of the last segmented acquisition
+void OscilloscopeWindow::nextSegment()
+{
+	showSegment(signalInfo.displayedSegment + 1);
+}
+
 //! Delete old plugin dock (if any), and recreate a new one by requesting plugins to generate their GUI (if any)
 void OscilloscopeWindow::recreatePluginDock(const DataConverter::ActivePlugins &configuration)
 {
@@ -719,6 +973,8 @@ void OscilloscopeWindow::configurePlugins()
 				activePlugins[plugin].plugin = dialog.pluginsInstanceTable[plugin];
 			else
 				activePlugins[plugin].plugin = processingPluginsDescriptions[id]->create(dataSource);
+			activePlugins[plugin].capabilities = processingPluginCapabilities(processingPluginsObjects[id]);
+			activePlugins[plugin].blockPlugin = qobject_cast<BlockProcessingPluginDescription *>(processingPluginsObjects[id]) != NULL;
 
 			// set the inputs
 			activePlugins[plugin].inputs.resize(processingPluginsDescriptions[id]->inputCount());
@@ -809,11 +1065,13 @@ void OscilloscopeWindow::loadPluginsConfiguration()
 				
 				// get description from plugin name
 				ProcessingPluginDescription *description = NULL;
+				QObject *descriptionObject = NULL;
 				for (size_t i = 0; i < processingPluginsDescriptions.size(); i++)
 				{
 					if (processingPluginsDescriptions[i]->systemName() == pluginSystemName)
 					{
 						description = processingPluginsDescriptions[i];
+						descriptionObject = processingPluginsObjects[i];
 						break;
 					}
 				}
@@ -830,6 +1088,8 @@ void OscilloscopeWindow::loadPluginsConfiguration()
 				// create new plugin instance
 				newConfiguration.resize(pos + 1);
 				newConfiguration[pos].plugin = description->create(dataSource);
+				newConfiguration[pos].capabilities = processingPluginCapabilities(descriptionObject);
+				newConfiguration[pos].blockPlugin = qobject_cast<BlockProcessingPluginDescription *>(descriptionObject) != NULL;
 				
 				// load inputs and outputs configuration
 				newConfiguration[pos].inputs.resize(description->inputCount());
@@ -967,6 +1227,15 @@ void OscilloscopeWindow::createActionsAndMenus()
 	connect(alphaBlendingAct, SIGNAL(triggered(bool)), mainView, SLOT(setAlphaBlending(bool)));
 	connect(alphaBlendingAct, SIGNAL(triggered(bool)), zoomedView, SLOT(setAlphaBlending(bool)));
 	
+	QAction *measurementsAct = measurementsDock->toggleViewAction();
+	measurementsAct->setText(tr("&Measurements"));
+	measurementsAct->setShortcut(QString("m"));
+	measurementsAct->setStatusTip(tr("Show automatic measurements of the displayed channels"));
+	
+	QAction *sourceStatisticsAct = sourceStatisticsDock->toggleViewAction();
+	sourceStatisticsAct->setText(tr("Source &statistics"));
+	sourceStatisticsAct->setStatusTip(tr("Show the statistics of the data source, such as lost data, while it acquires"));
+	
 	timescaleGroup = new QActionGroup(this);
 	for (size_t i = 0; i < ScaleFactorCount; i++)
 	{
@@ -979,6 +1248,41 @@ void OscilloscopeWindow::createActionsAndMenus()
 	}
 	timeScaleAct[getScaleFactorInvert(signalInfo.duration)]->setChecked(true);
 	
+	QActionGroup *acquisitionModeGroup = new QActionGroup(this);
+	
+	QAction *acquisitionNormalAct = new QAction(tr("&Normal sampling"), this);
+	acquisitionNormalAct->setData(DataConverter::ACQUISITION_NORMAL);
+	acquisitionNormalAct->setStatusTip(tr("Keep every sample"));
+	acquisitionModeGroup->addAction(acquisitionNormalAct);
+	
+	QAction *acquisitionPeakDetectAct = new QAction(tr("Pea&k detect"), this);
+	acquisitionPeakDetectAct->setData(DataConverter::ACQUISITION_PEAK_DETECT);
+	acquisitionPeakDetectAct->setStatusTip(tr("At long timescales, keep the minimum and maximum of each group of samples, so that glitches stay visible"));
+	acquisitionModeGroup->addAction(acquisitionPeakDetectAct);
+	
+	QAction *acquisitionHighResolutionAct = new QAction(tr("&High resolution"), this);
+	acquisitionHighResolutionAct->setData(DataConverter::ACQUISITION_HIGH_RESOLUTION);
+	acquisitionHighResolutionAct->setStatusTip(tr("At long timescales, keep the average of each group of samples, to reduce noise"));
+	acquisitionModeGroup->addAction(acquisitionHighResolutionAct);
+	
+	for (int i = 0; i < acquisitionModeGroup->actions().size(); i++)
+	{
+		QAction *action = acquisitionModeGroup->actions()[i];
+		action->setCheckable(true);
+		action->setChecked(action->data().toUInt() == (unsigned)signalInfo.dataConverter->acquisitionMode());
+		connect(action, SIGNAL(triggered()), SLOT(acquisitionModeAction()));
+	}
+	
+	QAction *rollModeAct = new QAction(tr("&Roll mode"), this);
+	rollModeAct->setCheckable(true);
+	rollModeAct->setChecked(signalInfo.dataConverter->rollMode());
+	rollModeAct->setStatusTip(tr("Scroll the display continuously, new samples appearing on the right, the trigger being ignored"));
+	connect(rollModeAct, SIGNAL(toggled(bool)), SLOT(rollModeToggled(bool)));
+	
+	QAction *historySizeAct = new QAction(tr("&History size..."), this);
+	historySizeAct->setStatusTip(tr("Set the size of the history that can be browsed when the display is frozen"));
+	connect(historySizeAct, SIGNAL(triggered()), SLOT(historySize()));
+	
 	// trigger mode
 	
 	triggerNoneAct = new QAction(tr("&None"), this);
@@ -1056,6 +1360,39 @@ void OscilloscopeWindow::createActionsAndMenus()
 	triggerResetAct->setStatusTip(tr("Reset the trigger to default position"));
 	connect(triggerResetAct, SIGNAL(triggered()), SLOT(triggerReset()));
 	
+	QAction *triggerAdvancedAct = new QAction(tr("Ad&vanced..."), this);
+	triggerAdvancedAct->setShortcut(QString("c"));
+	triggerAdvancedAct->setStatusTip(tr("Set hysteresis, pulse width, glitch, runt, slope, holdoff, event count and multi-channel pattern of the trigger"));
+	connect(triggerAdvancedAct, SIGNAL(triggered()), SLOT(triggerAdvanced()));
+	
+	// averaging
+	
+	QAction *averagingAct = new QAction(tr("A&veraging..."), this);
+	averagingAct->setShortcut(QString("v"));
+	averagingAct->setStatusTip(tr("Average successive trigger-aligned frames to reduce noise"));
+	connect(averagingAct, SIGNAL(triggered()), SLOT(averaging()));
+	
+	// segmented acquisition
+	
+	QAction *segmentedAct = new QAction(tr("Se&gmented acquisition..."), this);
+	segmentedAct->setShortcut(QString("g"));
+	segmentedAct->setStatusTip(tr("Acquire several trigger-aligned segments before displaying them"));
+	connect(segmentedAct, SIGNAL(triggered()), SLOT(segmentedAcquisition()));
+	
+	QAction *overlaySegmentsAct = new QAction(tr("&Overlay segments"), this);
+	overlaySegmentsAct->setShortcut(QString("o"));
+	overlaySegmentsAct->setCheckable(true);
+	overlaySegmentsAct->setStatusTip(tr("Draw all segments behind the displayed one"));
+	connect(overlaySegmentsAct, SIGNAL(toggled(bool)), SLOT(overlaySegmentsToggled(bool)));
+	
+	QAction *previousSegmentAct = new QAction(tr("&Previous segment"), this);
+	previousSegmentAct->setShortcut(QKeySequence(Qt::Key_PageUp));
+	connect(previousSegmentAct, SIGNAL(triggered()), SLOT(previousSegment()));
+	
+	QAction *nextSegmentAct = new QAction(tr("Ne&xt segment"), this);
+	nextSegmentAct->setShortcut(QKeySequence(Qt::Key_PageDown));
+	connect(nextSegmentAct, SIGNAL(triggered()), SLOT(nextSegment()));
+	
 	QAction *pluginsConfigureAct = new QAction(tr("&Configure"), this);
 	pluginsConfigureAct->setStatusTip(tr("Choose which plugin to use on which channels"));
 	connect(pluginsConfigureAct, SIGNAL(triggered()), SLOT(configurePlugins()));
@@ -1089,6 +1426,7 @@ void OscilloscopeWindow::createActionsAndMenus()
 	displayMenu->addAction(zoomAct);
 	displayMenu->addSeparator();
 	displayMenu->addAction(displayFreezeAct);
+	displayMenu->addAction(historySizeAct);
 	displayMenu->addSeparator();
 	displayMenu->addAction(drawingLineAct);
 	displayMenu->addAction(drawingPointAct);
@@ -1098,12 +1436,19 @@ void OscilloscopeWindow::createActionsAndMenus()
 	displayMenu->addSeparator();
 	displayMenu->addAction(antialiasedDisplayAct);
 	displayMenu->addAction(alphaBlendingAct);
+	displayMenu->addSeparator();
+	displayMenu->addAction(measurementsAct);
+	displayMenu->addAction(sourceStatisticsAct);
 
 	channelMenu = menuBar()->addMenu(tr("&Channel"));
 	
 	QMenu *timescaleMenu = menuBar()->addMenu(tr("&Timescale"));
 	for (size_t i = 0; i < ScaleFactorCount; i++)
 		timescaleMenu->addAction(timeScaleAct[i]);
+	timescaleMenu->addSeparator();
+	timescaleMenu->addActions(acquisitionModeGroup->actions());
+	timescaleMenu->addSeparator();
+	timescaleMenu->addAction(rollModeAct);
 	
 	QMenu *triggerMenu = menuBar()->addMenu(tr("T&rigger"));
 	triggerMenu->addAction(triggerNoneAct);
@@ -1120,6 +1465,14 @@ void OscilloscopeWindow::createActionsAndMenus()
 		triggerChannelMenu->addAction(triggerChannelAct[i]);*/
 	triggerMenu->addSeparator();
 	triggerMenu->addAction(triggerResetAct);
+	triggerMenu->addAction(triggerAdvancedAct);
+	triggerMenu->addSeparator();
+	triggerMenu->addAction(averagingAct);
+	triggerMenu->addSeparator();
+	triggerMenu->addAction(segmentedAct);
+	triggerMenu->addAction(overlaySegmentsAct);
+	triggerMenu->addAction(previousSegmentAct);
+	triggerMenu->addAction(nextSegmentAct);
 	
 	QMenu *pluginsMenu = menuBar()->addMenu(tr("&Plugins"));
 	pluginsMenu->addAction(pluginsConfigureAct);
@@ -1147,9 +1500,9 @@ void OscilloscopeWindow::recreateChannelActionsAndMenu()
 	
 	channelMenu->addSeparator();
 	
-	// create actions for all channels
-	channelAct.resize(signalInfo.channelCount);
-	for (unsigned channel = 0; channel < signalInfo.channelCount; channel++)
+	// create actions for all channels views can show
+	channelAct.resize(signalInfo.displayableChannelCount());
+	for (unsigned channel = 0; channel < channelAct.size(); channel++)
 	{
 		QAction *action = new QAction(channelNumberToString(channel), this);
 		action->setData(QVariant(channel));
@@ -1216,7 +1569,10 @@ void OscilloscopeWindow::loadPlugins()
 				{
 					ProcessingPluginDescription *iProcessingDescription = qobject_cast<ProcessingPluginDescription *>(plugin);
 					if (iProcessingDescription)
+					{
 						processingPluginsDescriptions.push_back(iProcessingDescription);
+						processingPluginsObjects.push_back(plugin);
+					}
 				}
 				else
 					qDebug() << "Processing plugin " << fileName << " failed to load: " << loader.errorString();
@@ -1248,9 +1604,16 @@ void OscilloscopeWindow::connectToDataConverter()
 {
 	connect(
 		signalInfo.dataConverter, 
-		SIGNAL(dataReady(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned)), 
+		SIGNAL(dataReady(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned)), 
+		this,
+		SLOT(setData(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned)),
+		Qt::QueuedConnection
+	);
+	connect(
+		signalInfo.dataConverter,
+		SIGNAL(segmentsReady(const std::valarray<signed short> &, const std::valarray<qint64> &, unsigned, unsigned, unsigned, unsigned)),
 		this,
-		SLOT(setData(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned)),
+		SLOT(setSegments(const std::valarray<signed short> &, const std::valarray<qint64> &, unsigned, unsigned, unsigned, unsigned)),
 		Qt::QueuedConnection
 	);
 }
@@ -1260,9 +1623,15 @@ void OscilloscopeWindow::disconnectFromDataConverter()
 {
 	disconnect(
 		signalInfo.dataConverter,
-		SIGNAL(dataReady(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned)),
+		SIGNAL(dataReady(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned)),
 		this,
-		SLOT(setData(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned))
+		SLOT(setData(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned))
+	);
+	disconnect(
+		signalInfo.dataConverter,
+		SIGNAL(segmentsReady(const std::valarray<signed short> &, const std::valarray<qint64> &, unsigned, unsigned, unsigned, unsigned)),
+		this,
+		SLOT(setSegments(const std::valarray<signed short> &, const std::valarray<qint64> &, unsigned, unsigned, unsigned, unsigned))
 	);
 }
 
@@ -1272,6 +1641,8 @@ void OscilloscopeWindow::saveGUISettings()
 	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
 	settings.setValue("extendedChannelCount", signalInfo.channelCount - dataSource->inputCount());
 	settings.setValue("timeScale", signalInfo.duration);
+	settings.setValue("measurementsVisible", measurementsDock->isVisible());
+	settings.setValue("sourceStatisticsVisible", sourceStatisticsDock->isVisible());
 	
 	settings.beginGroup("mainView");
 	mainView->saveGUISettings(&settings);
@@ -1288,11 +1659,23 @@ void OscilloscopeWindow::closeEvent(QCloseEvent *)
 	}
 }
 
+//! Show the current statistics of the data source, if the dock is visible
+void OscilloscopeWindow::updateSourceStatistics()
+{
+	if (!sourceStatisticsDock->isVisible())
+		return;
+	const QString statistics = dataSource->statistics();
+	sourceStatisticsLabel->setText(statistics.isEmpty() ? tr("This data source keeps no statistics") : statistics);
+}
+
 //! Load GUI parameters from settings
 void OscilloscopeWindow::loadGUISettings()
 {
 	QSettings settings(ORGANISATION_NAME, APPLICATION_NAME);
 	QStringList groups = settings.childGroups();
+	
+	measurementsDock->setVisible(settings.value("measurementsVisible", false).toBool());
+	sourceStatisticsDock->setVisible(settings.value("sourceStatisticsVisible", false).toBool());
 
 	if (groups.contains("mainView"))
 	{
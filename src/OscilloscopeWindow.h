@@ -39,6 +39,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 class ProcessingPluginDescription;
 class SignalViewWidget;
+class HistoryOverviewWidget;
+class MeasurementsWidget;
 class DataSource;
 class DataSourceDescription;
 class QMenu;
@@ -47,6 +49,8 @@ class QActionGroup;
 class QString;
 class QSplitter;
 class QDockWidget;
+class QLabel;
+class QTimer;
 class QVBoxLayout;
 class QScrollArea;
 
@@ -66,18 +70,24 @@ public:
 	bool isValid();
 	
 private slots:
-	void setData(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned);
+	void setData(const std::valarray<signed short> &, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned);
+	void setSegments(const std::valarray<signed short> &, const std::valarray<qint64> &, unsigned, unsigned, unsigned, unsigned);
 	void print();
 	void exportToPDF();
 	void exportData();
 	void exportVisibleData();
 	void zoomAction();
 	void freezeDisplayToggled(bool);
+	void showHistory(quint64);
+	void historySize();
 	void changeDrawingMode();
 	void channelAction();
 	void channelAllAction();
 	void channelNoneAction();
+	void updateDisplayedChannels();
 	void timeScaleAction();
+	void acquisitionModeAction();
+	void rollModeToggled(bool toggled);
 	void mainTimeScaleChanged(unsigned);
 	void zoomedTimeScaleChanged(unsigned);
 	void triggerChannel();
@@ -88,12 +98,19 @@ private slots:
 	void triggerDown();
 	void triggerBoth();
 	void triggerReset();
+	void triggerAdvanced();
+	void averaging();
+	void segmentedAcquisition();
+	void overlaySegmentsToggled(bool);
+	void previousSegment();
+	void nextSegment();
 	void configurePlugins();
 	void savePluginsConfiguration();
 	void loadPluginsConfiguration();
 	void about();
 	void recreateChannelActionsAndMenu();
 	void saveGUISettings();
+	void updateSourceStatistics();
 
 protected:
 	// events
@@ -106,6 +123,7 @@ private:
 	void recreatePluginDock(const DataConverter::ActivePlugins &configuration);
 	void connectToDataConverter();
 	void disconnectFromDataConverter();
+	void showSegment(unsigned segment);
 	void loadGUISettings();
 	
 	std::vector<DataSourceDescription *> dataSourceDescriptions; //!< available data sources. Real data source instances can be created out of descriptions
@@ -115,9 +133,16 @@ private:
 	QSplitter *splitter; //!< splitter for main and zoomed view
 	SignalViewWidget *mainView; //!< main data view
 	SignalViewWidget *zoomedView; //!< zoomed data view
+	HistoryOverviewWidget *historyView; //!< overview of history, to choose which part of it is displayed when frozen
 	
 	std::vector<ProcessingPluginDescription *> processingPluginsDescriptions; //!< available plugins. Real plugins instances can be created out of descriptions
+	std::vector<QObject *> processingPluginsObjects; //!< plugin objects of processingPluginsDescriptions, to query their other interfaces
 	QDockWidget *pluginDock; //!< plugins dock
+	QDockWidget *measurementsDock; //!< measurements dock
+	MeasurementsWidget *measurementsView; //!< automatic measurements of the displayed channels
+	QDockWidget *sourceStatisticsDock; //!< data source statistics dock
+	QLabel *sourceStatisticsLabel; //!< statistics of the data source, refreshed while the dock is visible
+	QTimer *sourceStatisticsTimer; //!< periodically refreshes sourceStatisticsLabel
 
 	QMenu *channelMenu; //!< menu for choosing channel to display. Dynamically recreated when number of menu are changed
 	QMenu *triggerChannelMenu; //!< menu for choosing channel to trigger on
@@ -141,6 +166,10 @@ private:
 	
 	QActionGroup *triggerChannelGroup; //!< group of trigger channel actions
 	std::valarray<QAction *> triggerChannelAct; //!< trigger channel actions
+	
+	unsigned segmentSampleCount; //!< number of sample per channel of each segment
+	unsigned segmentDuration; //!< duration of each segment in ms
+	unsigned segmentChannelCount; //!< number of channel of each segment
 };
 
 #endif
@@ -0,0 +1,389 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "ProcessingPipeline.h"
+#include "ProcessingPlugin.h"
+#include <algorithm>
+#include <QtGlobal>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! Convert count integer samples to floats
+static void int16ToFloat(const signed short *src, float *dest, unsigned count)
+{
+	unsigned i = 0;
+	#ifdef __SSE2__
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_ps(dest + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)));
+		_mm_storeu_ps(dest + i + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)));
+	}
+	#endif
+	for (; i < count; i++)
+		dest[i] = src[i];
+}
+
+//! Convert count float samples to integers, rounded and saturated
+static void floatToInt16(const float *src, signed short *dest, unsigned count)
+{
+	unsigned i = 0;
+	#ifdef __SSE2__
+	const __m128 low = _mm_set1_ps(-32768.f);
+	const __m128 high = _mm_set1_ps(32767.f);
+	for (; i + 8 <= count; i += 8)
+	{
+		// clamp first, as out of range conversions give the integer indefinite value
+		const __m128i a = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), low), high));
+		const __m128i b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), low), high));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(a, b));
+	}
+	#endif
+	for (; i < count; i++)
+		dest[i] = BlockProcessingPlugin::saturatedSample(src[i]);
+}
+
+
+//! Constructor, the pipeline is empty until build() is called
+ProcessingPipeline::ProcessingPipeline() :
+	blockSize(0),
+	samplingRate(1),
+	blockIndex(0),
+	_fusedStageCount(0),
+	_conversionCount(0),
+	_skippedPluginCount(0),
+	builtDisplayedChannels(0),
+	builtTriggerChannel(0)
+{
+}
+
+//! Schedule plugins on samples, one valarray of at least the block size per channel. Channels below firstPluginChannel come from the data source. displayedChannels is a mask of channels the user sees, channels above 31 are always considered displayed
+void ProcessingPipeline::build(const DataConverter::ActivePlugins &plugins, std::valarray<std::valarray<signed short> > *samples, unsigned firstPluginChannel, unsigned samplingRate, unsigned displayedChannels, unsigned triggerChannel)
+{
+	const unsigned channelCount = samples->size();
+	blockSize = channelCount ? (*samples)[0].size() : 0;
+	this->samplingRate = samplingRate;
+	builtDisplayedChannels = displayedChannels;
+	builtTriggerChannel = triggerChannel;
+	
+	// channels whose integer samples are used after the plugins
+	std::vector<bool> shown(channelCount, false);
+	for (unsigned channel = 0; channel < channelCount; channel++)
+		shown[channel] = (channel >= 32) || (displayedChannels & (1 << channel)) || (channel == triggerChannel);
+	
+	// hidden plugin channels may not be written anymore, clear them rather than leaving stale samples
+	for (unsigned channel = firstPluginChannel; channel < channelCount; channel++)
+		if (!shown[channel])
+			(*samples)[channel] = 0;
+	
+	// walk plugins backward to find those whose outputs are used
+	std::vector<bool> live(shown);
+	std::vector<bool> called(plugins.size(), true);
+	_skippedPluginCount = 0;
+	for (unsigned plugin = plugins.size(); plugin-- > 0;)
+	{
+		const DataConverter::ActivePlugin &p = plugins[plugin];
+		const unsigned capabilities = p.capabilities;
+		bool outputUsed = false;
+		for (size_t i = 0; i < p.outputs.size(); i++)
+			outputUsed = outputUsed || live[p.outputs[i]];
+		if (!outputUsed && (capabilities & (ProcessingPluginCapabilities::CAPABILITY_ELEMENT_WISE | ProcessingPluginCapabilities::CAPABILITY_STATELESS)))
+		{
+			called[plugin] = false;
+			_skippedPluginCount++;
+			continue;
+		}
+		for (size_t i = 0; i < p.outputs.size(); i++)
+			live[p.outputs[i]] = false;
+		for (size_t i = 0; i < p.inputs.size(); i++)
+			live[p.inputs[i]] = true;
+	}
+	
+	// create steps for called plugins, and group consecutive element-wise plugins of the same format into stages
+	steps.clear();
+	stages.clear();
+	_fusedStageCount = 0;
+	std::vector<unsigned> stepPlugin;
+	bool previousElementWise = false;
+	for (unsigned plugin = 0; plugin < plugins.size(); plugin++)
+	{
+		if (!called[plugin])
+			continue;
+		const unsigned capabilities = plugins[plugin].capabilities;
+		Step step;
+		step.plugin = plugins[plugin].plugin;
+		step.blockPlugin = plugins[plugin].blockPlugin ? static_cast<BlockProcessingPlugin *>(step.plugin) : NULL;
+		step.capabilities = capabilities;
+		step.floatSamples = step.blockPlugin && (capabilities & ProcessingPluginCapabilities::CAPABILITY_FLOAT_SAMPLES);
+		const bool elementWise = (capabilities & ProcessingPluginCapabilities::CAPABILITY_ELEMENT_WISE) != 0;
+		if (elementWise && previousElementWise && (steps.back().floatSamples == step.floatSamples))
+		{
+			if (stages.back().count == 1)
+				_fusedStageCount++;
+			stages.back().count++;
+		}
+		else
+		{
+			Stage stage;
+			stage.first = steps.size();
+			stage.count = 1;
+			stages.push_back(stage);
+		}
+		steps.push_back(step);
+		stepPlugin.push_back(plugin);
+		previousElementWise = elementWise;
+	}
+	
+	// for each channel, find the stage of every access, whether the first access within its stage is a write, and whether it is accessed as float
+	const unsigned NoStage = (unsigned)-1;
+	const unsigned SeveralStages = (unsigned)-2;
+	std::vector<unsigned> channelStage(channelCount, NoStage);
+	std::vector<bool> firstAccessIsWrite(channelCount, false);
+	std::vector<int> floatBuffer(channelCount, -1);
+	unsigned floatBufferCount = 0;
+	for (unsigned stage = 0; stage < stages.size(); stage++)
+		for (unsigned step = stages[stage].first; step < stages[stage].first + stages[stage].count; step++)
+		{
+			const DataConverter::ActivePlugin &p = plugins[stepPlugin[step]];
+			for (int write = 0; write < 2; write++)
+			{
+				const std::vector<unsigned> &channels = write ? p.outputs : p.inputs;
+				for (size_t i = 0; i < channels.size(); i++)
+				{
+					const unsigned channel = channels[i];
+					Q_ASSERT(channel < channelCount);
+					if (channelStage[channel] == NoStage)
+					{
+						channelStage[channel] = stage;
+						firstAccessIsWrite[channel] = write != 0;
+					}
+					else if (channelStage[channel] != stage)
+						channelStage[channel] = SeveralStages;
+					if (steps[step].floatSamples && (floatBuffer[channel] < 0))
+						floatBuffer[channel] = floatBufferCount++;
+				}
+			}
+		}
+	floatBuffers.resize(floatBufferCount * blockSize, 0);
+	
+	// assign scratch tiles to integer channels that need not be materialized
+	std::vector<int> scratchTile(channelCount, -1);
+	unsigned scratchTileCount = 0;
+	for (unsigned channel = firstPluginChannel; channel < channelCount; channel++)
+	{
+		const unsigned stage = channelStage[channel];
+		if ((stage == NoStage) || (stage == SeveralStages) || (stages[stage].count < 2))
+			continue;
+		if (!firstAccessIsWrite[channel] || shown[channel] || (floatBuffer[channel] >= 0))
+			continue;
+		scratchTile[channel] = scratchTileCount++;
+	}
+	scratch.resize(scratchTileCount * TileSize, 0);
+	
+	// create ports and pointers
+	for (unsigned step = 0; step < steps.size(); step++)
+	{
+		const DataConverter::ActivePlugin &p = plugins[stepPlugin[step]];
+		Step &s = steps[step];
+		for (int write = 0; write < 2; write++)
+		{
+			const std::vector<unsigned> &channels = write ? p.outputs : p.inputs;
+			std::vector<Port> &ports = write ? s.outputs : s.inputs;
+			std::valarray<ProcessingChannel> &bases = write ? s.outputBases : s.inputBases;
+			ports.resize(channels.size());
+			bases.resize(channels.size());
+			for (size_t i = 0; i < channels.size(); i++)
+			{
+				const unsigned channel = channels[i];
+				if (s.floatSamples)
+				{
+					ports[i].storage = Port::STORAGE_FLOAT;
+					ports[i].index = floatBuffer[channel];
+				}
+				else if (scratchTile[channel] >= 0)
+				{
+					ports[i].storage = Port::STORAGE_SCRATCH;
+					ports[i].index = scratchTile[channel];
+				}
+				else
+				{
+					ports[i].storage = Port::STORAGE_CHANNEL;
+					ports[i].index = channel;
+				}
+				bases[i] = base(ports[i], samples);
+				Q_ASSERT(!(s.capabilities & ProcessingPluginCapabilities::CAPABILITY_SIMD_ALIGNED) || ((((size_t)bases[i].int16 | (size_t)bases[i].float32) & 15) == 0));
+			}
+		}
+		s.inputPointers.resize(s.inputs.size());
+		s.outputPointers.resize(s.outputs.size());
+		s.inputChannels.resize(s.inputs.size());
+		s.outputChannels.resize(s.outputs.size());
+		bind(&s, 0);
+	}
+	
+	// follow which representation of each channel is up to date to schedule conversions
+	std::vector<bool> int16Valid(channelCount, true);
+	std::vector<bool> floatValid(channelCount, false);
+	_conversionCount = 0;
+	for (unsigned stage = 0; stage < stages.size(); stage++)
+		for (unsigned step = stages[stage].first; step < stages[stage].first + stages[stage].count; step++)
+		{
+			const DataConverter::ActivePlugin &p = plugins[stepPlugin[step]];
+			const bool floatSamples = steps[step].floatSamples;
+			for (size_t i = 0; i < p.inputs.size(); i++)
+			{
+				const unsigned channel = p.inputs[i];
+				if (floatSamples ? floatValid[channel] : int16Valid[channel])
+					continue;
+				Conversion conversion;
+				conversion.int16 = &(*samples)[channel][0];
+				conversion.float32 = &floatBuffers[floatBuffer[channel] * blockSize];
+				conversion.toFloat = floatSamples;
+				stages[stage].conversions.push_back(conversion);
+				_conversionCount++;
+				int16Valid[channel] = true;
+				floatValid[channel] = true;
+			}
+			for (size_t i = 0; i < p.outputs.size(); i++)
+			{
+				int16Valid[p.outputs[i]] = !floatSamples;
+				floatValid[p.outputs[i]] = floatSamples;
+			}
+		}
+	finalConversions.clear();
+	for (unsigned channel = 0; channel < channelCount; channel++)
+		if (shown[channel] && !int16Valid[channel])
+		{
+			Conversion conversion;
+			conversion.int16 = &(*samples)[channel][0];
+			conversion.float32 = &floatBuffers[floatBuffer[channel] * blockSize];
+			conversion.toFloat = false;
+			finalConversions.push_back(conversion);
+			_conversionCount++;
+		}
+}
+
+//! Apply all plugins to the first sampleCount samples of all channels of the storage given to build(). timestamp is the monotonic time of the first sample in ns, 0 if unknown
+void ProcessingPipeline::process(unsigned sampleCount, qint64 timestamp)
+{
+	Q_ASSERT(sampleCount <= blockSize || steps.empty());
+	for (size_t s = 0; s < stages.size(); s++)
+	{
+		const Stage &stage = stages[s];
+		convert(stage.conversions, sampleCount);
+		if (stage.count == 1)
+		{
+			// single plugin, process the whole block at once, pointers are already bound
+			call(&steps[stage.first], 0, sampleCount, timestamp);
+		}
+		else
+		{
+			// fused plugins, process the whole chain tile by tile
+			for (unsigned offset = 0; offset < sampleCount; offset += TileSize)
+			{
+				const unsigned count = std::min(TileSize, sampleCount - offset);
+				for (unsigned i = stage.first; i < stage.first + stage.count; i++)
+				{
+					bind(&steps[i], offset);
+					call(&steps[i], offset, count, timestamp);
+				}
+			}
+		}
+	}
+	convert(finalConversions, sampleCount);
+	blockIndex++;
+}
+
+//! Return the first sample of the storage of port
+ProcessingChannel ProcessingPipeline::base(const Port &port, std::valarray<std::valarray<signed short> > *samples)
+{
+	ProcessingChannel channel;
+	channel.int16 = NULL;
+	channel.float32 = NULL;
+	if (port.storage == Port::STORAGE_CHANNEL)
+		channel.int16 = &(*samples)[port.index][0];
+	else if (port.storage == Port::STORAGE_SCRATCH)
+		channel.int16 = &scratch[port.index * TileSize];
+	else
+		channel.float32 = &floatBuffers[port.index * blockSize];
+	return channel;
+}
+
+//! Fill pointers of step from their bases at sample offset. Scratch tiles only hold the current tile, so offset does not apply to them
+void ProcessingPipeline::bind(Step *step, unsigned offset)
+{
+	for (int write = 0; write < 2; write++)
+	{
+		const std::vector<Port> &ports = write ? step->outputs : step->inputs;
+		const std::valarray<ProcessingChannel> &bases = write ? step->outputBases : step->inputBases;
+		std::valarray<signed short *> &pointers = write ? step->outputPointers : step->inputPointers;
+		std::valarray<ProcessingChannel> &channels = write ? step->outputChannels : step->inputChannels;
+		for (size_t i = 0; i < ports.size(); i++)
+		{
+			const unsigned portOffset = ports[i].storage == Port::STORAGE_SCRATCH ? 0 : offset;
+			channels[i].int16 = bases[i].int16 ? bases[i].int16 + portOffset : NULL;
+			channels[i].float32 = bases[i].float32 ? bases[i].float32 + portOffset : NULL;
+			pointers[i] = channels[i].int16;
+		}
+	}
+}
+
+//! Call the plugin of step on sampleCount samples, starting at offset within the block
+void ProcessingPipeline::call(Step *step, unsigned offset, unsigned sampleCount, qint64 timestamp)
+{
+	Q_ASSERT(step->plugin);
+	if (step->blockPlugin)
+	{
+		ProcessingBlock block;
+		block.timestamp = timestamp;
+		block.index = blockIndex;
+		block.samplingRate = samplingRate;
+		block.offset = offset;
+		block.sampleCount = sampleCount;
+		block.inputs = step->inputChannels.size() ? &step->inputChannels[0] : NULL;
+		block.outputs = step->outputChannels.size() ? &step->outputChannels[0] : NULL;
+		step->blockPlugin->processBlock(block);
+	}
+	else
+		step->plugin->processData(step->inputPointers, step->outputPointers, sampleCount);
+}
+
+//! Do conversions on the first sampleCount samples
+void ProcessingPipeline::convert(const std::vector<Conversion> &conversions, unsigned sampleCount)
+{
+	for (size_t i = 0; i < conversions.size(); i++)
+	{
+		const Conversion &conversion = conversions[i];
+		if (conversion.toFloat)
+			int16ToFloat(conversion.int16, conversion.float32, sampleCount);
+		else
+			floatToInt16(conversion.float32, conversion.int16, sampleCount);
+	}
+}
@@ -0,0 +1,158 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __PROCESSING_PIPELINE_H
+#define __PROCESSING_PIPELINE_H
+
+#include "DataConverter.h"
+#include "ProcessingPlugin.h"
+#include <valarray>
+#include <vector>
+
+//! Schedule of the processing plugins of a DataConverter
+/*!
+	Consecutive plugins whose description declares
+	ProcessingPluginCapabilities::CAPABILITY_ELEMENT_WISE and that use the
+	same sample format are fused into a single stage, processed tile by
+	tile: each plugin of the stage is called on TileSize samples before
+	moving to the next tile, so the data of the whole chain stays in L1
+	cache.
+	
+	Within a fused integer stage, channels created by plugins that are
+	only used inside the stage, are neither displayed nor triggered on,
+	are not materialized: they live in a scratch tile only.
+	
+	Version 2 plugins with CAPABILITY_FLOAT_SAMPLES access channels
+	through float buffers. A channel is converted between its integer and
+	float representations only when a plugin reads it in the format it
+	was not last written in, or when it is displayed or triggered on and
+	was last written in float.
+	
+	Plugins that are element-wise or stateless and whose outputs are not
+	used are not called.
+	
+	As channels that are neither displayed nor triggered on may not be
+	written anymore, build() clears those created by plugins, so that
+	they read as zero instead of stale samples.
+	
+	The pipeline is bound to the sample storage given to build(), whose
+	pointers are precomputed, so process() makes no allocation: it must
+	be rebuilt if this storage is reallocated.
+*/
+class ProcessingPipeline
+{
+public:
+	//! Number of samples processed at once by each plugin of a fused stage
+	static const unsigned TileSize = 64;
+	
+	ProcessingPipeline();
+	
+	void build(const DataConverter::ActivePlugins &plugins, std::valarray<std::valarray<signed short> > *samples, unsigned firstPluginChannel, unsigned samplingRate, unsigned displayedChannels, unsigned triggerChannel);
+	//! Return whether the pipeline was built for these display and trigger parameters
+	bool isBuiltFor(unsigned displayedChannels, unsigned triggerChannel) const { return (displayedChannels == builtDisplayedChannels) && (triggerChannel == builtTriggerChannel); }
+	void process(unsigned sampleCount, qint64 timestamp);
+	
+	//! Return the number of fused stages
+	unsigned fusedStageCount() const { return _fusedStageCount; }
+	//! Return the number of channels that are not materialized
+	unsigned virtualChannelCount() const { return scratch.size() / TileSize; }
+	//! Return the number of channels converted between integer and float per block
+	unsigned conversionCount() const { return _conversionCount; }
+	//! Return the number of plugins not called because their outputs are not used
+	unsigned skippedPluginCount() const { return _skippedPluginCount; }
+	
+private:
+	//! Where an input or output of a plugin is
+	struct Port
+	{
+		//! Storage of a port
+		enum Storage
+		{
+			STORAGE_CHANNEL, //!< index is a channel
+			STORAGE_SCRATCH, //!< index is a scratch tile
+			STORAGE_FLOAT //!< index is a float buffer
+		};
+		Storage storage; //!< kind of storage
+		unsigned index; //!< channel, scratch tile or float buffer index
+	};
+	
+	//! A plugin with its ports and the pointers tables to call it
+	struct Step
+	{
+		ProcessingPlugin *plugin; //!< plugin to call
+		BlockProcessingPlugin *blockPlugin; //!< plugin, if it is a version 2 one, NULL otherwise
+		unsigned capabilities; //!< capabilities of the plugin
+		bool floatSamples; //!< if true, the plugin accesses its channels as floats
+		std::vector<Port> inputs; //!< inputs of the plugin
+		std::vector<Port> outputs; //!< outputs of the plugin
+		std::valarray<ProcessingChannel> inputBases; //!< first sample of each input
+		std::valarray<ProcessingChannel> outputBases; //!< first sample of each output
+		std::valarray<signed short *> inputPointers; //!< inputs passed to processData
+		std::valarray<signed short *> outputPointers; //!< outputs passed to processData
+		std::valarray<ProcessingChannel> inputChannels; //!< inputs passed to processBlock
+		std::valarray<ProcessingChannel> outputChannels; //!< outputs passed to processBlock
+	};
+	
+	//! Conversion of a channel between its integer and float representations
+	struct Conversion
+	{
+		signed short *int16; //!< integer samples
+		float *float32; //!< float samples
+		bool toFloat; //!< if true, convert from integers to floats, otherwise from floats to integers
+	};
+	
+	//! A stage is a range of steps, fused if more than one
+	struct Stage
+	{
+		unsigned first; //!< first step of stage
+		unsigned count; //!< number of steps in stage
+		std::vector<Conversion> conversions; //!< conversions to do before the stage
+	};
+	
+	ProcessingChannel base(const Port &port, std::valarray<std::valarray<signed short> > *samples);
+	void bind(Step *step, unsigned offset);
+	void call(Step *step, unsigned offset, unsigned sampleCount, qint64 timestamp);
+	void convert(const std::vector<Conversion> &conversions, unsigned sampleCount);
+	
+	std::vector<Step> steps; //!< plugins that are called, in execution order
+	std::vector<Stage> stages; //!< stages, in execution order
+	std::vector<Conversion> finalConversions; //!< conversions to do after all stages
+	std::valarray<signed short> scratch; //!< storage of channels which are not materialized, TileSize samples each
+	std::valarray<float> floatBuffers; //!< float representations of channels, a block each
+	unsigned blockSize; //!< number of samples in each channel of the storage
+	unsigned samplingRate; //!< sampling rate given to version 2 plugins
+	quint64 blockIndex; //!< index of the next block
+	unsigned _fusedStageCount; //!< number of stages with more than one step
+	unsigned _conversionCount; //!< number of conversions per block
+	unsigned _skippedPluginCount; //!< number of plugins that are not called
+	unsigned builtDisplayedChannels; //!< displayed channels mask used when built
+	unsigned builtTriggerChannel; //!< trigger channel used when built
+};
+
+#endif
@@ -112,6 +112,154 @@ public:
 };
 
 
+//! Optional interface to processing plugins descriptions, exposing capabilities
+/*!
+	A description may inherit from this interface in addition to
+	ProcessingPluginDescription, and declare it with Q_INTERFACES,
+	to tell the DataConverter about properties of its plugin that allow
+	optimisations. Descriptions that do not declare it have no capability.
+*/
+class ProcessingPluginCapabilities
+{
+public:
+	//! Capabilities of a plugin
+	enum Capability
+	{
+		CAPABILITY_ELEMENT_WISE = 0x1, //!< outputs at a sample only depend on inputs at the same sample, and plugin has no state depending on data. Thus processData can be called on any sub-range of the block
+		CAPABILITY_IN_PLACE = 0x2, //!< outputs may share their storage with inputs
+		CAPABILITY_STATELESS = 0x4, //!< plugin has no state depending on data, thus it need not be called when none of its outputs is used
+		CAPABILITY_THREAD_SAFE = 0x8, //!< different instances may process concurrently
+		CAPABILITY_SIMD_ALIGNED = 0x10, //!< plugin requires channel pointers aligned on 16 bytes
+		CAPABILITY_FLOAT_SAMPLES = 0x20 //!< BlockProcessingPlugin only: plugin wants float32 views of its channels instead of int16 ones
+	};
+	
+	//! Virtual destructor, do nothing
+	virtual ~ProcessingPluginCapabilities() { }
+	//! Return the capabilities of the plugin, a or-ed combination of Capability
+	virtual unsigned capabilities() const = 0;
+};
+
+//! Interface to version 2 processing plugins descriptions
+/*!
+	A version 2 plugin description inherits from this interface, which
+	extends ProcessingPluginDescription with capabilities, and declares
+	all three interfaces:
+	\code
+	Q_INTERFACES(ProcessingPluginDescription BlockProcessingPluginDescription ProcessingPluginCapabilities)
+	\endcode
+	so that it is also loaded as a version 1 plugin, and that the host
+	finds its capabilities and knows create() returns a BlockProcessingPlugin.
+*/
+class BlockProcessingPluginDescription : public ProcessingPluginDescription, public ProcessingPluginCapabilities
+{
+};
+
+
+//! Samples of a channel in a ProcessingBlock, in the format the plugin asked for
+struct ProcessingChannel
+{
+	signed short *int16; //!< samples as integers, NULL if the plugin has CAPABILITY_FLOAT_SAMPLES
+	float *float32; //!< samples as floats in the same unit as integers, NULL if the plugin does not have CAPABILITY_FLOAT_SAMPLES
+};
+
+//! Block of samples given to version 2 processing plugins
+struct ProcessingBlock
+{
+	qint64 timestamp; //!< monotonic time of the first sample of the block in ns, 0 if the data source does not know it
+	quint64 index; //!< index of the block since the start of acquisition
+	unsigned samplingRate; //!< sampling rate in Hz
+	unsigned offset; //!< position of the first sample within the block, non-zero when an element-wise plugin is called on a tile
+	unsigned sampleCount; //!< number of samples in each channel
+	const ProcessingChannel *inputs; //!< input channels, as many as ProcessingPluginDescription::inputCount()
+	const ProcessingChannel *outputs; //!< output channels, as many as ProcessingPluginDescription::outputCount()
+	
+	//! Return the timestamp of sample, 0 if unknown
+	qint64 sampleTimestamp(unsigned sample) const { return timestamp ? timestamp + ((qint64)(offset + sample) * 1000000000LL) / samplingRate : 0; }
+};
+
+//! Version 2 processing plugin, processing blocks with their description
+/*!
+	Such plugins receive a ProcessingBlock instead of raw pointers,
+	with the time and index of the block, and views of their channels as
+	int16 or, if their description has CAPABILITY_FLOAT_SAMPLES,
+	float32. The DataConverter keeps channels flowing between float
+	plugins in float, converting only where an int16 plugin, the
+	display or the trigger needs them.
+	
+	Their description must inherit from BlockProcessingPluginDescription.
+	processData is implemented for hosts that only know version 1, by
+	converting if required.
+*/
+class BlockProcessingPlugin : public ProcessingPlugin
+{
+protected:
+	//! Construct the plugin from its description
+	BlockProcessingPlugin(const ProcessingPluginDescription *description) : ProcessingPlugin(description) { }
+	
+public:
+	//! Apply plugin to the block
+	virtual void processBlock(const ProcessingBlock &block) = 0;
+	
+	//! Apply plugin to datas, for version 1 hosts, without time information
+	virtual void processData(const std::valarray<signed short *> &inputs, const std::valarray<signed short *> &outputs, unsigned sampleCount)
+	{
+		// the description of a version 2 plugin is a BlockProcessingPluginDescription
+		const BlockProcessingPluginDescription *blockDescription = static_cast<const BlockProcessingPluginDescription *>(description());
+		const bool floatSamples = (blockDescription->capabilities() & ProcessingPluginCapabilities::CAPABILITY_FLOAT_SAMPLES) != 0;
+		std::valarray<ProcessingChannel> inputChannels(inputs.size());
+		std::valarray<ProcessingChannel> outputChannels(outputs.size());
+		std::valarray<float> floatSamplesStorage(floatSamples ? (inputs.size() + outputs.size()) * sampleCount : 0);
+		for (size_t i = 0; i < inputs.size(); i++)
+		{
+			inputChannels[i].int16 = floatSamples ? NULL : inputs[i];
+			inputChannels[i].float32 = floatSamples ? &floatSamplesStorage[i * sampleCount] : NULL;
+			if (floatSamples)
+				for (unsigned sample = 0; sample < sampleCount; sample++)
+					inputChannels[i].float32[sample] = inputs[i][sample];
+		}
+		for (size_t i = 0; i < outputs.size(); i++)
+		{
+			outputChannels[i].int16 = floatSamples ? NULL : outputs[i];
+			outputChannels[i].float32 = floatSamples ? &floatSamplesStorage[(inputs.size() + i) * sampleCount] : NULL;
+		}
+		
+		ProcessingBlock block;
+		block.timestamp = 0;
+		block.index = 0;
+		block.samplingRate = 1;
+		block.offset = 0;
+		block.sampleCount = sampleCount;
+		block.inputs = inputs.size() ? &inputChannels[0] : NULL;
+		block.outputs = outputs.size() ? &outputChannels[0] : NULL;
+		processBlock(block);
+		
+		if (floatSamples)
+			for (size_t i = 0; i < outputs.size(); i++)
+				for (unsigned sample = 0; sample < sampleCount; sample++)
+					outputs[i][sample] = saturatedSample(outputChannels[i].float32[sample]);
+	}
+	
+	//! Return value rounded to the nearest integer sample, saturated
+	static signed short saturatedSample(float value)
+	{
+		if (value >= 32767.f)
+			return 32767;
+		if (value <= -32768.f)
+			return -32768;
+		return (signed short)(value < 0 ? value - 0.5f : value + 0.5f);
+	}
+};
+
+
 Q_DECLARE_INTERFACE(ProcessingPluginDescription, "ch.eig.lsn.Oscilloscope.ProcessingPluginDescription/1.0")
+Q_DECLARE_INTERFACE(BlockProcessingPluginDescription, "ch.eig.lsn.Oscilloscope.ProcessingPluginDescription/2.0")
+Q_DECLARE_INTERFACE(ProcessingPluginCapabilities, "ch.eig.lsn.Oscilloscope.ProcessingPluginCapabilities/1.0")
+
+//! Return the capabilities of the plugin whose description is the plugin object description, 0 if it does not declare ProcessingPluginCapabilities
+inline unsigned processingPluginCapabilities(QObject *description)
+{
+	const ProcessingPluginCapabilities *capabilities = qobject_cast<ProcessingPluginCapabilities *>(description);
+	return capabilities ? capabilities->capabilities() : 0;
+}
 
 #endif
@@ -0,0 +1,131 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "SampleArena.h"
+#ifdef OSQOOP_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+#endif
+
+//! Constructor, all slots are empty until setCapacity() is called
+SampleArena::SampleArena() :
+	nextSlot(0),
+	_allocationCount(0)
+{
+}
+
+//! Allocate all slots to hold capacity samples, if they do not already
+void SampleArena::setCapacity(size_t capacity)
+{
+	if (slots[0].size() == capacity)
+		return;
+	for (unsigned i = 0; i < SlotCount; i++)
+	{
+		slots[i].resize(capacity);
+		_allocationCount++;
+	}
+}
+
+//! Return a buffer of capacity() samples, valid until SlotCount other buffers have been acquired
+std::valarray<signed short> &SampleArena::acquire()
+{
+	std::valarray<signed short> &slot = slots[nextSlot];
+	nextSlot = (nextSlot + 1) % SlotCount;
+	return slot;
+}
+
+#ifdef OSQOOP_COUNT_ALLOCATIONS
+
+// count allocations per thread, so that the acquisition thread can check its steady state
+static __thread unsigned long allocationCounter = 0;
+
+unsigned long threadAllocationCount()
+{
+	return allocationCounter;
+}
+
+#ifdef __GLIBC__
+
+// with glibc, count at malloc level so that allocations made by C code are seen as well, operator new relies on malloc
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+	allocationCounter++;
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+	allocationCounter++;
+	return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+	allocationCounter++;
+	return __libc_realloc(p, size);
+}
+
+#else // __GLIBC__
+
+// elsewhere, only count allocations made by operator new
+void *operator new(size_t size)
+{
+	allocationCounter++;
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	allocationCounter++;
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw()
+{
+	free(p);
+}
+
+void operator delete[](void *p) throw()
+{
+	free(p);
+}
+
+#endif // __GLIBC__
+
+#endif
@@ -0,0 +1,70 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SAMPLE_ARENA_H
+#define __SAMPLE_ARENA_H
+
+#include <valarray>
+
+//! A small set of preallocated sample buffers, reused across blocks
+/*!
+	All slots are allocated at the capacity given to setCapacity(), which
+	is the largest number of samples a caller puts in a buffer. acquire()
+	returns the slots in turn, whatever the number of samples the caller
+	needs, so the caller carries that number separately from the size of
+	the buffer. Only setCapacity() allocates, when the capacity changes,
+	so that the steady state makes no allocation whatever the sizes
+	requested. The number of allocations is available for checking.
+*/
+class SampleArena
+{
+public:
+	//! Number of buffers kept
+	static const unsigned SlotCount = 4;
+	
+	SampleArena();
+	void setCapacity(size_t capacity);
+	//! Return the number of samples every slot can hold
+	size_t capacity() const { return slots[0].size(); }
+	std::valarray<signed short> &acquire();
+	//! Return the number of buffers allocated since construction
+	unsigned allocationCount() const { return _allocationCount; }
+	
+private:
+	std::valarray<signed short> slots[SlotCount]; //!< buffers, all of the same capacity
+	unsigned nextSlot; //!< slot returned by the next acquire
+	unsigned _allocationCount; //!< number of slots allocated
+};
+
+#ifdef OSQOOP_COUNT_ALLOCATIONS
+//! Return the number of heap allocations made by the calling thread, when built with COUNT_ALLOCATIONS; with glibc, malloc, calloc and realloc are counted, otherwise operator new only
+unsigned long threadAllocationCount();
+#endif
+
+#endif
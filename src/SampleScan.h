@@ -0,0 +1,106 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SAMPLE_SCAN_H
+#define __SAMPLE_SCAN_H
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Vectorised scans of blocks of samples, shared by the trigger and measurement engines
+
+//! Return the index of the first sample in [i, end) in lane order of mask, a _mm_movemask_epi8 result
+inline unsigned firstLane(unsigned i, int mask)
+{
+	while (!(mask & 1))
+	{
+		mask >>= 2;
+		i++;
+	}
+	return i;
+}
+
+//! Return the index of the first sample of [i, end) above threshold, or end
+inline unsigned findAbove(const signed short *samples, unsigned i, unsigned end, signed short threshold)
+{
+	#ifdef __SSE2__
+	const __m128i t = _mm_set1_epi16(threshold);
+	for (; i + 8 <= end; i += 8)
+	{
+		const int mask = _mm_movemask_epi8(_mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *)(samples + i)), t));
+		if (mask)
+			return firstLane(i, mask);
+	}
+	#endif
+	for (; i < end; i++)
+		if (samples[i] > threshold)
+			return i;
+	return end;
+}
+
+//! Return the index of the first sample of [i, end) below threshold, or end
+inline unsigned findBelow(const signed short *samples, unsigned i, unsigned end, signed short threshold)
+{
+	#ifdef __SSE2__
+	const __m128i t = _mm_set1_epi16(threshold);
+	for (; i + 8 <= end; i += 8)
+	{
+		const int mask = _mm_movemask_epi8(_mm_cmplt_epi16(_mm_loadu_si128((const __m128i *)(samples + i)), t));
+		if (mask)
+			return firstLane(i, mask);
+	}
+	#endif
+	for (; i < end; i++)
+		if (samples[i] < threshold)
+			return i;
+	return end;
+}
+
+//! Return the index of the first sample of [i, end) at or below low or at or above high, or end
+inline unsigned findOutside(const signed short *samples, unsigned i, unsigned end, signed short low, signed short high)
+{
+	#ifdef __SSE2__
+	const __m128i l = _mm_set1_epi16(low);
+	const __m128i h = _mm_set1_epi16(high);
+	for (; i + 8 <= end; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(samples + i));
+		const int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi16(v, l), _mm_cmplt_epi16(v, h))) ^ 0xFFFF;
+		if (mask)
+			return firstLane(i, mask);
+	}
+	#endif
+	for (; i < end; i++)
+		if ((samples[i] <= low) || (samples[i] >= high))
+			return i;
+	return end;
+}
+
+#endif
@@ -0,0 +1,83 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "SegmentPool.h"
+#include <QtDebug>
+#include <algorithm>
+
+//! Constructor, the pool is empty
+SegmentPool::SegmentPool() :
+	requestedCount(0),
+	_count(0),
+	_sampleCount(0),
+	_channelCount(0),
+	_filled(0)
+{
+}
+
+//! Prepare storage for requestedCount segments of sampleCount samples for channelCount channels. Return true if storage was reallocated, in which case stored segments are lost
+bool SegmentPool::configure(unsigned requestedCount, unsigned sampleCount, unsigned channelCount)
+{
+	if ((requestedCount == this->requestedCount) && (sampleCount == _sampleCount) && (channelCount == _channelCount))
+		return false;
+	
+	this->requestedCount = requestedCount;
+	_sampleCount = sampleCount;
+	_channelCount = channelCount;
+	const size_t segmentSize = (size_t)sampleCount * (size_t)channelCount;
+	_count = segmentSize ? (unsigned)std::min((size_t)requestedCount, MaxSampleCount / segmentSize) : 0;
+	if (requestedCount && (_count == 0))
+		_count = 1;
+	if (_count < requestedCount)
+		qDebug() << "Segmented acquisition: only" << _count << "segments of" << sampleCount << "samples fit in memory," << requestedCount << "requested";
+	
+	_samples.resize(_count * segmentSize);
+	_timestamps.resize(_count);
+	_filled = 0;
+	return true;
+}
+
+//! Store a segment from frame, a ring buffer of sampleCount samples per channel whose oldest sample is at startingPos. timestamp is the time of the trigger in ns
+void SegmentPool::store(const std::valarray<signed short> &frame, unsigned startingPos, qint64 timestamp)
+{
+	Q_ASSERT(!isFull());
+	Q_ASSERT(frame.size() == (size_t)_sampleCount * (size_t)_channelCount);
+	Q_ASSERT(startingPos < _sampleCount);
+	
+	// linearise the ring so that segments are aligned on their trigger
+	for (unsigned channel = 0; channel < _channelCount; channel++)
+	{
+		const signed short *source = &frame[channel * _sampleCount];
+		signed short *destination = &_samples[((size_t)_filled * _channelCount + channel) * _sampleCount];
+		std::copy(source + startingPos, source + _sampleCount, destination);
+		std::copy(source, source + startingPos, destination + _sampleCount - startingPos);
+	}
+	_timestamps[_filled] = timestamp;
+	_filled++;
+}
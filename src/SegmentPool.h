@@ -0,0 +1,82 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __SEGMENT_POOL_H
+#define __SEGMENT_POOL_H
+
+#include <QtGlobal>
+#include <valarray>
+
+//! Preallocated storage of the trigger-aligned segments of a segmented acquisition
+/*!
+	The pool holds count() segments of sampleCount() samples for
+	channelCount() channels, laid out segment after segment and, within a
+	segment, channel after channel like a normal data frame. Storing a
+	segment only copies samples, so that the acquisition thread can re-arm
+	the trigger without allocating. The number of segments is bounded so
+	that the pool does not exceed MaxSampleCount samples.
+*/
+class SegmentPool
+{
+public:
+	//! Maximum number of samples in the pool (128 MB)
+	static const size_t MaxSampleCount = 64 * 1024 * 1024;
+	
+	SegmentPool();
+	bool configure(unsigned requestedCount, unsigned sampleCount, unsigned channelCount);
+	void store(const std::valarray<signed short> &frame, unsigned startingPos, qint64 timestamp);
+	//! Forget stored segments, keep the storage
+	void clear() { _filled = 0; }
+	
+	//! Return the number of segments in the pool
+	unsigned count() const { return _count; }
+	//! Return the number of samples per channel in each segment
+	unsigned sampleCount() const { return _sampleCount; }
+	//! Return the number of channels in each segment
+	unsigned channelCount() const { return _channelCount; }
+	//! Return the number of segments stored since the last clear
+	unsigned filled() const { return _filled; }
+	//! Return whether all segments have been stored
+	bool isFull() const { return _filled >= _count; }
+	//! Return the samples of all segments
+	const std::valarray<signed short> &samples() const { return _samples; }
+	//! Return the trigger time of each segment in ns
+	const std::valarray<qint64> &timestamps() const { return _timestamps; }
+	
+private:
+	std::valarray<signed short> _samples; //!< samples of segments
+	std::valarray<qint64> _timestamps; //!< trigger time of segments in ns
+	unsigned requestedCount; //!< number of segments asked at last configure
+	unsigned _count; //!< number of segments, requestedCount bounded by MaxSampleCount
+	unsigned _sampleCount; //!< number of samples per channel in a segment
+	unsigned _channelCount; //!< number of channels in a segment
+	unsigned _filled; //!< number of segments stored
+};
+
+#endif
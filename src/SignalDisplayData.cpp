@@ -28,7 +28,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 
 #include "SignalDisplayData.h"
+#include "DataConverter.h"
 #include "Utilities.h"
+#include <algorithm>
 
 //! Return the number of sample per channel
 unsigned SignalDisplayData::sampleCount(void) const
@@ -36,6 +38,27 @@ unsigned SignalDisplayData::sampleCount(void) const
 	return data.size() / channelCount;
 }
 
+//! Rotate each channel so that its oldest sample comes first, for readers expecting data in time order
+void SignalDisplayData::linearize(void)
+{
+	if (rollStart == 0)
+		return;
+	for (unsigned channel = 0; channel < channelCount; channel++)
+	{
+		signed short *channelSamples = &data[channel * samplePerChannelCount];
+		std::rotate(channelSamples, channelSamples + rollStart, channelSamples + samplePerChannelCount);
+	}
+	rollStart = 0;
+}
+
+//! Return the samples of channel in segment, or NULL if segments do not have the layout of data
+const signed short *SignalDisplayData::segmentData(unsigned segment, unsigned channel) const
+{
+	if ((segment >= segmentCount) || (channel >= channelCount) || (segments.size() != segmentCount * data.size()))
+		return NULL;
+	return &segments[segment * data.size() + channel * sampleCount()];
+}
+
 //! Compute the mean, maximum amplitude in DC, maximum amplitude in AC (mean substracted). NULL can be passed if value has to be ignored
 void SignalDisplayData::channelAmplitude(unsigned channel, int *mean, int *maxAmplitudeDC, int *maxAmplitudeAC) const
 {
@@ -74,6 +97,26 @@ int SignalDisplayData::clipSamplePos(int pos) const
 		return pos;
 }
 
+//! Return the position in data of a position in samples of the data source, such as the trigger position. They differ if the data converter decimates
+int SignalDisplayData::sourceSampleToSample(unsigned sourceSample) const
+{
+	const unsigned sourceCount = dataConverter->outputSampleCount();
+	if ((sourceCount == 0) || (sampleCount() == 0))
+		return sourceSample;
+	return (int)(((quint64)sourceSample * sampleCount()) / sourceCount);
+}
+
+//! Return the position in samples of the data source of a position in data, negative positions being the first sample
+unsigned SignalDisplayData::sampleToSourceSample(int sample) const
+{
+	const unsigned sourceCount = dataConverter->outputSampleCount();
+	if (sample < 0)
+		return 0;
+	if ((sourceCount == 0) || (sampleCount() == 0))
+		return sample;
+	return (unsigned)(((quint64)sample * sourceCount) / sampleCount());
+}
+
 //! Return a duration in sample for the given time in ms. Integer version
 unsigned SignalDisplayData::timeToSample(unsigned time) const
 {
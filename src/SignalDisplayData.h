@@ -45,16 +45,36 @@ class DataConverter;
 */
 struct SignalDisplayData
 {
+	static const unsigned MaxDisplayedChannelCount = 32; //!< number of channels views can show, as they keep channel sets in 32 bits masks
+	
 	unsigned duration; //!< duration of data in millisecond
 	unsigned channelCount; //!< number of channel
 	unsigned incrementalPos; //!< position of new data in case of incremental acquisition
 	unsigned samplePerChannelCount; //!< number of sample per channel
+	unsigned rollStart; //!< in roll mode, position in each channel of data of the oldest sample, 0 otherwise
 	DataConverter *dataConverter; //!< data converter, to get trigger information
 	std::valarray<signed short> data; //!< the data (local copy is required when resizing)
+	std::valarray<signed short> segments; //!< segments of the last segmented acquisition, each laid out as data
+	std::valarray<qint64> segmentTimestamps; //!< trigger time of each segment in ns
+	unsigned segmentCount; //!< number of segments in segments, 0 if none
+	unsigned displayedSegment; //!< segment copied in data
+	bool overlaySegments; //!< if true, the other segments are drawn behind data
 	
 	unsigned sampleCount(void) const;
+	//! Return the number of channels views can show, the first ones of channelCount
+	unsigned displayableChannelCount(void) const { return channelCount < MaxDisplayedChannelCount ? channelCount : MaxDisplayedChannelCount; }
+	//! Return the sample at pos of channel, positions being in time order even when rolling
+	signed short sample(unsigned channel, unsigned pos) const
+	{
+		const unsigned rolledPos = pos + rollStart;
+		return data[channel * samplePerChannelCount + (rolledPos < samplePerChannelCount ? rolledPos : rolledPos - samplePerChannelCount)];
+	}
+	void linearize(void);
+	const signed short *segmentData(unsigned segment, unsigned channel) const;
 	void channelAmplitude(unsigned channel, int *mean, int *maxAmplitudeDC, int *maxAmplitudeAC) const;
 	int clipSamplePos(int pos) const;
+	int sourceSampleToSample(unsigned sourceSample) const;
+	unsigned sampleToSourceSample(int sample) const;
 	unsigned timeToSample(unsigned time) const;
 	double timeToSample(double time) const;
 	unsigned sampleToTime(unsigned sample) const;
@@ -76,6 +76,9 @@ SignalViewWidget::SignalViewWidget(const SignalDisplayData *signalInfo, int yPre
 	channelNameEditing->hide();
 	drawingMode = LineDrawing;
 	persistantBuffer = NULL;
+	rollBuffer = NULL;
+	rollRemainder = 0;
+	rollBufferChannelMask = 0;
 	zoomStartPos = 0;
 	zoomEndPos = 0;
 
@@ -89,6 +92,7 @@ SignalViewWidget::SignalViewWidget(const SignalDisplayData *signalInfo, int yPre
 SignalViewWidget::~SignalViewWidget()
 {
 	disableDisplayPersistance();
+	delete rollBuffer;
 }
 
 //! Return the best size for this widget
@@ -109,17 +113,23 @@ QSizePolicy SignalViewWidget::sizePolicy () const
 	return QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 }
 
-//! Enable channel a channel which will then be visible
+//! Enable channel a channel which will then be visible, channels beyond SignalDisplayData::MaxDisplayedChannelCount cannot be shown
 void SignalViewWidget::enableChannel(unsigned channel)
 {
+	if (channel >= SignalDisplayData::MaxDisplayedChannelCount)
+		return;
 	channelEnabledMask |= (1<<channel);
+	emit channelEnabledChanged();
 	update();
 }
 
 //! Disable channel a channel which will then be hidden
 void SignalViewWidget::disableChannel(unsigned channel)
 {
+	if (channel >= SignalDisplayData::MaxDisplayedChannelCount)
+		return;
 	channelEnabledMask &= ~(1<<channel);
+	emit channelEnabledChanged();
 	update();
 }
 
@@ -136,7 +146,7 @@ void SignalViewWidget::setChannelEnabled(unsigned channel, bool enabled)
 //! Return true if channel is enabled (i.e. visible)
 bool SignalViewWidget::channelEnabled(unsigned channel) const
 {
-	return (channelEnabledMask & (1<<channel)) != 0;
+	return (channel < SignalDisplayData::MaxDisplayedChannelCount) && ((channelEnabledMask & (1<<channel)) != 0);
 }
 
 //! Return true if antialiasing is enabled
@@ -210,11 +220,60 @@ void SignalViewWidget::newDataReady(int startSample, int endSample)
 	zoomStartPos = signalInfo->clipSamplePos(zoomStartPos);
 	zoomEndPos = signalInfo->clipSamplePos(zoomEndPos);
 
+	// the whole view is redrawn, roll restarts from it
+	delete rollBuffer;
+	rollBuffer = NULL;
+	rollRemainder = 0;
+
 	// update display
 	persistantBufferDirty = true;
 	update();
 }
 
+//! New samples have been appended at the end of the data in the SignalDisplayData structure, scrolling the oldest ones out. Only the pixel columns they expose are recomputed and drawn, the rest of the view is scrolled
+void SignalViewWidget::rollDataReady(int sampleCount)
+{
+	const int w = width();
+	const int span = static_cast<int>(signalInfo->sampleCount()) - 1;
+	// views not drawn from optimised data are redrawn as a whole
+	if (zoomed || persistantBuffer || (span + 1 <= w) || (optimisedData.size() != w * signalInfo->channelCount) || (yDivisionFactor.size() != signalInfo->channelCount))
+	{
+		newDataReady(0, signalInfo->sampleCount());
+		return;
+	}
+	
+	// scroll columns by the samples, carrying the fraction of a column to the next roll so that columns follow samples
+	rollRemainder += (qint64)sampleCount * (qint64)w;
+	const int shift = (int)std::min(rollRemainder / span, (qint64)w);
+	rollRemainder = (shift < w) ? rollRemainder - (qint64)shift * span : 0;
+	for (unsigned channel = 0; channel < signalInfo->channelCount; channel++)
+	{
+		QPoint *columns = &optimisedData[w * channel];
+		std::copy(columns + shift, columns + w, columns);
+	}
+	// the last column was partial, it is recomputed with the new ones
+	const int firstColumn = std::max(w - shift - 1, 0);
+	regenerateOptimisedData(screenToSampleX(firstColumn, w), signalInfo->sampleCount());
+	
+	if (!rollBuffer || (rollBuffer->size() != size()) || !rollBufferMatchesView())
+		redrawRollBuffer();
+	else
+	{
+		#if QT_VERSION >= 0x040600
+		rollBuffer->scroll(-shift, 0, rollBuffer->rect());
+		#else
+		QPixmap scrolled = rollBuffer->copy(shift, 0, w - shift, height());
+		QPainter(rollBuffer).drawPixmap(0, 0, scrolled);
+		#endif
+		// each column is drawn as a polygon joining it to the previous one, so redraw from the column before
+		const int firstPixel = std::max(sampleToScreenX(screenToSampleX(firstColumn, w), w) - 1, 0);
+		QPainter painter(rollBuffer);
+		painter.fillRect(QRect(firstPixel, 0, w - firstPixel, height()), Qt::white);
+		drawDataOptimised(&painter, QRect(std::max(firstPixel - 1, 0), 0, w - std::max(firstPixel - 1, 0), height()));
+	}
+	update();
+}
+
 //! Regenerate pixel-aligned data for optimised view
 void SignalViewWidget::regenerateOptimisedData(int startSample, int endSample)
 {
@@ -228,25 +287,46 @@ void SignalViewWidget::regenerateOptimisedData(int startSample, int endSample)
 
 	for (unsigned channel = 0; channel < signalInfo->channelCount; channel++)
 	{
-		const short int *dataPtr = &(signalInfo->data[channel * signalInfo->sampleCount()]);
 		for (int pixel = startPixel; pixel < endPixel; pixel++)
 		{
 			unsigned startSubSample = screenToSampleX(pixel, w);
 			unsigned endSubSample = screenToSampleX(pixel+1, w);
 			endSubSample = std::min(endSubSample, signalInfo->sampleCount()-1);
 
-			int min = dataPtr[startSubSample];
+			int min = signalInfo->sample(channel, startSubSample);
 			int max = min;
 			for (unsigned sample = startSubSample + 1; sample < endSubSample; sample++)
 			{
-				min = std::min(min, (int)dataPtr[sample]);
-				max = std::max(min, (int)dataPtr[sample]);
+				min = std::min(min, (int)signalInfo->sample(channel, sample));
+				max = std::max(max, (int)signalInfo->sample(channel, sample));
 			}
 			optimisedData[w * channel + pixel] = QPoint(min, max);
 		}
 	}
 }
 
+//! Draw the whole roll buffer from optimised data, and remember the view it corresponds to
+void SignalViewWidget::redrawRollBuffer(void)
+{
+	if (!rollBuffer || (rollBuffer->size() != size()))
+	{
+		delete rollBuffer;
+		rollBuffer = new QPixmap(size());
+	}
+	QPainter painter(rollBuffer);
+	painter.fillRect(rollBuffer->rect(), Qt::white);
+	drawDataOptimised(&painter, rollBuffer->rect());
+	rollBufferYDivisionFactor = yDivisionFactor;
+	rollBufferYShiftFactor = yShiftFactor;
+	rollBufferChannelMask = channelEnabledMask;
+}
+
+//! Return true if the roll buffer was drawn with the actual scales, shifts and enabled channels
+bool SignalViewWidget::rollBufferMatchesView(void) const
+{
+	return (rollBufferYDivisionFactor == yDivisionFactor) && (rollBufferYShiftFactor == yShiftFactor) && (rollBufferChannelMask == channelEnabledMask);
+}
+
 //! Enable/disable antialiasing
 void SignalViewWidget::setAntialiasing(bool enabled)
 {
@@ -505,12 +585,24 @@ void SignalViewWidget::paintEvent(QPaintEvent *event)
 		}
 		painter.drawPixmap(0, 0, *persistantBuffer);
 	}
+	
+	// draw roll buffer if any, redrawing it if the view changed since
+	if (rollBuffer)
+	{
+		if ((rollBuffer->size() != size()) || !rollBufferMatchesView())
+			redrawRollBuffer();
+		painter.drawPixmap(0, 0, *rollBuffer);
+	}
 
 	// draw grid
 	drawGrid(&painter, rect(), false);
+	
+	// draw other segments of a segmented acquisition behind data
+	if (signalInfo->overlaySegments && (signalInfo->segmentCount > 1))
+		drawSegments(&painter, validRect);
 
-	// draw data if not persistant buffer
-	if (persistantBuffer == NULL)
+	// draw data if not persistant nor roll buffer
+	if ((persistantBuffer == NULL) && (rollBuffer == NULL))
 	{
 		if (!zoomed && (int)signalInfo->sampleCount() > width())
 			drawDataOptimised(&painter, validRect);
@@ -524,13 +616,13 @@ void SignalViewWidget::paintEvent(QPaintEvent *event)
 			drawYTriangle(&painter, shiftToScreenY(channel, height()), channel, (int)channel == movingChannelShift, false);
 	
 	// trigger
-	if (!zoomed && (signalInfo->dataConverter->triggerType() != DataConverter::TRIGGER_NONE) && signalInfo->data.size())
+	if (!zoomed && (signalInfo->dataConverter->triggerType() != DataConverter::TRIGGER_NONE) && !signalInfo->dataConverter->rollMode() && signalInfo->data.size())
 	{
 		unsigned channel = signalInfo->dataConverter->triggerChannel();
 		if (channelEnabled(channel))
 		{
 			drawYTriangle(&painter, sampleToScreenY(channel, signalInfo->dataConverter->triggerValue(), height()) + shiftToScreenY(channel, height()), channel, true, true);
-			drawXTriangle(&painter, sampleToScreenX(signalInfo->dataConverter->triggerPos(), width()), channel, true, true);
+			drawXTriangle(&painter, sampleToScreenX(signalInfo->sourceSampleToSample(signalInfo->dataConverter->triggerPos()), width()), channel, true, true);
 		}
 	}
 	
@@ -654,7 +746,7 @@ void SignalViewWidget::drawData(QPainter *painter, const QRect &drawRect, const
 				for (int sample = sampleStart; sample < sampleEnd; sample++)
 				{
 					int newXPos = sampleToScreenX(sample, targetRect.width()) + targetRect.x();
-					int newSample = sampleToScreenY(channel, signalInfo->data[channel * sampleSize + sample], targetRect.height());
+					int newSample = sampleToScreenY(channel, signalInfo->sample(channel, sample), targetRect.height());
 					int yShift = shiftToScreenY(channel, targetRect.height());
 					linesToDraw[sample - sampleStart] = QPoint(newXPos, yMean - yShift - newSample + targetRect.y());
 				}
@@ -663,12 +755,12 @@ void SignalViewWidget::drawData(QPainter *painter, const QRect &drawRect, const
 			
 				// get original positions
 				int oldXPos = drawRect.x() + targetRect.x();
-				int oldSample = sampleToScreenY(channel, signalInfo->data[channel * sampleSize + sampleStart], targetRect.height());
+				int oldSample = sampleToScreenY(channel, signalInfo->sample(channel, sampleStart), targetRect.height());
 				
 				for (int sample = sampleStart + 1; sample < sampleEnd; sample++)
 				{
 					int newXPos = sampleToScreenX(sample, targetRect.width()) + targetRect.x();
-					int newSample = sampleToScreenY(channel, signalInfo->data[channel * sampleSize + sample], targetRect.height());
+					int newSample = sampleToScreenY(channel, signalInfo->sample(channel, sample), targetRect.height());
 					int yShift = shiftToScreenY(channel, targetRect.height());
 					
 					switch (drawingMode)
@@ -722,6 +814,56 @@ void SignalViewWidget::drawDataOptimised(QPainter *painter, const QRect &clipRec
 		}
 }
 
+//! Draw all segments but the displayed one as light polylines, with at most one point per pixel column
+void SignalViewWidget::drawSegments(QPainter *painter, const QRect &clipRect)
+{
+	int sampleSize = static_cast<int>(signalInfo->sampleCount());
+	int sampleStart = zoomed ? zoomStartPos : 0;
+	int sampleEnd = zoomed ? std::min(zoomEndPos + 1, sampleSize) : sampleSize;
+	if (sampleEnd - sampleStart < 2)
+		return;
+	
+	// one point per pixel column, or per sample if there are fewer samples than columns
+	int pixelStart = std::max(clipRect.left() - 1, 0);
+	int pixelEnd = std::min(clipRect.right() + 2, width());
+	int pointCount = std::min(sampleEnd - sampleStart, pixelEnd - pixelStart);
+	if (pointCount < 2)
+		return;
+	QPolygon polyline(pointCount);
+	int yMean = height() >> 1;
+	
+	for (unsigned channel = 0; channel < signalInfo->channelCount; channel++)
+		if (channelEnabled(channel))
+		{
+			QColor color = getChannelColor(channel);
+			if (useAlphaBlending)
+				color.setAlpha(std::max(16, 128 / (int)signalInfo->segmentCount));
+			else
+				color = color.light(170);
+			painter->setPen(color);
+			
+			int yShift = shiftToScreenY(channel, height());
+			for (unsigned segment = 0; segment < signalInfo->segmentCount; segment++)
+			{
+				if (segment == signalInfo->displayedSegment)
+					continue;
+				const signed short *samples = signalInfo->segmentData(segment, channel);
+				if (!samples)
+					return;
+				for (int point = 0; point < pointCount; point++)
+				{
+					int sample;
+					if (pointCount == sampleEnd - sampleStart)
+						sample = sampleStart + point;
+					else
+						sample = signalInfo->clipSamplePos(screenToSampleX(pixelStart + (point * (pixelEnd - pixelStart)) / pointCount, width()));
+					polyline.setPoint(point, sampleToScreenX(sample, width()), yMean - yShift - sampleToScreenY(channel, samples[sample], height()));
+				}
+				painter->drawPolyline(polyline);
+			}
+		}
+}
+
 //! A mouse button has been pressed
 void SignalViewWidget::mousePressEvent(QMouseEvent *event)
 {
@@ -783,7 +925,7 @@ void SignalViewWidget::mousePressEvent(QMouseEvent *event)
 				}
 
 		// trigger draw
-		if (!zoomed && (signalInfo->dataConverter->triggerType() != DataConverter::TRIGGER_NONE))
+		if (!zoomed && (signalInfo->dataConverter->triggerType() != DataConverter::TRIGGER_NONE) && !signalInfo->dataConverter->rollMode())
 		{
 			DataConverter *conv = signalInfo->dataConverter;
 			unsigned channel = conv->triggerChannel();
@@ -791,7 +933,7 @@ void SignalViewWidget::mousePressEvent(QMouseEvent *event)
 			
 			// TODO : move this call in its own function
 			QPoint triggerPos = QPoint(
-				sampleToScreenX(conv->triggerPos(),
+				sampleToScreenX(signalInfo->sourceSampleToSample(conv->triggerPos()),
 				width()),
 				yMean - sampleToScreenY(channel, conv->triggerValue(),
 				height()) - shiftToScreenY(channel, height()));
@@ -855,7 +997,7 @@ void SignalViewWidget::mouseMoveEvent(QMouseEvent *event)
 	{
 		DataConverter *conv = signalInfo->dataConverter;
 		unsigned channel = conv->triggerChannel();
-		int triggerSample = screenToSampleX(event->pos().x(), width());
+		unsigned triggerSample = signalInfo->sampleToSourceSample(screenToSampleX(event->pos().x(), width()));
 		int triggerValue = screenToSampleY(channel, yMean - event->pos().y() - shiftToScreenY(channel, height()), height());
 		conv->setTrigger(conv->triggerType(), conv->triggerTimeout(), channel, triggerSample, triggerValue);
 		update();
@@ -940,6 +1082,9 @@ void SignalViewWidget::resizeEvent(QResizeEvent *)
 		optimisedData.resize(width() * signalInfo->channelCount);
 		regenerateOptimisedData(0, signalInfo->sampleCount());
 	}
+	
+	delete rollBuffer;
+	rollBuffer = NULL;
 }
 
 //! A timescale action has been triggered. Timescale action will provide the data width in ms as a QVariant in its data() member
@@ -1163,7 +1308,7 @@ void SignalViewWidget::saveGUISettings(QSettings *settings)
 		settings->setValue("index", physicChannelIdToLogic(i));
 		settings->setValue("yDivisionFactor", yDivisionFactor[i]);
 		settings->setValue("yShiftFactor", yShiftFactor[i]);
-		if (channelEnabledMask & (1<<i))
+		if (channelEnabled(i))
 			settings->setValue("enabled", true);
 		else
 			settings->setValue("enabled", false);
@@ -1188,7 +1333,7 @@ void SignalViewWidget::loadGUISettings(QSettings *settings)
 			{
 				yDivisionFactor[id] = settings->value("yDivisionFactor").toInt();
 				yShiftFactor[id] = settings->value("yShiftFactor").toInt();
-				if (settings->value("enabled").toBool() == false)
+				if ((settings->value("enabled").toBool() == false) && (id < SignalDisplayData::MaxDisplayedChannelCount))
 					channelEnabledMask &= ~(1 << id);
 			}
 		}
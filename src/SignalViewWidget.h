@@ -85,9 +85,11 @@ signals:
 	void zoomPosChanged(int,int); //!< The zoom marker have been changed
 	void timeScaleChanged(unsigned); //!< The timescale has been changed by the timescale menu
 	void customChannelNameChanged(); //!< Name of a custom channel has been changed
+	void channelEnabledChanged(); //!< A channel has been enabled or disabled
 
 public slots:
 	void newDataReady(int startSample, int endSample);
+	void rollDataReady(int sampleCount);
 	void setAntialiasing(bool enabled);
 	void setAlphaBlending(bool enabled);
 	void setDisplayPersistance(bool enabled);
@@ -122,11 +124,14 @@ protected:
 	inline int screenToSampleX(int screen, int screenWidth);
 
 	void regenerateOptimisedData(int startSample, int endSample);
+	void redrawRollBuffer(void);
+	bool rollBufferMatchesView(void) const;
 	
 	// drawing helper methods
 	void drawGrid(QPainter *painter, const QRect &targetRect, bool blackAndWhite = false, qreal penWidth = 0);
 	void drawData(QPainter *painter, const QRect &drawRect, const QRect &targetRect, bool blackAndWhite = false, qreal penWidth = 0);
 	void drawDataOptimised(QPainter *painter, const QRect &clipRect);
+	void drawSegments(QPainter *painter, const QRect &clipRect);
 	int drawInfoBubble(QPainter *painter, int x, int y, const QString &text, const QColor &color = Qt::gray);
 	QRect getInfoBubbleRect(const QString &text, int x, int y);
 	void drawYTriangle(QPainter *painter, int yPos, unsigned channel, bool selected, bool trigger);
@@ -160,6 +165,11 @@ protected:
 	bool persistantBufferDirty; //!< persistant buffer needs redraw
 	bool isZoomMarker; //!< do we show zoom marker
 	std::valarray<QPoint> optimisedData; //!< data optimised for display
+	QPixmap *rollBuffer; //!< in roll mode, data drawn from optimised data, scrolled as new samples come
+	qint64 rollRemainder; //!< in roll mode, samples scrolled times width which do not amount to a whole pixel column yet
+	std::vector<int> rollBufferYDivisionFactor; //!< yDivisionFactor when rollBuffer was drawn
+	std::vector<int> rollBufferYShiftFactor; //!< yShiftFactor when rollBuffer was drawn
+	unsigned rollBufferChannelMask; //!< channelEnabledMask when rollBuffer was drawn
 
 	// gui interaction elements
 	int movingChannelShift; //!< number of channel being shifted. -1 if no channel is being shifted
@@ -0,0 +1,257 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "TriggerDialog.h"
+#include <TriggerDialog.moc>
+#include "Utilities.h"
+
+#include <QLabel>
+#include <QGridLayout>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QPushButton>
+#include <QGroupBox>
+#include <algorithm>
+
+//! Constructor, fill the widgets with condition and pattern for channelCount channels. unitPerVoltCount is the number of sample units per volt of the data source
+TriggerDialog::TriggerDialog(const TriggerCondition &condition, const TriggerPattern &pattern, unsigned channelCount, unsigned unitPerVoltCount, QWidget *parent) :
+	QDialog(parent)
+{
+	this->unitPerVoltCount = unitPerVoltCount ? unitPerVoltCount : 1;
+	const double voltPerUnit = 1.0 / (double)this->unitPerVoltCount;
+	
+	// widgets, in the order of TriggerCondition::Mode and TriggerCondition::Comparison
+	modeCombo = new QComboBox;
+	modeCombo->addItem(tr("Edge"));
+	modeCombo->addItem(tr("Pulse width"));
+	modeCombo->addItem(tr("Glitch"));
+	modeCombo->addItem(tr("Runt"));
+	modeCombo->addItem(tr("Slope"));
+	modeCombo->setCurrentIndex(condition.mode);
+	
+	hysteresisSpin = new QDoubleSpinBox;
+	hysteresisSpin->setDecimals(4);
+	hysteresisSpin->setRange(0, 65535 * voltPerUnit);
+	hysteresisSpin->setSingleStep(voltPerUnit);
+	hysteresisSpin->setSuffix(tr(" V"));
+	hysteresisSpin->setValue(condition.hysteresis * voltPerUnit);
+	
+	secondValueSpin = new QDoubleSpinBox;
+	secondValueSpin->setDecimals(4);
+	secondValueSpin->setRange(-32768 * voltPerUnit, 32767 * voltPerUnit);
+	secondValueSpin->setSingleStep(voltPerUnit);
+	secondValueSpin->setSuffix(tr(" V"));
+	secondValueSpin->setValue(condition.secondValue * voltPerUnit);
+	
+	comparisonCombo = new QComboBox;
+	comparisonCombo->addItem(tr("Shorter than"));
+	comparisonCombo->addItem(tr("Longer than"));
+	comparisonCombo->setCurrentIndex(condition.comparison);
+	
+	timeSpin = new QSpinBox;
+	timeSpin->setRange(0, 60000000);
+	timeSpin->setSuffix(tr(" us"));
+	timeSpin->setValue(condition.time);
+	
+	holdoffSpin = new QSpinBox;
+	holdoffSpin->setRange(0, 60000000);
+	holdoffSpin->setSuffix(tr(" us"));
+	holdoffSpin->setValue(condition.holdoff);
+	
+	eventCountSpin = new QSpinBox;
+	eventCountSpin->setRange(1, 1000000);
+	eventCountSpin->setValue(condition.eventCount);
+	
+	// pattern, in the order of TriggerPattern::Logic and TriggerPattern::ChannelCondition
+	logicCombo = new QComboBox;
+	logicCombo->addItem(tr("Trigger channel only"));
+	logicCombo->addItem(tr("All conditions (AND)"));
+	logicCombo->addItem(tr("Any condition (OR)"));
+	logicCombo->addItem(tr("Conditions in sequence"));
+	logicCombo->setCurrentIndex(pattern.logic);
+	
+	QGridLayout *patternLayout = new QGridLayout;
+	patternLayout->addWidget(new QLabel(tr("Logic")), 0, 0);
+	patternLayout->addWidget(logicCombo, 0, 1, 1, 2);
+	channelConditionCombos.resize(channelCount);
+	channelLevelSpins.resize(channelCount);
+	channelStepLabels.resize(channelCount);
+	for (unsigned channel = 0; channel < channelCount; channel++)
+	{
+		QComboBox *conditionCombo = new QComboBox;
+		conditionCombo->addItem(tr("Ignored"));
+		conditionCombo->addItem(tr("Above"));
+		conditionCombo->addItem(tr("Below"));
+		QDoubleSpinBox *levelSpin = new QDoubleSpinBox;
+		levelSpin->setDecimals(4);
+		levelSpin->setRange(-32768 * voltPerUnit, 32767 * voltPerUnit);
+		levelSpin->setSingleStep(voltPerUnit);
+		levelSpin->setSuffix(tr(" V"));
+		if (channel < pattern.conditions.size())
+		{
+			conditionCombo->setCurrentIndex(pattern.conditions[channel]);
+			levelSpin->setValue(pattern.levels[channel] * voltPerUnit);
+		}
+		channelConditionCombos[channel] = conditionCombo;
+		channelLevelSpins[channel] = levelSpin;
+		channelStepLabels[channel] = new QLabel;
+		patternLayout->addWidget(new QLabel(channelNumberToString(channel)), channel + 1, 0);
+		patternLayout->addWidget(conditionCombo, channel + 1, 1);
+		patternLayout->addWidget(levelSpin, channel + 1, 2);
+		patternLayout->addWidget(channelStepLabels[channel], channel + 1, 3);
+		connect(conditionCombo, SIGNAL(currentIndexChanged(int)), SLOT(channelConditionChanged(int)));
+	}
+	// the sequence keeps the order of the pattern, then conditions are appended as the user sets them
+	const std::vector<unsigned> terms = pattern.terms();
+	for (size_t i = 0; i < terms.size(); i++)
+		if (terms[i] < channelCount)
+			order.push_back(terms[i]);
+	QGroupBox *patternBox = new QGroupBox(tr("Pattern"));
+	patternBox->setLayout(patternLayout);
+	
+	// ok / cancel buttons
+	QPushButton *okButton = new QPushButton(tr("OK"));
+	okButton->setDefault(true);
+	QPushButton *cancelButton = new QPushButton(tr("Cancel"));
+	
+	// connections
+	connect(modeCombo, SIGNAL(currentIndexChanged(int)), SLOT(modeChanged(int)));
+	connect(logicCombo, SIGNAL(currentIndexChanged(int)), SLOT(logicChanged(int)));
+	connect(okButton, SIGNAL(clicked()), SLOT(accept()));
+	connect(cancelButton, SIGNAL(clicked()), SLOT(reject()));
+	
+	// layout
+	QGridLayout *mainLayout = new QGridLayout;
+	mainLayout->addWidget(new QLabel(tr("Mode")), 0, 0);
+	mainLayout->addWidget(modeCombo, 0, 1);
+	mainLayout->addWidget(new QLabel(tr("Hysteresis")), 1, 0);
+	mainLayout->addWidget(hysteresisSpin, 1, 1);
+	mainLayout->addWidget(new QLabel(tr("Second level")), 2, 0);
+	mainLayout->addWidget(secondValueSpin, 2, 1);
+	mainLayout->addWidget(new QLabel(tr("Width or duration")), 3, 0);
+	mainLayout->addWidget(comparisonCombo, 3, 1);
+	mainLayout->addWidget(timeSpin, 4, 1);
+	mainLayout->addWidget(new QLabel(tr("Holdoff")), 5, 0);
+	mainLayout->addWidget(holdoffSpin, 5, 1);
+	mainLayout->addWidget(new QLabel(tr("Trig on event")), 6, 0);
+	mainLayout->addWidget(eventCountSpin, 6, 1);
+	mainLayout->addWidget(patternBox, 7, 0, 1, -1);
+	
+	QHBoxLayout *buttonLayout = new QHBoxLayout;
+	buttonLayout->addStretch(1);
+	buttonLayout->addWidget(okButton);
+	buttonLayout->addWidget(cancelButton);
+	mainLayout->addLayout(buttonLayout, 8, 0, 1, -1);
+	
+	setLayout(mainLayout);
+	
+	setWindowTitle(tr("Advanced trigger"));
+	
+	modeChanged(condition.mode);
+	logicChanged(pattern.logic);
+}
+
+//! Return the condition as edited by the user
+TriggerCondition TriggerDialog::condition() const
+{
+	TriggerCondition condition;
+	condition.mode = (TriggerCondition::Mode)modeCombo->currentIndex();
+	condition.hysteresis = (unsigned)qRound(hysteresisSpin->value() * unitPerVoltCount);
+	condition.secondValue = (signed short)qRound(secondValueSpin->value() * unitPerVoltCount);
+	condition.comparison = (TriggerCondition::Comparison)comparisonCombo->currentIndex();
+	condition.time = timeSpin->value();
+	condition.holdoff = holdoffSpin->value();
+	condition.eventCount = eventCountSpin->value();
+	return condition;
+}
+
+//! Return the pattern as edited by the user
+TriggerPattern TriggerDialog::pattern() const
+{
+	TriggerPattern pattern;
+	pattern.logic = (TriggerPattern::Logic)logicCombo->currentIndex();
+	pattern.conditions.resize(channelConditionCombos.size());
+	pattern.levels.resize(channelLevelSpins.size());
+	for (size_t channel = 0; channel < channelConditionCombos.size(); channel++)
+	{
+		pattern.conditions[channel] = (TriggerPattern::ChannelCondition)channelConditionCombos[channel]->currentIndex();
+		pattern.levels[channel] = (signed short)qRound(channelLevelSpins[channel]->value() * unitPerVoltCount);
+	}
+	pattern.order = order;
+	return pattern;
+}
+
+//! Enable the conditions of channels only if logic uses them
+void TriggerDialog::logicChanged(int logic)
+{
+	for (size_t channel = 0; channel < channelConditionCombos.size(); channel++)
+	{
+		channelConditionCombos[channel]->setEnabled(logic != TriggerPattern::LOGIC_DISABLED);
+		channelLevelSpins[channel]->setEnabled(logic != TriggerPattern::LOGIC_DISABLED);
+	}
+	updateSteps();
+}
+
+//! Append the channel whose condition changed to the sequence when it gets a condition, remove it when it is ignored
+void TriggerDialog::channelConditionChanged(int condition)
+{
+	const std::vector<QComboBox *>::const_iterator it = std::find(channelConditionCombos.begin(), channelConditionCombos.end(), sender());
+	if (it == channelConditionCombos.end())
+		return;
+	const unsigned channel = it - channelConditionCombos.begin();
+	const std::vector<unsigned>::iterator position = std::find(order.begin(), order.end(), channel);
+	if ((condition == TriggerPattern::CHANNEL_IGNORED) && (position != order.end()))
+		order.erase(position);
+	else if ((condition != TriggerPattern::CHANNEL_IGNORED) && (position == order.end()))
+		order.push_back(channel);
+	updateSteps();
+}
+
+//! Show the step of every channel in the sequence, only with sequence logic
+void TriggerDialog::updateSteps()
+{
+	const bool isSequence = (logicCombo->currentIndex() == TriggerPattern::LOGIC_SEQUENCE);
+	for (size_t channel = 0; channel < channelStepLabels.size(); channel++)
+		channelStepLabels[channel]->clear();
+	if (!isSequence)
+		return;
+	for (size_t i = 0; i < order.size(); i++)
+		channelStepLabels[order[i]]->setText(tr("Step %0").arg(i + 1));
+}
+
+//! Enable only the widgets used by mode
+void TriggerDialog::modeChanged(int mode)
+{
+	const bool usesSecondValue = (mode == TriggerCondition::MODE_RUNT) || (mode == TriggerCondition::MODE_SLOPE);
+	const bool usesTime = (mode != TriggerCondition::MODE_EDGE) && (mode != TriggerCondition::MODE_RUNT);
+	secondValueSpin->setEnabled(usesSecondValue);
+	comparisonCombo->setEnabled(usesTime && (mode != TriggerCondition::MODE_GLITCH));
+	timeSpin->setEnabled(usesTime);
+}
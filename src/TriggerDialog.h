@@ -0,0 +1,76 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __TRIGGER_DIALOG_H
+#define __TRIGGER_DIALOG_H
+
+#include <QDialog>
+#include <vector>
+#include "TriggerEngine.h"
+
+class QComboBox;
+class QDoubleSpinBox;
+class QSpinBox;
+class QLabel;
+
+//! Dialog that let the user edit the advanced trigger condition: mode, hysteresis, second level, time, holdoff and event count, and the multi-channel pattern
+class TriggerDialog : public QDialog
+{
+	Q_OBJECT
+	
+public:
+	TriggerDialog(const TriggerCondition &condition, const TriggerPattern &pattern, unsigned channelCount, unsigned unitPerVoltCount, QWidget *parent = 0);
+	TriggerCondition condition() const;
+	TriggerPattern pattern() const;
+
+private slots:
+	void modeChanged(int mode);
+	void logicChanged(int logic);
+	void channelConditionChanged(int condition);
+
+private:
+	void updateSteps();
+	
+
+	unsigned unitPerVoltCount; //!< number of sample units per volt, to show levels in volts
+	QComboBox *modeCombo; //!< trigger mode, one of TriggerCondition::Mode
+	QDoubleSpinBox *hysteresisSpin; //!< hysteresis in volts
+	QDoubleSpinBox *secondValueSpin; //!< second level of runt and slope modes in volts
+	QComboBox *comparisonCombo; //!< comparison of pulse width and slope duration to time
+	QSpinBox *timeSpin; //!< pulse width, glitch width or slope duration in us
+	QSpinBox *holdoffSpin; //!< holdoff in us
+	QSpinBox *eventCountSpin; //!< trig on the Nth event
+	QComboBox *logicCombo; //!< pattern logic, one of TriggerPattern::Logic
+	std::vector<QComboBox *> channelConditionCombos; //!< pattern condition of every channel, one of TriggerPattern::ChannelCondition
+	std::vector<QDoubleSpinBox *> channelLevelSpins; //!< pattern level of every channel in volts
+	std::vector<QLabel *> channelStepLabels; //!< step of every channel in the sequence
+	std::vector<unsigned> order; //!< channels having a condition, in the order the user entered them
+};
+
+#endif
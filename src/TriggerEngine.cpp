@@ -0,0 +1,485 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include "TriggerEngine.h"
+#include "SampleScan.h"
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! Return the index of the first sample of [i, end) different from value, or end
+static unsigned findDifferent(const signed short *samples, unsigned i, unsigned end, signed short value)
+{
+	#ifdef __SSE2__
+	const __m128i t = _mm_set1_epi16(value);
+	for (; i + 8 <= end; i += 8)
+	{
+		const int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(samples + i)), t)) ^ 0xFFFF;
+		if (mask)
+			return firstLane(i, mask);
+	}
+	#endif
+	for (; i < end; i++)
+		if (samples[i] != value)
+			return i;
+	return end;
+}
+
+//! Saturate value to the range of samples
+static signed short saturated(int value)
+{
+	return (signed short)std::min(std::max(value, -32768), 32767);
+}
+
+//! Return the index of the first sample of [i, end) for which condition on level is true, or false if wanted is false, or end
+static unsigned findCondition(const signed short *samples, unsigned i, unsigned end, TriggerPattern::ChannelCondition condition, signed short level, bool wanted)
+{
+	if ((condition == TriggerPattern::CHANNEL_ABOVE) == wanted)
+		return wanted ? findAbove(samples, i, end, level) : findAbove(samples, i, end, saturated((int)level - 1));
+	else
+		return wanted ? findBelow(samples, i, end, level) : findBelow(samples, i, end, saturated((int)level + 1));
+}
+
+
+//! Constructor, the condition is a simple edge
+TriggerCondition::TriggerCondition() :
+	mode(MODE_EDGE),
+	hysteresis(0),
+	secondValue(0),
+	comparison(LESS_THAN),
+	time(0),
+	holdoff(0),
+	eventCount(1)
+{
+}
+
+//! Return whether all parameters are equal
+bool TriggerCondition::operator==(const TriggerCondition &that) const
+{
+	return
+		(mode == that.mode) &&
+		(hysteresis == that.hysteresis) &&
+		(secondValue == that.secondValue) &&
+		(comparison == that.comparison) &&
+		(time == that.time) &&
+		(holdoff == that.holdoff) &&
+		(eventCount == that.eventCount);
+}
+
+
+//! Constructor, the pattern is disabled
+TriggerPattern::TriggerPattern() :
+	logic(LOGIC_DISABLED)
+{
+}
+
+//! Return the mask of the channels below 32 having a condition
+unsigned TriggerPattern::channelMask() const
+{
+	unsigned mask = 0;
+	for (size_t channel = 0; (channel < conditions.size()) && (channel < 32); channel++)
+		if (conditions[channel] != CHANNEL_IGNORED)
+			mask |= 1 << channel;
+	return mask;
+}
+
+//! Return the channels having a condition, in the order of the sequence
+std::vector<unsigned> TriggerPattern::terms() const
+{
+	std::vector<unsigned> terms;
+	std::vector<bool> added(conditions.size(), false);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const unsigned channel = order[i];
+		if ((channel < conditions.size()) && (conditions[channel] != CHANNEL_IGNORED) && !added[channel])
+		{
+			terms.push_back(channel);
+			added[channel] = true;
+		}
+	}
+	for (unsigned channel = 0; channel < conditions.size(); channel++)
+		if ((conditions[channel] != CHANNEL_IGNORED) && !added[channel])
+			terms.push_back(channel);
+	return terms;
+}
+
+//! Return whether all parameters are equal
+bool TriggerPattern::operator==(const TriggerPattern &that) const
+{
+	return
+		(logic == that.logic) &&
+		(conditions == that.conditions) &&
+		(levels == that.levels) &&
+		(order == that.order);
+}
+
+
+//! Constructor, the pattern is disabled and never holds
+TriggerPatternEvaluator::TriggerPatternEvaluator() :
+	termsEnd(0)
+{
+	reset();
+}
+
+//! Set the pattern to evaluate, reset the sequence if it changed. Return whether it changed
+bool TriggerPatternEvaluator::configure(const TriggerPattern &pattern)
+{
+	if (pattern == this->pattern)
+		return false;
+	
+	this->pattern = pattern;
+	this->pattern.levels.resize(pattern.conditions.size(), 0);
+	terms = pattern.terms();
+	termsEnd = terms.empty() ? 0 : *std::max_element(terms.begin(), terms.end()) + 1;
+	// only a sequence depends on the order of terms, the others skip missing channels by stopping at the first one
+	if (pattern.logic != TriggerPattern::LOGIC_SEQUENCE)
+		std::sort(terms.begin(), terms.end());
+	reset();
+	return true;
+}
+
+//! Restart the sequence from its first condition
+void TriggerPatternEvaluator::reset()
+{
+	stage = 0;
+	stageArmed = false;
+}
+
+//! Write the value of the pattern for the first sampleCount samples of channels into output. Conditions on channels missing from channels are ignored
+void TriggerPatternEvaluator::evaluate(const std::valarray<std::valarray<signed short> > &channels, unsigned sampleCount, signed short *output)
+{
+	if (pattern.logic == TriggerPattern::LOGIC_SEQUENCE)
+	{
+		evaluateSequence(channels, sampleCount, output);
+		return;
+	}
+	
+	// terms present in this block
+	unsigned termCount = 0;
+	while ((termCount < terms.size()) && (terms[termCount] < channels.size()))
+		termCount++;
+	if ((termCount == 0) || (pattern.logic == TriggerPattern::LOGIC_DISABLED))
+	{
+		std::fill(output, output + sampleCount, (signed short)OUTPUT_FALSE);
+		return;
+	}
+	
+	// single pass over the block, combining all terms of a vector of samples before writing it
+	const bool isAnd = (pattern.logic == TriggerPattern::LOGIC_AND);
+	unsigned i = 0;
+	#ifdef __SSE2__
+	const __m128i two = _mm_set1_epi16(2);
+	const __m128i one = _mm_set1_epi16(1);
+	for (; i + 8 <= sampleCount; i += 8)
+	{
+		__m128i combined = isAnd ? _mm_cmpeq_epi16(one, one) : _mm_setzero_si128();
+		for (unsigned term = 0; term < termCount; term++)
+		{
+			const unsigned channel = terms[term];
+			const __m128i v = _mm_loadu_si128((const __m128i *)(&channels[channel][i]));
+			const __m128i level = _mm_set1_epi16(pattern.levels[channel]);
+			const __m128i holds = (pattern.conditions[channel] == TriggerPattern::CHANNEL_ABOVE) ? _mm_cmpgt_epi16(v, level) : _mm_cmplt_epi16(v, level);
+			combined = isAnd ? _mm_and_si128(combined, holds) : _mm_or_si128(combined, holds);
+		}
+		// all ones gives 2 - 1, zero gives 0 - 1
+		_mm_storeu_si128((__m128i *)(output + i), _mm_sub_epi16(_mm_and_si128(combined, two), one));
+	}
+	#endif
+	for (; i < sampleCount; i++)
+	{
+		bool combined = isAnd;
+		for (unsigned term = 0; term < termCount; term++)
+		{
+			const unsigned channel = terms[term];
+			const signed short v = channels[channel][i];
+			const bool holds = (pattern.conditions[channel] == TriggerPattern::CHANNEL_ABOVE) ? (v > pattern.levels[channel]) : (v < pattern.levels[channel]);
+			combined = isAnd ? (combined && holds) : (combined || holds);
+		}
+		output[i] = combined ? OUTPUT_TRUE : OUTPUT_FALSE;
+	}
+}
+
+//! Write the completions of the sequence for the first sampleCount samples of channels into output. Each stage waits for its condition to be false then true, using vectorised scans
+void TriggerPatternEvaluator::evaluateSequence(const std::valarray<std::valarray<signed short> > &channels, unsigned sampleCount, signed short *output)
+{
+	std::fill(output, output + sampleCount, (signed short)OUTPUT_FALSE);
+	if (terms.empty() || (termsEnd > channels.size()))
+		return;
+	
+	unsigned i = 0;
+	while (i < sampleCount)
+	{
+		const unsigned channel = terms[stage];
+		const signed short *samples = &channels[channel][0];
+		i = findCondition(samples, i, sampleCount, pattern.conditions[channel], pattern.levels[channel], stageArmed);
+		if (i == sampleCount)
+			break;
+		if (!stageArmed)
+		{
+			stageArmed = true;
+			continue;
+		}
+		// condition of this stage became true, the next stage starts from this sample
+		stageArmed = false;
+		if (++stage == terms.size())
+		{
+			output[i] = OUTPUT_TRUE;
+			stage = 0;
+			i++;
+		}
+	}
+}
+
+
+//! Constructor, looks for rising edges crossing 0
+TriggerEngine::TriggerEngine() :
+	directions(RISING),
+	value(0),
+	samplingRate(1),
+	time(0),
+	holdoff(0),
+	useRegions(false),
+	lowLevel(0),
+	highLevel(0),
+	lowExit(0),
+	highExit(0)
+{
+	reset();
+}
+
+//! Set what to look for: directions of events, level value and condition. Reset the state if anything changed
+void TriggerEngine::configure(unsigned directions, signed short value, const TriggerCondition &condition, unsigned samplingRate)
+{
+	if ((directions == this->directions) && (value == this->value) && (condition == this->condition) && (samplingRate == this->samplingRate))
+		return;
+	
+	this->directions = directions;
+	this->value = value;
+	this->condition = condition;
+	this->condition.eventCount = std::max(condition.eventCount, 1u);
+	this->samplingRate = samplingRate;
+	time = ((quint64)condition.time * samplingRate) / 1000000;
+	holdoff = ((quint64)condition.holdoff * samplingRate) / 1000000;
+	useRegions = (condition.mode == TriggerCondition::MODE_RUNT) || (condition.mode == TriggerCondition::MODE_SLOPE);
+	const int hysteresis = (int)std::min(condition.hysteresis, 65535u);
+	if (useRegions)
+	{
+		lowLevel = std::min(value, condition.secondValue);
+		highLevel = std::max(value, condition.secondValue);
+		lowExit = saturated((int)lowLevel + hysteresis);
+		highExit = saturated((int)highLevel - hysteresis);
+	}
+	else
+	{
+		lowLevel = saturated((int)value - hysteresis);
+		highLevel = saturated((int)value + hysteresis);
+	}
+	reset();
+}
+
+//! Forget the past of the signal, the next event requires a complete new transition
+void TriggerEngine::reset()
+{
+	state = STATE_UNKNOWN;
+	lastPosition = 0;
+	lastValid = false;
+	lastRising = false;
+	holdoffEnd = 0;
+	eventCounter = 0;
+}
+
+//! Run the state machine on samples [start, end) of a block whose first sample is at blockPosition since start of acquisition. Return the index of the first trigger event at or after armedFrom, or end if there is none. In the first case, samples after the event are not processed yet
+unsigned TriggerEngine::find(const signed short *samples, unsigned start, unsigned end, unsigned armedFrom, quint64 blockPosition)
+{
+	unsigned i = start;
+	while (i < end)
+	{
+		bool event = false;
+		const unsigned j = step(samples, i, end, blockPosition, &event);
+		if (event && (j >= armedFrom) && (blockPosition + j >= holdoffEnd))
+		{
+			eventCounter++;
+			if (eventCounter >= condition.eventCount)
+			{
+				eventCounter = 0;
+				holdoffEnd = blockPosition + j + holdoff;
+				// complete the transitions of the event sample, so that processing can resume after it
+				for (unsigned k = j; k <= j;)
+				{
+					bool ignored;
+					k = step(samples, k, j + 1, blockPosition, &ignored);
+				}
+				return j;
+			}
+		}
+		i = j;
+	}
+	return end;
+}
+
+//! Run a single transition of the state machine from sample i. Return the index of the sample causing the transition, or end if there is none, and set event if it is a candidate trigger event
+unsigned TriggerEngine::step(const signed short *samples, unsigned i, unsigned end, quint64 blockPosition, bool *event)
+{
+	if (useRegions)
+		return stepRegions(samples, i, end, blockPosition, event);
+	else
+		return stepCrossings(samples, i, end, blockPosition, event);
+}
+
+//! Transition of the crossing state machine, used by edge, pulse width and glitch conditions
+unsigned TriggerEngine::stepCrossings(const signed short *samples, unsigned i, unsigned end, quint64 blockPosition, bool *event)
+{
+	unsigned j;
+	switch (state)
+	{
+		case STATE_LOW:
+		// without hysteresis, reaching the level also allows a falling crossing
+		j = (lowLevel == highLevel) ? findAbove(samples, i, end, saturated((int)value - 1)) : findAbove(samples, i, end, value);
+		if (j < end)
+		{
+			if (samples[j] == value)
+				state = STATE_LEVEL;
+			else
+			{
+				// crossed upward, a new crossing needs to leave the hysteresis band first
+				state = STATE_UNKNOWN;
+				*event = crossing(true, blockPosition + j);
+			}
+		}
+		return j;
+		
+		case STATE_HIGH:
+		j = (lowLevel == highLevel) ? findBelow(samples, i, end, saturated((int)value + 1)) : findBelow(samples, i, end, value);
+		if (j < end)
+		{
+			if (samples[j] == value)
+				state = STATE_LEVEL;
+			else
+			{
+				state = STATE_UNKNOWN;
+				*event = crossing(false, blockPosition + j);
+			}
+		}
+		return j;
+		
+		case STATE_LEVEL:
+		j = findDifferent(samples, i, end, value);
+		if (j < end)
+		{
+			state = STATE_UNKNOWN;
+			*event = crossing(samples[j] > value, blockPosition + j);
+		}
+		return j;
+		
+		default:
+		j = findOutside(samples, i, end, lowLevel, highLevel);
+		if (j < end)
+		{
+			// without hysteresis, a sample at the level allows crossings in both directions
+			if ((samples[j] <= lowLevel) && (samples[j] >= highLevel))
+				state = STATE_LEVEL;
+			else
+				state = (samples[j] <= lowLevel) ? STATE_LOW : STATE_HIGH;
+		}
+		return j;
+	}
+}
+
+//! Process a crossing of the level at position, return whether it is a candidate event for the condition
+bool TriggerEngine::crossing(bool rising, quint64 position)
+{
+	if (condition.mode == TriggerCondition::MODE_EDGE)
+		return (directions & (rising ? RISING : FALLING)) != 0;
+	
+	// a pulse ends at this crossing if the previous one was in the other direction, a positive pulse ends falling
+	bool event = false;
+	if (lastValid && (lastRising != rising))
+	{
+		const quint64 width = position - lastPosition;
+		if (condition.mode == TriggerCondition::MODE_GLITCH)
+			event = width < time;
+		else if (directions & (rising ? FALLING : RISING))
+			event = (condition.comparison == TriggerCondition::LESS_THAN) ? (width < time) : (width > time);
+	}
+	lastValid = true;
+	lastRising = rising;
+	lastPosition = position;
+	return event;
+}
+
+//! Transition of the region state machine, used by runt and slope conditions
+unsigned TriggerEngine::stepRegions(const signed short *samples, unsigned i, unsigned end, quint64 blockPosition, bool *event)
+{
+	unsigned j;
+	switch (state)
+	{
+		case STATE_LOW:
+		j = findAbove(samples, i, end, lowExit);
+		if (j < end)
+		{
+			state = STATE_LEFT_LOW;
+			lastPosition = blockPosition + j;
+		}
+		return j;
+		
+		case STATE_HIGH:
+		j = findBelow(samples, i, end, highExit);
+		if (j < end)
+		{
+			state = STATE_LEFT_HIGH;
+			lastPosition = blockPosition + j;
+		}
+		return j;
+		
+		default:
+		j = findOutside(samples, i, end, lowLevel, highLevel);
+		if (j < end)
+		{
+			const State arrival = (samples[j] <= lowLevel) ? STATE_LOW : STATE_HIGH;
+			if ((state == STATE_LEFT_LOW) || (state == STATE_LEFT_HIGH))
+			{
+				const bool fromLow = (state == STATE_LEFT_LOW);
+				const bool runt = (arrival == STATE_LOW) == fromLow;
+				if (condition.mode == TriggerCondition::MODE_RUNT)
+				{
+					// positive runts leave and come back to the lower region
+					*event = runt && (directions & (fromLow ? RISING : FALLING));
+				}
+				else if (!runt && (directions & (fromLow ? RISING : FALLING)))
+				{
+					const quint64 duration = blockPosition + j - lastPosition;
+					*event = (condition.comparison == TriggerCondition::LESS_THAN) ? (duration < time) : (duration > time);
+				}
+			}
+			state = arrival;
+		}
+		return j;
+	}
+}
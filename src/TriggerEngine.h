@@ -0,0 +1,216 @@
+/*
+
+Osqoop, an open source software oscilloscope.
+Copyright (C) 2006--2009 Stephane Magnenat <stephane at magnenat dot net>
+http://stephane.magnenat.net
+Laboratory of Digital Systems
+http://www.eig.ch/fr/laboratoires/systemes-numeriques/
+Engineering School of Geneva
+http://hepia.hesge.ch/
+See authors file in source distribution for details about contributors
+
+
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef __TRIGGER_ENGINE_H
+#define __TRIGGER_ENGINE_H
+
+#include <QtGlobal>
+#include <valarray>
+#include <vector>
+
+//! Parameters of advanced triggers, in addition to the trigger level and slope
+struct TriggerCondition
+{
+	//! What is looked for on the trigger channel
+	enum Mode
+	{
+		MODE_EDGE = 0, //!< crossing of the level, with hysteresis
+		MODE_PULSE_WIDTH, //!< pulse between two crossings of the level, whose width is compared to time
+		MODE_GLITCH, //!< pulse of any polarity narrower than time
+		MODE_RUNT, //!< pulse crossing the level but not the second level before coming back
+		MODE_SLOPE, //!< transition between the level and the second level, whose duration is compared to time
+		MODE_COUNT //!< number of modes
+	};
+	
+	//! How pulse width and slope duration are compared to time
+	enum Comparison
+	{
+		LESS_THAN = 0, //!< trig if shorter than time
+		GREATER_THAN //!< trig if longer than time
+	};
+	
+	Mode mode; //!< what is looked for
+	unsigned hysteresis; //!< in sample units, distance to the level the signal must reach before a new crossing is detected, or before leaving a region
+	signed short secondValue; //!< second level of runt and slope triggers
+	Comparison comparison; //!< comparison of pulse width and slope duration
+	unsigned time; //!< pulse width, glitch width or slope duration, in us
+	unsigned holdoff; //!< time after a trigger during which events are ignored, in us
+	unsigned eventCount; //!< trig on the Nth qualifying event, 1 trigs on every event
+	
+	TriggerCondition();
+	bool operator==(const TriggerCondition &that) const;
+	bool operator!=(const TriggerCondition &that) const { return !(*this == that); }
+};
+
+//! Combination of conditions on several channels, replacing the trigger channel when enabled
+/*!
+	With AND and OR logic, the pattern is true when all, respectively any,
+	of the conditions hold, and the trigger looks for changes of the
+	pattern as it would for crossings of the trigger channel. With
+	sequence logic, the conditions must become true one after the other
+	in the order the user entered them, and the trigger fires when the
+	last one does.
+*/
+struct TriggerPattern
+{
+	//! How conditions of channels are combined
+	enum Logic
+	{
+		LOGIC_DISABLED = 0, //!< no pattern, trig on the trigger channel
+		LOGIC_AND, //!< all conditions hold
+		LOGIC_OR, //!< any condition holds
+		LOGIC_SEQUENCE, //!< conditions become true one after the other
+		LOGIC_COUNT //!< number of logics
+	};
+	
+	//! Condition on a single channel
+	enum ChannelCondition
+	{
+		CHANNEL_IGNORED = 0, //!< channel is not part of the pattern
+		CHANNEL_ABOVE, //!< channel is above its level
+		CHANNEL_BELOW, //!< channel is below its level
+		CHANNEL_CONDITION_COUNT //!< number of channel conditions
+	};
+	
+	Logic logic; //!< how conditions are combined
+	std::vector<ChannelCondition> conditions; //!< condition of every channel, missing channels are ignored
+	std::vector<signed short> levels; //!< level of every channel, same size as conditions
+	std::vector<unsigned> order; //!< channels in the order their conditions were entered, which is the order of the sequence; channels having a condition but missing from it come last, in increasing order
+	
+	TriggerPattern();
+	bool isEnabled() const { return logic != LOGIC_DISABLED; } //!< Return whether the pattern replaces the trigger channel
+	unsigned channelMask() const;
+	std::vector<unsigned> terms() const;
+	bool operator==(const TriggerPattern &that) const;
+	bool operator!=(const TriggerPattern &that) const { return !(*this == that); }
+};
+
+//! Evaluate a TriggerPattern on blocks of samples of all channels, producing a signal for the TriggerEngine
+/*!
+	The output is OUTPUT_FALSE or OUTPUT_TRUE, so that changes of the
+	pattern are crossings of level 0 without hysteresis. With sequence
+	logic, it is OUTPUT_TRUE only at the samples completing the sequence.
+*/
+class TriggerPatternEvaluator
+{
+public:
+	//! Values of the output
+	enum Output
+	{
+		OUTPUT_FALSE = -1, //!< pattern does not hold
+		OUTPUT_TRUE = 1 //!< pattern holds, or sequence completes
+	};
+	
+	TriggerPatternEvaluator();
+	bool configure(const TriggerPattern &pattern);
+	void reset();
+	void evaluate(const std::valarray<std::valarray<signed short> > &channels, unsigned sampleCount, signed short *output);
+	
+private:
+	void evaluateSequence(const std::valarray<std::valarray<signed short> > &channels, unsigned sampleCount, signed short *output);
+	
+	TriggerPattern pattern; //!< the evaluated pattern
+	std::vector<unsigned> terms; //!< channels having a condition, in sequence order with sequence logic, in increasing order otherwise
+	unsigned termsEnd; //!< one past the highest channel in terms
+	unsigned stage; //!< sequence: index in terms of the condition to wait for
+	bool stageArmed; //!< sequence: whether the condition of stage has been false, so that it can become true
+};
+
+//! State machines detecting trigger events on the samples of the trigger channel
+/*!
+	The engine runs on every sample of the trigger channel, block by
+	block, so that its state stays valid across frames. Every condition
+	is a state machine whose states wait for the signal to go above,
+	below or out of a band of levels; these waits are vectorised scans,
+	so the cost per sample is a few SIMD comparisons whatever the
+	condition, and the state machine only runs at transitions.
+	
+	Edge, pulse width and glitch conditions use the crossings of the
+	level with hysteresis: a rising crossing is detected when the signal
+	goes above the level after having been at or below level minus
+	hysteresis, and conversely. Runt and slope conditions use the
+	transitions between the regions at or below the lower level and at or
+	above the upper level, a region being left only once the signal is
+	further than hysteresis from it.
+*/
+class TriggerEngine
+{
+public:
+	//! Directions of events to look for, can be combined
+	enum Direction
+	{
+		RISING = 0x1, //!< rising edges, positive pulses and runts, rising slopes
+		FALLING = 0x2 //!< falling edges, negative pulses and runts, falling slopes
+	};
+	
+	TriggerEngine();
+	void configure(unsigned directions, signed short value, const TriggerCondition &condition, unsigned samplingRate);
+	void reset();
+	unsigned find(const signed short *samples, unsigned start, unsigned end, unsigned armedFrom, quint64 blockPosition);
+	
+private:
+	//! States of the state machines
+	enum State
+	{
+		STATE_UNKNOWN = 0, //!< not yet in a known region
+		STATE_LOW, //!< at or below the lower level
+		STATE_HIGH, //!< at or above the upper level
+		STATE_LEVEL, //!< exactly at the level without hysteresis (crossings only)
+		STATE_LEFT_LOW, //!< left the lower region, not yet in any region (regions only)
+		STATE_LEFT_HIGH //!< left the upper region, not yet in any region (regions only)
+	};
+	
+	unsigned stepCrossings(const signed short *samples, unsigned i, unsigned end, quint64 blockPosition, bool *event);
+	unsigned stepRegions(const signed short *samples, unsigned i, unsigned end, quint64 blockPosition, bool *event);
+	unsigned step(const signed short *samples, unsigned i, unsigned end, quint64 blockPosition, bool *event);
+	bool crossing(bool rising, quint64 position);
+	
+	// configuration
+	unsigned directions; //!< combination of Direction
+	signed short value; //!< trigger level
+	TriggerCondition condition; //!< trigger condition, times in us
+	unsigned samplingRate; //!< sampling rate, to convert times
+	quint64 time; //!< condition.time in samples
+	quint64 holdoff; //!< condition.holdoff in samples
+	bool useRegions; //!< whether condition uses regions instead of crossings
+	signed short lowLevel; //!< crossings: level minus hysteresis; regions: lower level
+	signed short highLevel; //!< crossings: level plus hysteresis; regions: upper level
+	signed short lowExit; //!< regions: level to go above to leave the lower region
+	signed short highExit; //!< regions: level to go below to leave the upper region
+	
+	// state
+	State state; //!< state of the state machine
+	quint64 lastPosition; //!< position of the last crossing, or of leaving a region
+	bool lastValid; //!< whether lastPosition is valid
+	bool lastRising; //!< whether last crossing was rising
+	quint64 holdoffEnd; //!< events before this position are ignored
+	unsigned eventCounter; //!< number of qualifying events since last trigger
+};
+
+#endif